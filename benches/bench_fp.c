@@ -0,0 +1,125 @@
+#include <gmp.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "fp2.h"
+#include "pprod.h"
+#include "proto_msidh.h"
+
+// Microbenchmarks of the field arithmetic on the MSIDH characteristics.
+// Every operation is repeated on N_ELEMS random elements, results are
+// reported in microseconds per single call.
+
+#define N_ELEMS 64
+
+// Run `stmt` (using index `i`) `reps` times over all elements, print the
+// average time of one call
+#define BENCH_OP(__name, __reps, __stmt)                                       \
+    do {                                                                       \
+        clock_t tic = clock();                                                 \
+        for (int __r = 0; __r < (__reps); __r++) {                             \
+            for (int i = 0; i < N_ELEMS; i++) {                                \
+                __stmt;                                                        \
+            }                                                                  \
+        }                                                                      \
+        clock_t toc = clock();                                                 \
+        double us = 1e6 * ((double)toc - tic) / CLOCKS_PER_SEC;                \
+        printf("%d\t%d\t%s\t%0.3lf\n", t, p_bitsize, __name,                   \
+               us / ((double)(__reps) * N_ELEMS));                             \
+        fflush(stdout);                                                        \
+    } while (0)
+
+void run_benchmark(int t, int f, gmp_randstate_t rs) {
+    mpz_t p, z;
+    mpz_init(p);
+    mpz_init(z);
+
+    pprod_t A, B;
+    pprod_init(&A);
+    pprod_init(&B);
+    msidh_calc_pub_params(p, A, B, t, f);
+    int p_bitsize = mpz_sizeinbase(p, 2);
+    fpchar_setup(p);
+
+    fp_t x[N_ELEMS], r[N_ELEMS];
+    mpz_t xz[N_ELEMS];
+    fp2_t x2[N_ELEMS], r2[N_ELEMS];
+    for (int i = 0; i < N_ELEMS; i++) {
+        fp_init(x[i]);
+        fp_init(r[i]);
+        fp2_init(&x2[i]);
+        fp2_init(&r2[i]);
+
+        mpz_urandomm(z, rs, p);
+        fp_set_mpz(x[i], z);
+        mpz_init_set(xz[i], z);
+        mpz_urandomm(z, rs, p);
+        fp_set_mpz(x2[i]->a, z);
+        mpz_urandomm(z, rs, p);
+        fp_set_mpz(x2[i]->b, z);
+    }
+
+    // Prevents the compiler from dropping the predicate calls
+    volatile int sink = 0;
+
+    BENCH_OP("fp_mul", 1000, fp_mul(r[i], x[i], x[(i + 1) % N_ELEMS]));
+    BENCH_OP("fp_sqr", 1000, fp_mul(r[i], x[i], x[i]));
+    // Products in groups of 4, time is reported per single product
+    fp_ptr res_ptr[N_ELEMS];
+    fp_srcptr x_ptr[N_ELEMS], y_ptr[N_ELEMS];
+    for (int i = 0; i < N_ELEMS; i++) {
+        res_ptr[i] = r[i];
+        x_ptr[i] = x[i];
+        y_ptr[i] = x[(i + 1) % N_ELEMS];
+    }
+    BENCH_OP("fp_mul_batch", 250,
+             if (i % 4 == 0) fp_mul_batch(res_ptr + i, x_ptr + i, y_ptr + i, 4));
+    // Reference: reduction of the full mpz product as done by the gmp backend
+    BENCH_OP("mpz_mul+mpz_mod", 1000, {
+        mpz_mul(z, xz[i], xz[(i + 1) % N_ELEMS]);
+        mpz_mod(z, z, p);
+    });
+    BENCH_OP("fp_inv", 20, fp_inv(r[i], x[i]));
+    // Reference: variable-time inversion of the gmp backend
+    BENCH_OP("mpz_invert", 20, mpz_invert(z, xz[i], p));
+    BENCH_OP("fp_sqrt", 2, fp_sqrt(r[i], x[i]));
+    BENCH_OP("fp_is_square", 20, sink += fp_is_square(x[i]));
+    BENCH_OP("fp2_mul", 500,
+             fp2_mul_unsafe(r2[i], x2[i], x2[(i + 1) % N_ELEMS]));
+    BENCH_OP("fp2_inv", 20, fp2_inv_unsafe(r2[i], x2[i]));
+    BENCH_OP("fp2_is_square", 20, sink += fp2_is_square(x2[i]));
+    BENCH_OP("fp2_sqrt", 2, sink += fp2_sqrt(r2[i], x2[i]));
+    (void)sink;
+
+    for (int i = 0; i < N_ELEMS; i++) {
+        fp_clear(x[i]);
+        fp_clear(r[i]);
+        mpz_clear(xz[i]);
+        fp2_clear(&x2[i]);
+        fp2_clear(&r2[i]);
+    }
+
+    fpchar_clear();
+    pprod_clear(&A);
+    pprod_clear(&B);
+    mpz_clear(p);
+    mpz_clear(z);
+}
+
+int main() {
+    printf("# C Microbenchmark results for Fp and Fp^2 arithmetic\n");
+    printf("t\tp_bitsize\top\tus_per_op\n");
+
+    gmp_randstate_t rs;
+    gmp_randinit_mt(rs);
+    gmp_randseed_ui(rs, 0xbe7c);
+
+    // Same (t, f) pairs as in BENCH_TASKS of bench_msidh.h
+    int params[][2] = {{100, 91}, {120, 52}, {200, 18}, {300, 75}, {400, 229}};
+    const int N_RUNS = sizeof(params) / sizeof(params[0]);
+    for (int i = 0; i < N_RUNS; i++) {
+        run_benchmark(params[i][0], params[i][1], rs);
+    }
+
+    gmp_randclear(rs);
+}
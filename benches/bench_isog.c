@@ -0,0 +1,130 @@
+#include <gmp.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "arena.h"
+#include "ec_mont.h"
+#include "fp2.h"
+#include "isog_mont.h"
+#include "pprod.h"
+#include "proto_msidh.h"
+
+// Single odd-degree isogeny step as taken by ISOG_chain: codomain and images
+// of N_PUSH points, computed with KPS and with the √élu formulas. Results are
+// reported in microseconds per step, the degree where the second column gets
+// below the first one is the crossover used for VELUSQRT_MIN_DEGREE. Kernel
+// is a random point, the cost does not depend on its order.
+
+#define N_PUSH 4
+
+static double step_kps(unsigned int degree, const point_t K, point_t *pts,
+                       const fp2_t A24p, const fp2_t C24, int reps) {
+    clock_t tic = clock();
+    for (int r = 0; r < reps; r++) {
+        arena_frame_t frame = arena_push();
+        fp2_t A_ = arena_fp2(), C_ = arena_fp2();
+        struct point_vec kpts;
+        arena_point_vec(&kpts, KPS_DEG2SIZE(degree));
+        KPS(&kpts, K, A24p, C24);
+        prepare_kernel_points(&kpts);
+        aISOG_curve_KPS(A_, C_, A24p, C24, &kpts);
+        xISOG_odd_batch(pts, &kpts, pts, N_PUSH);
+        arena_pop(frame);
+    }
+    clock_t toc = clock();
+    return 1e6 * ((double)toc - tic) / CLOCKS_PER_SEC / reps;
+}
+
+static double step_sqrt(unsigned int degree, const point_t K, point_t *pts,
+                        const fp2_t A24p, const fp2_t C24, int reps) {
+    clock_t tic = clock();
+    for (int r = 0; r < reps; r++) {
+        arena_frame_t frame = arena_push();
+        fp2_t A24p_ = arena_fp2(), C24_ = arena_fp2();
+        struct kps_sqrt ks;
+        KPS_sqrt(&ks, K, A24p, C24, degree);
+        aISOG_curve_sqrt(A24p_, C24_, &ks);
+        xISOG_sqrt_batch(pts, &ks, pts, N_PUSH);
+        arena_pop(frame);
+    }
+    clock_t toc = clock();
+    return 1e6 * ((double)toc - tic) / CLOCKS_PER_SEC / reps;
+}
+
+static void rand_fp2(fp2_t x, const mpz_t p, gmp_randstate_t rs, mpz_t z) {
+    mpz_urandomm(z, rs, p);
+    fp_set_mpz(x->a, z);
+    mpz_urandomm(z, rs, p);
+    fp_set_mpz(x->b, z);
+}
+
+void run_benchmark(int t, int f, gmp_randstate_t rs) {
+    mpz_t p, z;
+    mpz_init(p);
+    mpz_init(z);
+
+    pprod_t A, B;
+    pprod_init(&A);
+    pprod_init(&B);
+    msidh_calc_pub_params(p, A, B, t, f);
+    int p_bitsize = mpz_sizeinbase(p, 2);
+    fpchar_setup(p);
+
+    fp2_t A24p, C24;
+    fp2_init(&A24p);
+    fp2_init(&C24);
+    rand_fp2(A24p, p, rs, z);
+    rand_fp2(C24, p, rs, z);
+
+    point_t K, pts[N_PUSH];
+    point_init(&K);
+    rand_fp2(K->X, p, rs, z);
+    rand_fp2(K->Z, p, rs, z);
+    for (int i = 0; i < N_PUSH; i++) {
+        point_init(&pts[i]);
+        rand_fp2(pts[i]->X, p, rs, z);
+        rand_fp2(pts[i]->Z, p, rs, z);
+    }
+
+    unsigned int degrees[] = {13,  31,  61,  83,  103, 151,  211,  307,
+                              401, 601, 809, 1201, 2003, 3001, 4409};
+    for (size_t i = 0; i < sizeof(degrees) / sizeof(degrees[0]); i++) {
+        // Roughly the same time for each degree
+        int reps = 20000 / degrees[i] + 1;
+        double us_kps = step_kps(degrees[i], K, pts, A24p, C24, reps);
+        double us_sqrt = step_sqrt(degrees[i], K, pts, A24p, C24, reps);
+        printf("%d\t%d\t%u\t%0.1lf\t%0.1lf\n", t, p_bitsize, degrees[i],
+               us_kps, us_sqrt);
+        fflush(stdout);
+    }
+
+    for (int i = 0; i < N_PUSH; i++) {
+        point_clear(&pts[i]);
+    }
+    point_clear(&K);
+    fp2_clear(&A24p);
+    fp2_clear(&C24);
+    fpchar_clear();
+    pprod_clear(&A);
+    pprod_clear(&B);
+    mpz_clear(p);
+    mpz_clear(z);
+}
+
+int main() {
+    printf("# C Benchmark of the odd-degree isogeny step, KPS against √élu\n");
+    printf("t\tp_bitsize\tdegree\tus_kps\tus_sqrt\n");
+
+    gmp_randstate_t rs;
+    gmp_randinit_mt(rs);
+    gmp_randseed_ui(rs, 0x150);
+
+    // Same (t, f) pairs as in BENCH_TASKS of bench_msidh.h
+    int params[][2] = {{100, 91}, {200, 18}, {400, 229}};
+    const int N_RUNS = sizeof(params) / sizeof(params[0]);
+    for (int i = 0; i < N_RUNS; i++) {
+        run_benchmark(params[i][0], params[i][1], rs);
+    }
+
+    gmp_randclear(rs);
+}
@@ -8,6 +8,7 @@
 #include <time.h>
 
 #include "fp2.h"
+#include "gmp_alloc.h"
 #include "proto_msidh.h"
 
 #define N_REPS 5
@@ -3190,6 +3191,9 @@ struct benchmark_data {
     int p_bitsize;
     float timings[N_REPS];
     float sum, average, median, variance, stddev;
+    // GMP allocation requests of single msidh_key_exchange and the number of
+    // them which reached malloc, see gmp_alloc.h
+    size_t n_allocs, n_sys_allocs;
 };
 
 int comp_times(const void *a, const void *b) {
@@ -3241,6 +3245,13 @@ void run_benchmark(const struct bench_task *bt, struct benchmark_data *data) {
     // Copy the params from const "bt_array"
     params.t = bt->t;
     params.f = bt->f;
+
+    // Field elements can be parsed only when the characteristic is known,
+    // alice state is used as a temporary storage for public params
+    msidh_calc_pub_params(alice.p, alice.A, alice.B, bt->t, bt->f);
+    fpchar_clear_if_set();
+    fpchar_setup(alice.p);
+
     fp2_set_str(params.a, bt->a_str);
     fp2_set_str(params.xP, bt->xP_str);
     fp2_set_str(params.xQ, bt->xQ_str);
@@ -3252,10 +3263,15 @@ void run_benchmark(const struct bench_task *bt, struct benchmark_data *data) {
         msidh_get_pubkey(&alice, &alice_pk);
 
         // Calculate time for only one party
+        struct gmp_alloc_stats st;
         clock_t tic = clock();
         msidh_state_prepare(&bob, &params, 1);
+        gmp_alloc_reset_stats();
         msidh_key_exchange(&bob, &alice_pk);
+        gmp_alloc_get_stats(&st);
         clock_t toc = clock();
+        data->n_allocs = st.n_alloc + st.n_realloc;
+        data->n_sys_allocs = st.n_sys;
 
         msidh_get_pubkey(&bob, &bob_pk);
         msidh_key_exchange(&alice, &bob_pk);
@@ -2,16 +2,19 @@
 #include <stdio.h>
 
 int main() {
+    // Count the allocations, freed mpz limbs are reused
+    gmp_alloc_setup(GMP_ALLOC_POOL);
 
     printf("# C Benchmark results for MSIDH protocol\n");
-    printf("n\tt\tp_bitsize\tavg\tstddev\tn_reps\n");
+    printf("n\tt\tp_bitsize\tavg\tstddev\tn_reps\tallocs\tsys_allocs\n");
 
     struct benchmark_data bd;
 
     for (int j = 0; j < N_BENCHMARKS; j++) {
         run_benchmark(&BENCH_TASKS[j], &bd);
-        printf("%d\t%d\t%d\t%0.2lf\t%0.2lf\t%d\n", j + 1, BENCH_TASKS[j].t,
-               bd.p_bitsize, bd.average, bd.stddev, N_REPS);
+        printf("%d\t%d\t%d\t%0.2lf\t%0.2lf\t%d\t%zu\t%zu\n", j + 1,
+               BENCH_TASKS[j].t, bd.p_bitsize, bd.average, bd.stddev, N_REPS,
+               bd.n_allocs, bd.n_sys_allocs);
         fflush(stdout);
     }
 }
\ No newline at end of file
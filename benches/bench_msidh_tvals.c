@@ -2,9 +2,11 @@
 #include <stdio.h>
 
 int main() {
+    // Count the allocations, freed mpz limbs are reused
+    gmp_alloc_setup(GMP_ALLOC_POOL);
 
     printf("# C Benchmark results for MSIDH protocol\n");
-    printf("n\tt\tp_bitsize\tavg\tstddev\tn_reps\n");
+    printf("n\tt\tp_bitsize\tavg\tstddev\tn_reps\tallocs\tsys_allocs\n");
 
     int t_values[] = {100, 200, 300, 400};
     const int N_RUNS = sizeof(t_values) / sizeof(int);
@@ -19,8 +21,9 @@ int main() {
 
             t_found = 1;
             run_benchmark(&BENCH_TASKS[j], &bd);
-            printf("%d\t%d\t%d\t%0.2lf\t%0.2lf\t%d\n", i + 1, t_values[i],
-                   bd.p_bitsize, bd.average, bd.stddev, N_REPS);
+            printf("%d\t%d\t%d\t%0.2lf\t%0.2lf\t%d\t%zu\t%zu\n", i + 1,
+                   t_values[i], bd.p_bitsize, bd.average, bd.stddev, N_REPS,
+                   bd.n_allocs, bd.n_sys_allocs);
             fflush(stdout);
         }
 
@@ -0,0 +1,190 @@
+#include <gmp.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "arena.h"
+#include "ec_mont.h"
+#include "fp2.h"
+#include "isog_mont.h"
+#include "pprod.h"
+#include "proto_msidh.h"
+
+// Costs of the curve operations used by the chain strategy, measured in the
+// multiplications of Fp. Rounded results of this benchmark are the
+// STRATEGY_COST_* constants of src/isog_mont.c. Odd-degree image is fitted
+// as ISOG_KPT * (degree - 1) / 2 + ISOG_BASE from two degrees below
+// VELUSQRT_MIN_DEGREE, √élu image is divided by b log2(b). Points are
+// random, the costs do not depend on their order.
+
+#define N_PUSH 4
+#define N_ROUNDS 5
+
+// Run `stmt` `reps` times in N_ROUNDS rounds, store the average time of one
+// run in the fastest round in `us`
+#define TIME_OP(__us, __reps, __stmt)                                          \
+    do {                                                                       \
+        __us = -1;                                                             \
+        for (int __k = 0; __k < N_ROUNDS; __k++) {                             \
+            clock_t tic = clock();                                             \
+            for (int __r = 0; __r < (__reps); __r++) {                         \
+                __stmt;                                                        \
+            }                                                                  \
+            clock_t toc = clock();                                             \
+            double __t = 1e6 * ((double)toc - tic) / CLOCKS_PER_SEC;           \
+            if (__us < 0 || __t / (__reps) < __us) {                           \
+                __us = __t / (__reps);                                         \
+            }                                                                  \
+        }                                                                      \
+    } while (0)
+
+static void rand_fp2(fp2_t x, const mpz_t p, gmp_randstate_t rs, mpz_t z) {
+    mpz_urandomm(z, rs, p);
+    fp_set_mpz(x->a, z);
+    mpz_urandomm(z, rs, p);
+    fp_set_mpz(x->b, z);
+}
+
+// Image of one point under the odd-degree isogeny with prepared kernel points
+static double time_isog_odd(unsigned int degree, const point_t K, point_t Q,
+                            const point_t P, const fp2_t A24p,
+                            const fp2_t C24, int reps) {
+    arena_frame_t frame = arena_push();
+    struct point_vec kpts;
+    arena_point_vec(&kpts, KPS_DEG2SIZE(degree));
+    KPS(&kpts, K, A24p, C24);
+    prepare_kernel_points(&kpts);
+    double us;
+    TIME_OP(us, reps, xISOG_odd(Q, &kpts, P));
+    arena_pop(frame);
+    return us;
+}
+
+// Image of one point under the √élu isogeny, batch of N_PUSH points
+static double time_isog_sqrt(unsigned int degree, const point_t K,
+                             point_t *pts, const fp2_t A24p, const fp2_t C24,
+                             int reps) {
+    arena_frame_t frame = arena_push();
+    struct kps_sqrt ks;
+    KPS_sqrt(&ks, K, A24p, C24, degree);
+    double us;
+    TIME_OP(us, reps, xISOG_sqrt_batch(pts, &ks, pts, N_PUSH));
+    arena_pop(frame);
+    return us / N_PUSH;
+}
+
+static void print_cost(int t, int p_bitsize, const char *name, double us,
+                       double us_mul) {
+    printf("%d\t%d\t%s\t%0.3lf\t%0.1lf\n", t, p_bitsize, name, us, us / us_mul);
+    fflush(stdout);
+}
+
+void run_benchmark(int t, int f, gmp_randstate_t rs) {
+    mpz_t p, z;
+    mpz_init(p);
+    mpz_init(z);
+
+    pprod_t A, B;
+    pprod_init(&A);
+    pprod_init(&B);
+    msidh_calc_pub_params(p, A, B, t, f);
+    int p_bitsize = mpz_sizeinbase(p, 2);
+    fpchar_setup(p);
+
+    fp2_t A24p, C24;
+    fp2_init(&A24p);
+    fp2_init(&C24);
+    rand_fp2(A24p, p, rs, z);
+    rand_fp2(C24, p, rs, z);
+
+    point_t K, Q, pts[N_PUSH];
+    point_init(&K);
+    point_init(&Q);
+    rand_fp2(K->X, p, rs, z);
+    rand_fp2(K->Z, p, rs, z);
+    for (int i = 0; i < N_PUSH; i++) {
+        point_init(&pts[i]);
+        rand_fp2(pts[i]->X, p, rs, z);
+        rand_fp2(pts[i]->Z, p, rs, z);
+    }
+
+    fp_t x, y;
+    fp_init(x);
+    fp_init(y);
+    mpz_urandomm(z, rs, p);
+    fp_set_mpz(x, z);
+    mpz_urandomm(z, rs, p);
+    fp_set_mpz(y, z);
+
+    double us_mul, us;
+    TIME_OP(us_mul, 100000, fp_mul(x, x, y));
+    print_cost(t, p_bitsize, "fp_mul", us_mul, us_mul);
+
+    // Multiplier with 31 bits, the cost is reported per bit
+    const long int m = 0x5a5a5a5b;
+    TIME_OP(us, 1000, xLADDER_int(Q, pts[0], m, A24p, C24));
+    print_cost(t, p_bitsize, "LADDER_STEP", us / 31, us_mul);
+
+    TIME_OP(us, 10000, xDBL(Q, pts[0], A24p, C24));
+    print_cost(t, p_bitsize, "DBL", us, us_mul);
+
+    point_t K2;
+    point_init(&K2);
+    point_set(K2, K);
+    prepare_isog2_kernel(K2);
+    TIME_OP(us, 10000, xISOG2_prep(Q, K2, pts[0]));
+    print_cost(t, p_bitsize, "ISOG2", us, us_mul);
+    point_clear(&K2);
+
+    const unsigned int d1 = 13, d2 = 211;
+    double us1 = time_isog_odd(d1, K, Q, pts[0], A24p, C24, 2000);
+    double us2 = time_isog_odd(d2, K, Q, pts[0], A24p, C24, 200);
+    double us_kpt = (us2 - us1) / (KPS_DEG2SIZE(d2) - KPS_DEG2SIZE(d1));
+    print_cost(t, p_bitsize, "ISOG_KPT", us_kpt, us_mul);
+    print_cost(t, p_bitsize, "ISOG_BASE", us1 - us_kpt * KPS_DEG2SIZE(d1),
+               us_mul);
+
+    // b = floor(sqrt(degree - 1) / 2) as in KPS_sqrt
+    const unsigned int d3 = 2003;
+    unsigned int b = 0, bits = 0;
+    while ((2 * b + 2) * (2 * b + 2) <= d3 - 1) {
+        b++;
+    }
+    while (b >> bits) {
+        bits++;
+    }
+    us = time_isog_sqrt(d3, K, pts, A24p, C24, 20);
+    print_cost(t, p_bitsize, "ISOG_SQRT", us / (b * bits), us_mul);
+
+    for (int i = 0; i < N_PUSH; i++) {
+        point_clear(&pts[i]);
+    }
+    point_clear(&K);
+    point_clear(&Q);
+    fp_clear(x);
+    fp_clear(y);
+    fp2_clear(&A24p);
+    fp2_clear(&C24);
+    fpchar_clear();
+    pprod_clear(&A);
+    pprod_clear(&B);
+    mpz_clear(p);
+    mpz_clear(z);
+}
+
+int main() {
+    printf("# C Benchmark of the costs used by the isogeny chain strategy\n");
+    printf("t\tp_bitsize\top\tus_per_op\tfp_mul_per_op\n");
+
+    gmp_randstate_t rs;
+    gmp_randinit_mt(rs);
+    gmp_randseed_ui(rs, 0x57a7);
+
+    // Same (t, f) pairs as in BENCH_TASKS of bench_msidh.h
+    int params[][2] = {{100, 91}, {200, 18}, {400, 229}};
+    const int N_RUNS = sizeof(params) / sizeof(params[0]);
+    for (int i = 0; i < N_RUNS; i++) {
+        run_benchmark(params[i][0], params[i][1], rs);
+    }
+
+    gmp_randclear(rs);
+}
@@ -69,8 +69,8 @@ int main(int argc, char *argv[]) {
     printf("%s Isogeny Handshake...\n", PREFIX_RUN);
 
     // Run M-SIDH handshake with specified level
-    // Shared secret can have variable length (coefficient)
-    char *shared_secret = NULL;
+    // Shared secret has the fixed length of an encoded fp2 element
+    unsigned char *shared_secret = NULL;
     size_t shared_secret_len = 0;
     int status = msidh_handshake(sock_fd, 0, &shared_secret, &shared_secret_len, MSIDH_T150);
     if (status < 0) {
@@ -79,7 +79,7 @@ int main(int argc, char *argv[]) {
     printf("%s Isogeny Handshake...\n", PREFIX_RUN);
 
     // Run MSIDH handshake with specified level
-    char *shared_secret = NULL;
+    unsigned char *shared_secret = NULL;
     size_t shared_secret_len = 0;
 
     int status = msidh_handshake(client_fd, 1, &shared_secret, &shared_secret_len, MSIDH_T150);
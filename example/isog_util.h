@@ -19,9 +19,9 @@ const char *PREFIX_RUN = "\x1b[33m[%]:\x1b[0m";
 #define COLCTX(str) "\x1b[36m" str "\x1b[0m"
 
 /*
- * @brief Derive the symmetric shared key for both sides using shared secret from the M-SIDH. This function frees the memory
+ * @brief Derive the symmetric shared key for both sides using shared secret from the M-SIDH, i.e. the canonical bytes of the j-invariant. This function frees the memory
  */
-int derive_key(unsigned char encryption_key[SHA256_DIGEST_LENGTH], char **shared_secret, size_t *shared_secret_len) {
+int derive_key(unsigned char encryption_key[SHA256_DIGEST_LENGTH], unsigned char **shared_secret, size_t *shared_secret_len) {
     OSSL_PARAM params[4], *p = params;
     EVP_KDF *kdf = EVP_KDF_fetch(NULL, "HKDF", NULL);
     EVP_KDF_CTX *kctx = EVP_KDF_CTX_new(kdf);
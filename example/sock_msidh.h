@@ -166,96 +166,75 @@ int recv_u32(int fd, uint32_t *val) {
     return 0;
 }
 
-int send_fp2(int fd, fp2_t x) {
-    size_t buff_size = fp2_write_size(x);
-    char *buffer = malloc(buff_size);
-    if (buffer == NULL) {
-        return -1;
-    }
-
-    fp2_write(x, buffer);
-    int ret = send_u32(fd, buff_size);
-
-    // Something went wrong
-    if (ret == -1) {
-        free(buffer);
-        return ret;
+// Write all len bytes, retrying on short writes
+int send_all(int fd, const unsigned char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n <= 0) {
+            return -1;
+        }
+        buf += n;
+        len -= n;
     }
+    return 0;
+}
 
-    // Send fp2 stored as "b*i + a" decimal representation
-    if (write(fd, buffer, buff_size) != (ssize_t)buff_size) {
-        ret = -1;
+// Read exactly len bytes, retrying on short reads
+int recv_all(int fd, unsigned char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = read(fd, buf, len);
+        if (n <= 0) {
+            return -1;
+        }
+        buf += n;
+        len -= n;
     }
-
-    free(buffer);
-    return ret;
+    return 0;
 }
 
-int recv_fp2(int fd, fp2_t x) {
-    uint32_t buff_size;
-    if (0 != recv_u32(fd, &buff_size)) {
+// Data are received under the field context of the local parameters, so a
+// peer using different t or f is detected by the length of its message
+int recv_msidh_data(int fd, struct msidh_data *md) {
+    uint32_t len;
+    if (0 != recv_u32(fd, &len))
         return -1;
-    }
-
-    char *buffer = malloc(buff_size);
-    if (buffer == NULL) {
+    if (len != msidh_data_packed_size()) {
         return -1;
     }
 
-    if (read(fd, buffer, buff_size) != buff_size) {
-        free(buffer);
+    unsigned char *buffer = malloc(len);
+    if (buffer == NULL) {
         return -1;
     }
 
-    int ret = fp2_set_str(x, buffer);
+    int ret = recv_all(fd, buffer, len);
+    if (ret == 0)
+        ret = msidh_data_unpack(md, buffer);
     free(buffer);
     return ret;
 }
 
-int recv_msidh_data(int fd, struct msidh_data *md) {
-    if (0 != recv_u32(fd, (uint32_t *)&md->t))
-        return -1;
-    if (md->t < MSIDH_TMIN || md->t >= MSIDH_TMAX) {
-        return -1;
-    }
-    if (0 != recv_u32(fd, (uint32_t *)&md->f))
-        return -1;
-    if (md->f <= 0) {
+int send_msidh_data(int fd, struct msidh_data *md) {
+    size_t len = msidh_data_packed_size();
+    unsigned char *buffer = malloc(len);
+    if (buffer == NULL) {
         return -1;
     }
 
-    if (0 != recv_fp2(fd, md->a))
-        return -1;
-    if (0 != recv_fp2(fd, md->xP))
-        return -1;
-    if (0 != recv_fp2(fd, md->xQ))
-        return -1;
-    if (0 != recv_fp2(fd, md->xR))
-        return -1;
-    return 0;
-}
-
-int send_msidh_data(int fd, struct msidh_data *md) {
-    if (0 != send_u32(fd, md->t))
-        return -1;
-    if (0 != send_u32(fd, md->f))
-        return -1;
-    if (0 != send_fp2(fd, md->a))
-        return -1;
-    if (0 != send_fp2(fd, md->xP))
-        return -1;
-    if (0 != send_fp2(fd, md->xQ))
-        return -1;
-    if (0 != send_fp2(fd, md->xR))
-        return -1;
-    return 0;
+    // Fixed-length binary encoding prefixed by its length
+    msidh_data_pack(buffer, md);
+    int ret = send_u32(fd, len);
+    if (ret == 0)
+        ret = send_all(fd, buffer, len);
+    free(buffer);
+    return ret;
 }
 
 /* 
- * @brief Perform the M-SIDH handshake, store the decimal representation of the shared secret in `shared_secret` variable. Programmer is responsible for freeing the allocated memory.
+ * @brief Perform the M-SIDH handshake, store the canonical encoding of the shared j-invariant in `shared_secret` variable, see `msidh_get_shared_secret`. Programmer is responsible for freeing the allocated memory.
 */
 int msidh_handshake(int fd, int is_server,
-                    char **shared_secret, 
+                    unsigned char **shared_secret,
                     size_t *shared_secret_len,
                     enum MSIDH_LEVEL level) {
     if ((unsigned)level >= MSIDH_NLEVELS) {
@@ -270,19 +249,25 @@ int msidh_handshake(int fd, int is_server,
     msidh_data_init(&pk_self);
     msidh_data_init(&pk_other);
 
+    struct msidh_state msidh;
+    msidh_state_init(&msidh);
+
     // Parse the given MSIDH level
     const struct msidh_const_data *mcd = &MSIDH_PARAMS[level];
     params.t = mcd->t;
     params.f = mcd->f;
+
+    // Field elements can be parsed only when the characteristic is known
+    msidh_calc_pub_params(msidh.p, msidh.A, msidh.B, mcd->t, mcd->f);
+    fpchar_clear_if_set();
+    fpchar_setup(msidh.p);
+
     fp2_set_str(params.a, mcd->a_str);
     fp2_set_str(params.xP, mcd->xP_str);
     fp2_set_str(params.xQ, mcd->xQ_str);
     fp2_set_str(params.xR, mcd->xR_str);
 
     // Alice: Send public key information
-    struct msidh_state msidh;
-    msidh_state_init(&msidh);
-
     msidh_state_prepare(&msidh, &params, is_server);
     msidh_get_pubkey(&msidh, &pk_self);
     int ret = 0;
@@ -310,10 +295,10 @@ int msidh_handshake(int fd, int is_server,
 
     msidh_key_exchange(&msidh, &pk_other);
 
-    // Convert obtained j-invariant into SHA256 digest
-    *shared_secret_len = fp2_write_size(msidh.j_inv);
-    *shared_secret = (char*) malloc(*shared_secret_len);
-    fp2_write(msidh.j_inv, *shared_secret);
+    // Fixed-length bytes of the j-invariant are the input of the KDF
+    *shared_secret_len = msidh_shared_secret_size(&msidh);
+    *shared_secret = malloc(*shared_secret_len);
+    msidh_get_shared_secret(&msidh, *shared_secret);
 
 exit:
     // Clear all and return
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "ec_point_xz.h"
+
+// Per-thread stack of pre-initialized temporaries used by the curve and
+// isogeny functions instead of the init/clear pairs on every call. A function
+// opens a frame, borrows the registers it needs and returns all of them at
+// once by popping the frame:
+//
+//   arena_frame_t f = arena_push();
+//   point_t T = arena_point();
+//   struct ec_scratch *s = arena_scratch();
+//   ...
+//   arena_pop(f);
+//
+// Frames nest in the same way as the calls do. Registers are initialized once
+// and keep the memory of their coordinates between the frames, therefore
+// borrowing does not allocate after the first call of the same depth. Value
+// of a borrowed register is unspecified. Registers of the mont backend hold
+// FP_MAX_LIMBS limbs, so the arena can be shared by all characteristics used
+// in the thread. The arena is released at the exit of its thread.
+
+// Top of the arena, registers borrowed afterwards are returned by `arena_pop`
+typedef struct {
+    size_t n_fp2, n_fp2_batch, n_points, n_scratch, n_vecs;
+    size_t raw_chunk, raw_used;
+} arena_frame_t;
+
+/*
+ * @brief Open a new frame in the arena of the calling thread
+ */
+arena_frame_t arena_push();
+
+/*
+ * @brief Return every register borrowed since `arena_push` returned frame.
+ * Frames must be popped in the reverse order of pushing.
+ */
+void arena_pop(arena_frame_t frame);
+
+// Borrow single fp2 element
+fp2_t arena_fp2();
+
+// Borrow array of FP2_MUL_BATCH fp2 scratches, as used by fp2_mul_batch
+struct fp2_scratch *arena_fp2_scratch_batch();
+
+// Borrow point
+point_t arena_point();
+
+// Borrow curve scratch
+struct ec_scratch *arena_scratch();
+
+/*
+ * @brief Borrow vector of n fp2 elements. Vectors keep the largest length
+ * they were borrowed with, so a vector is resized only when a longer one is
+ * requested at the same position of the stack.
+ */
+fp2_vec_t arena_fp2_vec(size_t n);
+
+// Borrow vector of n points, see `arena_fp2_vec`
+void arena_point_vec(struct point_vec *v, size_t n);
+
+// Borrow vector of n fp elements, the coordinates of the fp2 vector of
+// ceil(n / 2) elements, see `arena_fp2_vec`
+fp_t *arena_fp_vec(size_t n);
+
+/*
+ * @brief Borrow uninitialized memory of given size, e.g. array of the handles
+ * of borrowed registers. Memory is aligned to 16 bytes.
+ */
+void *arena_alloc(size_t size);
+
+/*
+ * @brief Free the arena of the calling thread before its exit, no frame can
+ * be open. Next push creates a new arena.
+ */
+void arena_release();
@@ -11,6 +11,12 @@
  */
 void xDBL(point_t R, const point_t P, const fp2_t A24p, const fp2_t C24);
 
+/*
+ * @brief Same as xDBL, temporaries are taken from the scratch: t[0..1]
+ */
+void xDBL_scr(point_t R, const point_t P, const fp2_t A24p, const fp2_t C24,
+              struct ec_scratch *s);
+
 /*
  * @brief Calculate x-coordinate of the point multiplied by the power of 2 x(R)
  * = x([2^e]P). Function is argument-safe for R = P.
@@ -23,13 +29,55 @@ void xADD(point_t PQsum, const point_t P, const point_t Q,
           const point_t PQdiff);
 
 /*
- * @brief Calculate x coordinate of R = [m]P using Montgomery Ladder algorithm.
- *  Function is not argsafe for R0 = P.
+ * @brief Same as xADD, temporaries are taken from the scratch: t[0..3] and
+ * w[0..1]
+ */
+void xADD_scr(point_t PQsum, const point_t P, const point_t Q,
+              const point_t PQdiff, struct ec_scratch *s);
+
+/*
+ * @brief Calculate P = [2]P and Q = P + Q given PQdiff = P - Q, with the
+ * doubling and the addition sharing XP + ZP and XP - ZP. Points must be
+ * distinct.
+ */
+void xDBLADD(point_t P, point_t Q, const point_t PQdiff, const fp2_t A24p,
+             const fp2_t C24);
+
+/*
+ * @brief Same as xDBLADD, temporaries are taken from the scratch: t[0..3]
+ * and w[0..1]
+ */
+void xDBLADD_scr(point_t P, point_t Q, const point_t PQdiff, const fp2_t A24p,
+                 const fp2_t C24, struct ec_scratch *s);
+
+/*
+ * @brief Same as xDBLADD_scr on the curve with C24 = 1, A24 = (A + 2) / 4. If
+ * affine is set, PQdiff must be normalized (Z = 1) and the step saves one more
+ * multiplication.
+ */
+void xDBLADD_norm_scr(point_t P, point_t Q, const point_t PQdiff,
+                      const fp2_t A24, int affine, struct ec_scratch *s);
+
+/*
+ * @brief Calculate x coordinate of R = [m]P using Montgomery Ladder algorithm,
+ * without branching on the bits of m. Function is not argsafe for R0 = P.
+ * Steps are cheaper for the normalized P and for C24 = 1, for the long scalars
+ * the curve is normalized by the ladder.
  * @ref https://eprint.iacr.org/2017/212.pdf
  */
 void xLADDER(point_t R0, const point_t P, const mpz_t m, const fp2_t A24p,
              const fp2_t C24);
 
+/*
+ * @brief Calculate R[i] = [m]P[i] for i < k with one ladder, walking the bits
+ * of m once for all points. For the long scalars the points and the curve are
+ * normalized with a single inversion (points cannot have Z = 0) and the
+ * products of all points in each step are passed to `fp2_mul_batch` together.
+ * Function is argument-safe for R[i] = P[i].
+ */
+void xLADDER_multi(point_t *R, const point_t *P, size_t k, const mpz_t m,
+                   const fp2_t A24p, const fp2_t C24);
+
 /*
  * @brief Calculate x coordinate of R = [m]P using Montgomery Ladder algorithm
  * with m fitting in 63 bits. Function is not argsafe for R0 = P
@@ -38,14 +86,77 @@ void xLADDER(point_t R0, const point_t P, const mpz_t m, const fp2_t A24p,
 void xLADDER_int(point_t R0, const point_t P, long int m, const fp2_t A24p,
                  const fp2_t C24);
 
+/*
+ * @brief Same as xLADDER_int, temporaries are taken from the scratch: t[0..3],
+ * w[0..1] and R
+ */
+void xLADDER_int_scr(point_t R0, const point_t P, long int m,
+                     const fp2_t A24p, const fp2_t C24, struct ec_scratch *s);
+
+/*
+ * @brief Calculate P = P + [m]Q given PQdiff = P - Q, all three points are
+ * overwritten. The mpz variant does not branch on the bits of m and works on
+ * the normalized curve (C24 = 1) for the long scalars.
+ */
 void xLADDER3PT_int(point_t P, point_t Q, point_t PQdiff, long int m,
                     const fp2_t A24p, const fp2_t C24);
 
 void xLADDER3PT(point_t P, point_t Q, point_t PQdiff, const mpz_t m,
                 const fp2_t A24p, const fp2_t C24);
 
+// Precomputed affine x([2^i]Q) for i < n of a fixed base Q, used by the
+// right-to-left ladders instead of the doublings. Table depends only on Q and
+// the curve, so it can be built once per public parameters and kept.
+struct ladder_table {
+    fp2_vec_t X;
+    size_t n;
+};
+
+// Initialize empty table (n = 0)
+void ladder_table_init(struct ladder_table *T);
+
+void ladder_table_clear(struct ladder_table *T);
+
+/*
+ * @brief Fill the table with x([2^i]Q) for i < n_bits, so it serves scalars
+ * below 2^n_bits. Points [2^i]Q cannot be the point at infinity. Costs n_bits
+ * doublings and a single inversion.
+ */
+void ladder_table_build(struct ladder_table *T, const point_t Q,
+                        size_t n_bits, const fp2_t A24p, const fp2_t C24);
+
+/*
+ * @brief Same as xLADDER3PT with Q given by the table: P = P + [m]Q, PQdiff is
+ * overwritten. Each bit costs a single differential addition with the affine
+ * x([2^i]Q) (4M + 2S), all T->n bits are processed without branching on them.
+ * @ref Faz-Hernandez et al.: "A faster software implementation of the
+ * supersingular isogeny Diffie-Hellman key exchange protocol", alg. 2
+ */
+void xLADDER3PT_fixed(point_t P, point_t PQdiff, const struct ladder_table *T,
+                      const mpz_t m);
+
+/*
+ * @brief Calculate R = [m]Q with Q given by the table, m > 0. The ladder
+ * starts at the lowest set bit of m, see xLADDER3PT_fixed.
+ */
+void xLADDER_fixed(point_t R, const struct ladder_table *T, const mpz_t m);
+
 /*
  * @brief Calculate j-invariant of the Elliptic Curve in Montgomery Model with
  * coefficient a = (A : C)
  */
 void j_invariant(fp2_t j_inv, const fp2_t A, const fp2_t C);
+
+/*
+ * @brief Calculate j-invariant j = j_num / j_den of the curve given directly
+ * by (A24p : C24), without any inversion. The denominator can be inverted
+ * together with other pending values, e.g. by fp2_vec_inv. Cost: 3M + 3S.
+ */
+void j_invariant_proj(fp2_t j_num, fp2_t j_den, const fp2_t A24p,
+                      const fp2_t C24);
+
+/*
+ * @brief Calculate j-invariant of the curve given by (A24p : C24), cost:
+ * 1I + 4M + 3S
+ */
+void j_invariant_A24p(fp2_t j_inv, const fp2_t A24p, const fp2_t C24);
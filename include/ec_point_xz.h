@@ -26,12 +26,73 @@ struct point_xz {
 
 typedef struct point_xz *point_t;
 
+// Point together with the storage of its coordinates, can be placed on the
+// stack or embedded into a struct. It must not be copied by value, as the
+// point coordinates refer to the storage members.
+struct point_storage {
+    struct point_xz P;
+    fp2_elem X, Z;
+};
+
 void point_set(point_t R, const point_t P);
 
+// Swap the coordinates of P and Q if swap = 1, see `fp_cswap`
+void point_cswap(point_t P, point_t Q, int swap);
+
+// Allocate and initialize point on the heap (single allocation)
 void point_init(point_t *P);
 
 void point_clear(point_t *P);
 
+/*
+ * @brief Initialize point inside the storage owned by the caller and return
+ * the point handle. Coordinates are set to (0 : 0).
+ */
+point_t point_init_storage(struct point_storage *ps);
+
+/*
+ * @brief Clear point storage initialized with `point_init_storage`
+ */
+void point_clear_storage(struct point_storage *ps);
+
+// n points stored as vectors of coordinates: X[0..n) is directly followed by
+// Z[0..n) in a single array, so the list can be streamed through with the
+// fp2_vec kernels (X also spans all of the 2n coordinates)
+struct point_vec {
+    fp2_vec_t X, Z;
+    size_t n;
+};
+
+// Allocate and initialize vector of n points set to (0 : 0)
+void point_vec_init(struct point_vec *v, size_t n);
+
+void point_vec_clear(struct point_vec *v);
+
+/*
+ * @brief Return the i-th point of the vector as point_t, the handle is stored
+ * in `view` owned by the caller. Point refers to the coordinates in the vector.
+ */
+point_t point_vec_at(struct point_xz *view, const struct point_vec *v,
+                     size_t i);
+
+// Number of fp2 temporaries inside ec_scratch
+#define EC_SCRATCH_NFP2 6
+
+// Temporaries used by the `_scr` variants of the curve and isogeny functions.
+// Initialize once before the loop and reuse for every step, so the step does
+// not allocate any memory. Each function documents the slots it uses.
+// Unreduced accumulators w[0..1] hold the sums of products (see fp2_mul_wide).
+struct ec_scratch {
+    struct fp2_scratch fs;
+    fp2_elem t[EC_SCRATCH_NFP2];
+    struct fp2_acc w[2];
+    struct point_storage R;
+};
+
+void ec_scratch_init(struct ec_scratch *s);
+
+void ec_scratch_clear(struct ec_scratch *s);
+
 // Set: X(P) = x, and Z(P) = 1
 void point_set_str_x(point_t P, const char *x);
 
@@ -52,6 +113,12 @@ void point_printx(point_t P, const char *name);
 // Normalize: P = (X : Z) -> (X' : 1) with X' = X/Z
 void point_normalize_coords(point_t P);
 
+/*
+ * @brief Normalize n points at once: (X : Z) -> (X/Z : 1), using a single
+ * inversion for the whole list. Points cannot have Z = 0.
+ */
+void point_normalize_batch(point_t *pts, size_t n);
+
 /*
  * @brief Return 1 if point is normalized (P->Z == 1), 0 if P->Z != 1
  */
@@ -62,3 +129,15 @@ int point_is_normalized(point_t P);
  * initalization of the const char* str.
  */
 int point_equal_str_x(point_t P, const char *str);
+
+/*
+ * @brief Normalize P and write its x-coordinate into fp2_nbytes() bytes, see
+ * `fp2_to_bytes`. Return -1 if P is the point at infinity (Z = 0), 0 otherwise.
+ */
+int point_to_bytes(unsigned char *buf, point_t P);
+
+/*
+ * @brief Set P = (x : 1) with x read by `fp2_from_bytes`. Return 0 on success,
+ * -1 if the encoding is invalid.
+ */
+int point_from_bytes(point_t P, const unsigned char *buf);
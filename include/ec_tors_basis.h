@@ -13,6 +13,9 @@ typedef struct tors_basis* basis_t;
 void tors_basis_init(struct tors_basis *tb);
 void tors_basis_clear(struct tors_basis *tb);
 
+// Copy the points and the order: res = tb
+void tors_basis_set(struct tors_basis *res, const struct tors_basis *tb);
+
 /*
  * @brief Calculate subgroup basis of the torsion basis (R, S) = [N/n](P, Q)
  * of order n, where N is the order of (P, Q) and where n | N.
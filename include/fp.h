@@ -3,9 +3,86 @@
 #include <assert.h>
 #include <gmp.h>
 
+// Two interchangable backends are available for the Fp arithmetic:
+//  - default: arbitrary-length `mpz_t` numbers reduced with `mpz_mod`
+//  - FP_BACKEND_MONT: fixed-size limb arrays held in Montgomery form
+// Upper layers (fp2, ec, isog, proto) should only use the functions below.
+#ifdef FP_BACKEND_MONT
+
+// Maximal number of 64-bit limbs of the characteristic, can be overwritten at
+// compile time. 100 limbs are enough for every MSIDH parameter t < MSIDH_TMAX.
+#ifndef FP_MAX_LIMBS
+#define FP_MAX_LIMBS 100
+#endif
+
+// Element x stored as x * R (mod p), where R = 2^(64 * n) and n is the limb
+// count of the active field context. Only the lowest n limbs are meaningful.
+typedef struct {
+    mp_limb_t d[FP_MAX_LIMBS];
+} fp_elem;
+
+typedef fp_elem fp_t[1];
+
+// Unreduced double-width value: sum of products of elements, kept below pR.
+// Montgomery reduction of all 2n limbs gives the element of the sum.
+typedef struct {
+    mp_limb_t d[2 * FP_MAX_LIMBS];
+} fp_acc_elem;
+
+typedef fp_acc_elem fp_acc_t[1];
+
+// Pointers to the single element, used for arrays of scattered elements
+typedef fp_elem *fp_ptr;
+typedef const fp_elem *fp_srcptr;
+
+#else
+
 typedef mpz_t fp_t;
+typedef mpz_ptr fp_ptr;
+typedef mpz_srcptr fp_srcptr;
+typedef mpz_t fp_acc_t;
+
+#endif
+
+// Field context: characteristic together with the constants precomputed by
+// the backend and its scratch space. Every thread has its own *active* context,
+// implicitly used by all of the fp functions below (and therefore by fp2, ec
+// and isog layers). Contexts allow many characteristics to coexist in one
+// process, but single context should not be active in two threads at once.
+typedef struct fp_ctx *fp_ctx_t;
+
+/*
+ * @brief Allocate memory for the field context, characteristic is not set
+ */
+void fp_ctx_init(fp_ctx_t *ctx);
+
+/*
+ * @brief Deallocate the field context. If the context is active in the calling
+ * thread, no context is active afterwards.
+ */
+void fp_ctx_clear(fp_ctx_t *ctx);
 
-int fpchar_setup(fp_t p);
+/*
+ * @brief Set the characteristic p of the context, replacing the previous one.
+ * Only p = 3 (mod 4) is allowed. Return 0 on success, -1 otherwise.
+ */
+int fp_ctx_setup(fp_ctx_t ctx, const mpz_t p);
+
+/*
+ * @brief Make ctx active in the calling thread (NULL deactivates current one).
+ * Return previously active context, so it can be restored later.
+ */
+fp_ctx_t fp_ctx_swap(fp_ctx_t ctx);
+
+/*
+ * @brief Return the context active in the calling thread or NULL
+ */
+fp_ctx_t fp_ctx_get();
+
+// Simplified interface for the single characteristic per thread: setup, clear
+// and check the default context of the calling thread. Setup makes the default
+// context active.
+int fpchar_setup(const mpz_t p);
 int fpchar_setup_uint(unsigned int p);
 int fpchar_clear();
 int fpchar_clear_if_set();
@@ -20,9 +97,49 @@ void fp_clear(fp_t res);
 // set: res = a
 void fp_set(fp_t res, const fp_t a);
 
+/*
+ * @brief Swap a and b if swap = 1, do nothing if swap = 0. The mont backend
+ * does it without branching on swap, the gmp backend only swaps the handles.
+ */
+void fp_cswap(fp_t a, fp_t b, int swap);
+
 // set uint: res = (unsigned int) a
 void fp_set_uint(fp_t res, unsigned long int a);
 
+// set mpz: res = a (mod p)
+void fp_set_mpz(fp_t res, const mpz_t a);
+
+/*
+ * @brief Set fp element from the string. Base is detected from the prefix (0x,
+ * 0b, 0) same as in `mpz_set_str`. Return 0 on success, -1 otherwise.
+ */
+int fp_set_str(fp_t res, const char *str);
+
+// get mpz: res = a, as integer from range [0, p)
+void fp_get_mpz(mpz_t res, const fp_t a);
+
+// get uint: return a as unsigned long, truncated if larger
+unsigned long int fp_get_ui(const fp_t a);
+
+// Return number of digits of a in given base, same as `mpz_sizeinbase`
+size_t fp_sizeinbase(const fp_t a, int base);
+
+// Length of the binary encoding of the elements: (bits(p) + 7) / 8 bytes
+size_t fp_nbytes();
+
+/*
+ * @brief Write a as an integer from range [0, p) into fp_nbytes() bytes,
+ * least significant byte first
+ */
+void fp_to_bytes(unsigned char *buf, const fp_t a);
+
+/*
+ * @brief Read element from fp_nbytes() bytes written by `fp_to_bytes`. Return
+ * 0 on success, -1 if the encoded integer is not smaller than p (res is left
+ * unchanged).
+ */
+int fp_from_bytes(fp_t res, const unsigned char *buf);
+
 // add: result = a + b (mod p)
 void fp_add(fp_t res, const fp_t a, const fp_t b);
 
@@ -38,12 +155,50 @@ void fp_sub_uint(fp_t res, const fp_t a, unsigned long int b);
 // mul: res = a * b (mod p)
 void fp_mul(fp_t res, const fp_t a, const fp_t b);
 
+/*
+ * @brief Calculate n independent products res[i] = a[i] * b[i]. The mont
+ * backend built with FP_AVX2 computes four products at once in the AVX2 lanes
+ * when the CPU supports it, otherwise this is the same as calling fp_mul n
+ * times. res[i] can be equal to a[i] or b[i], but must not alias inputs of the
+ * other products.
+ */
+void fp_mul_batch(fp_ptr *res, const fp_srcptr *a, const fp_srcptr *b,
+                  size_t n);
+
+// Lazy reduction: products are accumulated in double-width fp_acc_t values
+// and reduced once, e.g. ac - bd costs 2 products and a single reduction.
+// Accumulators have to be initialized for the active characteristic.
+void fp_acc_init(fp_acc_t res);
+void fp_acc_clear(fp_acc_t res);
+
+// mul wide: res = a * b, not reduced
+void fp_mul_wide(fp_acc_t res, const fp_t a, const fp_t b);
+
+/*
+ * @brief Add two accumulators: res = a + b. The sum is not reduced, the mont
+ * backend only keeps it below pR by adjusting the upper half.
+ */
+void fp_acc_add(fp_acc_t res, const fp_acc_t a, const fp_acc_t b);
+
+// acc sub: res = a - b, not reduced
+void fp_acc_sub(fp_acc_t res, const fp_acc_t a, const fp_acc_t b);
+
+// acc reduce: res = a (mod p)
+void fp_acc_reduce(fp_t res, const fp_acc_t a);
+
 // mul int: res = a * (int) b (mod p)
 void fp_mul_int(fp_t res, const fp_t a, long int b);
 
 // inv: res = a^-1 (mod p)
 void fp_inv(fp_t res, const fp_t a);
 
+/*
+ * @brief Invert n elements at once using Montgomery's trick: res[i] = x[i]^-1.
+ * Cost: 1 inversion and 3(n - 1) multiplications. Can be called with res = x,
+ * all elements must be nonzero. Temporaries are borrowed from the arena.
+ */
+void fp_inv_batch(fp_t *res, const fp_t *x, size_t n);
+
 // div: res = a / b (mod p) = a * b^-1 (mod p)
 void fp_div(fp_t res, const fp_t a, const fp_t b);
 
@@ -54,6 +209,18 @@ void fp_neg(fp_t res, const fp_t a);
 // assumes that prime is in form: p = 3 (mod 4)
 void fp_sqrt(fp_t res, const fp_t a);
 
+/*
+ * @brief Calculate res = a^((p - 3)/4). For a nonzero square a it is the
+ * inverse square root (a * res^2 = 1), so sqrt(a) = a * res without inversion.
+ * For a non-square a * res^2 = -1.
+ */
+void fp_pow34(fp_t res, const fp_t a);
+
+/*
+ * @brief Return 1 if a is a square in Fp (including a = 0), 0 otherwise
+ */
+int fp_is_square(const fp_t a);
+
 // Return 1 if fp is zero, 0 otherwise
 int fp_is_zero(const fp_t a);
 
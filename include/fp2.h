@@ -12,16 +12,53 @@ typedef struct {
     fp_t b;
 } fp2_elem, *fp2_t;
 
+// Allocate and initialize element on the heap, x points to it afterwards
 void fp2_init(fp2_t *x);
 
 void fp2_clear(fp2_t *x);
 
+/*
+ * @brief Initialize fp2_elem storage owned by the caller (stack or struct
+ * member) to 0 + 0i. Does not allocate the structure itself.
+ */
+void fp2_init_storage(fp2_elem *x);
+
+/*
+ * @brief Clear fp2_elem storage initialized with `fp2_init_storage`
+ */
+void fp2_clear_storage(fp2_elem *x);
+
+// Unreduced Fp^2 value: coordinates are fp_acc_t accumulators, see fp.h
+struct fp2_acc {
+    fp_acc_t a, b;
+};
+
+void fp2_acc_init(struct fp2_acc *x);
+
+void fp2_acc_clear(struct fp2_acc *x);
+
+// Temporaries used by the fp2 arithmetic, passed to the `_scr` variants of the
+// functions to avoid allocations on every call. Can be reused by any number of
+// calls, but not by two threads at once.
+struct fp2_scratch {
+    fp_t t0, t1;
+    fp_acc_t w;
+    struct fp2_acc acc;
+};
+
+void fp2_scratch_init(struct fp2_scratch *s);
+
+void fp2_scratch_clear(struct fp2_scratch *s);
+
 // set: result = x[a + bi]
 void fp2_set(fp2_t res, const fp2_t x);
 
 // set: result = (ul) a + 0i
 void fp2_set_uint(fp2_t res, unsigned long int a);
 
+// Swap x and y if swap = 1, see `fp_cswap`
+void fp2_cswap(fp2_t x, fp2_t y, int swap);
+
 /*
  * @brief Set fp2_t into value represented by string x.
  * Possible formats are: a + b*i, b*i + a, a, b*i.
@@ -73,32 +110,141 @@ void fp2_sub_uint(fp2_t res, const fp2_t x, unsigned long int y);
 void fp2_mul_int(fp2_t r, const fp2_t x, long int y);
 
 /*
- * @brief Calculate mul: result = x[a + bi] * y[a + bi].
- * This function is not argument-safe, i.e. calling fp2_mul(r, x, y) for r = x
- * or r = y will provide incorrect results.
+ * @brief Calculate mul: result = x[a + bi] * y[a + bi] using Karatsuba method
+ * (3M). This function is not argument-safe, i.e. calling fp2_mul(r, x, y) for
+ * r = x or r = y will provide incorrect results.
  */
 void fp2_mul_unsafe(fp2_t res, const fp2_t x, const fp2_t y);
 
 /*
- * @brief Calculate mul: x[a + bi] *= y[a + bi].
+ * @brief Calculate mul: x[a + bi] *= y[a + bi] using Karatsuba method (3M).
  * This function is argument-safe, i.e. calling fp2_mul(r, x, y) for r = x or r
  * = y is allowed.
  */
 void fp2_mul_safe(fp2_t x, const fp2_t y);
 
+// Same as fp2_mul_unsafe, temporaries are taken from the scratch
+void fp2_mul_unsafe_scr(fp2_t res, const fp2_t x, const fp2_t y,
+                        struct fp2_scratch *s);
+
+// Same as fp2_mul_safe, temporaries are taken from the scratch
+void fp2_mul_safe_scr(fp2_t x, const fp2_t y, struct fp2_scratch *s);
+
+/*
+ * @brief Calculate unreduced product res = x * y using Karatsuba method (3M),
+ * each coordinate is reduced later by a single `fp2_acc_reduce`. Uses t0, t1
+ * and w of the scratch, res is written after x and y are read.
+ */
+void fp2_mul_wide(struct fp2_acc *res, const fp2_t x, const fp2_t y,
+                  struct fp2_scratch *s);
+
+// acc add: res = x + y, not reduced
+void fp2_acc_add(struct fp2_acc *res, const struct fp2_acc *x,
+                 const struct fp2_acc *y);
+
+// acc sub: res = x - y, not reduced
+void fp2_acc_sub(struct fp2_acc *res, const struct fp2_acc *x,
+                 const struct fp2_acc *y);
+
+// acc reduce: res = x, 2 Montgomery reductions (or mpz_mod)
+void fp2_acc_reduce(fp2_t res, const struct fp2_acc *x);
+
+// Number of products computed together by fp2_mul_batch, which is also the
+// size of its scratch array
+#define FP2_MUL_BATCH 4
+
+/*
+ * @brief Calculate n independent products res[i] = x[i] * y[i] (3M each). The
+ * Fp products of FP2_MUL_BATCH elements are passed together to `fp_mul_batch`.
+ * res[i] can be equal to x[i] or y[i], but must not alias inputs of the other
+ * products. s is an array of FP2_MUL_BATCH scratches.
+ */
+void fp2_mul_batch(fp2_t *res, const fp2_t *x, const fp2_t *y, size_t n,
+                   struct fp2_scratch *s);
+
 void fp2_inv_unsafe(fp2_t res, const fp2_t arg);
 void fp2_inv_safe(fp2_t x);
 
-// sq: result <- arg^2
-// This function cannot be used when res == arg
-static inline void fp2_sq_unsafe(fp2_t res, const fp2_t arg) {
-    assert(res != arg && "fp2_sq cannot be called with res = arg");
-    fp2_mul_unsafe(res, arg, arg);
-}
+/*
+ * @brief Invert n elements at once: res[i] = x[i]^-1. Norms a^2 + b^2 are
+ * inverted with `fp_inv_batch`, so the whole batch costs a single Fp inversion.
+ * Argument-safe for res[i] = x[i], all elements must be nonzero.
+ */
+void fp2_inv_batch(fp2_t *res, const fp2_t *x, size_t n);
+
+// Vector of Fp^2 elements stored in a single contiguous array, x[i] is the i-th
+// element. Unlike the arrays of fp2_t handles, consecutive elements are
+// adjacent in memory and reached without an indirection. Kernels below accept
+// any part of a vector, e.g. x + k is a vector of elements x[k], x[k + 1], ...
+typedef fp2_elem *fp2_vec_t;
+
+// Allocate and initialize vector of n elements set to 0 + 0i
+void fp2_vec_init(fp2_vec_t *x, size_t n);
+
+void fp2_vec_clear(fp2_vec_t *x, size_t n);
+
+// add: res[i] = x[i] + y[i] for i < n
+void fp2_vec_add(fp2_vec_t res, const fp2_vec_t x, const fp2_vec_t y, size_t n);
 
-// sq: result <- arg^2
-// This function can be used safely with res == arg
-static inline void fp2_sq_safe(fp2_t x) { fp2_mul_safe(x, x); }
+// sub: res[i] = x[i] - y[i] for i < n
+void fp2_vec_sub(fp2_vec_t res, const fp2_vec_t x, const fp2_vec_t y, size_t n);
+
+/*
+ * @brief Calculate res[i] = x[i] * y[i] for i < n with `fp2_mul_batch`. res
+ * can be equal to x or y, s is an array of FP2_MUL_BATCH scratches.
+ */
+void fp2_vec_mul(fp2_vec_t res, const fp2_vec_t x, const fp2_vec_t y, size_t n,
+                 struct fp2_scratch *s);
+
+/*
+ * @brief Calculate (lsum[i], rdiff[i]) = (x[i]w + y[i]z, x[i]w - y[i]z) for
+ * i < n, the same z and w are used for all elements. Each output is reduced
+ * once. Outputs must not overlap inputs, s is an array of FP2_MUL_BATCH
+ * scratches.
+ */
+void fp2_vec_criss_cross(fp2_vec_t lsum, fp2_vec_t rdiff, const fp2_vec_t x,
+                         const fp2_vec_t y, const fp2_t z, const fp2_t w,
+                         size_t n, struct fp2_scratch *s);
+
+/*
+ * @brief Calculate prefix products res[i] = x[0] * x[1] * ... * x[i] for
+ * i < n, res can be equal to x
+ */
+void fp2_vec_prefix_prod(fp2_vec_t res, const fp2_vec_t x, size_t n,
+                         struct fp2_scratch *s);
+
+/*
+ * @brief Invert n elements with a single inversion, see `fp2_inv_batch`.
+ * Argument-safe for res = x, all elements must be nonzero.
+ */
+void fp2_vec_inv(fp2_vec_t res, const fp2_vec_t x, size_t n);
+
+/*
+ * @brief Calculate sq: result = x^2 as (a + b)(a - b) + 2abi, cost: 2M.
+ * This function cannot be used when res == arg
+ */
+void fp2_sq_unsafe(fp2_t res, const fp2_t arg);
+
+/*
+ * @brief Calculate sq: x = x^2 as (a + b)(a - b) + 2abi, cost: 2M.
+ */
+void fp2_sq_safe(fp2_t x);
+
+// Same as fp2_sq_safe, temporaries are taken from the scratch
+void fp2_sq_safe_scr(fp2_t x, struct fp2_scratch *s);
+
+/*
+ * @brief Return 1 if x is a square in Fp^2 (including x = 0), 0 otherwise.
+ * Cost: 2M and one Legendre symbol in Fp.
+ */
+int fp2_is_square(const fp2_t x);
+
+/*
+ * @brief Calculate res = sqrt(x) for p = 3 (mod 4) using two Fp
+ * exponentiations. Argument-safe. Return 0 on success, -1 if x is not a square
+ * (res is left unchanged).
+ */
+int fp2_sqrt(fp2_t res, const fp2_t x);
 
 // Return true if fp2 is zero
 static inline int fp2_is_zero(const fp2_t arg) {
@@ -131,3 +277,18 @@ size_t fp2_write_size(fp2_t x);
  * '\0'. X is stored in decimal format.
  */
 void fp2_write(fp2_t x, char *buffer);
+
+// Length of the binary encoding of the elements, twice `fp_nbytes`
+size_t fp2_nbytes();
+
+/*
+ * @brief Write x = a + b*i into fp2_nbytes() bytes as a followed by b, both
+ * encoded by `fp_to_bytes`
+ */
+void fp2_to_bytes(unsigned char *buf, const fp2_t x);
+
+/*
+ * @brief Read element written by `fp2_to_bytes`. Return 0 on success, -1 if
+ * any of the coordinates is not smaller than p, res is then unspecified.
+ */
+int fp2_from_bytes(fp2_t res, const unsigned char *buf);
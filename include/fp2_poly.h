@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "fp2.h"
+
+// Polynomials over Fp^2 are fp2 vectors of their coefficients, f[i] is the
+// coefficient of z^i. Polynomial of length n has degree below n, the length
+// is passed next to the vector. Temporaries are borrowed from the arena.
+
+/*
+ * @brief Calculate product res = f * g of length nf + ng - 1. Karatsuba method
+ * is used above FP2_POLY_KARATSUBA coefficients, schoolbook below it with a
+ * single reduction per coefficient. res must not overlap f or g.
+ */
+void fp2_poly_mul(fp2_vec_t res, const fp2_vec_t f, size_t nf,
+                  const fp2_vec_t g, size_t ng);
+
+// Length of the shorter factor from which fp2_poly_mul uses Karatsuba
+#define FP2_POLY_KARATSUBA 4
+
+/*
+ * @brief Calculate power series inverse res = f^-1 mod z^n, where f[0] = 1.
+ * Cost: n^2 / 2 multiplications, reduced once per coefficient.
+ */
+void fp2_poly_inv_series(fp2_vec_t res, const fp2_vec_t f, size_t nf,
+                         size_t n);
+
+/*
+ * @brief Calculate remainder r = g mod f of length d, where f is monic of
+ * degree d (d + 1 coefficients) and rcp = rev(f)^-1 mod z^(ng - d) is the
+ * series inverse of the reversed f. Quotient is obtained with two products.
+ * r can be equal to g.
+ */
+void fp2_poly_rem_monic(fp2_vec_t r, const fp2_vec_t g, size_t ng,
+                        const fp2_vec_t f, size_t d, const fp2_vec_t rcp);
+
+// Product tree of the monic linear factors (z - roots[i]), node covering the
+// roots [lo, hi) is the polynomial of degree hi - lo stored with its reciprocal
+// used to reduce the remainders of its parent. Nodes are indexed as a heap,
+// children of the node k are 2k + 1 and 2k + 2.
+struct fp2_poly_tree {
+    size_t n;
+    fp2_vec_t poly, rcp;
+    // Offsets of the node polynomial and its reciprocal, length of the latter
+    size_t *poly_off, *rcp_off, *rcp_len;
+};
+
+/*
+ * @brief Build the product tree of n > 0 roots. Root of the tree reduces the
+ * polynomials of length up to n_top. Memory of the tree is borrowed from the
+ * arena in the frame of the caller.
+ * @details Cost: O(M(n) log n) for the products and O(n^2) for the
+ * reciprocals
+ */
+void fp2_poly_tree_build(struct fp2_poly_tree *t, const fp2_vec_t roots,
+                         size_t n, size_t n_top);
+
+/*
+ * @brief Return the root polynomial of the tree, monic of degree t->n
+ */
+static inline fp2_vec_t fp2_poly_tree_root(const struct fp2_poly_tree *t) {
+    return t->poly + t->poly_off[0];
+}
+
+/*
+ * @brief Calculate product of the values res = g(roots[0]) * ... *
+ * g(roots[n - 1]) for g of length ng <= n_top. g is reduced by the root of
+ * the tree and the remainders go down the tree to the leaves. Equal to the
+ * resultant Res(h, g) of the root h of the tree.
+ */
+void fp2_poly_tree_prod_eval(fp2_t res, const struct fp2_poly_tree *t,
+                             const fp2_vec_t g, size_t ng);
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stddef.h>
+
+// Optional replacement of the GMP memory functions. Every mpz reallocation
+// (e.g. `mpz_mul` growing its result to the double width) otherwise goes to
+// malloc/realloc. With the pool enabled, freed blocks are kept in per-thread
+// free lists of power-of-two size classes and reused by the next allocation
+// of the same class, so the steady state of a key exchange does not reach
+// malloc at all. Blocks are plain malloc blocks without headers: memory
+// returned by GMP to the caller (e.g. `mpz_get_str(NULL, ...)`) can still be
+// released with `free`.
+
+enum gmp_alloc_mode {
+    // Pass every call to malloc, only count the calls
+    GMP_ALLOC_COUNT,
+    // Reuse freed blocks of the size classes
+    GMP_ALLOC_POOL,
+};
+
+// Number of calls of the GMP memory functions made by the calling thread
+struct gmp_alloc_stats {
+    // Allocations and reallocations requested by GMP
+    size_t n_alloc, n_realloc;
+    // Requests which had to call malloc or realloc
+    size_t n_sys;
+};
+
+/*
+ * @brief Install the GMP memory functions, must be called before any mpz
+ * allocation and before starting other threads. The pool mode rounds the
+ * blocks up to their size class, therefore the blocks allocated before the
+ * setup cannot be freed into the pool. Setup cannot be undone.
+ */
+void gmp_alloc_setup(enum gmp_alloc_mode mode);
+
+/*
+ * @brief Get the counters of the calling thread, all of them are zero if
+ * `gmp_alloc_setup` was not called
+ */
+void gmp_alloc_get_stats(struct gmp_alloc_stats *stats);
+
+// Reset the counters of the calling thread
+void gmp_alloc_reset_stats();
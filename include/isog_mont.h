@@ -4,6 +4,7 @@
 
 #include "ec_point_xz.h"
 #include "fp2.h"
+#include "fp2_poly.h"
 #include "pprod.h"
 
 /*
@@ -11,11 +12,17 @@
  * @details
  *  Argument-safe: Yes
  *  Registers: 2
- *  Cost: 2M + 2a
+ *  Cost: 2M + 2a, each output coordinate is reduced once
  */
 void criss_cross(fp2_t lsum, fp2_t rdiff, const fp2_t x, const fp2_t y,
                  const fp2_t z, const fp2_t w);
 
+/*
+ * @brief Same as criss_cross, temporaries are taken from the scratch: w[0..1]
+ */
+void criss_cross_scr(fp2_t lsum, fp2_t rdiff, const fp2_t x, const fp2_t y,
+                     const fp2_t z, const fp2_t w, struct ec_scratch *s);
+
 /*
  * @brief Return size of the kernel points array based on odd isogeny degree
  */
@@ -24,52 +31,182 @@ void criss_cross(fp2_t lsum, fp2_t rdiff, const fp2_t x, const fp2_t y,
 /*
  * @brief Generate points that lay in the kernel of the isogeny of degree d
  * using generator P
- * @param[out]  kpoints     list of `P` multiples up to `deg`: `[[1]P, [2]P,
- * [3]P, ... [d - 1]P]`
- * @param[in]   n           size of the kpoints array (degree of the isogeny -
- * 1)
+ * @param[out]  kpoints     vector of `P` multiples: `[[1]P, [2]P, [3]P, ...
+ * [n]P]`, its length n is KPS_DEG2SIZE(d)
  * @see https://eprint.iacr.org/2017/504
  */
-void KPS(point_t *kpoints, size_t n, const point_t P, const fp2_t A24p,
+void KPS(struct point_vec *kpoints, const point_t P, const fp2_t A24p,
          const fp2_t C24);
 
 /*
  * @brief Transform (X : Z) kernel points into (X + Z : X - Z) pairs for
  * efficient computation
  */
-void prepare_kernel_points(point_t *kpts, size_t n);
+void prepare_kernel_points(struct point_vec *kpts);
 
 /*
  * @brief Calculate x-coordinate of the odd-degree isogeny point image Q = φ(P)
  * given ker(phi) = prep_points
  */
-void xISOG_odd(point_t Q, const point_t *prep_kpts, size_t n, const point_t P);
+void xISOG_odd(point_t Q, const struct point_vec *prep_kpts, const point_t P);
 
 /*
- * @brief Calculate a coefficient of the odd-degree isogeny curve codomain E' =
- * φ(E) given kernel points list
+ * @brief Same as xISOG_odd, temporaries are taken from the scratch: t[2..5]
+ * and w[0..1]
+ */
+void xISOG_odd_scr(point_t Q, const struct point_vec *prep_kpts,
+                   const point_t P, struct ec_scratch *s);
+
+/*
+ * @brief Calculate images Q[j] = φ(P[j]) of m points under the same odd-degree
+ * isogeny, ker(phi) = prep_points. Terms of all points are computed together
+ * by the fp2_vec kernels. Argument-safe for Q[j] = P[j].
  */
-void aISOG_curve_KPS(fp2_t A_, fp2_t C_, const fp2_t A24p, const fp2_t C24,
-                     const point_t *kpts, size_t n);
+void xISOG_odd_batch(point_t *Q, const struct point_vec *prep_kpts,
+                     const point_t *P, size_t m);
+
+/*
+ * @brief Calculate codomain E' = φ(E) of the odd-degree isogeny in the xDBL
+ * form (A24p_ : C24_) given the prepared kernel points, the same ones as used
+ * by xISOG_odd. Projective formula: (a : d) = (A + 2C : A - 2C) is mapped to
+ * (a^l prod(XK + ZK)^8 : d^l prod(XK - ZK)^8), no inversion is used.
+ * @details Cost: 2nM + 6S + 2 exponentiations by the degree l = 2n + 1, each
+ * of floor(log2 l) S and one M less than the number of set bits of l
+ * @ref Meyer, Reith: "A faster way to the CSIDH", https://eprint.iacr.org/2018/782
+ */
+void aISOG_curve_KPS(fp2_t A24p_, fp2_t C24_, const fp2_t A24p,
+                     const fp2_t C24, const struct point_vec *prep_kpts);
 
 /*
  * @brief Calculate a coefficient of the odd-degree isogeny curve codomain E' =
  * φ(E) given kernel point
  * @details
  *  This function allocates space and generates KPS list, later calling
- * `aISOG_curve_KPS` to obtain the result. If KPS is calulated beforehand use
- * `aISOG_curve_KPS` istead to avoid unnecessary computations.
+ * `aISOG_curve_KPS` to obtain the result, which is converted to (A_ : C_). If
+ * KPS is calulated beforehand use `aISOG_curve_KPS` istead to avoid
+ * unnecessary computations.
  */
 void aISOG_curve(fp2_t A_, fp2_t C_, const fp2_t A24p, const fp2_t C24,
                  const point_t K, int degree);
 
+// Smallest odd degree for which ISOG_chain uses the √élu formulas instead of
+// KPS, see bench_isog for the crossover
+#define VELUSQRT_MIN_DEGREE 257
+
+// Kernel of the odd-degree isogeny prepared for the √élu formulas. Multiples
+// [s]K for odd s < degree are split into I ± J, where I = {2b(2i + 1): i < b'}
+// and J = {2j + 1: j < b}, and the rest R. All x-coordinates are affine.
+struct kps_sqrt {
+    unsigned int degree;
+    size_t b, b_, n_rest;
+    // Product tree of h_I = prod(z - x([i]K)), i in I
+    struct fp2_poly_tree tree_I;
+    // x([j]K), x([j]K)^2 and x([j]K)^2 + 2a x([j]K) + 1 for j in J
+    fp2_vec_t xJ, xJ2, uJ;
+    // x([s]K) for s in R
+    fp2_vec_t xR;
+    // Domain curve
+    fp2_t A24p, C24;
+};
+
+/*
+ * @brief Generate the points of `kps_sqrt` for the isogeny of odd degree >= 5
+ * with kernel K. Memory is borrowed from the arena in the frame of the caller.
+ * @details Cost: O(√degree) curve operations, one inversion and the product
+ * tree of h_I
+ */
+void KPS_sqrt(struct kps_sqrt *k, const point_t K, const fp2_t A24p,
+              const fp2_t C24, unsigned int degree);
+
+/*
+ * @brief Calculate codomain (A24p_ : C24_) of the odd-degree isogeny with the
+ * projective formula of `aISOG_curve_KPS`: (a : d) is mapped to (a^l h(-1)^8 :
+ * d^l h(1)^8), where h is the kernel polynomial. No inversion is used.
+ * @ref Bernstein, De Feo, Leroux, Smith: "Faster computation of isogenies of
+ * large prime degree", https://eprint.iacr.org/2020/341
+ */
+void aISOG_curve_sqrt(fp2_t A24p_, fp2_t C24_, const struct kps_sqrt *k);
+
+/*
+ * @brief Calculate images Q[j] = φ(P[j]) of m points under the odd-degree
+ * isogeny prepared by `KPS_sqrt`. Values of the kernel polynomial are
+ * resultants with h_I computed by the product tree, cost: Õ(√degree) per
+ * point. Argument-safe for Q[j] = P[j].
+ */
+void xISOG_sqrt_batch(point_t *Q, const struct kps_sqrt *k, const point_t *P,
+                      size_t m);
+
+/*
+ * @brief Cost of the multiplication of a point by the factor div of the
+ * isogeny degree, in the multiplications of Fp. Powers of two are doubled,
+ * odd factors use xLADDER_int.
+ */
+uint64_t isog_strategy_mul_cost(unsigned int div);
+
+/*
+ * @brief Cost of pushing one point through the isogeny of the factor degree
+ * div, in the multiplications of Fp. Powers of two use 2-isogenies, odd
+ * factors KPS or √élu formulas from VELUSQRT_MIN_DEGREE on.
+ */
+uint64_t isog_strategy_eval_cost(unsigned int div);
+
+/*
+ * @brief Calculate the optimal strategy of the isogeny chain of n factors,
+ * split[lo * (n + 1) + hi] is the first factor of the second part of the
+ * factors [lo, hi). Kernel of the first part is computed by multiplying the
+ * kernel of [lo, hi) by the factors of the second part, while the kernel
+ * itself is pushed through the isogenies of the first part. The split
+ * minimizes the total cost of these multiplications and pushes, estimated
+ * from the costs of the curve operations. Table has (n + 1)^2 entries, cost:
+ * O(n^3) integer operations.
+ * @ref De Feo, Jao, Plut: "Towards quantum-resistant cryptosystems from
+ * supersingular elliptic curve isogenies", sec. 4
+ */
+void isog_chain_strategy(uint16_t *split, const unsigned int *primes,
+                         size_t n);
+
+// Memory of ISOG_chain reused by the chains of the degrees dividing one
+// product of primes, e.g. the degree of one side of the protocol. Strategy of
+// the last degree is kept and recomputed only when the factors change.
+struct isog_workspace {
+    // Kernel points of the largest degree computed with KPS
+    struct point_vec kpts;
+    // Pushed points and the strategy table for up to n_max factors and
+    // n_user_max points of the caller
+    point_t *push;
+    uint16_t *split;
+    unsigned int *primes;
+    size_t n_max, n_user_max;
+    // Number of factors of the strategy in split, 0 if there is none
+    size_t n;
+    // Strategy of the 2^e factor, e2 = 0 if there is none
+    uint16_t *split2;
+    unsigned int e2;
+};
+
+void isog_workspace_init(struct isog_workspace *ws);
+
+void isog_workspace_clear(struct isog_workspace *ws);
+
+/*
+ * @brief Size the workspace for the chains of the degrees dividing deg with
+ * up to n_user push points. Memory only grows, repeated calls with the same
+ * degree do not allocate.
+ */
+void isog_workspace_reserve(struct isog_workspace *ws, const pprod_t deg,
+                            size_t n_user);
+
 /*
  * @brief Calculate codomain of the isogeny generated by kernel K, using
- * chaining method
+ * chaining method. Kernels of the steps are computed by the traversal of
+ * `isog_chain_strategy`. NULL-terminated push_points are pushed through the
+ * isogeny. Kernel points, the strategy and the list of pushed points are kept
+ * in the workspace reserved for isog_degree, or borrowed from the arena if ws
+ * is NULL.
  */
 void ISOG_chain(fp2_t A24p, fp2_t C24, const fp2_t A24p_init,
                 const fp2_t C24_init, const point_t K, pprod_t isog_degree,
-                point_t *push_points);
+                point_t *push_points, struct isog_workspace *ws);
 
 /*
  * @brief Calculate image of the point P under the 2-isogeny using point K of
@@ -79,6 +216,13 @@ void ISOG_chain(fp2_t A24p, fp2_t C24, const fp2_t A24p_init,
  */
 void xISOG2_unsafe(point_t Q, const point_t K, const point_t P);
 
+/*
+ * @brief Same as xISOG2_unsafe, temporaries are taken from the scratch:
+ * t[2..5] and w[0..1]
+ */
+void xISOG2_unsafe_scr(point_t Q, const point_t K, const point_t P,
+                       struct ec_scratch *s);
+
 /*
  * @brief Transform kernel K = (XK : ZK) into (ZK + XK : ZK - XK).
  *   This is different formula than the one used for preparing KPTs
@@ -94,13 +238,53 @@ void prepare_isog2_kernel(point_t K);
  */
 void xISOG2_prep(point_t Q, const point_t prep_K, const point_t P);
 
+/*
+ * @brief Calculate codomain of the 4-isogeny in the xDBL form (A24p_ : C24_)
+ * using point K of order 4, [2]K != (0, 0). The isogeny is the composition of
+ * the 2-isogenies with kernel [2]K and with the image of K, both prepared from
+ * K without doublings, so the codomain is the same as the one of two calls of
+ * aISOG2_24p.
+ * Prepared kernels used by xISOG4 are written to coeff of length 4.
+ * @details Cost: 1M + 4S
+ * @ref https://eprint.iacr.org/2017/1198.pdf
+ */
+void aISOG4(fp2_t A24p_, fp2_t C24_, fp2_vec_t coeff, const point_t K);
+
+/*
+ * @brief Calculate image of the point P under the 4-isogeny given the
+ * prepared kernels computed by `aISOG4`
+ * @details
+ *  Argument-safe: Yes
+ *  Cost: 8M
+ */
+void xISOG4(point_t Q, const fp2_vec_t coeff, const point_t P);
+
+/*
+ * @brief Same as xISOG4, temporaries are taken from the scratch: t[2..5] and
+ * w[0..1]
+ */
+void xISOG4_scr(point_t Q, const fp2_vec_t coeff, const point_t P,
+                struct ec_scratch *s);
+
+/*
+ * @brief Calculate the optimal strategy of the chain of n 4-isogenies,
+ * split[len] is the number of isogenies in the first part of the chain of
+ * len isogenies, kernel of which is [4^(len - split[len])]K, see
+ * `isog_chain_strategy`. All steps have the same cost, table has n + 1
+ * entries, cost: O(n^2) integer operations.
+ */
+void isog2e_strategy(uint16_t *split, size_t n);
+
 /*
  * @brief Calculate codomain of the 2^e-isogeny in the xDBL form (A24p) using
  * point that does not lay above (0, 0). Additionaly push all points specified
- * in the list by the 2^e-isogeny
+ * in the list by the 2^e-isogeny. The chain consists of 4-isogenies, preceded
+ * by a 2-isogeny for odd e, and is traversed by `isog2e_strategy`. Strategy
+ * is taken from the workspace reserved for e, otherwise it is computed.
  */
 void ISOG2e(fp2_t A24p, fp2_t C24, const fp2_t A24p_init, const fp2_t C24_init,
-            const point_t K, uint32_t e, point_t *push_points);
+            const point_t K, uint32_t e, point_t *push_points,
+            const struct isog_workspace *ws);
 
 /*
  * @brief Calculate codomain of the 2-isogeny in the xDBL form (A24p) using
@@ -2,7 +2,9 @@
 
 #include <gmp.h>
 
+#include "ec_mont.h"
 #include "ec_tors_basis.h"
+#include "isog_mont.h"
 #include "pprod.h"
 
 // Used by msidh_state structure
@@ -13,6 +15,11 @@ enum {
     MSIDH_STATUS_EXCHANGED
 };
 
+struct msidh_data {
+    int t, f;
+    fp2_t a, xP, xQ, xR;
+};
+
 struct msidh_state {
     gmp_randstate_t randstate;
 
@@ -37,15 +44,25 @@ struct msidh_state {
     // Shared Key -> j_invariant
     fp2_t j_inv;
 
+    // Values derived only from the public parameters of the last prepare,
+    // reused while the parameters and the side do not change: both torsion
+    // bases, the fixed-base table of PQ_self.Q for the kernel generator and
+    // the isogeny workspace of my degree. Parameter t is 0 if nothing is
+    // cached.
+    struct msidh_data cache_params;
+    int cache_is_bob;
+    struct tors_basis PQ_self_base, PQ_pubkey_base;
+    struct ladder_table table_Q;
+    struct isog_workspace ws;
+
+    // Field context with the characteristic p, active in the calling thread
+    // only during the state functions
+    fp_ctx_t ctx;
+
     // Current state of the protocol
     int status;
 };
 
-struct msidh_data {
-    int t, f;
-    fp2_t a, xP, xQ, xR;
-};
-
 struct msidh_const_data {
     int t, f;
     const char *a_str, *xP_str, *xQ_str, *xR_str;
@@ -61,6 +78,23 @@ void msidh_data_init(struct msidh_data *md);
 
 void msidh_data_clear(struct msidh_data *md);
 
+/*
+ * @brief Size of the binary encoding of the data under the active field
+ * context: t and f as 32-bit little-endian integers followed by a, xP, xQ and
+ * xR, see `fp2_to_bytes`
+ */
+size_t msidh_data_packed_size();
+
+// Write data into msidh_data_packed_size() bytes
+void msidh_data_pack(unsigned char *buf, const struct msidh_data *md);
+
+/*
+ * @brief Read data written by `msidh_data_pack`. Return 0 on success, -1 if
+ * t is out of the range [MSIDH_TMIN, MSIDH_TMAX), f is not positive or some
+ * element is not reduced.
+ */
+int msidh_data_unpack(struct msidh_data *md, const unsigned char *buf);
+
 void msidh_state_init(struct msidh_state *msidh);
 
 void msidh_state_clear(struct msidh_state *msidh);
@@ -73,6 +107,21 @@ void msidh_state_prepare(struct msidh_state *msidh,
 void msidh_key_exchange(struct msidh_state *msidh,
                         const struct msidh_data *pk_other);
 
+/*
+ * @brief Size of the shared secret encoding, fp2_nbytes() of the state
+ * characteristic
+ */
+size_t msidh_shared_secret_size(const struct msidh_state *msidh);
+
+/*
+ * @brief Write the shared j-invariant after the key exchange into
+ * msidh_shared_secret_size() bytes. Encoding is canonical (fixed length, both
+ * coordinates reduced, see `fp2_to_bytes`), so both parties get equal bytes
+ * suitable as the KDF input.
+ */
+void msidh_get_shared_secret(const struct msidh_state *msidh,
+                             unsigned char *buf);
+
 void msidh_get_pubkey(const struct msidh_state *msidh,
                       struct msidh_data *pk_self);
 
@@ -94,21 +143,28 @@ int msidh_gen_pub_params(mpz_t p, pprod_t A, pprod_t B, int t);
 int msidh_calc_pub_params(mpz_t p, pprod_t A, pprod_t B, int t, int f);
 
 /*
- * @brief Generate MSIDH public key from Alice perspective
+ * @brief Generate MSIDH public key from Alice perspective. If the table of
+ * PQ_alice->Q is given, the kernel generator uses the fixed-base ladder and
+ * PQ_alice->Q is not needed, otherwise it is NULL. Workspace reserved for
+ * A_deg is optional, see `ISOG_chain`.
  */
 void _msidh_gen_pubkey_alice(fp2_t A24p_alice, fp2_t C24_alice,
                              struct tors_basis *PQ_alice,
                              struct tors_basis *PQ_bob, const pprod_t A_deg, const fp2_t A24p_base,
                              const fp2_t C24_base, const mpz_t secret,
-                             const mpz_t mask);
+                             const mpz_t mask,
+                             const struct ladder_table *table,
+                             struct isog_workspace *ws);
 // void msidh_gen_pubkey(fp2_t A24p_alice, fp2_t C24_alice, struct tors_basis*
 // PQ_alice, struct tors_basis* PQ_bob, const fp2_t A24p_base, const fp2_t
 // C24_base, const mpz_t secret, const mpz_t mask);
 
 /*
  * @brief Calculate shared secret (j_inv) and destination curve coefficient (a +
- * 2)/4 = (A24p : C24) in xDBL form
+ * 2)/4 = (A24p : C24) in xDBL form. Workspace reserved for A is optional,
+ * see `ISOG_chain`.
  */
 void _msidh_key_exchange_alice(fp2_t j_inv, fp2_t A24p_final, fp2_t C24_final,
                                const fp2_t A24p_bob, const fp2_t C24_bob,
-                               struct tors_basis *BPQA, const pprod_t A, const mpz_t A_sec);
+                               struct tors_basis *BPQA, const pprod_t A, const mpz_t A_sec,
+                               struct isog_workspace *ws);
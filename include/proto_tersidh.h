@@ -2,7 +2,9 @@
 
 #include <gmp.h>
 
+#include "ec_mont.h"
 #include "ec_tors_basis.h"
+#include "isog_mont.h"
 #include "pprod.h"
 
 // Number of prime numbers used by a single party
@@ -21,6 +23,11 @@ enum {
     TERSIDH_STATUS_EXCHANGED
 };
 
+struct tersidh_data {
+    int t, f;
+    fp2_t a, xP, xQ, xR;
+};
+
 struct tersidh_state {
     gmp_randstate_t randstate;
 
@@ -48,15 +55,25 @@ struct tersidh_state {
     // Shared Key -> j_invariant
     fp2_t j_inv;
 
+    // Values derived only from the public parameters of the last prepare,
+    // reused while the parameters and the side do not change: both torsion
+    // bases, the fixed-base tables of PQ_self.P and PQ_self.Q for the kernel
+    // points and the isogeny workspace of my degree, shared by the chains of
+    // KP and KQ. Parameter t is 0 if nothing is cached.
+    struct tersidh_data cache_params;
+    int cache_is_bob;
+    struct tors_basis PQ_self_base, PQ_pubkey_base;
+    struct ladder_table table_P, table_Q;
+    struct isog_workspace ws;
+
+    // Field context with the characteristic p, active in the calling thread
+    // only during the state functions
+    fp_ctx_t ctx;
+
     // Current state of the protocol
     int status;
 };
 
-struct tersidh_data {
-    int t, f;
-    fp2_t a, xP, xQ, xR;
-};
-
 struct tersidh_const_data {
     int t, f;
     const char *a_str, *xP_str, *xQ_str, *xR_str;
@@ -68,6 +85,23 @@ void tersidh_data_init(struct tersidh_data *td);
 
 void tersidh_data_clear(struct tersidh_data *td);
 
+/*
+ * @brief Size of the binary encoding of the data under the active field
+ * context: t and f as 32-bit little-endian integers followed by a, xP, xQ and
+ * xR, see `fp2_to_bytes`
+ */
+size_t tersidh_data_packed_size();
+
+// Write data into tersidh_data_packed_size() bytes
+void tersidh_data_pack(unsigned char *buf, const struct tersidh_data *td);
+
+/*
+ * @brief Read data written by `tersidh_data_pack`. Return 0 on success, -1 if
+ * t is out of the range [TERSIDH_TMIN, TERSIDH_TMAX], f is not positive or some
+ * element is not reduced.
+ */
+int tersidh_data_unpack(struct tersidh_data *td, const unsigned char *buf);
+
 void tersidh_state_init(struct tersidh_state *tersidh);
 
 void tersidh_state_clear(struct tersidh_state *tersidh);
@@ -80,10 +114,32 @@ void tersidh_state_prepare(struct tersidh_state *tersidh,
 void tersidh_key_exchange(struct tersidh_state *tersidh,
                         const struct tersidh_data *pk_other);
 
+/*
+ * @brief Size of the shared secret encoding, fp2_nbytes() of the state
+ * characteristic
+ */
+size_t tersidh_shared_secret_size(const struct tersidh_state *tersidh);
+
+/*
+ * @brief Write the shared j-invariant after the key exchange into
+ * tersidh_shared_secret_size() bytes. Encoding is canonical (fixed length, both
+ * coordinates reduced, see `fp2_to_bytes`), so both parties get equal bytes
+ * suitable as the KDF input.
+ */
+void tersidh_get_shared_secret(const struct tersidh_state *tersidh,
+                               unsigned char *buf);
+
 void tersidh_get_pubkey(const struct tersidh_state *tersidh,
                       struct tersidh_data *pk_self);
 
-void tersidh_generate_kernel_points(struct tersidh_state* tersidh, int skip_secret);
+/*
+ * @brief Generate the kernel points KP and KQ from PQ_self. If the tables of
+ * PQ_self.P and PQ_self.Q are given, the fixed-base ladders are used,
+ * otherwise they are NULL.
+ */
+void tersidh_generate_kernel_points(struct tersidh_state* tersidh, int skip_secret,
+                                    const struct ladder_table *table_P,
+                                    const struct ladder_table *table_Q);
 
 /*
  * @brief Given security parameter t, and cofactor generate public params used
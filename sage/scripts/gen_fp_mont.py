@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+#
+# Generate Montgomery multiplication and squaring specialized for the single
+# MSIDH characteristic p = f * A * B - 1: limb count, p and -p^-1 (mod 2^64)
+# become compile-time constants of the unrolled MULX/ADX rows. The output is
+# included by `src/fp_mont.c` when compiled with FP_MONT_SPEC (see
+# `make FP_SPEC=<t> lib`). Plain python, sage is not required.
+
+import argparse
+import pathlib
+import random
+import sys
+
+sys.path.insert(0, str(pathlib.Path(__file__).resolve().parents[1]))
+
+from isogencrypt_sage.utils import print_error_and_exit, print_info, print_ok
+
+LIMB_BITS = 64
+LIMB_MASK = (1 << LIMB_BITS) - 1
+
+TEMPLATE = """// Auto-generated code using gen_fp_mont.py script, do not edit.
+// MSIDH characteristic t = {t}, f = {f}: {bits}-bit prime, {n} limbs.
+// Included by src/fp_mont.c, selected at setup when the characteristic is
+// equal to the one below.
+
+#define FP_SPEC_N {n}
+
+// -p^-1 (mod 2^64)
+#define FP_SPEC_PINV {pinv:#018x}ULL
+
+static const mp_limb_t FP_SPEC_P[FP_SPEC_N] = {{
+{p_limbs}
+}};
+
+#ifdef FP_MONT_X86
+FP_ADX_KERNELS_P(spec, FP_SPEC_N, FP_SPEC_P, FP_SPEC_PINV)
+#endif
+"""
+
+
+def msidh_primes(count: int) -> tuple[list[int], list[int]]:
+    """Prime factors of A and B, same as PRIMES_ALICE and PRIMES_BOB"""
+    primes, c = [], 2
+    while len(primes) < count:
+        if all(c % q for q in primes if q * q <= c):
+            primes.append(c)
+        c += 1
+    alice, bob = primes[0::2], primes[1::2]
+    alice[0] = 4
+    return alice, bob
+
+
+def is_probable_prime(n: int, rounds: int = 40) -> bool:
+    if n < 4:
+        return n in (2, 3)
+    d, s = n - 1, 0
+    while d % 2 == 0:
+        d, s = d // 2, s + 1
+    rng = random.Random(n)
+    for _ in range(rounds):
+        x = pow(rng.randrange(2, n - 1), d, n)
+        if x in (1, n - 1):
+            continue
+        for _ in range(s - 1):
+            x = x * x % n
+            if x == n - 1:
+                break
+        else:
+            return False
+    return True
+
+
+def msidh_prime(t: int, f: int | None) -> tuple[int, int]:
+    """Return (p, f) for p = f * A * B - 1, smallest cofactor if f is None"""
+    alice, bob = msidh_primes(t)
+    AB = 1
+    for q in alice[: (t + 1) // 2] + bob[: t // 2]:
+        AB *= q
+    for f in [f] if f is not None else range(1, 1000):
+        p = f * AB - 1
+        if is_probable_prime(p):
+            return p, f
+    raise ValueError(f"Cannot find cofactor f for t = {t}")
+
+
+def limbs(x: int, n: int) -> list[int]:
+    return [(x >> (LIMB_BITS * i)) & LIMB_MASK for i in range(n)]
+
+
+def generate(t: int, f: int | None) -> str:
+    p, f = msidh_prime(t, f)
+    n = (p.bit_length() + LIMB_BITS - 1) // LIMB_BITS
+    pl = limbs(p, n)
+    pinv = -pow(p, -1, 1 << LIMB_BITS) & LIMB_MASK
+
+    rows = [pl[i : i + 3] for i in range(0, n, 3)]
+    p_limbs = "\n".join(
+        "    " + " ".join(f"{x:#018x}ULL," for x in row) for row in rows
+    )
+    return TEMPLATE.format(
+        t=t, f=f, bits=p.bit_length(), n=n, pinv=pinv, p_limbs=p_limbs
+    )
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(
+        prog="gen_fp_mont",
+        description="Generate Montgomery kernels specialized for the MSIDH prime",
+    )
+    parser.add_argument("-t", type=int, required=True, help="MSIDH parameter t")
+    parser.add_argument(
+        "-f", type=int, help="Cofactor of p (default: smallest valid one)"
+    )
+    parser.add_argument(
+        "-o", "--output", default="fp_mont_spec.h", help="Output file"
+    )
+    args = parser.parse_args()
+
+    try:
+        code = generate(args.t, args.f)
+    except ValueError as e:
+        print_error_and_exit(str(e))
+
+    print_info(f"Dumping generated C code into: {args.output}")
+    pathlib.Path(args.output).parent.mkdir(parents=True, exist_ok=True)
+    with open(args.output, "w") as out:
+        out.write(code)
+    print_ok("Success")
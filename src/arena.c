@@ -0,0 +1,261 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "arena.h"
+#include "ec_point_xz.h"
+#include "fp2.h"
+
+// Minimal size of the chunk of raw memory
+#define ARENA_CHUNK (64 * 1024)
+
+// Registers of one kind, allocated in blocks of `per_block` elements so their
+// addresses stay valid when the pool grows. Elements [0, top) are borrowed.
+struct arena_pool {
+    void **blocks;
+    size_t n_blocks, top;
+    size_t elem_size, per_block;
+    void (*init)(void *);
+    void (*clear)(void *);
+};
+
+// Vectors of fp2 elements, each one keeps its own length. Vectors [0, top) are
+// borrowed.
+struct arena_vecs {
+    struct arena_vec {
+        fp2_vec_t x;
+        size_t len;
+    } *items;
+    size_t n_items, top;
+};
+
+struct arena {
+    struct arena_pool fp2, fp2_batch, points, scratch;
+    struct arena_vecs vecs;
+    // Raw memory continues in chunks[raw_chunk] at offset raw_used
+    unsigned char **chunks;
+    size_t *chunk_size;
+    size_t n_chunks, raw_chunk, raw_used;
+};
+
+static _Thread_local struct arena *g_arena = NULL;
+
+// The key only runs the destructor at the thread exit
+static pthread_key_t g_arena_key;
+static pthread_once_t g_arena_once = PTHREAD_ONCE_INIT;
+
+static void _init_fp2(void *x) { fp2_init_storage(x); }
+static void _clear_fp2(void *x) { fp2_clear_storage(x); }
+static void _init_fp2_batch(void *s) {
+    for (int i = 0; i < FP2_MUL_BATCH; i++) {
+        fp2_scratch_init((struct fp2_scratch *)s + i);
+    }
+}
+static void _clear_fp2_batch(void *s) {
+    for (int i = 0; i < FP2_MUL_BATCH; i++) {
+        fp2_scratch_clear((struct fp2_scratch *)s + i);
+    }
+}
+static void _init_point(void *ps) { point_init_storage(ps); }
+static void _clear_point(void *ps) { point_clear_storage(ps); }
+static void _init_scratch(void *s) { ec_scratch_init(s); }
+static void _clear_scratch(void *s) { ec_scratch_clear(s); }
+
+static void _pool_setup(struct arena_pool *pl, size_t elem_size,
+                        size_t per_block, void (*init)(void *),
+                        void (*clear)(void *)) {
+    pl->blocks = NULL;
+    pl->n_blocks = 0;
+    pl->top = 0;
+    pl->elem_size = elem_size;
+    pl->per_block = per_block;
+    pl->init = init;
+    pl->clear = clear;
+}
+
+static void *_pool_get(struct arena_pool *pl) {
+    size_t b = pl->top / pl->per_block;
+    if (b == pl->n_blocks) {
+        pl->blocks = realloc(pl->blocks, (b + 1) * sizeof(void *));
+        unsigned char *block = malloc(pl->per_block * pl->elem_size);
+        for (size_t i = 0; i < pl->per_block; i++) {
+            pl->init(block + i * pl->elem_size);
+        }
+        pl->blocks[b] = block;
+        pl->n_blocks++;
+    }
+    unsigned char *block = pl->blocks[b];
+    return block + (pl->top++ % pl->per_block) * pl->elem_size;
+}
+
+static void _pool_free(struct arena_pool *pl) {
+    for (size_t b = 0; b < pl->n_blocks; b++) {
+        unsigned char *block = pl->blocks[b];
+        for (size_t i = 0; i < pl->per_block; i++) {
+            pl->clear(block + i * pl->elem_size);
+        }
+        free(block);
+    }
+    free(pl->blocks);
+}
+
+static void _vecs_free(struct arena_vecs *vs) {
+    for (size_t i = 0; i < vs->n_items; i++) {
+        fp2_vec_clear(&vs->items[i].x, vs->items[i].len);
+    }
+    free(vs->items);
+}
+
+static void _arena_free(void *ptr) {
+    struct arena *a = ptr;
+    _pool_free(&a->fp2);
+    _pool_free(&a->fp2_batch);
+    _pool_free(&a->points);
+    _pool_free(&a->scratch);
+    _vecs_free(&a->vecs);
+    for (size_t i = 0; i < a->n_chunks; i++) {
+        free(a->chunks[i]);
+    }
+    free(a->chunks);
+    free(a->chunk_size);
+    free(a);
+}
+
+static void _create_key() { pthread_key_create(&g_arena_key, _arena_free); }
+
+// Arena of the calling thread, created on the first use
+static struct arena *_arena() {
+    if (g_arena != NULL) {
+        return g_arena;
+    }
+
+    struct arena *a = calloc(1, sizeof(struct arena));
+    // Fp2 temporaries are needed in the largest numbers, ec_scratch is the
+    // largest structure
+    _pool_setup(&a->fp2, sizeof(fp2_elem), 64, _init_fp2, _clear_fp2);
+    _pool_setup(&a->fp2_batch, FP2_MUL_BATCH * sizeof(struct fp2_scratch), 4,
+                _init_fp2_batch, _clear_fp2_batch);
+    _pool_setup(&a->points, sizeof(struct point_storage), 32, _init_point,
+                _clear_point);
+    _pool_setup(&a->scratch, sizeof(struct ec_scratch), 2, _init_scratch,
+                _clear_scratch);
+
+    pthread_once(&g_arena_once, _create_key);
+    pthread_setspecific(g_arena_key, a);
+    g_arena = a;
+    return a;
+}
+
+arena_frame_t arena_push() {
+    struct arena *a = _arena();
+    arena_frame_t frame = {
+        .n_fp2 = a->fp2.top,
+        .n_fp2_batch = a->fp2_batch.top,
+        .n_points = a->points.top,
+        .n_scratch = a->scratch.top,
+        .n_vecs = a->vecs.top,
+        .raw_chunk = a->raw_chunk,
+        .raw_used = a->raw_used,
+    };
+    return frame;
+}
+
+void arena_pop(arena_frame_t frame) {
+    struct arena *a = g_arena;
+    assert(a != NULL && frame.n_fp2 <= a->fp2.top &&
+           frame.n_fp2_batch <= a->fp2_batch.top &&
+           frame.n_points <= a->points.top &&
+           frame.n_scratch <= a->scratch.top &&
+           frame.n_vecs <= a->vecs.top && "Popping frame twice");
+    a->fp2.top = frame.n_fp2;
+    a->fp2_batch.top = frame.n_fp2_batch;
+    a->points.top = frame.n_points;
+    a->scratch.top = frame.n_scratch;
+    a->vecs.top = frame.n_vecs;
+    a->raw_chunk = frame.raw_chunk;
+    a->raw_used = frame.raw_used;
+}
+
+fp2_t arena_fp2() { return _pool_get(&_arena()->fp2); }
+
+struct fp2_scratch *arena_fp2_scratch_batch() {
+    return _pool_get(&_arena()->fp2_batch);
+}
+
+// Storage starts with the point structure
+point_t arena_point() {
+    struct point_storage *ps = _pool_get(&_arena()->points);
+    return &ps->P;
+}
+
+struct ec_scratch *arena_scratch() { return _pool_get(&_arena()->scratch); }
+
+fp2_vec_t arena_fp2_vec(size_t n) {
+    struct arena_vecs *vs = &_arena()->vecs;
+    if (vs->top == vs->n_items) {
+        vs->items =
+            realloc(vs->items, (vs->n_items + 1) * sizeof(struct arena_vec));
+        vs->items[vs->n_items].x = NULL;
+        vs->items[vs->n_items].len = 0;
+        vs->n_items++;
+    }
+
+    struct arena_vec *v = &vs->items[vs->top++];
+    if (v->len < n) {
+        // Elements can be moved in memory, only the new ones are initialized
+        v->x = realloc(v->x, n * sizeof(fp2_elem));
+        for (size_t i = v->len; i < n; i++) {
+            fp2_init_storage(&v->x[i]);
+        }
+        v->len = n;
+    }
+    return v->x;
+}
+
+void arena_point_vec(struct point_vec *v, size_t n) {
+    v->X = arena_fp2_vec(2 * n);
+    v->Z = v->X + n;
+    v->n = n;
+}
+
+// Coordinates a, b of the consecutive fp2 elements form one array of fp_t
+_Static_assert(sizeof(fp2_elem) == 2 * sizeof(fp_t), "fp2_elem is padded");
+
+fp_t *arena_fp_vec(size_t n) { return (fp_t *)arena_fp2_vec((n + 1) / 2); }
+
+void *arena_alloc(size_t size) {
+    struct arena *a = _arena();
+    size = (size + 15) & ~(size_t)15;
+
+    // Chunks too small for this request are skipped, but kept for later
+    while (a->raw_chunk < a->n_chunks &&
+           a->raw_used + size > a->chunk_size[a->raw_chunk]) {
+        a->raw_chunk++;
+        a->raw_used = 0;
+    }
+    if (a->raw_chunk == a->n_chunks) {
+        size_t n = a->n_chunks + 1;
+        a->chunks = realloc(a->chunks, n * sizeof(unsigned char *));
+        a->chunk_size = realloc(a->chunk_size, n * sizeof(size_t));
+        a->chunk_size[a->n_chunks] = size > ARENA_CHUNK ? size : ARENA_CHUNK;
+        a->chunks[a->n_chunks] =
+            aligned_alloc(16, a->chunk_size[a->n_chunks]);
+        a->n_chunks = n;
+    }
+
+    void *ptr = a->chunks[a->raw_chunk] + a->raw_used;
+    a->raw_used += size;
+    return ptr;
+}
+
+void arena_release() {
+    if (g_arena == NULL) {
+        return;
+    }
+    assert(g_arena->fp2.top == 0 && g_arena->fp2_batch.top == 0 &&
+           g_arena->points.top == 0 && g_arena->vecs.top == 0 &&
+           g_arena->scratch.top == 0 && "Releasing arena with open frames");
+    pthread_setspecific(g_arena_key, NULL);
+    _arena_free(g_arena);
+    g_arena = NULL;
+}
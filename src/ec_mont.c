@@ -1,47 +1,68 @@
 #include <gmp.h>
 
+#include "arena.h"
 #include "ec_mont.h"
 
 void xDBL(point_t R, const point_t P, const fp2_t A24p, const fp2_t C24) {
-    fp2_t t0, t1;
-    fp2_init(&t0);
-    fp2_init(&t1);
+    arena_frame_t frame = arena_push();
+    struct ec_scratch *s = arena_scratch();
+    xDBL_scr(R, P, A24p, C24, s);
+    arena_pop(frame);
+}
+
+void xDBL_scr(point_t R, const point_t P, const fp2_t A24p, const fp2_t C24,
+              struct ec_scratch *s) {
+    fp2_t t0 = &s->t[0], t1 = &s->t[1];
 
     // P = (X : Z)
     fp2_sub(t0, P->X, P->Z); // t0 = X - Z
     fp2_add(t1, P->X, P->Z); // t1 = X + Z
 
     // Warning! Must use "safe" function for square-ing
-    fp2_sq_safe(t0); // t0 = (X - Z)^2
-    fp2_sq_safe(t1); // t1 = (X + Z)^2
+    fp2_sq_safe_scr(t0, &s->fs); // t0 = (X - Z)^2
+    fp2_sq_safe_scr(t1, &s->fs); // t1 = (X + Z)^2
 
-    fp2_mul_unsafe(R->Z, t0, C24);  // Z' = (X - Z)^2 * C24
-    fp2_mul_unsafe(R->X, R->Z, t1); // X' = (X + Z)^2 * (X - Z)^2 * C24
+    // Z' = (X - Z)^2 * C24
+    fp2_mul_unsafe_scr(R->Z, t0, C24, &s->fs);
+    // X' = (X + Z)^2 * (X - Z)^2 * C24
+    fp2_mul_unsafe_scr(R->X, R->Z, t1, &s->fs);
 
-    fp2_sub(t1, t1, t0);          // t1 = (X + Z)^2 - (X - Z)^2
-    fp2_mul_unsafe(t0, A24p, t1); // t0 = A24p * [(X + Z)^2 - (X - Z)^2]
+    // t1 = (X + Z)^2 - (X - Z)^2
+    fp2_sub(t1, t1, t0);
+    // t0 = A24p * [(X + Z)^2 - (X - Z)^2]
+    fp2_mul_unsafe_scr(t0, A24p, t1, &s->fs);
 
     // Z' = A24p * [(X + Z)^2 - (X - Z)^2] + (X - Z)^2 * C24
     fp2_add(R->Z, R->Z, t0);
     // Z' = { A24p * [(X + Z)^2 - (X - Z)^2] + C24 (X - Z)^2] } [(X + Z)^2 - (X
     // - Z)^2]
-    fp2_mul_safe(R->Z, t1);
-
-    fp2_clear(&t0);
-    fp2_clear(&t1);
+    fp2_mul_safe_scr(R->Z, t1, &s->fs);
 }
 
 void xDBLe(point_t R, const point_t P, const fp2_t A24p, const fp2_t C24,
            const int e) {
+    arena_frame_t frame = arena_push();
+    struct ec_scratch *s = arena_scratch();
+
     point_set(R, P);
     // Repeat the step of doubling multiple times
     for (int i = 0; i < e; i++) {
-        xDBL(R, R, A24p, C24);
+        xDBL_scr(R, R, A24p, C24, s);
     }
+
+    arena_pop(frame);
 }
 
 void xADD(point_t PQsum, const point_t P, const point_t Q,
           const point_t PQdiff) {
+    arena_frame_t frame = arena_push();
+    struct ec_scratch *s = arena_scratch();
+    xADD_scr(PQsum, P, Q, PQdiff, s);
+    arena_pop(frame);
+}
+
+void xADD_scr(point_t PQsum, const point_t P, const point_t Q,
+              const point_t PQdiff, struct ec_scratch *s) {
     // Function is argument safe for calling PQSum = Q or P or PQdiff
     // Given P, Q and PQdiff = P-Q output P+Q
 
@@ -53,11 +74,8 @@ void xADD(point_t PQsum, const point_t P, const point_t Q,
     // X' = ZR * [(XP - ZP)(XQ + ZQ) + (XP + ZP)(XQ - ZQ)]^2
     // Z' = XR * [(XP - ZP)(XQ + ZQ) - (XP + ZP)(XQ - ZQ)]^2
 
-    fp2_t t0, t1, t2, t3;
-    fp2_init(&t0);
-    fp2_init(&t1);
-    fp2_init(&t2);
-    fp2_init(&t3);
+    fp2_t t0 = &s->t[0], t1 = &s->t[1], t2 = &s->t[2], t3 = &s->t[3];
+    struct fp2_acc *ad = &s->w[0], *bc = &s->w[1];
 
     // Defining additional variables:
     // a: XP + ZP
@@ -72,84 +90,378 @@ void xADD(point_t PQsum, const point_t P, const point_t Q,
     fp2_add(t2, Q->X, Q->Z); // t2 = c: xQ + zQ
     fp2_sub(t3, Q->X, Q->Z); // t3 = d: xQ - zQ
 
-    fp2_mul_safe(t0, t3); // t0 = t0 * t3: a * d
-    fp2_mul_safe(t1, t2); // t1 = t1 * t2: b * c
+    // Products stay unreduced, the sum and the difference are reduced once
+    fp2_mul_wide(ad, t0, t3, &s->fs); // ad = a * d
+    fp2_mul_wide(bc, t1, t2, &s->fs); // bc = b * c
 
-    fp2_add(t2, t0, t1); // t2 = t0 + t1: ad + bc
-    fp2_sub(t3, t0, t1); // t3 = t0 - t1: ad - bc
+    fp2_acc_add(ad, ad, bc);
+    fp2_acc_reduce(t2, ad); // t2 = ad + bc
+    fp2_acc_sub(ad, ad, bc);
+    fp2_acc_sub(ad, ad, bc);
+    fp2_acc_reduce(t3, ad); // t3 = (ad + bc) - 2bc: ad - bc
 
     fp2_sq_unsafe(t0, t2); // t0 = t2^2: (ad + bc)^2
     fp2_sq_unsafe(t1, t3); // t1 = t3^2: (ad - bc)^2
 
     // We must use t2 to not override the used later PQdiff->X in scenario when
     // PQsum = PQdiff t2 = t0 * Z(P-Q): (ad + bc)^2 * Z(P-Q)
-    fp2_mul_unsafe(t2, t0, PQdiff->Z);
+    fp2_mul_unsafe_scr(t2, t0, PQdiff->Z, &s->fs);
     // Z' = t1 * X(P-Q): (ad - bc)^2 * Z(P-Q)
-    fp2_mul_unsafe(PQsum->Z, t1, PQdiff->X);
+    fp2_mul_unsafe_scr(PQsum->Z, t1, PQdiff->X, &s->fs);
     // X' = t2
     fp2_set(PQsum->X, t2);
-
-    fp2_clear(&t0);
-    fp2_clear(&t1);
-    fp2_clear(&t2);
-    fp2_clear(&t3);
 }
 
-// Out: P = 2P, Q = P + Q
-// TODO: check argument-safeness
-// TODO: think about expressing function
-// as set of arithmetic instructions
-// instead of combinatin of 2 function calls
 void xDBLADD(point_t P, point_t Q, const point_t PQdiff, const fp2_t A24p,
              const fp2_t C24) {
-    xADD(Q, P, Q, PQdiff);
-    xDBL(P, P, A24p, C24);
+    arena_frame_t frame = arena_push();
+    struct ec_scratch *s = arena_scratch();
+    xDBLADD_scr(P, Q, PQdiff, A24p, C24, s);
+    arena_pop(frame);
+}
+
+// Shared part of the xDBLADD variants: t0 = a, t1 = b, t2 = ad + bc and
+// t3 = ad - bc, see xDBLADD_scr
+static void _xDBLADD_sums(const point_t P, const point_t Q,
+                          struct ec_scratch *s) {
+    fp2_t t0 = &s->t[0], t1 = &s->t[1], t2 = &s->t[2], t3 = &s->t[3];
+    struct fp2_acc *ad = &s->w[0], *bc = &s->w[1];
+
+    fp2_add(t0, P->X, P->Z); // t0 = a
+    fp2_sub(t1, P->X, P->Z); // t1 = b
+    fp2_add(t2, Q->X, Q->Z); // t2 = c
+    fp2_sub(t3, Q->X, Q->Z); // t3 = d
+
+    // Sum and difference of the unreduced products are reduced once
+    fp2_mul_wide(ad, t0, t3, &s->fs);
+    fp2_mul_wide(bc, t1, t2, &s->fs);
+    fp2_acc_add(ad, ad, bc);
+    fp2_acc_reduce(t2, ad); // t2 = ad + bc
+    fp2_acc_sub(ad, ad, bc);
+    fp2_acc_sub(ad, ad, bc);
+    fp2_acc_reduce(t3, ad); // t3 = ad - bc
+}
+
+void xDBLADD_scr(point_t P, point_t Q, const point_t PQdiff, const fp2_t A24p,
+                 const fp2_t C24, struct ec_scratch *s) {
+    // Fused xDBL and xADD sharing XP + ZP and XP - ZP
+    // (Costello, Smith: "Montgomery curves and their arithmetic", alg. 5)
+    // Cost: 8M + 4S + 8a, 2 of the multiplications are by C24 and A24p
+    //
+    // a: XP + ZP, b: XP - ZP, c: XQ + ZQ, d: XQ - ZQ
+    // [2]P = (C24 a^2 b^2 : (a^2 - b^2)(C24 b^2 + A24p (a^2 - b^2)))
+    // P + Q = (ZR (ad + bc)^2 : XR (ad - bc)^2)
+    assert(P != Q && P != PQdiff && Q != PQdiff &&
+           "xDBLADD cannot be called with aliased points");
+
+    fp2_t t0 = &s->t[0], t1 = &s->t[1], t2 = &s->t[2], t3 = &s->t[3];
+    _xDBLADD_sums(P, Q, s);
+
+    // Doubling, P is not read anymore
+    fp2_sq_safe_scr(t0, &s->fs);                // t0 = a^2
+    fp2_sq_safe_scr(t1, &s->fs);                // t1 = b^2
+    fp2_mul_unsafe_scr(P->Z, t1, C24, &s->fs);  // ZP = C24 b^2
+    fp2_mul_unsafe_scr(P->X, P->Z, t0, &s->fs); // XP = C24 a^2 b^2
+    fp2_sub(t0, t0, t1);                        // t0 = a^2 - b^2
+    fp2_mul_unsafe_scr(t1, A24p, t0, &s->fs);   // t1 = A24p (a^2 - b^2)
+    fp2_add(P->Z, P->Z, t1);
+    fp2_mul_safe_scr(P->Z, t0, &s->fs);
+
+    // Differential addition, Q is not read anymore
+    fp2_sq_unsafe(t0, t2);                           // t0 = (ad + bc)^2
+    fp2_sq_unsafe(t1, t3);                           // t1 = (ad - bc)^2
+    fp2_mul_unsafe_scr(Q->X, t0, PQdiff->Z, &s->fs); // XQ = ZR (ad + bc)^2
+    fp2_mul_unsafe_scr(Q->Z, t1, PQdiff->X, &s->fs); // ZQ = XR (ad - bc)^2
+}
+
+void xDBLADD_norm_scr(point_t P, point_t Q, const point_t PQdiff,
+                      const fp2_t A24, int affine, struct ec_scratch *s) {
+    // Same as xDBLADD_scr with C24 = 1, the multiplication by ZR is skipped
+    // for the affine difference
+    // Cost: 7M + 4S + 8a, or 6M + 4S + 8a with ZR = 1
+    assert(P != Q && P != PQdiff && Q != PQdiff &&
+           "xDBLADD cannot be called with aliased points");
+    assert((!affine || point_is_normalized(PQdiff)) &&
+           "Difference is not affine");
+
+    fp2_t t0 = &s->t[0], t1 = &s->t[1], t2 = &s->t[2], t3 = &s->t[3];
+    _xDBLADD_sums(P, Q, s);
+
+    // Doubling, P is not read anymore
+    fp2_sq_safe_scr(t0, &s->fs);               // t0 = a^2
+    fp2_sq_safe_scr(t1, &s->fs);               // t1 = b^2
+    fp2_mul_unsafe_scr(P->X, t0, t1, &s->fs);  // XP = a^2 b^2
+    fp2_sub(t0, t0, t1);                       // t0 = a^2 - b^2
+    fp2_mul_unsafe_scr(P->Z, A24, t0, &s->fs); // ZP = A24 (a^2 - b^2)
+    fp2_add(P->Z, P->Z, t1);
+    fp2_mul_safe_scr(P->Z, t0, &s->fs);
+
+    // Differential addition, Q is not read anymore
+    if (affine) {
+        fp2_sq_unsafe(Q->X, t2); // XQ = (ad + bc)^2
+    } else {
+        fp2_sq_unsafe(t0, t2);
+        fp2_mul_unsafe_scr(Q->X, t0, PQdiff->Z, &s->fs);
+    }
+    fp2_sq_unsafe(t1, t3);
+    fp2_mul_unsafe_scr(Q->Z, t1, PQdiff->X, &s->fs); // ZQ = XR (ad - bc)^2
+}
+
+// Normalizing the curve costs an inversion, which is paid back by the saved
+// multiplications only for the longer scalars
+#define LADDER_NORM_MIN_BITS 128
+
+/*
+ * @brief Set A24 = A24p / C24 if the ladder over n_bits bits runs faster with
+ * C24 = 1, return 0 otherwise
+ */
+static int _ladder_norm_curve(fp2_t A24, const fp2_t A24p, const fp2_t C24,
+                              size_t n_bits) {
+    if (fp2_equal_uint(C24, 1)) {
+        fp2_set(A24, A24p);
+        return 1;
+    }
+    if (n_bits < LADDER_NORM_MIN_BITS) {
+        return 0;
+    }
+    fp2_inv_unsafe(A24, C24);
+    fp2_mul_safe(A24, A24p);
+    return 1;
 }
 
 void xLADDER(point_t R0, const point_t P, const mpz_t m, const fp2_t A24p,
              const fp2_t C24) {
     assert(mpz_sgn(m) > 0 && "Given scalar m must be nonnegative");
 
-    mpz_t r;
-    mpz_init(r);
+    arena_frame_t frame = arena_push();
+    struct ec_scratch *s = arena_scratch();
 
-    point_t R1;
-    point_init(&R1);
+    // R1 is stored inside the scratch, not used by xDBLADD
+    point_t R1 = &s->R.P;
 
     // R0 = P, R1 = [2]R
     point_set(R0, P);
-    xDBL(R1, P, A24p, C24);
+    xDBL_scr(R1, P, A24p, C24, s);
 
     // Get number of "active" bits
     int n_bits = mpz_sizeinbase(m, 2);
 
+    // Steps with C24 = 1 and the affine difference P save 2M each
+    fp2_t A24 = arena_fp2();
+    int norm = _ladder_norm_curve(A24, A24p, C24, n_bits);
+    int affine = point_is_normalized(P);
+
     // Iterate over bits downwards (leading bit not included).
-    // Invariant of the algorithm R1 - R0 = P
+    // Invariant of the algorithm R1 - R0 = P. Instead of branching on the bit
+    // of the scalar the registers are swapped when the bit changes, so both
+    // cases call xDBLADD with the same arguments.
+    int swap = 0;
     for (int bit = n_bits - 2; bit >= 0; bit--) {
-        // Bit is equal to 1
-        if (mpz_tstbit(m, bit)) {
-            // R1 = [2]R1; R0 = R0 + R1
-            xDBLADD(R1, R0, P, A24p, C24);
+        int b = mpz_tstbit(m, bit);
+        // Bit is equal to 1: R1 = [2]R1; R0 = R0 + R1
+        // Bit is equal to 0: R0 = [2]R0; R1 = R0 + R1
+        point_cswap(R0, R1, swap ^ b);
+        swap = b;
+        if (norm) {
+            xDBLADD_norm_scr(R0, R1, P, A24, affine, s);
         } else {
-            // R0 = [2]R0; R1 = R0 + R1
-            xDBLADD(R0, R1, P, A24p, C24);
+            xDBLADD_scr(R0, R1, P, A24p, C24, s);
         }
     }
+    point_cswap(R0, R1, swap);
 
-    mpz_clear(r);
-    point_clear(&R1);
+    arena_pop(frame);
+}
+
+// Registers of xLADDER_multi: ladder points R0, R1 and differences D, five
+// vectors of temporaries and the handles of the batched products, which do not
+// change between the steps
+struct ladder_multi {
+    size_t k;
+    struct point_vec R0, R1, D;
+    fp2_vec_t t0, t1, t2, t3, t4;
+    // XR0 = a^2 b^2, ZR0 = A24 (a^2 - b^2)
+    fp2_t *dbl_r, *dbl_x, *dbl_y;
+    // ZR0 *= a^2 - b^2, ZR1 = XD (ad - bc)^2, XR1 = ZD (ad + bc)^2
+    fp2_t *add_r, *add_x, *add_y;
+    struct fp2_scratch *fs;
+};
+
+static void _ladder_multi_setup(struct ladder_multi *L, size_t k,
+                                const fp2_t A24) {
+    L->k = k;
+    arena_point_vec(&L->R0, k);
+    arena_point_vec(&L->R1, k);
+    arena_point_vec(&L->D, k);
+    L->t0 = arena_fp2_vec(5 * k);
+    L->t1 = L->t0 + k;
+    L->t2 = L->t1 + k;
+    L->t3 = L->t2 + k;
+    L->t4 = L->t3 + k;
+    L->fs = arena_fp2_scratch_batch();
+
+    fp2_t *h = arena_alloc(15 * k * sizeof(fp2_t));
+    L->dbl_r = h;
+    L->dbl_x = h + 2 * k;
+    L->dbl_y = h + 4 * k;
+    L->add_r = h + 6 * k;
+    L->add_x = h + 9 * k;
+    L->add_y = h + 12 * k;
+    for (size_t i = 0; i < k; i++) {
+        L->dbl_r[i] = &L->R0.X[i];
+        L->dbl_x[i] = &L->t0[i];
+        L->dbl_y[i] = &L->t1[i];
+        L->dbl_r[k + i] = &L->R0.Z[i];
+        L->dbl_x[k + i] = A24;
+        L->dbl_y[k + i] = &L->t4[i];
+
+        L->add_r[i] = &L->R0.Z[i];
+        L->add_x[i] = &L->R0.Z[i];
+        L->add_y[i] = &L->t4[i];
+        L->add_r[k + i] = &L->R1.Z[i];
+        L->add_x[k + i] = &L->t3[i];
+        L->add_y[k + i] = &L->D.X[i];
+        L->add_r[2 * k + i] = &L->R1.X[i];
+        L->add_x[2 * k + i] = &L->t0[i];
+        L->add_y[2 * k + i] = &L->D.Z[i];
+    }
+}
+
+// Step of xLADDER_multi on the curve with C24 = 1, same formulas as
+// xDBLADD_norm_scr with the independent products of all points batched
+static void _ladder_multi_step(struct ladder_multi *L, int affine,
+                               struct ec_scratch *s) {
+    const size_t k = L->k;
+    struct fp2_acc *ad = &s->w[0], *bc = &s->w[1];
+
+    fp2_vec_add(L->t0, L->R0.X, L->R0.Z, k); // t0 = a
+    fp2_vec_sub(L->t1, L->R0.X, L->R0.Z, k); // t1 = b
+    fp2_vec_add(L->t2, L->R1.X, L->R1.Z, k); // t2 = c
+    fp2_vec_sub(L->t3, L->R1.X, L->R1.Z, k); // t3 = d
+    for (size_t i = 0; i < k; i++) {
+        fp2_mul_wide(ad, &L->t0[i], &L->t3[i], &s->fs);
+        fp2_mul_wide(bc, &L->t1[i], &L->t2[i], &s->fs);
+        fp2_acc_add(ad, ad, bc);
+        fp2_acc_reduce(&L->t2[i], ad); // t2 = ad + bc
+        fp2_acc_sub(ad, ad, bc);
+        fp2_acc_sub(ad, ad, bc);
+        fp2_acc_reduce(&L->t3[i], ad); // t3 = ad - bc
+
+        fp2_sq_safe_scr(&L->t0[i], &s->fs); // t0 = a^2
+        fp2_sq_safe_scr(&L->t1[i], &s->fs); // t1 = b^2
+        fp2_sq_safe_scr(&L->t3[i], &s->fs); // t3 = (ad - bc)^2
+    }
+    fp2_vec_sub(L->t4, L->t0, L->t1, k); // t4 = a^2 - b^2
+    fp2_mul_batch(L->dbl_r, (const fp2_t *)L->dbl_x,
+                  (const fp2_t *)L->dbl_y, 2 * k, L->fs);
+    fp2_vec_add(L->R0.Z, L->R0.Z, L->t1, k);
+
+    // Affine difference: XR1 = (ad + bc)^2 without the product by ZD,
+    // otherwise t0 = (ad + bc)^2 (a^2 is not needed anymore)
+    for (size_t i = 0; i < k; i++) {
+        fp2_sq_unsafe(affine ? &L->R1.X[i] : &L->t0[i], &L->t2[i]);
+    }
+    fp2_mul_batch(L->add_r, (const fp2_t *)L->add_x,
+                  (const fp2_t *)L->add_y, affine ? 2 * k : 3 * k, L->fs);
+}
+
+void xLADDER_multi(point_t *R, const point_t *P, size_t k, const mpz_t m,
+                   const fp2_t A24p, const fp2_t C24) {
+    assert(mpz_sgn(m) > 0 && "Given scalar m must be nonnegative");
+    if (k == 0) {
+        return;
+    }
+
+    arena_frame_t frame = arena_push();
+    struct ec_scratch *s = arena_scratch();
+    fp2_t A24 = arena_fp2();
+    struct ladder_multi L;
+    _ladder_multi_setup(&L, k, A24);
+    struct point_xz *views = arena_alloc(3 * k * sizeof(struct point_xz));
+    point_t *R0 = arena_alloc(3 * k * sizeof(point_t));
+    point_t *R1 = R0 + k, *D = R1 + k;
+    for (size_t i = 0; i < k; i++) {
+        R0[i] = point_vec_at(&views[i], &L.R0, i);
+        R1[i] = point_vec_at(&views[k + i], &L.R1, i);
+        D[i] = point_vec_at(&views[2 * k + i], &L.D, i);
+        point_set(D[i], P[i]);
+    }
+
+    int n_bits = mpz_sizeinbase(m, 2);
+    int norm = 0, affine = 1;
+    if (n_bits >= LADDER_NORM_MIN_BITS) {
+        // Differences and C24 share a single inversion
+        fp2_vec_t z = arena_fp2_vec(k + 1);
+        for (size_t i = 0; i < k; i++) {
+            assert(!fp2_is_zero(&L.D.Z[i]) && "Point cannot have Z = 0");
+            fp2_set(&z[i], &L.D.Z[i]);
+        }
+        fp2_set(&z[k], C24);
+        fp2_vec_inv(z, z, k + 1);
+        fp2_vec_mul(L.D.X, L.D.X, z, k, L.fs);
+        for (size_t i = 0; i < k; i++) {
+            fp2_set_uint(&L.D.Z[i], 1);
+        }
+        fp2_mul_unsafe(A24, A24p, &z[k]);
+        norm = 1;
+    } else {
+        norm = _ladder_norm_curve(A24, A24p, C24, n_bits);
+        for (size_t i = 0; i < k; i++) {
+            affine &= point_is_normalized(D[i]);
+        }
+    }
+
+    // R0 = P, R1 = [2]P
+    for (size_t i = 0; i < k; i++) {
+        point_set(R0[i], D[i]);
+        xDBL_scr(R1[i], D[i], A24p, C24, s);
+    }
+
+    // Same bits and swaps as in xLADDER, shared by all points
+    int swap = 0;
+    for (int bit = n_bits - 2; bit >= 0; bit--) {
+        int b = mpz_tstbit(m, bit);
+        for (size_t i = 0; i < 2 * k; i++) {
+            fp2_cswap(&L.R0.X[i], &L.R1.X[i], swap ^ b);
+        }
+        swap = b;
+        if (norm) {
+            _ladder_multi_step(&L, affine, s);
+        } else {
+            for (size_t i = 0; i < k; i++) {
+                xDBLADD_scr(R0[i], R1[i], D[i], A24p, C24, s);
+            }
+        }
+    }
+    for (size_t i = 0; i < 2 * k; i++) {
+        fp2_cswap(&L.R0.X[i], &L.R1.X[i], swap);
+    }
+
+    for (size_t i = 0; i < k; i++) {
+        point_set(R[i], R0[i]);
+    }
+
+    arena_pop(frame);
 }
 
 void xLADDER_int(point_t R0, const point_t P, long int m, const fp2_t A24p,
                  const fp2_t C24) {
+    arena_frame_t frame = arena_push();
+    struct ec_scratch *s = arena_scratch();
+    xLADDER_int_scr(R0, P, m, A24p, C24, s);
+    arena_pop(frame);
+}
+
+void xLADDER_int_scr(point_t R0, const point_t P, long int m,
+                     const fp2_t A24p, const fp2_t C24, struct ec_scratch *s) {
     assert(m > 0 && "Given scalar m must be nonnegative");
 
-    point_t R1;
-    point_init(&R1);
+    // R1 is stored inside the scratch, not used by xDBLADD
+    point_t R1 = &s->R.P;
 
     // R0 = P, R1 = [2]R
     point_set(R0, P);
-    xDBL(R1, P, A24p, C24);
+    xDBL_scr(R1, P, A24p, C24, s);
 
     // Get number of "active" bits (count until leading bit is found)
     int bits = 0;
@@ -163,14 +475,12 @@ void xLADDER_int(point_t R0, const point_t P, long int m, const fp2_t A24p,
         // bit = 1
         if (m & (1 << bit)) {
             // R1 = [2]R1; R0 = R0 + R1
-            xDBLADD(R1, R0, P, A24p, C24);
+            xDBLADD_scr(R1, R0, P, A24p, C24, s);
         } else {
             // R0 = [2]R0; R1 = R0 + R1
-            xDBLADD(R0, R1, P, A24p, C24);
+            xDBLADD_scr(R0, R1, P, A24p, C24, s);
         }
     }
-
-    point_clear(&R1);
 }
 
 // calculate P = P + [m]Q
@@ -178,78 +488,261 @@ void xLADDER3PT_int(point_t P, point_t Q, point_t PQdiff, long int m,
                     const fp2_t A24p, const fp2_t C24) {
     assert(m >= 0 && "Given scalar m must be nonnegative");
 
+    arena_frame_t frame = arena_push();
+    struct ec_scratch *s = arena_scratch();
+
     while (m > 0) {
         if (m & 1)
-            xDBLADD(Q, P, PQdiff, A24p, C24);
+            xDBLADD_scr(Q, P, PQdiff, A24p, C24, s);
         else
-            xDBLADD(Q, PQdiff, P, A24p, C24);
+            xDBLADD_scr(Q, PQdiff, P, A24p, C24, s);
         m /= 2;
     }
+
+    arena_pop(frame);
 }
 
-// calculate P = P + [m]Q
 void xLADDER3PT(point_t P, point_t Q, point_t PQdiff, const mpz_t m,
                 const fp2_t A24p, const fp2_t C24) {
     assert(mpz_sgn(m) >= 0 && "Given scalar m must be nonnegative");
 
-    mpz_t r, n;
-    mpz_init(r);
-    mpz_init_set(n, m);
+    arena_frame_t frame = arena_push();
+    struct ec_scratch *s = arena_scratch();
+
+    // Iterate over bits upwards, the scalar is not modified. Registers P and
+    // PQdiff are swapped for the zero bits, see xLADDER:
+    // Bit is equal to 1: Q = [2]Q; P = P + Q
+    // Bit is equal to 0: Q = [2]Q; PQdiff = PQdiff + Q
+    size_t n_bits = mpz_sgn(m) > 0 ? mpz_sizeinbase(m, 2) : 0;
+
+    // The difference changes in every step, only C24 = 1 saves 1M
+    fp2_t A24 = arena_fp2();
+    int norm = _ladder_norm_curve(A24, A24p, C24, n_bits);
+
+    int swap = 0;
+    for (size_t bit = 0; bit < n_bits; bit++) {
+        int b = !mpz_tstbit(m, bit);
+        point_cswap(P, PQdiff, swap ^ b);
+        swap = b;
+        if (norm) {
+            xDBLADD_norm_scr(Q, P, PQdiff, A24, 0, s);
+        } else {
+            xDBLADD_scr(Q, P, PQdiff, A24p, C24, s);
+        }
+    }
+    point_cswap(P, PQdiff, swap);
 
-    while (mpz_sgn(n) > 0) {
-        // m = m//2; r = m % 2
-        mpz_fdiv_qr_ui(n, r, n, 2);
+    arena_pop(frame);
+}
 
-        if (mpz_sgn(r) > 0)
-            xDBLADD(Q, P, PQdiff, A24p, C24);
-        else
-            xDBLADD(Q, PQdiff, P, A24p, C24);
+void ladder_table_init(struct ladder_table *T) {
+    T->X = NULL;
+    T->n = 0;
+}
+
+void ladder_table_clear(struct ladder_table *T) {
+    fp2_vec_clear(&T->X, T->n);
+    T->n = 0;
+}
+
+void ladder_table_build(struct ladder_table *T, const point_t Q,
+                        size_t n_bits, const fp2_t A24p, const fp2_t C24) {
+    assert(n_bits > 0 && "Table must have at least one point");
+    ladder_table_clear(T);
+    fp2_vec_init(&T->X, n_bits);
+    T->n = n_bits;
+
+    arena_frame_t frame = arena_push();
+    struct ec_scratch *s = arena_scratch();
+    struct fp2_scratch *fs = arena_fp2_scratch_batch();
+    fp2_vec_t Z = arena_fp2_vec(n_bits);
+
+    // Projective doublings first, then a single inversion of all Z
+    struct point_xz view, prev;
+    fp2_set(&T->X[0], Q->X);
+    fp2_set(&Z[0], Q->Z);
+    for (size_t i = 1; i < n_bits; i++) {
+        prev.X = &T->X[i - 1];
+        prev.Z = &Z[i - 1];
+        view.X = &T->X[i];
+        view.Z = &Z[i];
+        xDBL_scr(&view, &prev, A24p, C24, s);
+        assert(!fp2_is_zero(&Z[i]) && "Table point is at infinity");
     }
+    fp2_vec_inv(Z, Z, n_bits);
+    fp2_vec_mul(T->X, T->X, Z, n_bits, fs);
 
-    mpz_clear(r);
-    mpz_clear(n);
+    arena_pop(frame);
+}
+
+// Differential addition R = R + B with the affine B = (xB : 1) given
+// D = R - B, cost: 4M + 2S. R and D cannot share memory.
+static void _xADD_affine(point_t R, const fp2_t xB, const point_t D,
+                         struct ec_scratch *s) {
+    fp2_t t0 = &s->t[0], t1 = &s->t[1], t2 = &s->t[2], t3 = &s->t[3];
+    struct fp2_acc *ad = &s->w[0], *bc = &s->w[1];
+
+    fp2_add(t0, R->X, R->Z); // t0 = a: XR + ZR
+    fp2_sub(t1, R->X, R->Z); // t1 = b: XR - ZR
+    fp2_add_uint(t2, xB, 1); // t2 = c: xB + 1
+    fp2_sub_uint(t3, xB, 1); // t3 = d: xB - 1
+
+    fp2_mul_wide(ad, t0, t3, &s->fs);
+    fp2_mul_wide(bc, t1, t2, &s->fs);
+    fp2_acc_add(ad, ad, bc);
+    fp2_acc_reduce(t2, ad); // t2 = ad + bc
+    fp2_acc_sub(ad, ad, bc);
+    fp2_acc_sub(ad, ad, bc);
+    fp2_acc_reduce(t3, ad); // t3 = ad - bc
+
+    fp2_sq_unsafe(t0, t2);
+    fp2_sq_unsafe(t1, t3);
+    fp2_mul_unsafe_scr(R->X, t0, D->Z, &s->fs); // X = ZD (ad + bc)^2
+    fp2_mul_unsafe_scr(R->Z, t1, D->X, &s->fs); // Z = XD (ad - bc)^2
+}
+
+// Right-to-left ladder on the bits [start, T->n) of m. Invariant before the
+// bit i: R1 = P + [m mod 2^i]Q and R2 = R1 - [2^i]Q, so both cases are a single
+// differential addition with the other register as the difference:
+// Bit is equal to 1: R1 = R1 + [2^i]Q
+// Bit is equal to 0: R2 = R2 - [2^i]Q
+static void _ladder_fixed(point_t R1, point_t R2, const struct ladder_table *T,
+                          const mpz_t m, size_t start, struct ec_scratch *s) {
+    assert(mpz_sizeinbase(m, 2) <= T->n && "Scalar is too large for table");
+
+    // Registers are swapped for the zero bits, see xLADDER3PT
+    int swap = 0;
+    for (size_t i = start; i < T->n; i++) {
+        int b = !mpz_tstbit(m, i);
+        point_cswap(R1, R2, swap ^ b);
+        swap = b;
+        _xADD_affine(R1, &T->X[i], R2, s);
+    }
+    point_cswap(R1, R2, swap);
+}
+
+void xLADDER3PT_fixed(point_t P, point_t PQdiff, const struct ladder_table *T,
+                      const mpz_t m) {
+    assert(mpz_sgn(m) >= 0 && "Given scalar m must be nonnegative");
+
+    arena_frame_t frame = arena_push();
+    struct ec_scratch *s = arena_scratch();
+
+    // R1 = P, R2 = P - Q
+    _ladder_fixed(P, PQdiff, T, m, 0, s);
+
+    arena_pop(frame);
+}
+
+void xLADDER_fixed(point_t R, const struct ladder_table *T, const mpz_t m) {
+    assert(mpz_sgn(m) > 0 && "Given scalar m must be positive");
+
+    arena_frame_t frame = arena_push();
+    struct ec_scratch *s = arena_scratch();
+    point_t R2 = &s->R.P;
+
+    // The lowest set bit j of m starts the ladder with R1 = [2^j]Q and
+    // R2 = [2^j]Q - [2^(j+1)]Q = -[2^j]Q, as the addition of the point at
+    // infinity cannot be expressed with the differential additions
+    size_t j = mpz_scan1(m, 0);
+    point_set_fp2_x(R, &T->X[j]);
+    point_set_fp2_x(R2, &T->X[j]);
+    _ladder_fixed(R, R2, T, m, j + 1, s);
+
+    arena_pop(frame);
+}
+
+// x = 2^k x by the additions, cheaper than fp2_mul_int
+static void _fp2_mul_pow2(fp2_t x, int k) {
+    for (int i = 0; i < k; i++) {
+        fp2_add(x, x, x);
+    }
 }
 
 void j_invariant(fp2_t j_inv, const fp2_t A, const fp2_t C) {
-    fp2_t t0, t1;
+    fp2_t t0, t1, t2;
     fp2_init(&t0);
     fp2_init(&t1);
+    fp2_init(&t2);
 
-    // TODO: compare this approach with trying to stay in projective coords
-    // until last division
+    // With a = A/C we stay in projective coordinates until the last division:
+    // j = 256(a^2 - 3)^3/(a^2 - 4) = 256(A^2 - 3C^2)^3 / [C^4 (A^2 - 4C^2)]
+    // Cost: 1I + 3M + 4S instead of 2I
 
-    // Use jinv as register until last line:
-    // jinv = A/C: a
-    fp2_div_unsafe(j_inv, A, C);
+    // t0 = A^2
+    fp2_sq_unsafe(t0, A);
+    // t1 = C^2
+    fp2_sq_unsafe(t1, C);
 
-    // t0 = jinv^2: a^2
-    fp2_sq_unsafe(t0, j_inv);
+    // t2 = A^2 - 3C^2
+    fp2_sub(t2, t0, t1);
+    fp2_sub(t2, t2, t1);
+    fp2_sub(t2, t2, t1);
 
-    // jinv = t0 - 3: a^2 - 3
-    fp2_sub_uint(j_inv, t0, 3);
+    // t0 = A^2 - 4C^2
+    fp2_sub(t0, t2, t1);
+    assert(!fp2_is_zero(t0) && "A was equal 2 or -2");
 
-    // t0 = jinv^3: (a^2 - 3)^3
-    fp2_sq_unsafe(t0, j_inv);
-    fp2_mul_safe(t0, j_inv);
+    // Use jinv as register: (A^2 - 3C^2)^3
+    fp2_sq_unsafe(j_inv, t2);
+    fp2_mul_safe(j_inv, t2);
 
-    // t1 = jinv - 1: a^2 - 4
-    fp2_sub_uint(t1, j_inv, 1);
-    assert(!fp2_is_zero(t1) && "A was equal 2 or -2");
+    // t2 = C^4 (A^2 - 4C^2)
+    fp2_sq_unsafe(t2, t1);
+    fp2_mul_safe(t2, t0);
 
-    // jinv = t0 / t1: (a^2 - 3)^3/(a^2 - 4)
-    fp2_div_unsafe(j_inv, t0, t1);
+    // jinv = (A^2 - 3C^2)^3 / [C^4 (A^2 - 4C^2)]
+    fp2_inv_safe(t2);
+    fp2_mul_safe(j_inv, t2);
 
     // jinv = 256 * jinv: 256(a^2 - 3)^3/(a^2 - 4)
-    // fp2_mul_int(j_inv, j_inv, 256);
-    fp2_add(j_inv, j_inv, j_inv);
-    fp2_add(j_inv, j_inv, j_inv);
-    fp2_add(j_inv, j_inv, j_inv);
-    fp2_add(j_inv, j_inv, j_inv);
-    fp2_add(j_inv, j_inv, j_inv);
-    fp2_add(j_inv, j_inv, j_inv);
-    fp2_add(j_inv, j_inv, j_inv);
-    fp2_add(j_inv, j_inv, j_inv);
+    _fp2_mul_pow2(j_inv, 8);
 
     fp2_clear(&t0);
     fp2_clear(&t1);
+    fp2_clear(&t2);
+}
+
+void j_invariant_proj(fp2_t j_num, fp2_t j_den, const fp2_t A24p,
+                      const fp2_t C24) {
+    arena_frame_t frame = arena_push();
+    fp2_t t0 = arena_fp2(), t1 = arena_fp2(), t2 = arena_fp2();
+
+    // With A = 4A24p - 2C24 and C = C24:
+    // A^2 - 4C^2 = (A - 2C)(A + 2C) = 16 A24p (A24p - C24)
+    // A^2 - 3C^2 = 16 A24p (A24p - C24) + C24^2
+    // j = 256(A^2 - 3C^2)^3 / [C^4 (A^2 - 4C^2)], so the conversion to (A : C)
+    // is not needed
+
+    // t0 = A^2 - 4C^2
+    fp2_sub(t0, A24p, C24);
+    fp2_mul_safe(t0, A24p);
+    _fp2_mul_pow2(t0, 4);
+    assert(!fp2_is_zero(t0) && "A was equal 2 or -2");
+
+    // t1 = C^2, t2 = A^2 - 3C^2
+    fp2_sq_unsafe(t1, C24);
+    fp2_add(t2, t0, t1);
+
+    // j_num = 256(A^2 - 3C^2)^3
+    fp2_sq_unsafe(j_num, t2);
+    fp2_mul_safe(j_num, t2);
+    _fp2_mul_pow2(j_num, 8);
+
+    // j_den = C^4 (A^2 - 4C^2)
+    fp2_sq_unsafe(j_den, t1);
+    fp2_mul_safe(j_den, t0);
+
+    arena_pop(frame);
+}
+
+void j_invariant_A24p(fp2_t j_inv, const fp2_t A24p, const fp2_t C24) {
+    arena_frame_t frame = arena_push();
+    fp2_t j_den = arena_fp2();
+
+    j_invariant_proj(j_inv, j_den, A24p, C24);
+    fp2_inv_safe(j_den);
+    fp2_mul_safe(j_inv, j_den);
+
+    arena_pop(frame);
 }
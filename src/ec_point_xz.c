@@ -1,5 +1,6 @@
 #include <stdlib.h>
 
+#include "arena.h"
 #include "ec_point_xz.h"
 #include "fp2.h"
 
@@ -27,21 +28,71 @@ void A_from_A24p(fp2_t A, fp2_t C, const fp2_t A24p, const fp2_t C24) {
 // Elliptic Curve Point related methods
 
 void point_init(point_t *P) {
-    *P = (point_t)malloc(sizeof(struct point_xz));
-    // Recursively allocate memory for the member pointers
-    fp2_init(&(*P)->X);
-    fp2_init(&(*P)->Z);
+    // Storage starts with the point structure, so it can be freed by handle
+    struct point_storage *ps = malloc(sizeof(struct point_storage));
+    *P = point_init_storage(ps);
 }
 
 void point_clear(point_t *P) {
     if (P) {
-        fp2_clear(&(*P)->X);
-        fp2_clear(&(*P)->Z);
+        point_clear_storage((struct point_storage *)*P);
         free(*P);
-        P = NULL;
+        *P = NULL;
     }
 }
 
+point_t point_init_storage(struct point_storage *ps) {
+    fp2_init_storage(&ps->X);
+    fp2_init_storage(&ps->Z);
+    ps->P.X = &ps->X;
+    ps->P.Z = &ps->Z;
+    return &ps->P;
+}
+
+void point_clear_storage(struct point_storage *ps) {
+    fp2_clear_storage(&ps->X);
+    fp2_clear_storage(&ps->Z);
+}
+
+void point_vec_init(struct point_vec *v, size_t n) {
+    fp2_vec_init(&v->X, 2 * n);
+    v->Z = v->X + n;
+    v->n = n;
+}
+
+void point_vec_clear(struct point_vec *v) {
+    fp2_vec_clear(&v->X, 2 * v->n);
+    v->Z = NULL;
+    v->n = 0;
+}
+
+point_t point_vec_at(struct point_xz *view, const struct point_vec *v,
+                     size_t i) {
+    view->X = &v->X[i];
+    view->Z = &v->Z[i];
+    return view;
+}
+
+void ec_scratch_init(struct ec_scratch *s) {
+    fp2_scratch_init(&s->fs);
+    for (int i = 0; i < EC_SCRATCH_NFP2; i++) {
+        fp2_init_storage(&s->t[i]);
+    }
+    fp2_acc_init(&s->w[0]);
+    fp2_acc_init(&s->w[1]);
+    point_init_storage(&s->R);
+}
+
+void ec_scratch_clear(struct ec_scratch *s) {
+    fp2_scratch_clear(&s->fs);
+    for (int i = 0; i < EC_SCRATCH_NFP2; i++) {
+        fp2_clear_storage(&s->t[i]);
+    }
+    fp2_acc_clear(&s->w[0]);
+    fp2_acc_clear(&s->w[1]);
+    point_clear_storage(&s->R);
+}
+
 // copy coordinates of point: R <- P
 void point_set(point_t R, const point_t P) {
     // TODO: Not a deepcopy -> only copies the pointers
@@ -50,6 +101,11 @@ void point_set(point_t R, const point_t P) {
     fp2_set(R->Z, P->Z);
 }
 
+void point_cswap(point_t P, point_t Q, int swap) {
+    fp2_cswap(P->X, Q->X, swap);
+    fp2_cswap(P->Z, Q->Z, swap);
+}
+
 // Set: x(P) = x, and z(P) = 1
 void point_set_str_x(point_t P, const char *x) {
     fp2_set_str(P->X, x);
@@ -90,6 +146,23 @@ int point_equal_str_x(point_t P, const char *str) {
     return equal;
 }
 
+int point_to_bytes(unsigned char *buf, point_t P) {
+    if (fp2_is_zero(P->Z)) {
+        return -1;
+    }
+    point_normalize_coords(P);
+    fp2_to_bytes(buf, P->X);
+    return 0;
+}
+
+int point_from_bytes(point_t P, const unsigned char *buf) {
+    if (fp2_from_bytes(P->X, buf) != 0) {
+        return -1;
+    }
+    fp2_set_uint(P->Z, 1);
+    return 0;
+}
+
 inline int point_is_normalized(point_t P) { 
     return fp2_equal_uint(P->Z, 1); 
 }
@@ -108,3 +181,27 @@ void point_normalize_coords(point_t P) {
 
     fp2_clear(&t);
 }
+
+void point_normalize_batch(point_t *pts, size_t n) {
+    if (n == 0) {
+        return;
+    }
+
+    arena_frame_t frame = arena_push();
+
+    // Invert Z coordinates in place, Z := Z^-1
+    fp2_t *zs = arena_alloc(n * sizeof(fp2_t));
+    for (size_t i = 0; i < n; i++) {
+        assert(!fp2_is_zero(pts[i]->Z) && "Normalized Point cannot have Z = 0");
+        zs[i] = pts[i]->Z;
+    }
+    fp2_inv_batch(zs, (const fp2_t *)zs, n);
+
+    struct fp2_scratch *s = arena_fp2_scratch_batch();
+    for (size_t i = 0; i < n; i++) {
+        fp2_mul_safe_scr(pts[i]->X, pts[i]->Z, s);
+        fp2_set_uint(pts[i]->Z, 1);
+    }
+
+    arena_pop(frame);
+}
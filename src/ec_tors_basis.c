@@ -15,15 +15,22 @@ void tors_basis_clear(struct tors_basis *tb) {
     mpz_clear(tb->n);
 }
 
+void tors_basis_set(struct tors_basis *res, const struct tors_basis *tb) {
+    point_set(res->P, tb->P);
+    point_set(res->Q, tb->Q);
+    point_set(res->PQd, tb->PQd);
+    mpz_set(res->n, tb->n);
+}
+
 void tors_basis_get_subgroup(struct tors_basis *RS, mpz_t n,
                              const struct tors_basis *PQ, const fp2_t A24p,
                              const fp2_t C24) {
     // Temporarily set the order as [N/n] to not introduce additional variable
     mpz_divexact(RS->n, PQ->n, n);
     // Multiply all points in the subbasis by [N/n]
-    xLADDER(RS->P, PQ->P, RS->n, A24p, C24);
-    xLADDER(RS->Q, PQ->Q, RS->n, A24p, C24);
-    xLADDER(RS->PQd, PQ->PQd, RS->n, A24p, C24);
+    point_t res[] = {RS->P, RS->Q, RS->PQd};
+    const point_t pts[] = {PQ->P, PQ->Q, PQ->PQd};
+    xLADDER_multi(res, pts, 3, RS->n, A24p, C24);
     // Set the proper order of the subgroup torsion basis
     mpz_set(RS->n, n);
 }
@@ -1,79 +1,87 @@
 #include <assert.h>
 #include <gmp.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "fp.h"
 
-static fp_t g_fpchar;
-static int g_is_fpchar_set = 0;
-
-int fpchar_clear_if_set() {
-    if (g_is_fpchar_set) {
-        fpchar_clear();
-        return 1;
-    } else {
-        return 0;
-    }
-}
-
-int fpchar_check() { return g_is_fpchar_set; }
-
-int fpchar_setup_uint(unsigned int p) {
-    fp_t pp;
-    fp_init(pp);
-    fp_set_uint(pp, p);
-    int retval = fpchar_setup(pp);
-    fp_clear(pp);
-    return retval;
+#ifndef FP_BACKEND_MONT
+
+struct fp_ctx {
+    mpz_t p;
+    // Exponents precomputed for p = 3 (mod 4): (p + 1)/4 and (p - 3)/4
+    mpz_t e_sqrt, e_pow34;
+    // Initial size of the elements: product of two elements fits without
+    // reallocation
+    mp_bitcnt_t init_bits;
+    // Length of the binary encoding
+    size_t nbytes;
+    // Scratch used for decoding
+    mpz_t tmp;
+};
+
+// Context active in the calling thread
+static _Thread_local fp_ctx_t g_ctx = NULL;
+
+void fp_ctx_init(fp_ctx_t *ctx) {
+    *ctx = malloc(sizeof(struct fp_ctx));
+    mpz_init((*ctx)->p);
+    mpz_init((*ctx)->e_sqrt);
+    mpz_init((*ctx)->e_pow34);
+    mpz_init((*ctx)->tmp);
+    (*ctx)->init_bits = 0;
 }
 
-// Initialize and set the field characteristic of Fp and Fp^2 arithmetic.
-// For now, only p = 3 (mod 4) is allowed
-int fpchar_setup(fp_t p) {
-    if (g_is_fpchar_set) {
-        fprintf(stderr,
-                "[!] trying to initialize the characteristic second time!\n");
-        return -1;
-    }
-
-    int invalid_mod4 = 0;
-
-    // Check for modulo 4 operans
-    {
-        fp_t t;
-        fp_init(t);
-        // TODO: change inconsistent API
-        mpz_mod_ui(t, p, 4);
-        // invalid := p mod 4 is different than 3
-        invalid_mod4 = mpz_cmp_ui(t, 3);
-        fp_clear(t);
+void fp_ctx_clear(fp_ctx_t *ctx) {
+    if (g_ctx == *ctx) {
+        g_ctx = NULL;
     }
+    mpz_clear((*ctx)->p);
+    mpz_clear((*ctx)->e_sqrt);
+    mpz_clear((*ctx)->e_pow34);
+    mpz_clear((*ctx)->tmp);
+    free(*ctx);
+    *ctx = NULL;
+}
 
-    if (invalid_mod4) {
+int fp_ctx_setup(fp_ctx_t ctx, const mpz_t p) {
+    if (mpz_fdiv_ui(p, 4) != 3) {
         fprintf(stderr, "[!] Trying to set prime field characteristic with "
                         "prime != 3 (mod 4)\n");
         assert(0);
+        return -1;
     }
+    mpz_set(ctx->p, p);
+
+    // p = 3 (mod 4), therefore both divisions are exact
+    mpz_add_ui(ctx->e_sqrt, p, 1);
+    mpz_divexact_ui(ctx->e_sqrt, ctx->e_sqrt, 4);
+    mpz_sub_ui(ctx->e_pow34, p, 3);
+    mpz_divexact_ui(ctx->e_pow34, ctx->e_pow34, 4);
 
-    fp_init(g_fpchar);
-    fp_set(g_fpchar, p);
-    g_is_fpchar_set = 1;
+    ctx->init_bits = 2 * mpz_size(p) * mp_bits_per_limb;
+    ctx->nbytes = (mpz_sizeinbase(p, 2) + 7) / 8;
     return 0;
 }
 
-int fpchar_clear() {
-    if (!g_is_fpchar_set) {
-        fprintf(stderr,
-                "[!] trying to clear not-initialized characteristic!\n");
-        return -1;
-    }
-    fp_clear(g_fpchar);
-    g_is_fpchar_set = 0;
-    return 0;
+fp_ctx_t fp_ctx_swap(fp_ctx_t ctx) {
+    fp_ctx_t prev = g_ctx;
+    g_ctx = ctx;
+    return prev;
 }
 
-// init: allocate memory and set value = 0
-void fp_init(fp_t res) { mpz_init(res); }
+fp_ctx_t fp_ctx_get() { return g_ctx; }
+
+// init: allocate memory and set value = 0, space for the double width is
+// reserved if the characteristic is known
+void fp_init(fp_t res) {
+    if (g_ctx != NULL) {
+        mpz_init2(res, g_ctx->init_bits);
+    } else {
+        mpz_init(res);
+    }
+}
 
 // clear: deallocate memory
 void fp_clear(fp_t res) { mpz_clear(res); }
@@ -81,31 +89,73 @@ void fp_clear(fp_t res) { mpz_clear(res); }
 // set: result <- a
 void fp_set(fp_t res, const fp_t a) { mpz_set(res, a); }
 
+void fp_cswap(fp_t a, fp_t b, int swap) {
+    if (swap) {
+        mpz_swap(a, b);
+    }
+}
+
 // set uint: result <- (uint) a
 void fp_set_uint(fp_t res, unsigned long int a) { mpz_set_ui(res, a); }
 
+// set mpz: result <- a (mod p)
+void fp_set_mpz(fp_t res, const mpz_t a) { mpz_mod(res, a, g_ctx->p); }
+
+int fp_set_str(fp_t res, const char *str) {
+    assert(g_ctx != NULL && "Characteristic must be set before parsing");
+    if (mpz_set_str(g_ctx->tmp, str, 0) != 0) {
+        return -1;
+    }
+    mpz_mod(res, g_ctx->tmp, g_ctx->p);
+    return 0;
+}
+
+void fp_get_mpz(mpz_t res, const fp_t a) { mpz_set(res, a); }
+
+unsigned long int fp_get_ui(const fp_t a) { return mpz_get_ui(a); }
+
+size_t fp_sizeinbase(const fp_t a, int base) { return mpz_sizeinbase(a, base); }
+
+size_t fp_nbytes() { return g_ctx->nbytes; }
+
+void fp_to_bytes(unsigned char *buf, const fp_t a) {
+    size_t count;
+    mpz_export(buf, &count, -1, 1, 0, 0, a);
+    assert(count <= g_ctx->nbytes && "Element is not reduced");
+    memset(buf + count, 0, g_ctx->nbytes - count);
+}
+
+int fp_from_bytes(fp_t res, const unsigned char *buf) {
+    mpz_import(g_ctx->tmp, g_ctx->nbytes, -1, 1, 0, 0, buf);
+    if (mpz_cmp(g_ctx->tmp, g_ctx->p) >= 0) {
+        return -1;
+    }
+    mpz_set(res, g_ctx->tmp);
+    return 0;
+}
+
 // add: result = a + b (mod p)
 void fp_add(fp_t res, const fp_t a, const fp_t b) {
     mpz_add(res, a, b);
-    mpz_mod(res, res, g_fpchar);
+    mpz_mod(res, res, g_ctx->p);
 }
 
 // add uint: result = a + (unsigned int) b (mod p)
 void fp_add_uint(fp_t res, const fp_t a, unsigned long int b) {
     mpz_add_ui(res, a, b);
-    mpz_mod(res, res, g_fpchar);
+    mpz_mod(res, res, g_ctx->p);
 }
 
 // sub: res = a - b (mod p)
 void fp_sub(fp_t res, const fp_t a, const fp_t b) {
     mpz_sub(res, a, b);
-    mpz_mod(res, res, g_fpchar);
+    mpz_mod(res, res, g_ctx->p);
 }
 
 // sub uint: res = a - (unsigned int) b (mod p)
 void fp_sub_uint(fp_t res, const fp_t a, unsigned long int b) {
     mpz_sub_ui(res, a, b);
-    mpz_mod(res, res, g_fpchar);
+    mpz_mod(res, res, g_ctx->p);
 }
 
 // mul: res = a * b (mod p)
@@ -113,53 +163,71 @@ void fp_sub_uint(fp_t res, const fp_t a, unsigned long int b) {
 // with: fp_mul(n, n, n), where n is the same variable
 void fp_mul(fp_t res, const fp_t a, const fp_t b) {
     mpz_mul(res, a, b);
-    mpz_mod(res, res, g_fpchar);
+    mpz_mod(res, res, g_ctx->p);
+}
+
+void fp_mul_batch(fp_ptr *res, const fp_srcptr *a, const fp_srcptr *b,
+                  size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        fp_mul(res[i], a[i], b[i]);
+    }
+}
+
+void fp_acc_init(fp_acc_t res) { fp_init(res); }
+
+void fp_acc_clear(fp_acc_t res) { mpz_clear(res); }
+
+// mpz products are reduced only by fp_acc_reduce
+void fp_mul_wide(fp_acc_t res, const fp_t a, const fp_t b) {
+    mpz_mul(res, a, b);
+}
+
+void fp_acc_add(fp_acc_t res, const fp_acc_t a, const fp_acc_t b) {
+    mpz_add(res, a, b);
 }
 
+void fp_acc_sub(fp_acc_t res, const fp_acc_t a, const fp_acc_t b) {
+    mpz_sub(res, a, b);
+}
+
+void fp_acc_reduce(fp_t res, const fp_acc_t a) { mpz_mod(res, a, g_ctx->p); }
+
 // mul int: res = a * (int) b (mod p)
 void fp_mul_int(fp_t res, const fp_t a, long int b) {
     mpz_mul_si(res, a, b);
-    mpz_mod(res, res, g_fpchar);
+    mpz_mod(res, res, g_ctx->p);
 }
 
 // modular inverse: res = a^-1 (mod p)
-void fp_inv(fp_t res, const fp_t a) { mpz_invert(res, a, g_fpchar); }
+void fp_inv(fp_t res, const fp_t a) { mpz_invert(res, a, g_ctx->p); }
 
 // div: a / b (mod p) = a * b^-1 (mod p)
 void fp_div(fp_t res, const fp_t a, const fp_t b) {
-    mpz_invert(res, b, g_fpchar);
+    mpz_invert(res, b, g_ctx->p);
     mpz_mul(res, res, a);
-    mpz_mod(res, res, g_fpchar);
+    mpz_mod(res, res, g_ctx->p);
 }
 
 // neg: a = -a (mod p)
 void fp_neg(fp_t res, const fp_t a) {
-    mpz_sub(res, g_fpchar, a);
-    mpz_mod(res, res, g_fpchar);
+    mpz_sub(res, g_ctx->p, a);
+    mpz_mod(res, res, g_ctx->p);
 }
 
-// sqrt:
+// sqrt: res = a^((p + 1)/4)
 // assumes that prime is in form: p = 3 (mod 4)
 void fp_sqrt(fp_t res, const fp_t a) {
-    mpz_t exp;
-    mpz_init(exp);
-
-    // calculate a^((p + 1)/4)
-
-    // step 1: e = p + 1
-    mpz_add_ui(exp, g_fpchar, 1);
-
-    // step 2: e = (p + 1)/4
-    // can use divexact only if we know the divisor: d = 4
-    mpz_divexact_ui(exp, exp, 4);
-
-    // step 3: res = a ^ e
-    mpz_powm(res, a, exp, g_fpchar);
+    mpz_powm(res, a, g_ctx->e_sqrt, g_ctx->p);
+}
 
-    // step 4: clear memory for e variable
-    mpz_clear(exp);
+// pow34: res = a^((p - 3)/4)
+void fp_pow34(fp_t res, const fp_t a) {
+    mpz_powm(res, a, g_ctx->e_pow34, g_ctx->p);
 }
 
+// Legendre symbol is computed by GMP without any exponentiation
+int fp_is_square(const fp_t a) { return mpz_jacobi(a, g_ctx->p) >= 0; }
+
 int fp_is_zero(const fp_t a) { return (int)(mpz_sgn(a) == 0); }
 
 int fp_equal_uint(fp_t a, unsigned long int b) { return !mpz_cmp_ui(a, b); }
@@ -175,3 +243,5 @@ int fp_equal_str(fp_t a, const char *b_str) {
 }
 
 void fp_print(fp_t a, const char *name) { gmp_printf("%s: %Zd\n", name, a); }
+
+#endif
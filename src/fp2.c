@@ -4,33 +4,69 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "arena.h"
 #include "fp2.h"
 
 // init: allocate memory and set value to 0 + 0i
 void fp2_init(fp2_t *res) {
     // allocate memory for the fp2 structure
     *res = (fp2_t)malloc(sizeof(fp2_elem));
-    // initialize both variables
-    fp_init((*res)->a);
-    fp_init((*res)->b);
+    fp2_init_storage(*res);
 }
 
 // clear: free memory and set pointer to NULL
 void fp2_clear(fp2_t *res) {
-    // clear both variables
-    fp_clear((*res)->a);
-    fp_clear((*res)->b);
+    fp2_clear_storage(*res);
     // free memory for res pointer
     free(*res);
     *res = NULL;
 }
 
+void fp2_init_storage(fp2_elem *x) {
+    fp_init(x->a);
+    fp_init(x->b);
+}
+
+void fp2_clear_storage(fp2_elem *x) {
+    fp_clear(x->a);
+    fp_clear(x->b);
+}
+
+void fp2_acc_init(struct fp2_acc *x) {
+    fp_acc_init(x->a);
+    fp_acc_init(x->b);
+}
+
+void fp2_acc_clear(struct fp2_acc *x) {
+    fp_acc_clear(x->a);
+    fp_acc_clear(x->b);
+}
+
+void fp2_scratch_init(struct fp2_scratch *s) {
+    fp_init(s->t0);
+    fp_init(s->t1);
+    fp_acc_init(s->w);
+    fp2_acc_init(&s->acc);
+}
+
+void fp2_scratch_clear(struct fp2_scratch *s) {
+    fp_clear(s->t0);
+    fp_clear(s->t1);
+    fp_acc_clear(s->w);
+    fp2_acc_clear(&s->acc);
+}
+
 // set: result = x
 void fp2_set(fp2_t r, const fp2_t x) {
     fp_set(r->a, x->a);
     fp_set(r->b, x->b);
 }
 
+void fp2_cswap(fp2_t x, fp2_t y, int swap) {
+    fp_cswap(x->a, y->a, swap);
+    fp_cswap(x->b, y->b, swap);
+}
+
 // set: result = (uint) x
 void fp2_set_uint(fp2_t res, unsigned long int x) {
     fp_set_uint(res->a, x);
@@ -46,10 +82,10 @@ int fp2_set_str(fp2_t res, const char *x) {
 
     // Only a part was passed as argument
     if (only_real) {
-        mpz_set_ui(res->b, 0);
+        fp_set_uint(res->b, 0);
         // "This function returns 0 if the entire string is a valid number in
         // base base. Otherwise it returns −1."
-        return mpz_set_str(res->a, x, 0);
+        return fp_set_str(res->a, x);
     }
 
     // Allocate string on the heap to allow for strsep and truncating
@@ -64,8 +100,8 @@ int fp2_set_str(fp2_t res, const char *x) {
         // "Cut" the string before *i, imag will point to the start of the
         // buffer, "*" will be replaced with "\0"
         char *imag = strsep(&temp, "*i");
-        mpz_set_ui(res->a, 0);
-        int ret_imag = mpz_set_str(res->b, imag, 0);
+        fp_set_uint(res->a, 0);
+        int ret_imag = fp_set_str(res->b, imag);
         free(buffer);
         return ret_imag;
     }
@@ -88,9 +124,8 @@ int fp2_set_str(fp2_t res, const char *x) {
     // Strip the "*i" part
     imag = strsep(&temp, "*i");
 
-    // TODO: change inconsistent API
-    int ret_real = mpz_set_str(res->a, real, 0);
-    int ret_imag = mpz_set_str(res->b, imag, 0);
+    int ret_real = fp_set_str(res->a, real);
+    int ret_imag = fp_set_str(res->b, imag);
 
     free(buffer);
 
@@ -106,9 +141,8 @@ void fp2_fill(fp2_t res, fp_t a, fp_t b) {
 
 // fill_str: result = a + bi
 void fp2_fill_str(fp2_t res, const char *a, const char *b) {
-    // TODO: change inconsistent API
-    mpz_set_str(res->a, a, 0);
-    mpz_set_str(res->b, b, 0);
+    fp_set_str(res->a, a);
+    fp_set_str(res->b, b);
 }
 
 // fill_uint: result = a + bi
@@ -142,34 +176,51 @@ void fp2_sub_uint(fp2_t res, const fp2_t x, unsigned long int y) {
 }
 
 void fp2_mul_unsafe(fp2_t res, const fp2_t x, const fp2_t y) {
+    struct fp2_scratch s;
+    fp2_scratch_init(&s);
+    fp2_mul_unsafe_scr(res, x, y, &s);
+    fp2_scratch_clear(&s);
+}
+
+void fp2_mul_unsafe_scr(fp2_t res, const fp2_t x, const fp2_t y,
+                        struct fp2_scratch *s) {
     assert(res != x && res != y &&
            "fp2_mul cannot be called with res = x or res = y");
-    // add temprary field elements for storing values
-    fp_t t;
-    fp_init(t); // allocate and set to 0
-
-    // (a + bi) * (c + di) = [ac - bd] + [ad + bc]i
-
-    // calculate the first variable (real part); ac - bd
-    // res[0] <- a * c
-    fp_mul(res->a, x->a, y->a);
-    // temp <- b * d
-    fp_mul(t, x->b, y->b);
-    // res[0] <- [res0](a * c) - [tmp](b * d)
-    fp_sub(res->a, res->a, t);
-
-    // calculate the second variable (real part); ad - bc
-    // res[1] <- a * d
-    fp_mul(res->b, x->a, y->b);
-    // TODO: make sure we can set the register without UB
-    // i.e-> there is no garbage left from other operations
-    // so no need to set value to 0?
-
-    // tmp <- b * c
-    fp_mul(t, x->b, y->a);
-    fp_add(res->b, res->b, t);
+    fp2_mul_wide(&s->acc, x, y, s);
+    fp2_acc_reduce(res, &s->acc);
+}
 
-    fp_clear(t);
+void fp2_mul_wide(struct fp2_acc *res, const fp2_t x, const fp2_t y,
+                  struct fp2_scratch *s) {
+    // Karatsuba, using i^2 = -1:
+    // (a + bi) * (c + di) = [ac - bd] + [(a + b)(c + d) - ac - bd]i
+    // cost: 3M + 2a + 3 double-width a
+    fp_add(s->t0, x->a, x->b);         // t0 = a + b
+    fp_add(s->t1, y->a, y->b);         // t1 = c + d
+    fp_mul_wide(s->w, x->b, y->b);     // w = bd
+    fp_mul_wide(res->a, x->a, y->a);   // res.a = ac
+    fp_mul_wide(res->b, s->t0, s->t1); // res.b = (a + b)(c + d)
+
+    fp_acc_sub(res->b, res->b, res->a); // res.b = (a + b)(c + d) - ac
+    fp_acc_sub(res->b, res->b, s->w);   // res.b = (a + b)(c + d) - ac - bd
+    fp_acc_sub(res->a, res->a, s->w);   // res.a = ac - bd
+}
+
+void fp2_acc_add(struct fp2_acc *res, const struct fp2_acc *x,
+                 const struct fp2_acc *y) {
+    fp_acc_add(res->a, x->a, y->a);
+    fp_acc_add(res->b, x->b, y->b);
+}
+
+void fp2_acc_sub(struct fp2_acc *res, const struct fp2_acc *x,
+                 const struct fp2_acc *y) {
+    fp_acc_sub(res->a, x->a, y->a);
+    fp_acc_sub(res->b, x->b, y->b);
+}
+
+void fp2_acc_reduce(fp2_t res, const struct fp2_acc *x) {
+    fp_acc_reduce(res->a, x->a);
+    fp_acc_reduce(res->b, x->b);
 }
 
 void fp2_mul_int(fp2_t r, const fp2_t x, long int y) {
@@ -180,31 +231,90 @@ void fp2_mul_int(fp2_t r, const fp2_t x, long int y) {
 }
 
 void fp2_mul_safe(fp2_t x, const fp2_t y) {
-    // x = a + bi, y = c + di
-    // r = (ac - bd) + (ad + bc)i = e + fi
-    // cost: 4m + 2a
+    struct fp2_scratch s;
+    fp2_scratch_init(&s);
+    fp2_mul_safe_scr(x, y, &s);
+    fp2_scratch_clear(&s);
+}
 
-    fp_t t0, t1, tc;
-    fp_init(t0);
-    fp_init(t1);
-    fp_init(tc);
+void fp2_mul_safe_scr(fp2_t x, const fp2_t y, struct fp2_scratch *s) {
+    // Coordinates of x are overwritten only by the final reduction, so the
+    // function can be called with x = y
+    fp2_mul_wide(&s->acc, x, y, s);
+    fp2_acc_reduce(x, &s->acc);
+}
 
-    // tc is used for storing value c in case
-    // it will be overwritten in step: e = ac
-    // if fp2_mul is called with r = x = y
-    fp_set(tc, y->a);       // tc = c
-    fp_mul(t0, x->b, y->b); // t0 = bd
-    fp_mul(t1, x->a, y->b); // t1 = ad
+void fp2_mul_batch(fp2_t *res, const fp2_t *x, const fp2_t *y, size_t n,
+                   struct fp2_scratch *s) {
+    fp_ptr r[FP2_MUL_BATCH];
+    fp_srcptr u[FP2_MUL_BATCH], v[FP2_MUL_BATCH];
+
+    for (size_t i = 0; i < n; i += FP2_MUL_BATCH) {
+        size_t c = n - i < FP2_MUL_BATCH ? n - i : FP2_MUL_BATCH;
+
+        // Same Karatsuba as in fp2_mul_safe_scr, every product of the formula
+        // is computed for the whole chunk at once
+        for (size_t j = 0; j < c; j++) {
+            fp_add(s[j].t0, x[i + j]->a, x[i + j]->b); // t0 = a + b
+            fp_add(s[j].t1, y[i + j]->a, y[i + j]->b); // t1 = c + d
+            r[j] = s[j].t0;
+            u[j] = s[j].t0;
+            v[j] = s[j].t1;
+        }
+        fp_mul_batch(r, u, v, c); // t0 = (a + b)(c + d)
+
+        for (size_t j = 0; j < c; j++) {
+            r[j] = s[j].t1;
+            u[j] = x[i + j]->a;
+            v[j] = y[i + j]->a;
+        }
+        fp_mul_batch(r, u, v, c); // t1 = ac
+
+        // x->a is not needed anymore, so res can be equal to x or y
+        for (size_t j = 0; j < c; j++) {
+            r[j] = res[i + j]->b;
+            u[j] = x[i + j]->b;
+            v[j] = y[i + j]->b;
+        }
+        fp_mul_batch(r, u, v, c); // f = bd
+
+        for (size_t j = 0; j < c; j++) {
+            fp2_t rj = res[i + j];
+            fp_sub(s[j].t0, s[j].t0, s[j].t1); // t0 = (a + b)(c + d) - ac
+            fp_sub(rj->a, s[j].t1, rj->b);     // e = ac - bd
+            fp_sub(rj->b, s[j].t0, rj->b);     // f = (a + b)(c + d) - ac - bd
+        }
+    }
+}
 
-    fp_mul(x->a, x->a, y->a); // e = ac
-    fp_sub(x->a, x->a, t0);   // e = ac - bd
+void fp2_sq_unsafe(fp2_t res, const fp2_t x) {
+    assert(res != x && "fp2_sq cannot be called with res = arg");
+    // (a + bi)^2 = (a + b)(a - b) + 2abi
+    // cost: 2M + 3a
+    fp_add(res->a, x->a, x->b);     // res.a = a + b
+    fp_sub(res->b, x->a, x->b);     // res.b = a - b
+    fp_mul(res->a, res->a, res->b); // res.a = (a + b)(a - b)
 
-    fp_mul(x->b, x->b, tc); // f = bc
-    fp_add(x->b, x->b, t1); // f = bc + ad
+    fp_mul(res->b, x->a, x->b);     // res.b = ab
+    fp_add(res->b, res->b, res->b); // res.b = 2ab
+}
 
-    fp_clear(t0);
-    fp_clear(t1);
-    fp_clear(tc);
+void fp2_sq_safe(fp2_t x) {
+    struct fp2_scratch s;
+    fp2_scratch_init(&s);
+    fp2_sq_safe_scr(x, &s);
+    fp2_scratch_clear(&s);
+}
+
+void fp2_sq_safe_scr(fp2_t x, struct fp2_scratch *s) {
+    // (a + bi)^2 = (a + b)(a - b) + 2abi
+    // cost: 2M + 4a
+    fp_mul(s->t0, x->a, x->b);  // t0 = ab
+    fp_sub(x->b, x->a, x->b);   // x.b = a - b
+    fp_add(x->a, x->a, x->a);   // x.a = 2a
+    fp_sub(x->a, x->a, x->b);   // x.a = 2a - (a - b) = a + b
+    fp_mul(x->a, x->a, x->b);   // x.a = (a + b)(a - b)
+    fp_add(x->b, s->t0, s->t0); // x.b = 2ab
 }
 
 // Calculate inverse of element in Fp^2
@@ -256,17 +366,222 @@ void fp2_inv_safe(fp2_t x) {
     fp_clear(t1);
 }
 
+void fp2_inv_batch(fp2_t *res, const fp2_t *x, size_t n) {
+    if (n == 0) {
+        return;
+    }
+    arena_frame_t frame = arena_push();
+
+    // (a + bi)^-1 = (a - bi) / (a^2 + b^2), so only the norms have to be
+    // inverted and they are inverted together in Fp
+    fp_t *norm = arena_fp_vec(n + 1);
+    fp_ptr t = norm[n];
+
+    for (size_t i = 0; i < n; i++) {
+        fp_mul(norm[i], x[i]->a, x[i]->a); // norm = a^2
+        fp_mul(t, x[i]->b, x[i]->b);       // t = b^2
+        fp_add(norm[i], norm[i], t);       // norm = a^2 + b^2
+    }
+
+    fp_inv_batch(norm, (const fp_t *)norm, n);
+
+    for (size_t i = 0; i < n; i++) {
+        fp_mul(res[i]->a, x[i]->a, norm[i]); // res.a = a / (a^2 + b^2)
+        fp_mul(res[i]->b, x[i]->b, norm[i]); // res.b = b / (a^2 + b^2)
+        fp_neg(res[i]->b, res[i]->b);        // res.b = -b / (a^2 + b^2)
+    }
+
+    arena_pop(frame);
+}
+
+void fp2_vec_init(fp2_vec_t *x, size_t n) {
+    *x = malloc(n * sizeof(fp2_elem));
+    for (size_t i = 0; i < n; i++) {
+        fp2_init_storage(&(*x)[i]);
+    }
+}
+
+void fp2_vec_clear(fp2_vec_t *x, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        fp2_clear_storage(&(*x)[i]);
+    }
+    free(*x);
+    *x = NULL;
+}
+
+void fp2_vec_add(fp2_vec_t res, const fp2_vec_t x, const fp2_vec_t y,
+                 size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        fp2_add(&res[i], &x[i], &y[i]);
+    }
+}
+
+void fp2_vec_sub(fp2_vec_t res, const fp2_vec_t x, const fp2_vec_t y,
+                 size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        fp2_sub(&res[i], &x[i], &y[i]);
+    }
+}
+
+void fp2_vec_mul(fp2_vec_t res, const fp2_vec_t x, const fp2_vec_t y, size_t n,
+                 struct fp2_scratch *s) {
+    fp2_t r[FP2_MUL_BATCH], u[FP2_MUL_BATCH], v[FP2_MUL_BATCH];
+
+    for (size_t i = 0; i < n; i += FP2_MUL_BATCH) {
+        size_t c = n - i < FP2_MUL_BATCH ? n - i : FP2_MUL_BATCH;
+        for (size_t j = 0; j < c; j++) {
+            r[j] = &res[i + j];
+            u[j] = &x[i + j];
+            v[j] = &y[i + j];
+        }
+        fp2_mul_batch(r, (const fp2_t *)u, (const fp2_t *)v, c, s);
+    }
+}
+
+void fp2_vec_criss_cross(fp2_vec_t lsum, fp2_vec_t rdiff, const fp2_vec_t x,
+                         const fp2_vec_t y, const fp2_t z, const fp2_t w,
+                         size_t n, struct fp2_scratch *s) {
+    struct fp2_acc *xw = &s[0].acc, *yz = &s[1].acc;
+
+    for (size_t i = 0; i < n; i++) {
+        fp2_mul_wide(xw, &x[i], w, &s[0]);
+        fp2_mul_wide(yz, &y[i], z, &s[0]);
+
+        // lsum = xw + yz, rdiff = (xw + yz) - 2yz
+        fp2_acc_add(xw, xw, yz);
+        fp2_acc_reduce(&lsum[i], xw);
+        fp2_acc_sub(xw, xw, yz);
+        fp2_acc_sub(xw, xw, yz);
+        fp2_acc_reduce(&rdiff[i], xw);
+    }
+}
+
+void fp2_vec_prefix_prod(fp2_vec_t res, const fp2_vec_t x, size_t n,
+                         struct fp2_scratch *s) {
+    if (n == 0) {
+        return;
+    }
+
+    fp2_set(&res[0], &x[0]);
+    for (size_t i = 1; i < n; i++) {
+        // Previous product is overwritten only by the final reduction
+        fp2_mul_wide(&s->acc, &res[i - 1], &x[i], s);
+        fp2_acc_reduce(&res[i], &s->acc);
+    }
+}
+
+void fp2_vec_inv(fp2_vec_t res, const fp2_vec_t x, size_t n) {
+    if (n == 0) {
+        return;
+    }
+
+    arena_frame_t frame = arena_push();
+    fp2_t *r = arena_alloc(2 * n * sizeof(fp2_t)), *u = r + n;
+    for (size_t i = 0; i < n; i++) {
+        r[i] = &res[i];
+        u[i] = &x[i];
+    }
+    fp2_inv_batch(r, (const fp2_t *)u, n);
+    arena_pop(frame);
+}
+
+// x = a + bi is a square in Fp^2 iff its norm a^2 + b^2 is a square in Fp
+int fp2_is_square(const fp2_t x) {
+    fp_t t0, t1;
+    fp_init(t0);
+    fp_init(t1);
+
+    fp_mul(t0, x->a, x->a);
+    fp_mul(t1, x->b, x->b);
+    fp_add(t0, t0, t1);
+    int is_square = fp_is_square(t0);
+
+    fp_clear(t0);
+    fp_clear(t1);
+    return is_square;
+}
+
+// Complex method for p = 3 (mod 4), two Fp exponentiations and no inversion.
+// For x = a + bi with b != 0 and n = sqrt(a^2 + b^2), let u = a + n and
+// t = (2u)^((p - 3)/4):
+//  - 2u * t^2 = 1: sqrt(x) = ut + bti
+//  - 2u * t^2 = -1: sqrt(x) = bt - uti
+// Exactly one case applies, because (a + n)(a - n) = -b^2 is a non-square.
+int fp2_sqrt(fp2_t res, const fp2_t x) {
+    fp_t n, u, t;
+    fp_init(n);
+    fp_init(u);
+    fp_init(t);
+    int retval = 0;
+
+    if (fp_is_zero(x->b)) {
+        // Either a or -a is a square in Fp, -1 is a non-square
+        if (fp_is_square(x->a)) {
+            fp_sqrt(res->a, x->a);
+            fp_set_uint(res->b, 0);
+        } else {
+            fp_neg(u, x->a);
+            fp_sqrt(res->b, u);
+            fp_set_uint(res->a, 0);
+        }
+        goto cleanup;
+    }
+
+    fp_mul(n, x->a, x->a);
+    fp_mul(t, x->b, x->b);
+    fp_add(n, n, t); // n = a^2 + b^2
+    if (!fp_is_square(n)) {
+        retval = -1;
+        goto cleanup;
+    }
+    fp_sqrt(n, n);
+
+    fp_add(u, x->a, n); // u = a + n
+    fp_add(n, u, u);    // n = 2u
+    fp_pow34(t, n);     // t = (2u)^((p - 3)/4)
+
+    // n = 2u * t^2 = +-1
+    fp_mul(n, n, t);
+    fp_mul(n, n, t);
+
+    fp_mul(u, u, t);    // u = ut
+    fp_mul(t, x->b, t); // t = bt
+    if (fp_equal_uint(n, 1)) {
+        fp_set(res->a, u);
+        fp_set(res->b, t);
+    } else {
+        fp_set(res->a, t);
+        fp_neg(res->b, u);
+    }
+
+cleanup:
+    fp_clear(n);
+    fp_clear(u);
+    fp_clear(t);
+    return retval;
+}
+
 /*
  * @brief Output fp2 element to the stdout in format: "name: a*i + b"
  */
 void fp2_print(fp2_t x, const char *name) {
+    // Printing goes through mpz, as fp_t does not have to be an integer
+    mpz_t a, b;
+    mpz_init(a);
+    mpz_init(b);
+    fp_get_mpz(a, x->a);
+    fp_get_mpz(b, x->b);
+
     if (fp_is_zero(x->b)) {
-        gmp_printf("%s: %Zd\n", name, x->a);
+        gmp_printf("%s: %Zd\n", name, a);
     } else if (fp_is_zero(x->a)) {
-        gmp_printf("%s: %Zd*i\n", name, x->b);
+        gmp_printf("%s: %Zd*i\n", name, b);
     } else {
-        gmp_printf("%s: %Zd*i + %Zd\n", name, x->b, x->a);
+        gmp_printf("%s: %Zd*i + %Zd\n", name, b, a);
     }
+
+    mpz_clear(a);
+    mpz_clear(b);
 }
 
 int fp2_equal_uint(fp2_t x, unsigned long int a) {
@@ -293,8 +608,8 @@ size_t fp2_write_size(fp2_t x) {
     // Calculate buffer size required before calling "fp2_write"
 
     // TODO: Maybe store as hex in the future to save space?
-    size_t size_a = mpz_sizeinbase(x->a, 10);
-    size_t size_b = mpz_sizeinbase(x->b, 10);
+    size_t size_a = fp_sizeinbase(x->a, 10);
+    size_t size_b = fp_sizeinbase(x->b, 10);
     size_t size_mid = 5; // "*i + "
 
     // Add +1 for null termination
@@ -304,5 +619,29 @@ size_t fp2_write_size(fp2_t x) {
 
 void fp2_write(fp2_t x, char *buffer) {
     // Use GMP sprintf to store the fp2 value in format respected by fp2_set_str
-    gmp_sprintf(buffer, "%Zd*i + %Zd", x->b, x->a);
+    mpz_t a, b;
+    mpz_init(a);
+    mpz_init(b);
+    fp_get_mpz(a, x->a);
+    fp_get_mpz(b, x->b);
+
+    gmp_sprintf(buffer, "%Zd*i + %Zd", b, a);
+
+    mpz_clear(a);
+    mpz_clear(b);
+}
+
+size_t fp2_nbytes() { return 2 * fp_nbytes(); }
+
+void fp2_to_bytes(unsigned char *buf, const fp2_t x) {
+    fp_to_bytes(buf, x->a);
+    fp_to_bytes(buf + fp_nbytes(), x->b);
+}
+
+int fp2_from_bytes(fp2_t res, const unsigned char *buf) {
+    if (fp_from_bytes(res->a, buf) != 0 ||
+        fp_from_bytes(res->b, buf + fp_nbytes()) != 0) {
+        return -1;
+    }
+    return 0;
 }
@@ -0,0 +1,261 @@
+#include <assert.h>
+
+#include "arena.h"
+#include "fp2.h"
+#include "fp2_poly.h"
+
+// res = f * g for nf <= ng, each coefficient is a sum of products reduced once
+static void _poly_mul_school(fp2_vec_t res, const fp2_vec_t f, size_t nf,
+                             const fp2_vec_t g, size_t ng,
+                             struct fp2_scratch *s) {
+    struct fp2_acc *sum = &s[1].acc, *prod = &s[0].acc;
+    for (size_t k = 0; k < nf + ng - 1; k++) {
+        // f[i] * g[k - i] for max(0, k - ng + 1) <= i <= min(k, nf - 1)
+        size_t lo = k + 1 > ng ? k + 1 - ng : 0, hi = k < nf ? k : nf - 1;
+        fp2_mul_wide(sum, &f[lo], &g[k - lo], &s[0]);
+        for (size_t i = lo + 1; i <= hi; i++) {
+            fp2_mul_wide(prod, &f[i], &g[k - i], &s[0]);
+            fp2_acc_add(sum, sum, prod);
+        }
+        fp2_acc_reduce(&res[k], sum);
+    }
+}
+
+static void _poly_zero(fp2_vec_t f, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        fp2_set_uint(&f[i], 0);
+    }
+}
+
+// Balanced Karatsuba of two polynomials of length n: f = f0 + z^m f1 gives
+// f * g = z0 + z^m ((f0 + f1)(g0 + g1) - z0 - z2) + z^2m z2
+static void _poly_mul_kara(fp2_vec_t res, const fp2_vec_t f, const fp2_vec_t g,
+                           size_t n) {
+    size_t m = n / 2, h = n - m;
+    arena_frame_t frame = arena_push();
+    fp2_vec_t fs = arena_fp2_vec(h), gs = arena_fp2_vec(h),
+              z1 = arena_fp2_vec(2 * h - 1);
+
+    // z0 and z2 are placed directly in the result, z0 ends below z^(2m - 1)
+    fp2_poly_mul(res, f, m, g, m);
+    fp2_set_uint(&res[2 * m - 1], 0);
+    fp2_poly_mul(res + 2 * m, f + m, h, g + m, h);
+
+    // fs = f0 + f1, gs = g0 + g1, f1 is longer by at most one coefficient
+    fp2_vec_add(fs, f, f + m, m);
+    fp2_vec_add(gs, g, g + m, m);
+    if (h > m) {
+        fp2_set(&fs[m], &f[n - 1]);
+        fp2_set(&gs[m], &g[n - 1]);
+    }
+    fp2_poly_mul(z1, fs, h, gs, h);
+    fp2_vec_sub(z1, z1, res, 2 * m - 1);
+    fp2_vec_sub(z1, z1, res + 2 * m, 2 * h - 1);
+    fp2_vec_add(res + m, res + m, z1, 2 * h - 1);
+
+    arena_pop(frame);
+}
+
+void fp2_poly_mul(fp2_vec_t res, const fp2_vec_t f, size_t nf,
+                  const fp2_vec_t g, size_t ng) {
+    if (nf == 0 || ng == 0) {
+        return;
+    }
+    // a is the shorter factor
+    fp2_vec_t a = f, b = g;
+    size_t na = nf, nb = ng;
+    if (nf > ng) {
+        a = g, b = f;
+        na = ng, nb = nf;
+    }
+
+    arena_frame_t frame = arena_push();
+    if (na < FP2_POLY_KARATSUBA) {
+        _poly_mul_school(res, a, na, b, nb, arena_fp2_scratch_batch());
+    } else if (na == nb) {
+        _poly_mul_kara(res, a, b, na);
+    } else {
+        // Longer factor is split into the parts of length na, their products
+        // overlap on na - 1 coefficients
+        fp2_vec_t t = arena_fp2_vec(2 * na - 1);
+        _poly_zero(res, na + nb - 1);
+        for (size_t i = 0; i < nb; i += na) {
+            size_t c = nb - i < na ? nb - i : na;
+            fp2_poly_mul(t, a, na, b + i, c);
+            fp2_vec_add(res + i, res + i, t, na + c - 1);
+        }
+    }
+    arena_pop(frame);
+}
+
+void fp2_poly_inv_series(fp2_vec_t res, const fp2_vec_t f, size_t nf,
+                         size_t n) {
+    assert(nf > 0 && fp2_equal_uint(f, 1) && "Series must start with 1");
+    if (n == 0) {
+        return;
+    }
+
+    arena_frame_t frame = arena_push();
+    struct fp2_scratch *s = arena_fp2_scratch_batch();
+    struct fp2_acc *sum = &s[1].acc, *prod = &s[0].acc;
+
+    // res[i] = -(f[1] res[i - 1] + ... + f[i] res[0])
+    fp2_set_uint(&res[0], 1);
+    for (size_t i = 1; i < n; i++) {
+        size_t hi = i < nf - 1 ? i : nf - 1;
+        if (hi == 0) {
+            fp2_set_uint(&res[i], 0);
+            continue;
+        }
+        fp2_mul_wide(sum, &f[1], &res[i - 1], &s[0]);
+        for (size_t j = 2; j <= hi; j++) {
+            fp2_mul_wide(prod, &f[j], &res[i - j], &s[0]);
+            fp2_acc_add(sum, sum, prod);
+        }
+        fp2_acc_reduce(&res[i], sum);
+        fp_neg(res[i].a, res[i].a);
+        fp_neg(res[i].b, res[i].b);
+    }
+
+    arena_pop(frame);
+}
+
+void fp2_poly_rem_monic(fp2_vec_t r, const fp2_vec_t g, size_t ng,
+                        const fp2_vec_t f, size_t d, const fp2_vec_t rcp) {
+    if (ng <= d) {
+        for (size_t i = 0; i < ng; i++) {
+            fp2_set(&r[i], &g[i]);
+        }
+        _poly_zero(r + ng, d - ng);
+        return;
+    }
+
+    arena_frame_t frame = arena_push();
+    size_t k = ng - d;
+    fp2_vec_t rg = arena_fp2_vec(k), rq = arena_fp2_vec(2 * k - 1),
+              q = arena_fp2_vec(k), qf = arena_fp2_vec(k + d);
+
+    // rev(q) = rev(g) * rev(f)^-1 mod z^k, only the top k coefficients of g
+    // take part in it
+    for (size_t i = 0; i < k; i++) {
+        fp2_set(&rg[i], &g[ng - 1 - i]);
+    }
+    fp2_poly_mul(rq, rg, k, rcp, k);
+    for (size_t i = 0; i < k; i++) {
+        fp2_set(&q[i], &rq[k - 1 - i]);
+    }
+
+    // r = g - q * f, the upper coefficients cancel out
+    fp2_poly_mul(qf, q, k, f, d + 1);
+    fp2_vec_sub(r, g, qf, d);
+
+    arena_pop(frame);
+}
+
+// Assign the offsets of the node k covering the roots [lo, hi), the remainder
+// of its parent has length n_parent
+static void _tree_layout(struct fp2_poly_tree *t, size_t k, size_t lo,
+                         size_t hi, size_t n_parent, size_t *n_poly,
+                         size_t *n_rcp) {
+    size_t d = hi - lo;
+    t->poly_off[k] = *n_poly;
+    t->rcp_off[k] = *n_rcp;
+    t->rcp_len[k] = n_parent > d ? n_parent - d : 0;
+    *n_poly += d + 1;
+    *n_rcp += t->rcp_len[k];
+
+    if (d > 1) {
+        size_t mid = lo + d / 2;
+        _tree_layout(t, 2 * k + 1, lo, mid, d, n_poly, n_rcp);
+        _tree_layout(t, 2 * k + 2, mid, hi, d, n_poly, n_rcp);
+    }
+}
+
+// Products of the subtree of node k, bottom-up
+static void _tree_fill(struct fp2_poly_tree *t, const fp2_vec_t roots,
+                       size_t k, size_t lo, size_t hi) {
+    size_t d = hi - lo;
+    fp2_vec_t f = t->poly + t->poly_off[k];
+
+    if (d == 1) {
+        // z - roots[lo]
+        fp2_set_uint(&f[0], 0);
+        fp2_sub(&f[0], &f[0], &roots[lo]);
+        fp2_set_uint(&f[1], 1);
+    } else {
+        size_t mid = lo + d / 2;
+        _tree_fill(t, roots, 2 * k + 1, lo, mid);
+        _tree_fill(t, roots, 2 * k + 2, mid, hi);
+        fp2_poly_mul(f, t->poly + t->poly_off[2 * k + 1], mid - lo + 1,
+                     t->poly + t->poly_off[2 * k + 2], hi - mid + 1);
+    }
+
+    if (t->rcp_len[k] > 0) {
+        arena_frame_t frame = arena_push();
+        fp2_vec_t rev = arena_fp2_vec(d + 1);
+        for (size_t i = 0; i <= d; i++) {
+            fp2_set(&rev[i], &f[d - i]);
+        }
+        fp2_poly_inv_series(t->rcp + t->rcp_off[k], rev, d + 1,
+                            t->rcp_len[k]);
+        arena_pop(frame);
+    }
+}
+
+void fp2_poly_tree_build(struct fp2_poly_tree *t, const fp2_vec_t roots,
+                         size_t n, size_t n_top) {
+    assert(n > 0 && "Tree must have at least one root");
+    t->n = n;
+
+    // Heap indices of the halving split stay below 4n
+    t->poly_off = arena_alloc(3 * 4 * n * sizeof(size_t));
+    t->rcp_off = t->poly_off + 4 * n;
+    t->rcp_len = t->rcp_off + 4 * n;
+
+    size_t n_poly = 0, n_rcp = 0;
+    _tree_layout(t, 0, 0, n, n_top, &n_poly, &n_rcp);
+    t->poly = arena_fp2_vec(n_poly);
+    t->rcp = arena_fp2_vec(n_rcp > 0 ? n_rcp : 1);
+
+    _tree_fill(t, roots, 0, 0, n);
+}
+
+// Multiply acc by the values at the roots [lo, hi), given remainder g of
+// length hi - lo of the node k
+static void _tree_descend(fp2_t acc, const struct fp2_poly_tree *t, size_t k,
+                          size_t lo, size_t hi, const fp2_vec_t g,
+                          struct fp2_scratch *s) {
+    size_t d = hi - lo;
+    if (d == 1) {
+        fp2_mul_safe_scr(acc, &g[0], s);
+        return;
+    }
+
+    arena_frame_t frame = arena_push();
+    size_t mid = lo + d / 2;
+    size_t c[2] = {2 * k + 1, 2 * k + 2}, bounds[3] = {lo, mid, hi};
+    fp2_vec_t r = arena_fp2_vec(hi - mid);
+    for (int i = 0; i < 2; i++) {
+        size_t dc = bounds[i + 1] - bounds[i];
+        fp2_poly_rem_monic(r, g, d, t->poly + t->poly_off[c[i]], dc,
+                           t->rcp + t->rcp_off[c[i]]);
+        _tree_descend(acc, t, c[i], bounds[i], bounds[i + 1], r, s);
+    }
+    arena_pop(frame);
+}
+
+void fp2_poly_tree_prod_eval(fp2_t res, const struct fp2_poly_tree *t,
+                             const fp2_vec_t g, size_t ng) {
+    assert(ng <= t->n + t->rcp_len[0] && "Polynomial is too long for the tree");
+
+    arena_frame_t frame = arena_push();
+    struct fp2_scratch *s = arena_fp2_scratch_batch();
+    fp2_vec_t r = arena_fp2_vec(t->n);
+
+    fp2_poly_rem_monic(r, g, ng, fp2_poly_tree_root(t), t->n,
+                       t->rcp + t->rcp_off[0]);
+    fp2_set_uint(res, 1);
+    _tree_descend(res, t, 0, 0, t->n, r, s);
+
+    arena_pop(frame);
+}
@@ -0,0 +1,93 @@
+#include <assert.h>
+#include <gmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "arena.h"
+#include "fp.h"
+
+// Backend-independent part of the Fp arithmetic, built only on the fp.h API
+
+// Default context of each thread, used by the `fpchar_*` interface
+static _Thread_local fp_ctx_t g_default_ctx = NULL;
+
+int fpchar_clear_if_set() {
+    if (g_default_ctx != NULL) {
+        fpchar_clear();
+        return 1;
+    } else {
+        return 0;
+    }
+}
+
+int fpchar_check() { return g_default_ctx != NULL; }
+
+int fpchar_setup_uint(unsigned int p) {
+    mpz_t pp;
+    mpz_init_set_ui(pp, p);
+    int retval = fpchar_setup(pp);
+    mpz_clear(pp);
+    return retval;
+}
+
+// Initialize and set the field characteristic of Fp and Fp^2 arithmetic for
+// the calling thread. For now, only p = 3 (mod 4) is allowed
+int fpchar_setup(const mpz_t p) {
+    if (g_default_ctx != NULL) {
+        fprintf(stderr,
+                "[!] trying to initialize the characteristic second time!\n");
+        return -1;
+    }
+
+    fp_ctx_init(&g_default_ctx);
+    if (fp_ctx_setup(g_default_ctx, p) != 0) {
+        fp_ctx_clear(&g_default_ctx);
+        return -1;
+    }
+
+    fp_ctx_swap(g_default_ctx);
+    return 0;
+}
+
+int fpchar_clear() {
+    if (g_default_ctx == NULL) {
+        fprintf(stderr,
+                "[!] trying to clear not-initialized characteristic!\n");
+        return -1;
+    }
+    fp_ctx_clear(&g_default_ctx);
+    return 0;
+}
+
+void fp_inv_batch(fp_t *res, const fp_t *x, size_t n) {
+    if (n == 0) {
+        return;
+    }
+    arena_frame_t frame = arena_push();
+
+    // acc[i] = x[0] * x[1] * ... * x[i], followed by the temporaries inv, t
+    fp_t *acc = arena_fp_vec(n + 2);
+    fp_ptr inv = acc[n], t = acc[n + 1];
+    fp_set(acc[0], x[0]);
+    for (size_t i = 1; i < n; i++) {
+        fp_mul(acc[i], acc[i - 1], x[i]);
+    }
+
+    assert(!fp_is_zero(acc[n - 1]) && "Batch inversion does not accept 0");
+
+    // inv = (x[0] * ... * x[n - 1])^-1, single inversion for the whole batch
+    fp_inv(inv, acc[n - 1]);
+
+    // Going downwards: inv = (x[0] * ... * x[i])^-1 at the start of iteration
+    for (size_t i = n - 1; i > 0; i--) {
+        // t = (x[0] * ... * x[i - 1])^-1, x[i] must be read before res[i] is
+        // written, as res can be equal to x
+        fp_mul(t, inv, x[i]);
+        // res[i] = x[i]^-1
+        fp_mul(res[i], inv, acc[i - 1]);
+        fp_set(inv, t);
+    }
+    fp_set(res[0], inv);
+
+    arena_pop(frame);
+}
@@ -0,0 +1,1193 @@
+#include <assert.h>
+#include <gmp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fp.h"
+
+#ifdef FP_BACKEND_MONT
+
+// Hand-written MULX/ADCX/ADOX and AVX2 kernels are available only for x86-64
+// with GNU-style inline assembly, FP_NO_ASM forces the portable code
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(FP_NO_ASM)
+#define FP_MONT_X86
+#include <cpuid.h>
+
+// Four-lane AVX2 kernel of fp_mul_batch is built only on request (FP_AVX2),
+// as it is slower than MULX/ADX on the CPUs supporting both
+#ifdef FP_AVX2
+#define FP_MONT_AVX2
+#include <immintrin.h>
+
+// Digits of the AVX2 kernel: sum of 2k products < 2^56 together with the
+// carries must fit into 64-bit lane
+#define FP_AVX2_BITS 28
+#define FP_AVX2_MASK ((1ULL << FP_AVX2_BITS) - 1)
+#define FP_AVX2_MAX_DIGITS 124
+#endif
+#endif
+
+// Inversion uses the constant-time safegcd of Bernstein and Yang on signed
+// 62-bit digits, which needs 128-bit products. Without them (or with
+// FP_INV_POW) it falls back to the exponentiation a^(p - 2).
+#if defined(__SIZEOF_INT128__) && !defined(FP_INV_POW)
+#define FP_MONT_SAFEGCD
+#define FP_SG_BITS 62
+#define FP_SG_MASK (UINT64_MAX >> 2)
+// Digits for the numbers from (-2p, p) with the sign
+#define FP_SG_MAX_DIGITS ((GMP_NUMB_BITS * FP_MAX_LIMBS + 1) / FP_SG_BITS + 2)
+#endif
+
+// Montgomery multiplication and squaring: r = a * b * R^-1 (mod p)
+typedef void (*fp_mont_mul_fn)(mp_limb_t *r, const mp_limb_t *a,
+                               const mp_limb_t *b);
+typedef void (*fp_mont_sqr_fn)(mp_limb_t *r, const mp_limb_t *a);
+// Montgomery reduction: r = t * R^-1 (mod p) for t < pR, t is destroyed
+typedef void (*fp_mont_redc_fn)(mp_limb_t *r, mp_limb_t *t);
+// Double-width product and square without reduction: t = a * b
+typedef void (*fp_mont_mulw_fn)(mp_limb_t *t, const mp_limb_t *a,
+                                const mp_limb_t *b);
+typedef void (*fp_mont_sqrw_fn)(mp_limb_t *t, const mp_limb_t *a);
+// Four independent Montgomery multiplications: r[i] = a[i] * b[i] * R^-1
+typedef void (*fp_mont_mul_x4_fn)(mp_limb_t *const r[4],
+                                  const mp_limb_t *const a[4],
+                                  const mp_limb_t *const b[4]);
+
+// Field characteristic together with the Montgomery constants.
+// All limb arrays use only the lowest `n` limbs, n = 0 if p is not set.
+struct fp_ctx {
+    mpz_t p;
+    mp_size_t n;
+    // Length of the binary encoding
+    size_t nbytes;
+    // p as limb array
+    mp_limb_t p_limbs[FP_MAX_LIMBS];
+    // pinv = -p^-1 (mod 2^64)
+    mp_limb_t pinv;
+    // R^2 (mod p), used for conversion into Montgomery form
+    mp_limb_t r2[FP_MAX_LIMBS];
+    // R^3 (mod p), used for fixing the inversion result
+    mp_limb_t r3[FP_MAX_LIMBS];
+    // Exponents precomputed for p = 3 (mod 4): (p + 1)/4 and (p - 3)/4
+    mpz_t e_sqrt, e_pow34;
+#ifdef FP_MONT_SAFEGCD
+    // safegcd: p in sg_len signed 62-bit digits, p^-1 (mod 2^62) and the number
+    // of 62-divstep batches sufficient for any input
+    int64_t sg_p[FP_SG_MAX_DIGITS];
+    uint64_t sg_pinv;
+    int sg_len, sg_batches;
+#else
+    // Exponent of the inversion: p - 2
+    mpz_t e_inv;
+#endif
+    // Scratch used for conversions between mpz and limbs
+    mpz_t tmp;
+    // Kernels selected at setup based on n and the CPU features, mul_x4 is
+    // NULL if there is no vectorized kernel
+    fp_mont_mul_fn mul;
+    fp_mont_sqr_fn sqr;
+    fp_mont_redc_fn redc;
+    fp_mont_mulw_fn mulw;
+    fp_mont_sqrw_fn sqrw;
+    fp_mont_mul_x4_fn mul_x4;
+#ifdef FP_MONT_AVX2
+    // AVX2 kernel: k digits of 28 bits with p in this radix and the shift
+    // aligning its R' = 2^(28k) with R = 2^(64n)
+    int avx2_k, avx2_shift;
+    uint64_t avx2_p[FP_AVX2_MAX_DIGITS];
+#endif
+};
+
+// Context active in the calling thread
+static _Thread_local fp_ctx_t g_ctx = NULL;
+
+static void _select_kernels(fp_ctx_t ctx);
+#ifdef FP_MONT_SAFEGCD
+static void _setup_safegcd(fp_ctx_t ctx);
+#else
+static void _pow(fp_t res, const fp_t a, const mpz_t e);
+#endif
+
+// Copy integer 0 <= a < 2^(64 * n) into the zero-padded limb array
+static void _limbs_from_mpz(mp_limb_t *r, const mpz_t a, mp_size_t n) {
+    mp_size_t size = mpz_size(a);
+    assert(size <= n);
+    mpn_copyi(r, mpz_limbs_read(a), size);
+    mpn_zero(r + size, n - size);
+}
+
+void fp_ctx_init(fp_ctx_t *ctx) {
+    *ctx = malloc(sizeof(struct fp_ctx));
+    mpz_init((*ctx)->p);
+    mpz_init((*ctx)->tmp);
+    mpz_init((*ctx)->e_sqrt);
+    mpz_init((*ctx)->e_pow34);
+#ifndef FP_MONT_SAFEGCD
+    mpz_init((*ctx)->e_inv);
+#endif
+    (*ctx)->n = 0;
+}
+
+void fp_ctx_clear(fp_ctx_t *ctx) {
+    if (g_ctx == *ctx) {
+        g_ctx = NULL;
+    }
+    mpz_clear((*ctx)->p);
+    mpz_clear((*ctx)->tmp);
+    mpz_clear((*ctx)->e_sqrt);
+    mpz_clear((*ctx)->e_pow34);
+#ifndef FP_MONT_SAFEGCD
+    mpz_clear((*ctx)->e_inv);
+#endif
+    free(*ctx);
+    *ctx = NULL;
+}
+
+int fp_ctx_setup(fp_ctx_t ctx, const mpz_t p) {
+    if (mpz_fdiv_ui(p, 4) != 3) {
+        fprintf(stderr, "[!] Trying to set prime field characteristic with "
+                        "prime != 3 (mod 4)\n");
+        assert(0);
+        return -1;
+    }
+
+    mp_size_t n = mpz_size(p);
+    if (n > FP_MAX_LIMBS) {
+        fprintf(stderr,
+                "[!] characteristic requires %ld limbs, but FP_MAX_LIMBS is "
+                "%d\n",
+                (long)n, FP_MAX_LIMBS);
+        return -1;
+    }
+
+    mpz_set(ctx->p, p);
+    ctx->n = n;
+    ctx->nbytes = (mpz_sizeinbase(p, 2) + 7) / 8;
+    _limbs_from_mpz(ctx->p_limbs, p, n);
+
+    // Newton iteration for p^-1 (mod 2^64): each step doubles correct bits,
+    // p * p = 1 (mod 8) gives 3 correct bits at the start
+    mp_limb_t inv = ctx->p_limbs[0];
+    for (int i = 0; i < 5; i++) {
+        inv *= 2 - ctx->p_limbs[0] * inv;
+    }
+    ctx->pinv = -inv;
+
+    // r2 = R^2 (mod p), r3 = R^3 (mod p) where R = 2^(64 * n)
+    mpz_set_ui(ctx->tmp, 0);
+    mpz_setbit(ctx->tmp, 2 * GMP_NUMB_BITS * n);
+    mpz_mod(ctx->tmp, ctx->tmp, p);
+    _limbs_from_mpz(ctx->r2, ctx->tmp, n);
+
+    mpz_set_ui(ctx->tmp, 0);
+    mpz_setbit(ctx->tmp, 3 * GMP_NUMB_BITS * n);
+    mpz_mod(ctx->tmp, ctx->tmp, p);
+    _limbs_from_mpz(ctx->r3, ctx->tmp, n);
+
+    // p = 3 (mod 4), therefore both divisions are exact
+    mpz_add_ui(ctx->e_sqrt, p, 1);
+    mpz_divexact_ui(ctx->e_sqrt, ctx->e_sqrt, 4);
+    mpz_sub_ui(ctx->e_pow34, p, 3);
+    mpz_divexact_ui(ctx->e_pow34, ctx->e_pow34, 4);
+
+#ifdef FP_MONT_SAFEGCD
+    _setup_safegcd(ctx);
+#else
+    mpz_sub_ui(ctx->e_inv, p, 2);
+#endif
+
+    _select_kernels(ctx);
+    return 0;
+}
+
+fp_ctx_t fp_ctx_swap(fp_ctx_t ctx) {
+    fp_ctx_t prev = g_ctx;
+    g_ctx = ctx;
+    return prev;
+}
+
+fp_ctx_t fp_ctx_get() { return g_ctx; }
+
+// Final step of the Montgomery reduction: r = t[n..2n) + t[0..n), where the
+// lower half holds the carries of the reduction rows. Result r < 2p requires at
+// most one subtraction.
+static void _redc_finish(mp_limb_t *r, const mp_limb_t *t) {
+    const mp_size_t n = g_ctx->n;
+    const mp_limb_t *p = g_ctx->p_limbs;
+    mp_limb_t cy = mpn_add_n(r, t + n, t, n);
+    if (cy || mpn_cmp(r, p, n) >= 0) {
+        mpn_sub_n(r, r, p, n);
+    }
+}
+
+// Montgomery reduction: r = t * R^-1 (mod p) for t < pR.
+// Input t has 2n limbs and is destroyed during the computation.
+static void _redc(mp_limb_t *r, mp_limb_t *t) {
+    const mp_size_t n = g_ctx->n;
+    const mp_limb_t *p = g_ctx->p_limbs;
+
+    // Zero the limbs one by one, the carry of each step is stored inside the
+    // just-zeroed limb and added back at the end
+    for (mp_size_t i = 0; i < n; i++) {
+        mp_limb_t q = t[i] * g_ctx->pinv;
+        t[i] = mpn_addmul_1(t + i, p, n, q);
+    }
+    _redc_finish(r, t);
+}
+
+// Portable kernels for any limb count
+static void _mulw_generic(mp_limb_t *t, const mp_limb_t *a,
+                          const mp_limb_t *b) {
+    mpn_mul_n(t, a, b, g_ctx->n);
+}
+
+static void _sqrw_generic(mp_limb_t *t, const mp_limb_t *a) {
+    mpn_sqr(t, a, g_ctx->n);
+}
+
+static void _mul_generic(mp_limb_t *r, const mp_limb_t *a,
+                         const mp_limb_t *b) {
+    mp_limb_t t[2 * FP_MAX_LIMBS];
+    mpn_mul_n(t, a, b, g_ctx->n);
+    _redc(r, t);
+}
+
+static void _sqr_generic(mp_limb_t *r, const mp_limb_t *a) {
+    mp_limb_t t[2 * FP_MAX_LIMBS];
+    mpn_sqr(t, a, g_ctx->n);
+    _redc(r, t);
+}
+
+#ifdef FP_MONT_X86
+
+// Unrolled kernels for fixed limb counts N. Each row of the schoolbook
+// product/reduction runs two independent carry chains: ADCX (CF) adds the high
+// half of the previous MULX, ADOX (OF) adds the accumulator limb.
+//
+// FP_ADX_ROW rp, rpo, up, upo, len:
+//   (rp + rpo)[0..len) += (up + upo)[0..len) * rdx
+// where rp, up are registers and rpo, upo byte offsets (arguments are split on
+// spaces, so expressions must not contain any). Carry limb is left in r8.
+// Clobbers rax, r8, r9 and flags.
+__asm__(".macro FP_ADX_ROW rp, rpo, up, upo, len\n"
+        "xor %r8d, %r8d\n"
+        ".set .Lfp_j, 0\n"
+        ".rept \\len\n"
+        "mulx (\\upo + 8*.Lfp_j)(\\up), %rax, %r9\n"
+        "adcx %r8, %rax\n"
+        "adox (\\rpo + 8*.Lfp_j)(\\rp), %rax\n"
+        "mov %rax, (\\rpo + 8*.Lfp_j)(\\rp)\n"
+        "mov %r9, %r8\n"
+        ".set .Lfp_j, .Lfp_j + 1\n"
+        ".endr\n"
+        "mov $0, %eax\n"
+        "adcx %rax, %r8\n"
+        "adox %rax, %r8\n"
+        ".endm\n");
+
+// t[0..2N) = a^2, t must be zeroed: off-diagonal products are accumulated,
+// doubled and the squares a_i^2 are added on the diagonal
+#define FP_ADX_SQR(t, a, N)                                                    \
+    __asm__ volatile(                                                          \
+        ".set .Lfp_i, 0\n"                                                     \
+        ".rept %c[n] - 1\n"                                                    \
+        "mov 8*.Lfp_i(%[pa]), %%rdx\n"                                         \
+        "FP_ADX_ROW %[pt], 8*(2*.Lfp_i+1), %[pa], 8*(.Lfp_i+1), "              \
+        "%c[n]-1-.Lfp_i\n"                                                     \
+        "mov %%r8, 8*(.Lfp_i + %c[n])(%[pt])\n"                                \
+        ".set .Lfp_i, .Lfp_i + 1\n"                                            \
+        ".endr\n"                                                              \
+        "xor %%eax, %%eax\n"                                                   \
+        ".set .Lfp_i, 0\n"                                                     \
+        ".rept 2 * %c[n]\n"                                                    \
+        "mov 8*.Lfp_i(%[pt]), %%rax\n"                                         \
+        "adc %%rax, %%rax\n"                                                   \
+        "mov %%rax, 8*.Lfp_i(%[pt])\n"                                         \
+        ".set .Lfp_i, .Lfp_i + 1\n"                                            \
+        ".endr\n"                                                              \
+        "xor %%eax, %%eax\n"                                                   \
+        ".set .Lfp_i, 0\n"                                                     \
+        ".rept %c[n]\n"                                                        \
+        "mov 8*.Lfp_i(%[pa]), %%rdx\n"                                         \
+        "mulx %%rdx, %%rax, %%r9\n"                                            \
+        "adcx 8*(2*.Lfp_i)(%[pt]), %%rax\n"                                    \
+        "mov %%rax, 8*(2*.Lfp_i)(%[pt])\n"                                     \
+        "adcx 8*(2*.Lfp_i + 1)(%[pt]), %%r9\n"                                 \
+        "mov %%r9, 8*(2*.Lfp_i + 1)(%[pt])\n"                                  \
+        ".set .Lfp_i, .Lfp_i + 1\n"                                            \
+        ".endr\n"                                                              \
+        :                                                                      \
+        : [pt] "r"(t), [pa] "r"(a), [n] "i"(N)                                 \
+        : "rax", "rdx", "r8", "r9", "cc", "memory")
+
+// rp[0..N) += up[0..N) * v, carry limb is written into cy
+#define FP_ADX_ADDMUL(cy, rp, up, v, N)                                        \
+    __asm__ volatile("FP_ADX_ROW %[prp], 0, %[pup], 0, %c[n]\n"                \
+                     "mov %%r8, %[c]\n"                                        \
+                     : [c] "=r"(cy)                                            \
+                     : [prp] "r"(rp), [pup] "r"(up), "d"(v), [n] "i"(N)        \
+                     : "rax", "r8", "r9", "cc", "memory")
+
+// Multiplication and reduction unroll only the rows, the loops over them are
+// kept to fit into the instruction cache (fully unrolled 2N^2 MULX were slower
+// for every measured N). Squaring triangle has half the size and is unrolled.
+// Kernels are named by suffix S, P and PINV are the expressions giving p and
+// -p^-1 (mod 2^64): context values or constants of the generated kernels.
+#define FP_ADX_KERNELS_P(S, N, P, PINV)                                        \
+    static void _redc_adx_##S(mp_limb_t *r, mp_limb_t *t) {                    \
+        const mp_limb_t *p = (P);                                              \
+        for (int i = 0; i < N; i++) {                                          \
+            mp_limb_t q = t[i] * (PINV);                                       \
+            FP_ADX_ADDMUL(t[i], t + i, p, q, N);                               \
+        }                                                                      \
+        _redc_finish(r, t);                                                    \
+    }                                                                          \
+    static void _mulw_adx_##S(mp_limb_t *t, const mp_limb_t *a,                \
+                              const mp_limb_t *b) {                            \
+        mpn_zero(t, N);                                                        \
+        for (int i = 0; i < N; i++) {                                          \
+            FP_ADX_ADDMUL(t[i + N], t + i, b, a[i], N);                        \
+        }                                                                      \
+    }                                                                          \
+    static void _sqrw_adx_##S(mp_limb_t *t, const mp_limb_t *a) {              \
+        mpn_zero(t, 2 * N);                                                    \
+        FP_ADX_SQR(t, a, N);                                                   \
+    }                                                                          \
+    static void _mul_adx_##S(mp_limb_t *r, const mp_limb_t *a,                 \
+                             const mp_limb_t *b) {                             \
+        mp_limb_t t[2 * N];                                                    \
+        _mulw_adx_##S(t, a, b);                                                \
+        _redc_adx_##S(r, t);                                                   \
+    }                                                                          \
+    static void _sqr_adx_##S(mp_limb_t *r, const mp_limb_t *a) {               \
+        mp_limb_t t[2 * N];                                                    \
+        _sqrw_adx_##S(t, a);                                                   \
+        _redc_adx_##S(r, t);                                                   \
+    }
+
+#define FP_ADX_KERNELS(N)                                                      \
+    FP_ADX_KERNELS_P(N, N, g_ctx->p_limbs, g_ctx->pinv)
+
+// Limb counts of the deployed MSIDH characteristics: 738-bit (t = 100),
+// 922-bit (t = 120) and 1709-bit (t = 200) primes
+FP_ADX_KERNELS(12)
+FP_ADX_KERNELS(15)
+FP_ADX_KERNELS(27)
+
+static int _cpu_has_adx() {
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        return 0;
+    }
+    return (ebx & bit_BMI2) && (ebx & bit_ADX);
+}
+
+#ifdef FP_MONT_AVX2
+
+// AVX2 requires also the OS support for saving the YMM registers
+static int _cpu_has_avx2() {
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_OSXSAVE)) {
+        return 0;
+    }
+    unsigned int xcr0_lo, xcr0_hi;
+    __asm__("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+    if ((xcr0_lo & 6) != 6) {
+        return 0;
+    }
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        return 0;
+    }
+    return (ebx & bit_AVX2) != 0;
+}
+
+// Four Montgomery products in AVX2 lanes, one 64-bit lane per product.
+// Operands are split into k digits of 28 bits, k is a multiple of 4. Products
+// and the digit-wise Montgomery reduction by R' = 2^(28k) are computed with
+// VPMULUDQ four rows at a time, so that every accumulator digit is loaded and
+// stored once per four rows. Operand a is shifted by 28k - 64n bits, so that
+// a 2^shift b / R' = a b / R matches the scalar Montgomery form.
+
+// Number of 28-bit digits covering n limbs, rounded up to a multiple of 4
+static int _avx2_digits(mp_size_t n) {
+    int k = (GMP_NUMB_BITS * n + FP_AVX2_BITS - 1) / FP_AVX2_BITS;
+    return (k + 3) & ~3;
+}
+
+// r[j * stride] = bits [28j - shift, 28j - shift + 28) of a
+static void _to_radix28(uint64_t *r, int stride, const mp_limb_t *a,
+                        mp_size_t n, int k, int shift) {
+    for (int j = 0; j < k; j++) {
+        int pos = FP_AVX2_BITS * j - shift;
+        uint64_t v = 0;
+        if (pos < 0) {
+            v = pos > -FP_AVX2_BITS ? a[0] << -pos : 0;
+        } else if (pos < GMP_NUMB_BITS * n) {
+            int w = pos / 64, off = pos % 64;
+            v = a[w] >> off;
+            if (off > 64 - FP_AVX2_BITS && w + 1 < n) {
+                v |= a[w + 1] << (64 - off);
+            }
+        }
+        r[j * stride] = v & FP_AVX2_MASK;
+    }
+}
+
+// Inverse of _to_radix28 (without shift) into n + 1 limbs, the value must be
+// smaller than 2^(64(n + 1)) and the last digit can exceed 28 bits
+static void _from_radix28(mp_limb_t *r, const uint64_t *d, int stride,
+                          mp_size_t n, int k) {
+    mpn_zero(r, n + 1);
+    for (int j = 0; j < k; j++) {
+        int pos = FP_AVX2_BITS * j, w = pos / 64, off = pos % 64;
+        if (w > n) {
+            break;
+        }
+        r[w] |= d[j * stride] << off;
+        if (off > 0 && w + 1 <= n) {
+            r[w + 1] |= d[j * stride] >> (64 - off);
+        }
+    }
+}
+
+static void _setup_avx2(fp_ctx_t ctx) {
+    ctx->avx2_k = _avx2_digits(ctx->n);
+    ctx->avx2_shift = FP_AVX2_BITS * ctx->avx2_k - GMP_NUMB_BITS * ctx->n;
+    _to_radix28(ctx->avx2_p, 1, ctx->p_limbs, ctx->n, ctx->avx2_k, 0);
+}
+
+#define MUL4(__x, __y) _mm256_mul_epu32(__x, __y)
+#define ADD4(__x, __y) _mm256_add_epi64(__x, __y)
+
+// T[c] += x0 y[c] + x1 y[c - 1] + x2 y[c - 2] + x3 y[c - 3] for c < k + 3,
+// y is zero outside of [0, k)
+__attribute__((target("avx2"))) static inline void
+_rows4_avx2(__m256i *T, __m256i x0, __m256i x1, __m256i x2, __m256i x3,
+            const __m256i *y, int k) {
+    __m256i y1 = _mm256_setzero_si256(), y2 = y1, y3 = y1;
+    for (int c = 0; c < k + 3; c++) {
+        __m256i y0 = c < k ? y[c] : _mm256_setzero_si256();
+        __m256i s = ADD4(MUL4(x0, y0), MUL4(x1, y1));
+        s = ADD4(s, ADD4(MUL4(x2, y2), MUL4(x3, y3)));
+        T[c] = ADD4(T[c], s);
+        y3 = y2;
+        y2 = y1;
+        y1 = y0;
+    }
+}
+
+__attribute__((target("avx2"))) static void
+_mul_x4_avx2(mp_limb_t *const r[4], const mp_limb_t *const a[4],
+             const mp_limb_t *const b[4]) {
+    const mp_size_t n = g_ctx->n;
+    const int k = g_ctx->avx2_k;
+
+    // Digit j of lane l is at [j][l]. All inputs are read before any output
+    // is written, so r[i] can alias the inputs.
+    uint64_t da[FP_AVX2_MAX_DIGITS][4], db[FP_AVX2_MAX_DIGITS][4];
+    for (int l = 0; l < 4; l++) {
+        _to_radix28(&da[0][l], 4, a[l], n, k, g_ctx->avx2_shift);
+        _to_radix28(&db[0][l], 4, b[l], n, k, 0);
+    }
+
+    __m256i A[FP_AVX2_MAX_DIGITS], B[FP_AVX2_MAX_DIGITS];
+    __m256i P[FP_AVX2_MAX_DIGITS];
+    for (int j = 0; j < k; j++) {
+        A[j] = _mm256_loadu_si256((const __m256i *)da[j]);
+        B[j] = _mm256_loadu_si256((const __m256i *)db[j]);
+        P[j] = _mm256_set1_epi64x(g_ctx->avx2_p[j]);
+    }
+    const __m256i pinv = _mm256_set1_epi64x(g_ctx->pinv & FP_AVX2_MASK);
+    const __m256i mask = _mm256_set1_epi64x(FP_AVX2_MASK);
+
+    // Every digit of T[0..2k) receives at most 2k products < 2^56 and carries
+    __m256i T[2 * FP_AVX2_MAX_DIGITS];
+    for (int m = 0; m < 2 * k; m++) {
+        T[m] = _mm256_setzero_si256();
+    }
+    for (int i = 0; i < k; i += 4) {
+        _rows4_avx2(T + i, A[i], A[i + 1], A[i + 2], A[i + 3], B, k);
+    }
+
+    // Reduction, four digits at once: q_m = T[m] * (-p^-1) (mod 2^28) zeroes
+    // the digit m after its carry is moved into the next one. The quotients
+    // of the block are found on the copy of its four digits first.
+    for (int m = 0; m < k; m += 4) {
+        __m256i u0 = T[m], u1 = T[m + 1], u2 = T[m + 2], u3 = T[m + 3];
+        __m256i q0 = _mm256_and_si256(MUL4(u0, pinv), mask);
+        u0 = ADD4(u0, MUL4(q0, P[0]));
+        u1 = ADD4(u1, MUL4(q0, P[1]));
+        u1 = ADD4(u1, _mm256_srli_epi64(u0, FP_AVX2_BITS));
+        __m256i q1 = _mm256_and_si256(MUL4(u1, pinv), mask);
+        u1 = ADD4(u1, MUL4(q1, P[0]));
+        u2 = ADD4(ADD4(u2, MUL4(q0, P[2])), MUL4(q1, P[1]));
+        u2 = ADD4(u2, _mm256_srli_epi64(u1, FP_AVX2_BITS));
+        __m256i q2 = _mm256_and_si256(MUL4(u2, pinv), mask);
+        u3 = ADD4(ADD4(u3, MUL4(q0, P[3])), MUL4(q1, P[2]));
+        u3 = ADD4(u3, MUL4(q2, P[1]));
+        u2 = ADD4(u2, MUL4(q2, P[0]));
+        u3 = ADD4(u3, _mm256_srli_epi64(u2, FP_AVX2_BITS));
+        __m256i q3 = _mm256_and_si256(MUL4(u3, pinv), mask);
+
+        _rows4_avx2(T + m, q0, q1, q2, q3, P, k);
+        for (int j = m; j < m + 4; j++) {
+            T[j + 1] = ADD4(T[j + 1], _mm256_srli_epi64(T[j], FP_AVX2_BITS));
+        }
+    }
+
+    // Normalize the upper half into the result digits, the last one keeps
+    // the carry
+    uint64_t D[FP_AVX2_MAX_DIGITS][4];
+    __m256i carry = _mm256_setzero_si256();
+    for (int m = k; m < 2 * k; m++) {
+        __m256i acc = ADD4(T[m], carry);
+        _mm256_storeu_si256((__m256i *)D[m - k], _mm256_and_si256(acc, mask));
+        carry = _mm256_srli_epi64(acc, FP_AVX2_BITS);
+    }
+    _mm256_storeu_si256(
+        (__m256i *)D[k - 1],
+        ADD4(_mm256_loadu_si256((__m256i *)D[k - 1]),
+             _mm256_slli_epi64(carry, FP_AVX2_BITS)));
+
+    // Result < 2p can have one more limb, at most one subtraction is needed
+    mp_limb_t t[FP_MAX_LIMBS + 1];
+    for (int l = 0; l < 4; l++) {
+        _from_radix28(t, &D[0][l], 4, n, k);
+        if (t[n] || mpn_cmp(t, g_ctx->p_limbs, n) >= 0) {
+            mpn_sub_n(t, t, g_ctx->p_limbs, n);
+        }
+        mpn_copyi(r[l], t, n);
+    }
+}
+
+#undef MUL4
+#undef ADD4
+
+#endif
+#endif
+
+#ifdef FP_MONT_SPEC
+// Kernels generated for a single characteristic by
+// sage/scripts/gen_fp_mont.py, see `make FP_SPEC=<t>`. They are built from
+// the MULX/ADX rows, there is nothing to specialize without them.
+#ifndef FP_MONT_X86
+#error "FP_SPEC requires the x86-64 MULX/ADX kernels (GNU C, no FP_NO_ASM)"
+#endif
+#include "fp_mont_spec.h"
+
+// Other characteristics are reported once per thread
+static _Thread_local int g_spec_warned = 0;
+#endif
+
+static void _select_kernels(fp_ctx_t ctx) {
+    ctx->mul = _mul_generic;
+    ctx->sqr = _sqr_generic;
+    ctx->redc = _redc;
+    ctx->mulw = _mulw_generic;
+    ctx->sqrw = _sqrw_generic;
+    ctx->mul_x4 = NULL;
+
+#ifdef FP_MONT_X86
+    if (_cpu_has_adx()) {
+        switch (ctx->n) {
+        case 12:
+            ctx->mul = _mul_adx_12;
+            ctx->sqr = _sqr_adx_12;
+            ctx->redc = _redc_adx_12;
+            ctx->mulw = _mulw_adx_12;
+            ctx->sqrw = _sqrw_adx_12;
+            break;
+        case 15:
+            ctx->mul = _mul_adx_15;
+            ctx->sqr = _sqr_adx_15;
+            ctx->redc = _redc_adx_15;
+            ctx->mulw = _mulw_adx_15;
+            ctx->sqrw = _sqrw_adx_15;
+            break;
+        case 27:
+            ctx->mul = _mul_adx_27;
+            ctx->sqr = _sqr_adx_27;
+            ctx->redc = _redc_adx_27;
+            ctx->mulw = _mulw_adx_27;
+            ctx->sqrw = _sqrw_adx_27;
+            break;
+        }
+    }
+#endif
+#ifdef FP_MONT_SPEC
+    // Specialized library must not silently run the generic kernels
+    if (!_cpu_has_adx()) {
+        fprintf(stderr, "[!] Library built with FP_SPEC requires a CPU with "
+                        "MULX/ADX\n");
+        abort();
+    }
+    if (ctx->n == FP_SPEC_N && !mpn_cmp(ctx->p_limbs, FP_SPEC_P, FP_SPEC_N)) {
+        ctx->mul = _mul_adx_spec;
+        ctx->sqr = _sqr_adx_spec;
+        ctx->redc = _redc_adx_spec;
+        ctx->mulw = _mulw_adx_spec;
+        ctx->sqrw = _sqrw_adx_spec;
+    } else if (!g_spec_warned) {
+        fprintf(stderr, "[!] Characteristic differs from the one of FP_SPEC, "
+                        "generated kernels are not used\n");
+        g_spec_warned = 1;
+    }
+#endif
+#ifdef FP_MONT_AVX2
+    if (_cpu_has_avx2() && _avx2_digits(ctx->n) <= FP_AVX2_MAX_DIGITS) {
+        _setup_avx2(ctx);
+        ctx->mul_x4 = _mul_x4_avx2;
+    }
+#endif
+}
+
+// Convert canonical integer a < R (zero-padded to 2n limbs) into the
+// Montgomery form: r = a * R (mod p)
+static void _to_mont(mp_limb_t *r, const mp_limb_t *a) {
+    mp_limb_t t[2 * FP_MAX_LIMBS];
+    mpn_mul_n(t, a, g_ctx->r2, g_ctx->n);
+    _redc(r, t);
+}
+
+// Convert from the Montgomery form into canonical integer: r = a * R^-1
+static void _from_mont(mp_limb_t *r, const mp_limb_t *a) {
+    const mp_size_t n = g_ctx->n;
+    mp_limb_t t[2 * FP_MAX_LIMBS];
+    mpn_copyi(t, a, n);
+    mpn_zero(t + n, n);
+    _redc(r, t);
+}
+
+// init: set value = 0, before the characteristic is set whole storage is
+// cleared
+void fp_init(fp_t res) {
+    mp_size_t n = (g_ctx != NULL && g_ctx->n) ? g_ctx->n : FP_MAX_LIMBS;
+    mpn_zero(res->d, n);
+}
+
+// clear: storage is inline - nothing to deallocate
+void fp_clear(fp_t res) { (void)res; }
+
+// set: result <- a
+void fp_set(fp_t res, const fp_t a) {
+    if (res != a) {
+        mpn_copyi(res->d, a->d, g_ctx->n);
+    }
+}
+
+void fp_cswap(fp_t a, fp_t b, int swap) {
+    const mp_limb_t mask = -(mp_limb_t)(swap & 1);
+    for (mp_size_t i = 0; i < g_ctx->n; i++) {
+        mp_limb_t t = (a->d[i] ^ b->d[i]) & mask;
+        a->d[i] ^= t;
+        b->d[i] ^= t;
+    }
+}
+
+// set uint: result <- (uint) a * R (mod p)
+void fp_set_uint(fp_t res, unsigned long int a) {
+    const mp_size_t n = g_ctx->n;
+    mp_limb_t t[2 * FP_MAX_LIMBS];
+    // a < R, therefore a * R^2 < pR is a valid input for REDC
+    t[n] = mpn_mul_1(t, g_ctx->r2, n, a);
+    mpn_zero(t + n + 1, n - 1);
+    _redc(res->d, t);
+}
+
+void fp_set_mpz(fp_t res, const mpz_t a) {
+    mp_limb_t t[FP_MAX_LIMBS];
+    mpz_mod(g_ctx->tmp, a, g_ctx->p);
+    _limbs_from_mpz(t, g_ctx->tmp, g_ctx->n);
+    _to_mont(res->d, t);
+}
+
+int fp_set_str(fp_t res, const char *str) {
+    assert(g_ctx != NULL && g_ctx->n &&
+           "Characteristic must be set before parsing");
+    if (mpz_set_str(g_ctx->tmp, str, 0) != 0) {
+        return -1;
+    }
+    fp_set_mpz(res, g_ctx->tmp);
+    return 0;
+}
+
+void fp_get_mpz(mpz_t res, const fp_t a) {
+    const mp_size_t n = g_ctx->n;
+    mp_limb_t *r = mpz_limbs_write(res, n);
+    _from_mont(r, a->d);
+    mpz_limbs_finish(res, n);
+}
+
+unsigned long int fp_get_ui(const fp_t a) {
+    fp_get_mpz(g_ctx->tmp, a);
+    return mpz_get_ui(g_ctx->tmp);
+}
+
+size_t fp_sizeinbase(const fp_t a, int base) {
+    fp_get_mpz(g_ctx->tmp, a);
+    return mpz_sizeinbase(g_ctx->tmp, base);
+}
+
+size_t fp_nbytes() { return g_ctx->nbytes; }
+
+void fp_to_bytes(unsigned char *buf, const fp_t a) {
+    mp_limb_t t[FP_MAX_LIMBS];
+    _from_mont(t, a->d);
+    for (size_t i = 0; i < g_ctx->nbytes; i++) {
+        size_t limb = i / sizeof(mp_limb_t);
+        size_t shift = 8 * (i % sizeof(mp_limb_t));
+        buf[i] = (unsigned char)(t[limb] >> shift);
+    }
+}
+
+int fp_from_bytes(fp_t res, const unsigned char *buf) {
+    const mp_size_t n = g_ctx->n;
+    mp_limb_t t[FP_MAX_LIMBS];
+    mpn_zero(t, n);
+    for (size_t i = 0; i < g_ctx->nbytes; i++) {
+        size_t limb = i / sizeof(mp_limb_t);
+        size_t shift = 8 * (i % sizeof(mp_limb_t));
+        t[limb] |= (mp_limb_t)buf[i] << shift;
+    }
+    if (mpn_cmp(t, g_ctx->p_limbs, n) >= 0) {
+        return -1;
+    }
+    _to_mont(res->d, t);
+    return 0;
+}
+
+// add: result = a + b (mod p)
+void fp_add(fp_t res, const fp_t a, const fp_t b) {
+    const mp_size_t n = g_ctx->n;
+    mp_limb_t cy = mpn_add_n(res->d, a->d, b->d, n);
+    if (cy || mpn_cmp(res->d, g_ctx->p_limbs, n) >= 0) {
+        mpn_sub_n(res->d, res->d, g_ctx->p_limbs, n);
+    }
+}
+
+// add uint: result = a + (unsigned int) b (mod p)
+void fp_add_uint(fp_t res, const fp_t a, unsigned long int b) {
+    fp_t t;
+    fp_set_uint(t, b);
+    fp_add(res, a, t);
+}
+
+// sub: res = a - b (mod p)
+void fp_sub(fp_t res, const fp_t a, const fp_t b) {
+    const mp_size_t n = g_ctx->n;
+    if (mpn_sub_n(res->d, a->d, b->d, n)) {
+        mpn_add_n(res->d, res->d, g_ctx->p_limbs, n);
+    }
+}
+
+// sub uint: res = a - (unsigned int) b (mod p)
+void fp_sub_uint(fp_t res, const fp_t a, unsigned long int b) {
+    fp_t t;
+    fp_set_uint(t, b);
+    fp_sub(res, a, t);
+}
+
+// mul: res = a * b (mod p)
+// Product is calculated into separate buffer, therefore the function is
+// argument-safe
+void fp_mul(fp_t res, const fp_t a, const fp_t b) {
+    if (a == b) {
+        g_ctx->sqr(res->d, a->d);
+    } else {
+        g_ctx->mul(res->d, a->d, b->d);
+    }
+}
+
+void fp_mul_batch(fp_ptr *res, const fp_srcptr *a, const fp_srcptr *b,
+                  size_t n) {
+    size_t i = 0;
+    if (g_ctx->mul_x4 != NULL) {
+        for (; i + 4 <= n; i += 4) {
+            mp_limb_t *r4[4] = {res[i]->d, res[i + 1]->d, res[i + 2]->d,
+                                res[i + 3]->d};
+            const mp_limb_t *a4[4] = {a[i]->d, a[i + 1]->d, a[i + 2]->d,
+                                      a[i + 3]->d};
+            const mp_limb_t *b4[4] = {b[i]->d, b[i + 1]->d, b[i + 2]->d,
+                                      b[i + 3]->d};
+            g_ctx->mul_x4(r4, a4, b4);
+        }
+    }
+    for (; i < n; i++) {
+        fp_mul(res[i], a[i], b[i]);
+    }
+}
+
+// Accumulator t = U R + L holds the upper half U < p, therefore t < pR is
+// a valid REDC input. Adjusting only U by p keeps t (mod p) and the result of
+// the reduction unchanged.
+void fp_acc_init(fp_acc_t res) {
+    mp_size_t n = (g_ctx != NULL && g_ctx->n) ? g_ctx->n : FP_MAX_LIMBS;
+    mpn_zero(res->d, 2 * n);
+}
+
+void fp_acc_clear(fp_acc_t res) { (void)res; }
+
+// a, b < p gives ab < p^2 < pR
+void fp_mul_wide(fp_acc_t res, const fp_t a, const fp_t b) {
+    if (a == b) {
+        g_ctx->sqrw(res->d, a->d);
+    } else {
+        g_ctx->mulw(res->d, a->d, b->d);
+    }
+}
+
+// U = Ua + Ub + carry < 2p, at most one subtraction
+void fp_acc_add(fp_acc_t res, const fp_acc_t a, const fp_acc_t b) {
+    const mp_size_t n = g_ctx->n;
+    mp_limb_t *u = res->d + n;
+    mp_limb_t cy = mpn_add_n(res->d, a->d, b->d, 2 * n);
+    if (cy || mpn_cmp(u, g_ctx->p_limbs, n) >= 0) {
+        mpn_sub_n(u, u, g_ctx->p_limbs, n);
+    }
+}
+
+// U = Ua - Ub - borrow >= -p, at most one addition
+void fp_acc_sub(fp_acc_t res, const fp_acc_t a, const fp_acc_t b) {
+    const mp_size_t n = g_ctx->n;
+    if (mpn_sub_n(res->d, a->d, b->d, 2 * n)) {
+        mpn_add_n(res->d + n, res->d + n, g_ctx->p_limbs, n);
+    }
+}
+
+void fp_acc_reduce(fp_t res, const fp_acc_t a) {
+    mp_limb_t t[2 * FP_MAX_LIMBS];
+    mpn_copyi(t, a->d, 2 * g_ctx->n);
+    g_ctx->redc(res->d, t);
+}
+
+// mul int: res = a * (int) b (mod p)
+void fp_mul_int(fp_t res, const fp_t a, long int b) {
+    fp_t t;
+    // Take the absolute value without overflow for LONG_MIN
+    unsigned long int ub = b < 0 ? -(unsigned long int)b : (unsigned long int)b;
+    fp_set_uint(t, ub);
+    fp_mul(res, a, t);
+    if (b < 0) {
+        fp_neg(res, res);
+    }
+}
+
+#ifdef FP_MONT_SAFEGCD
+// safegcd inversion (Bernstein, Yang: "Fast constant-time gcd computation and
+// modular inversion", 2019). Numbers are held in signed 62-bit digits: all but
+// the top one from [0, 2^62), the top one carries the sign. Divsteps are done
+// in batches of 62 on the lowest digits only, the batch is then applied to the
+// full numbers as 2x2 matrix scaled by 2^62. The layout follows the modinv64
+// module of libsecp256k1, generalized to sg_len digits.
+
+// Write a < 2^(64 * n) as sg_len digits
+static void _sg_from_limbs(int64_t *r, const mp_limb_t *a, mp_size_t n,
+                           int len) {
+    for (int j = 0; j < len; j++) {
+        int bit = FP_SG_BITS * j, w = bit / GMP_NUMB_BITS;
+        int s = bit % GMP_NUMB_BITS;
+        uint64_t x = w < n ? a[w] >> s : 0;
+        if (s > GMP_NUMB_BITS - FP_SG_BITS && w + 1 < n) {
+            x |= a[w + 1] << (GMP_NUMB_BITS - s);
+        }
+        r[j] = x & FP_SG_MASK;
+    }
+}
+
+// Inverse of `_sg_from_limbs` for 0 <= d < 2^(64 * n)
+static void _sg_to_limbs(mp_limb_t *r, const int64_t *d, mp_size_t n,
+                         int len) {
+    mpn_zero(r, n);
+    for (int j = 0; j < len; j++) {
+        int bit = FP_SG_BITS * j, w = bit / GMP_NUMB_BITS;
+        int s = bit % GMP_NUMB_BITS;
+        if (w < n) {
+            r[w] |= (uint64_t)d[j] << s;
+        }
+        if (s > GMP_NUMB_BITS - FP_SG_BITS && w + 1 < n) {
+            r[w + 1] |= (uint64_t)d[j] >> (GMP_NUMB_BITS - s);
+        }
+    }
+}
+
+static void _setup_safegcd(fp_ctx_t ctx) {
+    // The numbers from (-2p, p) need two bits above p
+    long int bits = mpz_sizeinbase(ctx->p, 2);
+    ctx->sg_len = (bits + 2) / FP_SG_BITS + 1;
+    _sg_from_limbs(ctx->sg_p, ctx->p_limbs, ctx->n, ctx->sg_len);
+
+    // Newton iteration as for pinv, 64 correct bits are more than enough
+    uint64_t inv = ctx->p_limbs[0];
+    for (int i = 0; i < 5; i++) {
+        inv *= 2 - ctx->p_limbs[0] * inv;
+    }
+    ctx->sg_pinv = inv & FP_SG_MASK;
+
+    // Theorem 11.2 of the paper: for f = p and 0 <= g < p this many divsteps
+    // reach g = 0, any further divsteps keep the result
+    long int steps = bits < 46 ? (49 * bits + 80) / 17 : (49 * bits + 57) / 17;
+    ctx->sg_batches = (steps + FP_SG_BITS - 1) / FP_SG_BITS;
+}
+
+// 62 divsteps on the lowest 62 bits of f and g, starting with given delta:
+//   delta > 0 and g odd: (delta, f, g) -> (1 - delta, g, (g - f)/2)
+//   otherwise:           (delta, f, g) -> (1 + delta, f, (g + (g&1) f)/2)
+// Return new delta and write matrix t = [u, v, q, r] of the batch, so that
+// 2^62 (f', g') = (u f + v g, q f + r g). |u| + |v| <= 2^62, same for q, r.
+// Branch-free, the selection is done by the masks c1 and c2.
+static int64_t _sg_divsteps(int64_t delta, uint64_t f, uint64_t g,
+                            int64_t t[4]) {
+    uint64_t u = 1, v = 0, q = 0, r = 1, x;
+    for (int i = 0; i < FP_SG_BITS; i++) {
+        // c1 = -1 if delta > 0 and g is odd, swap and negate: (g, -f)
+        uint64_t c1 = -((-(uint64_t)delta >> 63) & g & 1);
+        x = (f ^ g) & c1;
+        f ^= x;
+        g ^= x;
+        g = (g ^ c1) - c1;
+        x = (u ^ q) & c1;
+        u ^= x;
+        q ^= x;
+        q = (q ^ c1) - c1;
+        x = (v ^ r) & c1;
+        v ^= x;
+        r ^= x;
+        r = (r ^ c1) - c1;
+        delta = (delta ^ (int64_t)c1) - (int64_t)c1;
+
+        // g is odd: g += f
+        uint64_t c2 = -(g & 1);
+        g += f & c2;
+        q += u & c2;
+        r += v & c2;
+
+        g >>= 1;
+        u <<= 1;
+        v <<= 1;
+        delta++;
+    }
+    t[0] = (int64_t)u;
+    t[1] = (int64_t)v;
+    t[2] = (int64_t)q;
+    t[3] = (int64_t)r;
+    return delta;
+}
+
+// (f, g) = (u f + v g, q f + r g) / 2^62, the divisions are exact
+static void _sg_update_fg(int64_t *f, int64_t *g, const int64_t t[4],
+                          int len) {
+    const int64_t u = t[0], v = t[1], q = t[2], r = t[3];
+    __int128 cf = (__int128)u * f[0] + (__int128)v * g[0];
+    __int128 cg = (__int128)q * f[0] + (__int128)r * g[0];
+    assert(((uint64_t)cf & FP_SG_MASK) == 0);
+    assert(((uint64_t)cg & FP_SG_MASK) == 0);
+    cf >>= FP_SG_BITS;
+    cg >>= FP_SG_BITS;
+    for (int i = 1; i < len; i++) {
+        cf += (__int128)u * f[i] + (__int128)v * g[i];
+        cg += (__int128)q * f[i] + (__int128)r * g[i];
+        f[i - 1] = (uint64_t)cf & FP_SG_MASK;
+        g[i - 1] = (uint64_t)cg & FP_SG_MASK;
+        cf >>= FP_SG_BITS;
+        cg >>= FP_SG_BITS;
+    }
+    f[len - 1] = (int64_t)cf;
+    g[len - 1] = (int64_t)cg;
+}
+
+// (d, e) = (u d + v e, q d + r e) / 2^62 (mod p). Multiples of p are added to
+// make the divisions exact and keep both numbers in the range (-2p, p).
+static void _sg_update_de(int64_t *d, int64_t *e, const int64_t t[4]) {
+    const int len = g_ctx->sg_len;
+    const int64_t *p = g_ctx->sg_p;
+    const int64_t u = t[0], v = t[1], q = t[2], r = t[3];
+
+    // Add p (u, q) for d < 0 and p (v, r) for e < 0 as in libsecp256k1, then
+    // fix the lowest 62 bits of md, me for the exact division
+    int64_t sd = d[len - 1] >> 63, se = e[len - 1] >> 63;
+    int64_t md = (u & sd) + (v & se);
+    int64_t me = (q & sd) + (r & se);
+    __int128 cd = (__int128)u * d[0] + (__int128)v * e[0];
+    __int128 ce = (__int128)q * d[0] + (__int128)r * e[0];
+    md -= (g_ctx->sg_pinv * (uint64_t)cd + md) & FP_SG_MASK;
+    me -= (g_ctx->sg_pinv * (uint64_t)ce + me) & FP_SG_MASK;
+    cd += (__int128)p[0] * md;
+    ce += (__int128)p[0] * me;
+    assert(((uint64_t)cd & FP_SG_MASK) == 0);
+    assert(((uint64_t)ce & FP_SG_MASK) == 0);
+    cd >>= FP_SG_BITS;
+    ce >>= FP_SG_BITS;
+    for (int i = 1; i < len; i++) {
+        cd += (__int128)u * d[i] + (__int128)v * e[i] + (__int128)p[i] * md;
+        ce += (__int128)q * d[i] + (__int128)r * e[i] + (__int128)p[i] * me;
+        d[i - 1] = (uint64_t)cd & FP_SG_MASK;
+        e[i - 1] = (uint64_t)ce & FP_SG_MASK;
+        cd >>= FP_SG_BITS;
+        ce >>= FP_SG_BITS;
+    }
+    d[len - 1] = (int64_t)cd;
+    e[len - 1] = (int64_t)ce;
+}
+
+// Propagate carries, so that all digits but the top one are in [0, 2^62)
+static void _sg_carry(int64_t *d, int len) {
+    int64_t c = 0;
+    for (int i = 0; i < len - 1; i++) {
+        c += d[i];
+        d[i] = c & FP_SG_MASK;
+        c >>= FP_SG_BITS;
+    }
+    d[len - 1] += c;
+}
+
+// d = d + p if d < 0
+static void _sg_add_p_if_neg(int64_t *d) {
+    const int len = g_ctx->sg_len;
+    int64_t mask = d[len - 1] >> 63;
+    for (int i = 0; i < len; i++) {
+        d[i] += g_ctx->sg_p[i] & mask;
+    }
+    _sg_carry(d, len);
+}
+
+// modular inverse: res = a^-1 (mod p), constant-time
+void fp_inv(fp_t res, const fp_t a) {
+    const mp_size_t n = g_ctx->n;
+    const int len = g_ctx->sg_len;
+    int64_t f[FP_SG_MAX_DIGITS], g[FP_SG_MAX_DIGITS];
+    int64_t d[FP_SG_MAX_DIGITS], e[FP_SG_MAX_DIGITS];
+
+    // Invariants: d a = f and e a = g (mod p) up to the common power of 2
+    memcpy(f, g_ctx->sg_p, len * sizeof(int64_t));
+    _sg_from_limbs(g, a->d, n, len);
+    memset(d, 0, len * sizeof(int64_t));
+    memset(e, 0, len * sizeof(int64_t));
+    e[0] = 1;
+
+    int64_t delta = 1, t[4];
+    for (int i = 0; i < g_ctx->sg_batches; i++) {
+        delta = _sg_divsteps(delta, f[0], g[0], t);
+        _sg_update_de(d, e, t);
+        _sg_update_fg(f, g, t, len);
+    }
+
+    // Now g = 0 and f = +-1 = gcd(p, a), so a^-1 = d f: map d from (-2p, p)
+    // into [0, p) taking the sign of f
+    int64_t neg = f[len - 1] >> 63;
+    _sg_add_p_if_neg(d);
+    for (int i = 0; i < len; i++) {
+        d[i] = (d[i] ^ neg) - neg;
+    }
+    _sg_carry(d, len);
+    _sg_add_p_if_neg(d);
+
+    // safegcd on the Montgomery form gives: (aR)^-1 = a^-1 R^-1, and
+    // REDC(a^-1 R^-1 * R^3) = a^-1 R
+    _sg_to_limbs(res->d, d, n, len);
+    mp_limb_t tmp[2 * FP_MAX_LIMBS];
+    mpn_mul_n(tmp, res->d, g_ctx->r3, n);
+    _redc(res->d, tmp);
+}
+#else
+// modular inverse: res = a^-1 (mod p) by Fermat's little theorem
+void fp_inv(fp_t res, const fp_t a) { _pow(res, a, g_ctx->e_inv); }
+#endif
+
+// div: a / b (mod p) = a * b^-1 (mod p)
+void fp_div(fp_t res, const fp_t a, const fp_t b) {
+    fp_t t;
+    fp_inv(t, b);
+    fp_mul(res, a, t);
+}
+
+// neg: a = -a (mod p)
+void fp_neg(fp_t res, const fp_t a) {
+    const mp_size_t n = g_ctx->n;
+    if (mpn_zero_p(a->d, n)) {
+        mpn_zero(res->d, n);
+    } else {
+        mpn_sub_n(res->d, g_ctx->p_limbs, a->d, n);
+    }
+}
+
+// Fixed-window exponentiation: res = a^e for e > 0, processing POW_WINDOW bits
+// of e per multiplication. Powers are precomputed, so res = a is allowed.
+#define POW_WINDOW 4
+static void _pow(fp_t res, const fp_t a, const mpz_t e) {
+    // pw[i] = a^i for 0 < i < 2^POW_WINDOW
+    fp_t pw[1 << POW_WINDOW];
+    fp_set(pw[1], a);
+    fp_mul(pw[2], a, a);
+    for (int i = 3; i < (1 << POW_WINDOW); i++) {
+        fp_mul(pw[i], pw[i - 1], pw[1]);
+    }
+
+    // Number of windows, the top one can be shorter
+    long int n_bits = mpz_sizeinbase(e, 2);
+    long int w = (n_bits - 1) / POW_WINDOW;
+
+    int started = 0;
+    for (; w >= 0; w--) {
+        unsigned int digit = 0;
+        for (int j = POW_WINDOW - 1; j >= 0; j--) {
+            digit = (digit << 1) | mpz_tstbit(e, w * POW_WINDOW + j);
+        }
+
+        if (!started) {
+            // Most significant window is nonzero, because e > 0
+            fp_set(res, pw[digit]);
+            started = 1;
+            continue;
+        }
+        for (int j = 0; j < POW_WINDOW; j++) {
+            fp_mul(res, res, res);
+        }
+        if (digit) {
+            fp_mul(res, res, pw[digit]);
+        }
+    }
+}
+
+// sqrt: res = a^((p + 1)/4)
+// assumes that prime is in form: p = 3 (mod 4)
+void fp_sqrt(fp_t res, const fp_t a) { _pow(res, a, g_ctx->e_sqrt); }
+
+// pow34: res = a^((p - 3)/4)
+void fp_pow34(fp_t res, const fp_t a) { _pow(res, a, g_ctx->e_pow34); }
+
+// Legendre symbol of the Montgomery form: (aR / p) = (a / p), because
+// R = 2^(64 * n) is an even power of two and thus a square
+int fp_is_square(const fp_t a) {
+    mpz_t a_view;
+    mpz_roinit_n(a_view, a->d, g_ctx->n);
+    return mpz_jacobi(a_view, g_ctx->p) >= 0;
+}
+
+int fp_is_zero(const fp_t a) { return mpn_zero_p(a->d, g_ctx->n); }
+
+int fp_equal_uint(fp_t a, unsigned long int b) {
+    fp_t t;
+    fp_set_uint(t, b);
+    return fp_equal(a, t);
+}
+
+int fp_equal(fp_t a, fp_t b) {
+    return !mpn_cmp(a->d, b->d, g_ctx->n);
+}
+
+int fp_equal_str(fp_t a, const char *b_str) {
+    fp_t b;
+    if (fp_set_str(b, b_str) != 0) {
+        return 0;
+    }
+    return fp_equal(a, b);
+}
+
+void fp_print(fp_t a, const char *name) {
+    fp_get_mpz(g_ctx->tmp, a);
+    gmp_printf("%s: %Zd\n", name, g_ctx->tmp);
+}
+
+#endif
@@ -0,0 +1,172 @@
+#include <gmp.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "gmp_alloc.h"
+
+// Size classes 2^GMP_ALLOC_MIN_LOG .. 2^GMP_ALLOC_MAX_LOG bytes, larger blocks
+// are passed directly to malloc
+#define GMP_ALLOC_MIN_LOG 4
+#define GMP_ALLOC_MAX_LOG 15
+#define GMP_ALLOC_N_CLASSES (GMP_ALLOC_MAX_LOG - GMP_ALLOC_MIN_LOG + 1)
+
+// Maximal size of the free blocks kept in one class
+#define GMP_ALLOC_MAX_FREE (4 << 20)
+
+// Free block of the pool holds the pointer to the next one
+struct free_block {
+    struct free_block *next;
+};
+
+struct gmp_pool {
+    struct free_block *head[GMP_ALLOC_N_CLASSES];
+    size_t n_free[GMP_ALLOC_N_CLASSES];
+};
+
+static _Thread_local struct gmp_alloc_stats g_stats;
+static _Thread_local struct gmp_pool *g_pool = NULL;
+
+// The key only runs the destructor at the thread exit
+static pthread_key_t g_pool_key;
+static pthread_once_t g_pool_once = PTHREAD_ONCE_INIT;
+
+static void _check(void *ptr, size_t size) {
+    if (ptr == NULL) {
+        fprintf(stderr, "[!] GMP allocator cannot allocate %zu bytes\n", size);
+        abort();
+    }
+}
+
+// Index of the smallest class of at least `size` bytes, N_CLASSES if none
+static int _size_class(size_t size) {
+    int c = 0;
+    while (c < GMP_ALLOC_N_CLASSES &&
+           ((size_t)1 << (c + GMP_ALLOC_MIN_LOG)) < size) {
+        c++;
+    }
+    return c;
+}
+
+// Size of the block actually allocated for `size` bytes
+static size_t _block_size(size_t size) {
+    int c = _size_class(size);
+    return c < GMP_ALLOC_N_CLASSES ? (size_t)1 << (c + GMP_ALLOC_MIN_LOG)
+                                   : size;
+}
+
+static void _pool_destroy(void *ptr) {
+    struct gmp_pool *pl = ptr;
+    for (int c = 0; c < GMP_ALLOC_N_CLASSES; c++) {
+        while (pl->head[c] != NULL) {
+            struct free_block *b = pl->head[c];
+            pl->head[c] = b->next;
+            free(b);
+        }
+    }
+    free(pl);
+    // Blocks freed later by other destructors of the thread create new pool
+    g_pool = NULL;
+}
+
+static void _create_key() { pthread_key_create(&g_pool_key, _pool_destroy); }
+
+// Pool of the calling thread, created on the first use
+static struct gmp_pool *_pool() {
+    if (g_pool == NULL) {
+        g_pool = calloc(1, sizeof(struct gmp_pool));
+        _check(g_pool, sizeof(struct gmp_pool));
+        pthread_once(&g_pool_once, _create_key);
+        pthread_setspecific(g_pool_key, g_pool);
+    }
+    return g_pool;
+}
+
+static void *_count_alloc(size_t size) {
+    g_stats.n_alloc++;
+    g_stats.n_sys++;
+    void *ptr = malloc(size);
+    _check(ptr, size);
+    return ptr;
+}
+
+static void *_count_realloc(void *ptr, size_t old_size, size_t new_size) {
+    (void)old_size;
+    g_stats.n_realloc++;
+    g_stats.n_sys++;
+    ptr = realloc(ptr, new_size);
+    _check(ptr, new_size);
+    return ptr;
+}
+
+static void _count_free(void *ptr, size_t size) {
+    (void)size;
+    free(ptr);
+}
+
+static void *_pool_alloc(size_t size) {
+    g_stats.n_alloc++;
+    int c = _size_class(size);
+    if (c < GMP_ALLOC_N_CLASSES) {
+        struct gmp_pool *pl = _pool();
+        if (pl->head[c] != NULL) {
+            struct free_block *b = pl->head[c];
+            pl->head[c] = b->next;
+            pl->n_free[c]--;
+            return b;
+        }
+    }
+
+    g_stats.n_sys++;
+    size = _block_size(size);
+    void *ptr = malloc(size);
+    _check(ptr, size);
+    return ptr;
+}
+
+static void *_pool_realloc(void *ptr, size_t old_size, size_t new_size) {
+    g_stats.n_realloc++;
+    // Block is already large enough
+    int c = _size_class(new_size);
+    if (c < GMP_ALLOC_N_CLASSES && c == _size_class(old_size)) {
+        return ptr;
+    }
+
+    // Every block is a malloc block, therefore it can be resized in place
+    g_stats.n_sys++;
+    new_size = _block_size(new_size);
+    ptr = realloc(ptr, new_size);
+    _check(ptr, new_size);
+    return ptr;
+}
+
+static void _pool_free_block(void *ptr, size_t size) {
+    int c = _size_class(size);
+    if (c < GMP_ALLOC_N_CLASSES) {
+        struct gmp_pool *pl = _pool();
+        if ((pl->n_free[c] << (c + GMP_ALLOC_MIN_LOG)) < GMP_ALLOC_MAX_FREE) {
+            struct free_block *b = ptr;
+            b->next = pl->head[c];
+            pl->head[c] = b;
+            pl->n_free[c]++;
+            return;
+        }
+    }
+    free(ptr);
+}
+
+void gmp_alloc_setup(enum gmp_alloc_mode mode) {
+    if (mode == GMP_ALLOC_POOL) {
+        mp_set_memory_functions(_pool_alloc, _pool_realloc, _pool_free_block);
+    } else {
+        mp_set_memory_functions(_count_alloc, _count_realloc, _count_free);
+    }
+}
+
+void gmp_alloc_get_stats(struct gmp_alloc_stats *stats) { *stats = g_stats; }
+
+void gmp_alloc_reset_stats() {
+    g_stats.n_alloc = 0;
+    g_stats.n_realloc = 0;
+    g_stats.n_sys = 0;
+}
@@ -2,74 +2,95 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "arena.h"
 #include "ec_mont.h"
 #include "fp2.h"
 #include "isog_mont.h"
 
 void criss_cross(fp2_t lsum, fp2_t rdiff, const fp2_t x, const fp2_t y,
                  const fp2_t z, const fp2_t w) {
+    arena_frame_t frame = arena_push();
+    struct ec_scratch *s = arena_scratch();
+    criss_cross_scr(lsum, rdiff, x, y, z, w, s);
+    arena_pop(frame);
+}
+
+void criss_cross_scr(fp2_t lsum, fp2_t rdiff, const fp2_t x, const fp2_t y,
+                     const fp2_t z, const fp2_t w, struct ec_scratch *s) {
     // Calculate (xw + yz, xw - yz) given (x, y, z, w)
     // Argument-safe: Yes
-    // Registers: 2
-    // Cost: 2M + 2a
+    // Registers: w[0..1]
+    // Cost: 2M + 2a, reduced once per coordinate of each output
 
-    fp2_t t0, t1;
-    fp2_init(&t0);
-    fp2_init(&t1);
+    struct fp2_acc *xw = &s->w[0], *yz = &s->w[1];
 
-    // t0 = x * w
-    fp2_mul_unsafe(t0, x, w);
-    // t1 = y * z
-    fp2_mul_unsafe(t1, y, z);
+    fp2_mul_wide(xw, x, w, &s->fs);
+    fp2_mul_wide(yz, y, z, &s->fs);
 
-    // rdiff = t0 - t1: xw - yz
-    fp2_sub(rdiff, t0, t1);
-    // lsum = t0 + t1: xw + yz
-    fp2_add(lsum, t0, t1);
-
-    fp2_clear(&t0);
-    fp2_clear(&t1);
+    // lsum = xw + yz
+    fp2_acc_add(xw, xw, yz);
+    fp2_acc_reduce(lsum, xw);
+    // rdiff = (xw + yz) - 2yz: xw - yz
+    fp2_acc_sub(xw, xw, yz);
+    fp2_acc_sub(xw, xw, yz);
+    fp2_acc_reduce(rdiff, xw);
 }
 
-void KPS(point_t *kpts, size_t n, const point_t K, const fp2_t A24p,
+void KPS(struct point_vec *kpts, const point_t K, const fp2_t A24p,
          const fp2_t C24) {
+    size_t n = kpts->n;
+    if (n == 0) {
+        return;
+    }
+
+    arena_frame_t frame = arena_push();
+    struct ec_scratch *s = arena_scratch();
+
+    // Handles of the points [1]K, [i - 2]K, [i - 1]K and [i]K
+    struct point_xz v[4];
+    point_t K1 = point_vec_at(&v[3], kpts, 0);
+
     // "deepcopy" generator point as the first [1]K point
-    point_set(kpts[0], K);
+    point_set(K1, K);
 
     // Calculate the second as simple [2]K
     if (n >= 2) {
-        xDBL(kpts[1], K, A24p, C24);
+        xDBL_scr(point_vec_at(&v[1], kpts, 1), K, A24p, C24, s);
     }
 
     // Calculate next using: [i]K = [i - 1]K + K
     // To get difference: [i - 1]K - K = [i - 2]K
     for (size_t i = 2; i < n; i++) {
-        xADD(kpts[i], kpts[i - 1], kpts[0], kpts[i - 2]);
+        xADD_scr(point_vec_at(&v[2], kpts, i), point_vec_at(&v[1], kpts, i - 1),
+                 K1, point_vec_at(&v[0], kpts, i - 2), s);
     }
+
+    arena_pop(frame);
 }
 
-void prepare_kernel_points(point_t *kpoints, size_t n) {
-    fp2_t temp;
-    fp2_init(&temp);
-    for (size_t i = 0; i < n; i++) {
-        // (X : Z) -> (X + Z, X - Z)
-        fp2_add(temp, kpoints[i]->X, kpoints[i]->Z);
-        fp2_sub(kpoints[i]->Z, kpoints[i]->X, kpoints[i]->Z);
-        fp2_set(kpoints[i]->X, temp);
-    }
-    fp2_clear(&temp);
+void prepare_kernel_points(struct point_vec *kpts) {
+    size_t n = kpts->n;
+    // (X : Z) -> (X + Z, X - Z), without additional register:
+    // X' = X + Z, Z' = X' - 2Z
+    fp2_vec_add(kpts->X, kpts->X, kpts->Z, n);
+    fp2_vec_add(kpts->Z, kpts->Z, kpts->Z, n);
+    fp2_vec_sub(kpts->Z, kpts->X, kpts->Z, n);
+}
+
+void xISOG_odd(point_t Q, const struct point_vec *prep_kpts, const point_t P) {
+    arena_frame_t frame = arena_push();
+    struct ec_scratch *s = arena_scratch();
+    xISOG_odd_scr(Q, prep_kpts, P, s);
+    arena_pop(frame);
 }
 
-void xISOG_odd(point_t Q, const point_t *prep_kpts, size_t n, const point_t P) {
-    assert(n > 0 && prep_kpts != NULL &&
-           "List of kernel points cannot be empty");
-    // Registers: 4
+void xISOG_odd_scr(point_t Q, const struct point_vec *prep_kpts,
+                   const point_t P, struct ec_scratch *s) {
+    assert(prep_kpts->n > 0 && "List of kernel points cannot be empty");
+    // Registers: 4 (w[0..1] are used by criss_cross)
 
-    fp2_t t0, t1, t2, t3;
-    fp2_init(&t0);
-    fp2_init(&t1);
-    fp2_init(&t2);
-    fp2_init(&t3);
+    fp2_t t0 = &s->t[2], t1 = &s->t[3], t2 = &s->t[4], t3 = &s->t[5];
+    fp2_vec_t XK = prep_kpts->X, ZK = prep_kpts->Z;
 
     // Prepare point P = (X : Z) => P^ = (X + Z : X - Z)
     // Unfortunately we cannot modify P - so it requires additional 2 registers
@@ -81,13 +102,13 @@ void xISOG_odd(point_t Q, const point_t *prep_kpts, size_t n, const point_t P) {
     // By XP^ we represent the "prepared" variant
     // X' = [(XK + ZK)(XP - ZP) + (XK - ZK)(XP + ZP)] = [XK^ * ZP^ + ZK^ * XP^]
     // Z' = [(XK + ZK)(XP - ZP) - (XK - ZK)(XP + ZP)] = [XK^ * ZP^ - ZK^ * XP^]
-    criss_cross(Q->X, Q->Z, prep_kpts[0]->X, prep_kpts[0]->Z, t2, t3);
+    criss_cross_scr(Q->X, Q->Z, &XK[0], &ZK[0], t2, t3, s);
 
     // Multiply X' and Z' by same formula for Ki
-    for (size_t i = 1; i < n; i++) {
-        criss_cross(t0, t1, prep_kpts[i]->X, prep_kpts[i]->Z, t2, t3);
-        fp2_mul_safe(Q->X, t0);
-        fp2_mul_safe(Q->Z, t1);
+    for (size_t i = 1; i < prep_kpts->n; i++) {
+        criss_cross_scr(t0, t1, &XK[i], &ZK[i], t2, t3, s);
+        fp2_mul_safe_scr(Q->X, t0, &s->fs);
+        fp2_mul_safe_scr(Q->Z, t1, &s->fs);
     }
 
     // t0 = XQ^2: prod(i: XKi_ * ZP_ + ZKi_ * XP_)^2
@@ -96,111 +117,432 @@ void xISOG_odd(point_t Q, const point_t *prep_kpts, size_t n, const point_t P) {
     fp2_sq_unsafe(t1, Q->Z);
 
     // XQ = XP * t0: XP * prod(i: XKi_ * ZP_ - ZKi_ * XP_)^2
-    fp2_mul_unsafe(Q->X, t0, P->X);
+    fp2_mul_unsafe_scr(Q->X, t0, P->X, &s->fs);
     // ZQ = ZP * t1: ZP * prod(i: XKi_ * ZP_ - ZKi_ * XP_)^2
-    fp2_mul_unsafe(Q->Z, t1, P->Z);
-
-    fp2_clear(&t0);
-    fp2_clear(&t1);
-    fp2_clear(&t2);
-    fp2_clear(&t3);
+    fp2_mul_unsafe_scr(Q->Z, t1, P->Z, &s->fs);
 }
 
-void aISOG_curve_KPS(fp2_t A_, fp2_t C_, const fp2_t A24p, const fp2_t C24,
-                     const point_t *kpts, size_t n) {
-
-    fp2_t sigma, sigma_inv, pi;
-    fp2_init(&sigma);
-    fp2_init(&sigma_inv);
-    fp2_init(&pi);
+void xISOG_odd_batch(point_t *Q, const struct point_vec *prep_kpts,
+                     const point_t *P, size_t m) {
+    assert(prep_kpts->n > 0 && "List of kernel points cannot be empty");
+    if (m == 0) {
+        return;
+    }
 
-    // pi is equal to product of points x-coordinates, therefore it must be
-    // initialized with 1
-    fp2_set_uint(pi, 1);
+    arena_frame_t frame = arena_push();
 
-    fp2_t t0, t1;
-    fp2_init(&t0);
-    fp2_init(&t1);
+    // Same formulas as in xISOG_odd_scr, with the temporaries of every point
+    // stored in the vectors: P^ = (XP^ : ZP^), products (X' : Z') and the
+    // criss_cross terms (XK^ * ZP^ + ZK^ * XP^ : XK^ * ZP^ - ZK^ * XP^)
+    fp2_vec_t t = arena_fp2_vec(6 * m);
+    // hat = [XP^ ... | ZP^ ...], acc = [X' ... | Z' ...], cc = [... | ...]
+    fp2_vec_t hat = t, acc = t + 2 * m, cc = t + 4 * m;
+    struct fp2_scratch *s = arena_fp2_scratch_batch();
 
-    for (size_t i = 0; i < n; i++) {
-        // x(P) = X/Z
-        fp2_div_unsafe(t0, kpts[i]->X, kpts[i]->Z);
-        // x(P)^-1 = (X/Z)^-1 = (Z/X)
-        fp2_div_unsafe(t1, kpts[i]->Z, kpts[i]->X);
+    for (size_t j = 0; j < m; j++) {
+        fp2_add(&hat[j], P[j]->X, P[j]->Z);
+        fp2_sub(&hat[m + j], P[j]->X, P[j]->Z);
+    }
 
-        // sigma += x([i]K)
-        fp2_add(sigma, sigma, t0);
-        // pi *= x([i]K)
-        fp2_mul_safe(pi, t0);
+    for (size_t i = 0; i < prep_kpts->n; i++) {
+        fp2_vec_criss_cross(i == 0 ? acc : cc, (i == 0 ? acc : cc) + m,
+                            hat + m, hat, &prep_kpts->Z[i], &prep_kpts->X[i],
+                            m, s);
+        if (i > 0) {
+            fp2_vec_mul(acc, acc, cc, 2 * m, s);
+        }
+    }
 
-        // sigma_inv += x([i]K)^-1
-        fp2_add(sigma_inv, sigma_inv, t1);
+    // (XQ : ZQ) = (XP * X'^2 : ZP * Z'^2)
+    for (size_t j = 0; j < 2 * m; j++) {
+        fp2_sq_safe_scr(&acc[j], &s[0]);
+    }
+    // Pushed points are not stored in a vector, so their handles are collected
+    fp2_t *h = arena_alloc(6 * m * sizeof(fp2_t)), *k = h + 2 * m,
+          *q = h + 4 * m;
+    for (size_t j = 0; j < m; j++) {
+        k[j] = P[j]->X;
+        k[m + j] = P[j]->Z;
+        q[j] = Q[j]->X;
+        q[m + j] = Q[j]->Z;
+    }
+    for (size_t j = 0; j < 2 * m; j++) {
+        h[j] = &acc[j];
     }
+    fp2_mul_batch(q, (const fp2_t *)k, (const fp2_t *)h, 2 * m, s);
 
-    // Obtain original coordinates (A:C) from (A24:C24)
-    // use (t0 : t1) as registers
-    A_from_A24p(t0, t1, A24p, C24);
+    arena_pop(frame);
+}
 
-    // Use "C_" as register to hold "a" = (a:1) = (A:C) value
-    // C_ = t0 / t1: A / C = a
-    fp2_div_unsafe(C_, t0, t1);
+// res = x^e, left-to-right from the highest set bit of e. Function is not
+// safe when res = x.
+static void _fp2_pow_uint(fp2_t res, const fp2_t x, unsigned int e,
+                          struct fp2_scratch *s) {
+    if (e == 0) {
+        fp2_set_uint(res, 1);
+        return;
+    }
+    int top = 8 * sizeof(e) - 1;
+    while (!((e >> top) & 1)) {
+        top--;
+    }
+    fp2_set(res, x);
+    for (int i = top - 1; i >= 0; i--) {
+        fp2_sq_safe_scr(res, s);
+        if ((e >> i) & 1) {
+            fp2_mul_safe_scr(res, x, s);
+        }
+    }
+}
 
-    // t0 = sigma_inv - sigma
-    fp2_sub(t0, sigma_inv, sigma);
+// Codomain of the isogeny of odd degree l given the values of the kernel
+// polynomial h_p ~ h(1) and h_m ~ h(-1), scaled by the same factor. The
+// twisted Edwards coefficients (a : d) = (A + 2C : A - 2C) are mapped to
+// (a^l h(-1)^8 : d^l h(1)^8), a = A24p and d = A24p - C24 up to a factor 4.
+// h_p and h_m are overwritten.
+static void _aISOG_odd_from_h(fp2_t A24p_, fp2_t C24_, const fp2_t A24p,
+                              const fp2_t C24, unsigned int degree, fp2_t h_p,
+                              fp2_t h_m, struct fp2_scratch *s) {
+    arena_frame_t frame = arena_push();
+    fp2_t d = arena_fp2(), t = arena_fp2();
+
+    // h^8 by three squarings
+    for (int i = 0; i < 3; i++) {
+        fp2_sq_safe_scr(h_p, s);
+        fp2_sq_safe_scr(h_m, s);
+    }
 
-    // t0 = t0 * 6: A_ = 6(sigma_inv - sigma) = 6sigma_inv - 6sigma
-    fp2_mul_int(t0, t0, 6);
+    // a' = (A24p)^l h(-1)^8, d' = (A24p - C24)^l h(1)^8
+    fp2_sub(d, A24p, C24);
+    _fp2_pow_uint(t, d, degree, s);
+    fp2_mul_unsafe_scr(d, t, h_p, s);
+    _fp2_pow_uint(t, A24p, degree, s);
+    fp2_mul_unsafe_scr(A24p_, t, h_m, s);
 
-    // t0:: t0 + C_: 6sigma_inv - 6sigma + A/C
-    // use value stored in C_ register := A/C = a
-    fp2_add(t0, t0, C_);
+    // (A24p' : C24') = (a' : a' - d')
+    fp2_sub(C24_, A24p_, d);
 
-    // t1 = pi^2
-    fp2_sq_unsafe(t1, pi);
+    arena_pop(frame);
+}
 
-    // A_ = t0 * t1: (6sigma_inv - 6sigma + A/C) * pi^2
-    fp2_mul_unsafe(A_, t0, t1);
-    // C_ = 1
-    fp2_set_uint(C_, 1);
+void aISOG_curve_KPS(fp2_t A24p_, fp2_t C24_, const fp2_t A24p,
+                     const fp2_t C24, const struct point_vec *prep_kpts) {
+    assert(prep_kpts->n > 0 && "List of kernel points cannot be empty");
+    arena_frame_t frame = arena_push();
+    struct fp2_scratch *s = arena_fp2_scratch_batch();
+    fp2_t h_p = arena_fp2(), h_m = arena_fp2();
+
+    // Prepared points are (X + Z : X - Z), so h(1) ~ prod(XK - ZK) = prod(ZK^)
+    // and h(-1) ~ prod(XK + ZK) = prod(XK^)
+    fp2_set(h_p, &prep_kpts->Z[0]);
+    fp2_set(h_m, &prep_kpts->X[0]);
+    for (size_t i = 1; i < prep_kpts->n; i++) {
+        fp2_mul_wide(&s[1].acc, h_p, &prep_kpts->Z[i], &s[0]);
+        fp2_acc_reduce(h_p, &s[1].acc);
+        fp2_mul_wide(&s[1].acc, h_m, &prep_kpts->X[i], &s[0]);
+        fp2_acc_reduce(h_m, &s[1].acc);
+    }
 
-    fp2_clear(&sigma);
-    fp2_clear(&sigma_inv);
-    fp2_clear(&pi);
-    fp2_clear(&t0);
-    fp2_clear(&t1);
+    _aISOG_odd_from_h(A24p_, C24_, A24p, C24, 2 * prep_kpts->n + 1, h_p, h_m,
+                      s);
+
+    arena_pop(frame);
 }
 
 void aISOG_curve(fp2_t A_, fp2_t C_, const fp2_t A24p, const fp2_t C24,
                  const point_t K, int degree) {
 
-    size_t n = KPS_DEG2SIZE(degree);
-    point_t *kpts = calloc(n, sizeof(point_t));
+    arena_frame_t frame = arena_push();
 
-    // Initialize kernel points
-    for (size_t i = 0; i < n; i++) {
-        point_init(&kpts[i]);
-    }
+    struct point_vec kpts;
+    arena_point_vec(&kpts, KPS_DEG2SIZE(degree));
 
     // Calculate [1]K, [2]K, [3]K, ...
-    KPS(kpts, n, K, A24p, C24);
+    KPS(&kpts, K, A24p, C24);
+    prepare_kernel_points(&kpts);
 
-    aISOG_curve_KPS(A_, C_, A24p, C24, kpts, n);
+    aISOG_curve_KPS(A_, C_, A24p, C24, &kpts);
+    A_from_A24p(A_, C_, A_, C_);
 
-    for (size_t i = 0; i < n; i++) {
-        point_clear(&kpts[i]);
+    arena_pop(frame);
+}
+
+// Fill v[0..n) with x([s]K), x([s + 2]K), ... for odd s >= 3 given [2]K,
+// the steps are [s + 2]K = [s]K + [2]K with the difference [s - 2]K
+static void _kps_odd_run(struct point_vec *v, size_t n, const point_t K,
+                         const point_t K2, unsigned int s, const fp2_t A24p,
+                         const fp2_t C24, struct ec_scratch *sc) {
+    struct point_xz w[3];
+    if (n == 0) {
+        return;
+    }
+    xLADDER_int_scr(point_vec_at(&w[0], v, 0), K, s, A24p, C24, sc);
+    if (n == 1) {
+        return;
+    }
+    // Difference of the second step [s - 2]K is computed separately, unless
+    // it is K itself
+    arena_frame_t frame = arena_push();
+    point_t D = arena_point();
+    if (s == 3) {
+        point_set(D, K);
+    } else {
+        xLADDER_int_scr(D, K, s - 2, A24p, C24, sc);
+    }
+    xADD_scr(point_vec_at(&w[1], v, 1), point_vec_at(&w[0], v, 0), K2, D, sc);
+    for (size_t i = 2; i < n; i++) {
+        xADD_scr(point_vec_at(&w[2], v, i), point_vec_at(&w[1], v, i - 1), K2,
+                 point_vec_at(&w[0], v, i - 2), sc);
+    }
+    arena_pop(frame);
+}
+
+void KPS_sqrt(struct kps_sqrt *k, const point_t K, const fp2_t A24p,
+              const fp2_t C24, unsigned int degree) {
+    assert(degree >= 5 && degree % 2 == 1 && "Unsupported √élu degree");
+
+    // b = floor(sqrt(degree - 1) / 2), b' = floor((degree - 1) / 4b)
+    size_t b = 0;
+    while ((2 * b + 2) * (2 * b + 2) <= degree - 1) {
+        b++;
+    }
+    k->degree = degree;
+    k->b = b;
+    k->b_ = (degree - 1) / (4 * b);
+    k->n_rest = (degree - 1) / 2 - 2 * b * k->b_;
+    const size_t n_I = k->b_, n_J = b, n_R = k->n_rest;
+
+    fp2_vec_t xI = arena_fp2_vec(n_I);
+    k->xJ = arena_fp2_vec(3 * n_J);
+    k->xJ2 = k->xJ + n_J;
+    k->uJ = k->xJ2 + n_J;
+    k->xR = arena_fp2_vec(n_R > 0 ? n_R : 1);
+    k->A24p = arena_fp2();
+    k->C24 = arena_fp2();
+    fp2_set(k->A24p, A24p);
+    fp2_set(k->C24, C24);
+
+    arena_frame_t frame = arena_push();
+    struct ec_scratch *s = arena_scratch();
+    struct fp2_scratch *sb = arena_fp2_scratch_batch();
+
+    // Points of I, J and R followed by the curve (4A24p - 2C24 : C24) = (A : C)
+    // in one vector, so a single inversion normalizes all of them
+    const size_t n = n_I + n_J + n_R + 1;
+    struct point_vec pts;
+    arena_point_vec(&pts, n);
+    struct point_vec vI = {pts.X, pts.Z, n_I},
+                     vJ = {pts.X + n_I, pts.Z + n_I, n_J},
+                     vR = {pts.X + n_I + n_J, pts.Z + n_I + n_J, n_R};
+    point_t K2 = arena_point(), K4b = arena_point();
+    struct point_xz w;
+
+    // J = {1, 3, ..., 2b - 1}
+    xDBL_scr(K2, K, A24p, C24, s);
+    point_set(point_vec_at(&w, &vJ, 0), K);
+    struct point_vec vJ3 = {vJ.X + 1, vJ.Z + 1, n_J - 1};
+    _kps_odd_run(&vJ3, n_J - 1, K, K2, 3, A24p, C24, s);
+
+    // I = {2b, 6b, 10b, ...}, steps of [4b]K with the difference [2b(2i - 1)]K
+    point_t I0 = point_vec_at(&w, &vI, 0);
+    xLADDER_int_scr(I0, K, 2 * b, A24p, C24, s);
+    xDBL_scr(K4b, I0, A24p, C24, s);
+    struct point_xz u[3];
+    if (n_I > 1) {
+        xADD_scr(point_vec_at(&u[1], &vI, 1), I0, K4b, I0, s);
+    }
+    for (size_t i = 2; i < n_I; i++) {
+        xADD_scr(point_vec_at(&u[2], &vI, i), point_vec_at(&u[1], &vI, i - 1),
+                 K4b, point_vec_at(&u[0], &vI, i - 2), s);
     }
-    free(kpts);
+
+    // R = {4bb' + 1, 4bb' + 3, ..., degree - 2}
+    _kps_odd_run(&vR, n_R, K, K2, 4 * b * k->b_ + 1, A24p, C24, s);
+
+    fp2_sub(&pts.X[n - 1], A24p, C24);
+    fp2_add(&pts.X[n - 1], &pts.X[n - 1], &pts.X[n - 1]);
+    fp2_add(&pts.X[n - 1], &pts.X[n - 1], A24p);
+    fp2_add(&pts.X[n - 1], &pts.X[n - 1], A24p);
+    fp2_set(&pts.Z[n - 1], C24);
+    fp2_vec_inv(pts.Z, pts.Z, n);
+    fp2_vec_mul(pts.X, pts.X, pts.Z, n, sb);
+
+    for (size_t i = 0; i < n_I; i++) {
+        fp2_set(&xI[i], &vI.X[i]);
+    }
+    for (size_t i = 0; i < n_R; i++) {
+        fp2_set(&k->xR[i], &vR.X[i]);
+    }
+
+    // uJ = xJ^2 + 2a xJ + 1 = xJ (xJ + 2a) + 1
+    fp2_t a2 = &pts.X[n - 1];
+    fp2_add(a2, a2, a2);
+    for (size_t j = 0; j < n_J; j++) {
+        fp2_set(&k->xJ[j], &vJ.X[j]);
+        fp2_add(&k->uJ[j], &vJ.X[j], a2);
+    }
+    fp2_vec_mul(k->xJ2, k->xJ, k->xJ, n_J, sb);
+    fp2_vec_mul(k->uJ, k->uJ, k->xJ, n_J, sb);
+    for (size_t j = 0; j < n_J; j++) {
+        fp2_add_uint(&k->uJ[j], &k->uJ[j], 1);
+    }
+
+    arena_pop(frame);
+
+    // Polynomials E_J reduced by the tree have 2b + 1 coefficients
+    fp2_poly_tree_build(&k->tree_I, xI, n_I, 2 * n_J + 1);
+}
+
+// Product of the biquadratic factors of J in [lo, hi) into res of length
+// 2(hi - lo) + 1, given the factors q (3 coefficients each)
+static void _sqrt_EJ_prod(fp2_vec_t res, const fp2_vec_t q, size_t lo,
+                          size_t hi) {
+    if (hi - lo == 1) {
+        for (size_t i = 0; i < 3; i++) {
+            fp2_set(&res[i], &q[3 * lo + i]);
+        }
+        return;
+    }
+    arena_frame_t frame = arena_push();
+    size_t mid = lo + (hi - lo) / 2;
+    fp2_vec_t l = arena_fp2_vec(2 * (mid - lo) + 1),
+              r = arena_fp2_vec(2 * (hi - mid) + 1);
+    _sqrt_EJ_prod(l, q, lo, mid);
+    _sqrt_EJ_prod(r, q, mid, hi);
+    fp2_poly_mul(res, l, 2 * (mid - lo) + 1, r, 2 * (hi - mid) + 1);
+    arena_pop(frame);
+}
+
+// Values of the kernel polynomial at α = (X : Z) up to a factor common to all
+// α: den = prod(X - x_s Z) and, if num is not NULL, num = prod(Z - x_s X) over
+// the odd s < degree. For I ± J they are the resultants Res(h_I, E_J) of
+//   E_J(z) = prod_j (X - x_j Z)^2 z^2 - 2(x_j X^2 + u_j XZ + x_j Z^2) z
+//            + (x_j X - Z)^2,
+// which equals prod_j (z - x_j)^2 (X - x(z + x_j) Z)(X - x(z - x_j) Z). For
+// the reciprocal 1/α the coefficients of E_J are reversed.
+static void _sqrt_h(fp2_t num, fp2_t den, const struct kps_sqrt *k,
+                    const fp2_t X, const fp2_t Z) {
+    const size_t b = k->b, n_E = 2 * b + 1;
+    arena_frame_t frame = arena_push();
+    struct fp2_scratch *sb = arena_fp2_scratch_batch();
+    struct fp2_acc *acc = &sb[1].acc, *prod = &sb[2].acc;
+    fp2_t XX = arena_fp2(), XZ = arena_fp2(), ZZ = arena_fp2(),
+          S = arena_fp2(), t = arena_fp2(), u = arena_fp2();
+    fp2_vec_t q = arena_fp2_vec(3 * b), E = arena_fp2_vec(n_E);
+
+    fp2_sq_unsafe(XX, X);
+    fp2_sq_unsafe(ZZ, Z);
+    fp2_mul_unsafe_scr(XZ, X, Z, &sb[0]);
+    fp2_add(S, XX, ZZ);
+
+    for (size_t j = 0; j < b; j++) {
+        fp2_t xj = &k->xJ[j], xj2 = &k->xJ2[j];
+        fp2_vec_t qj = q + 3 * j;
+
+        // t = 2 x_j XZ
+        fp2_mul_unsafe_scr(t, xj, XZ, &sb[0]);
+        fp2_add(t, t, t);
+
+        // q0 = x_j^2 X^2 - 2 x_j XZ + Z^2
+        fp2_mul_unsafe_scr(u, xj2, XX, &sb[0]);
+        fp2_sub(u, u, t);
+        fp2_add(&qj[0], u, ZZ);
+
+        // q2 = X^2 - 2 x_j XZ + x_j^2 Z^2
+        fp2_mul_unsafe_scr(u, xj2, ZZ, &sb[0]);
+        fp2_sub(u, u, t);
+        fp2_add(&qj[2], u, XX);
+
+        // q1 = -2(x_j (X^2 + Z^2) + u_j XZ)
+        fp2_mul_wide(acc, xj, S, &sb[0]);
+        fp2_mul_wide(prod, &k->uJ[j], XZ, &sb[0]);
+        fp2_acc_add(acc, acc, prod);
+        fp2_acc_reduce(u, acc);
+        fp2_add(u, u, u);
+        fp2_set_uint(&qj[1], 0);
+        fp2_sub(&qj[1], &qj[1], u);
+    }
+    _sqrt_EJ_prod(E, q, 0, b);
+    fp2_poly_tree_prod_eval(den, &k->tree_I, E, n_E);
+
+    if (num != NULL) {
+        for (size_t i = 0; i < b; i++) {
+            fp2_set(t, &E[i]);
+            fp2_set(&E[i], &E[n_E - 1 - i]);
+            fp2_set(&E[n_E - 1 - i], t);
+        }
+        fp2_poly_tree_prod_eval(num, &k->tree_I, E, n_E);
+    }
+
+    // Remaining multiples are multiplied directly
+    for (size_t i = 0; i < k->n_rest; i++) {
+        fp2_mul_unsafe_scr(t, &k->xR[i], Z, &sb[0]);
+        fp2_sub(t, X, t);
+        fp2_mul_safe_scr(den, t, &sb[0]);
+        if (num != NULL) {
+            fp2_mul_unsafe_scr(t, &k->xR[i], X, &sb[0]);
+            fp2_sub(t, Z, t);
+            fp2_mul_safe_scr(num, t, &sb[0]);
+        }
+    }
+
+    arena_pop(frame);
+}
+
+void aISOG_curve_sqrt(fp2_t A24p_, fp2_t C24_, const struct kps_sqrt *k) {
+    arena_frame_t frame = arena_push();
+    struct fp2_scratch *s = arena_fp2_scratch_batch();
+    fp2_t X = arena_fp2(), Z = arena_fp2(), h_p = arena_fp2(),
+          h_m = arena_fp2();
+
+    // h_p = h(1), h_m = h(-1)
+    fp2_set_uint(Z, 1);
+    fp2_set_uint(X, 1);
+    _sqrt_h(NULL, h_p, k, X, Z);
+    fp2_set_uint(X, 0);
+    fp2_sub_uint(X, X, 1);
+    _sqrt_h(NULL, h_m, k, X, Z);
+
+    _aISOG_odd_from_h(A24p_, C24_, k->A24p, k->C24, k->degree, h_p, h_m, s);
+
+    arena_pop(frame);
+}
+
+void xISOG_sqrt_batch(point_t *Q, const struct kps_sqrt *k, const point_t *P,
+                      size_t m) {
+    arena_frame_t frame = arena_push();
+    struct fp2_scratch *s = arena_fp2_scratch_batch();
+    fp2_t num = arena_fp2(), den = arena_fp2();
+
+    // (XQ : ZQ) = (XP num^2 : ZP den^2)
+    for (size_t j = 0; j < m; j++) {
+        _sqrt_h(num, den, k, P[j]->X, P[j]->Z);
+        fp2_sq_safe_scr(num, s);
+        fp2_sq_safe_scr(den, s);
+        fp2_mul_safe_scr(num, P[j]->X, s);
+        fp2_mul_safe_scr(den, P[j]->Z, s);
+        fp2_set(Q[j]->X, num);
+        fp2_set(Q[j]->Z, den);
+    }
+
+    arena_pop(frame);
 }
 
 void xISOG2_unsafe(point_t Q, const point_t K, const point_t P) {
+    arena_frame_t frame = arena_push();
+    struct ec_scratch *s = arena_scratch();
+    xISOG2_unsafe_scr(Q, K, P, s);
+    arena_pop(frame);
+}
+
+void xISOG2_unsafe_scr(point_t Q, const point_t K, const point_t P,
+                       struct ec_scratch *s) {
     // Formula works only for K = (x, y=0) where x != 0
     assert(!fp2_is_zero(K->X));
 
-    fp2_t t0, t1, t2, t3;
-    fp2_init(&t0);
-    fp2_init(&t1);
-    fp2_init(&t2);
-    fp2_init(&t3);
+    // w[0..1] are used by criss_cross
+    fp2_t t0 = &s->t[2], t1 = &s->t[3], t2 = &s->t[4], t3 = &s->t[5];
+
     fp2_sub(t0, P->X, P->Z); // t0: XP - ZP
     fp2_add(t1, P->X, P->Z); // t1: XP + ZP
     fp2_sub(t2, K->Z, K->X); // t2: ZK - XK
@@ -208,23 +550,18 @@ void xISOG2_unsafe(point_t Q, const point_t K, const point_t P) {
 
     // Z = (XP - ZP)(ZK + XK) + (XP + ZP)(ZK - XK)
     // X = (XP - ZP)(ZK + XK) - (XP + ZP)(ZK - XK)
-    criss_cross(Q->Z, Q->X, t0, t1, t2, t3);
-
-    fp2_mul_safe(Q->X, P->X);
-    fp2_mul_safe(Q->Z, P->Z);
+    criss_cross_scr(Q->Z, Q->X, t0, t1, t2, t3, s);
 
-    fp2_clear(&t0);
-    fp2_clear(&t1);
-    fp2_clear(&t2);
-    fp2_clear(&t3);
+    fp2_mul_safe_scr(Q->X, P->X, &s->fs);
+    fp2_mul_safe_scr(Q->Z, P->Z, &s->fs);
 }
 
 void prepare_isog2_kernel(point_t K) {
     // Formula works only for K = (x, y=0) where x != 0
     assert(!fp2_is_zero(K->X));
 
-    fp2_t t;
-    fp2_init(&t);
+    arena_frame_t frame = arena_push();
+    fp2_t t = arena_fp2();
 
     // t = ZK + XK
     fp2_add(t, K->Z, K->X);
@@ -234,16 +571,15 @@ void prepare_isog2_kernel(point_t K) {
     fp2_set(K->X, t);
     // K = (ZK + XK : ZK - XK)
 
-    fp2_clear(&t);
+    arena_pop(frame);
 }
 
 void xISOG2_prep(point_t Q, const point_t prep_K, const point_t P) {
     // Assertion for K.x != 0 is present in `prepare_isog2_kernel`.
     // At this point we cannot tell whether K.x = 0.
 
-    fp2_t t0, t1;
-    fp2_init(&t0);
-    fp2_init(&t1);
+    arena_frame_t frame = arena_push();
+    fp2_t t0 = arena_fp2(), t1 = arena_fp2();
     fp2_sub(t0, P->X, P->Z); // t0: XP - ZP
     fp2_add(t1, P->X, P->Z); // t1: XP + ZP
 
@@ -254,8 +590,7 @@ void xISOG2_prep(point_t Q, const point_t prep_K, const point_t P) {
     fp2_mul_safe(Q->X, P->X);
     fp2_mul_safe(Q->Z, P->Z);
 
-    fp2_clear(&t0);
-    fp2_clear(&t1);
+    arena_pop(frame);
 }
 
 void aISOG2_24p(fp2_t A24p_, fp2_t C24_, const point_t K) {
@@ -290,175 +625,526 @@ void aISOG2(fp2_t A_, fp2_t C_, const point_t K) {
     fp2_add(A_, A_, A_);
 }
 
-void ISOG2e(fp2_t A24p, fp2_t C24, const fp2_t A24p_init, const fp2_t C24_init,
-            const point_t K, uint32_t e, point_t *push_points) {
+void aISOG4(fp2_t A24p_, fp2_t C24_, fp2_vec_t coeff, const point_t K) {
+    arena_frame_t frame = arena_push();
+    struct fp2_scratch *s = arena_fp2_scratch_batch();
+    fp2_t X2 = arena_fp2(), Z2 = arena_fp2();
+
+    // For k = x(K): x([2]K) = (k^2 + 1) / 2k and the image of K under the
+    // first 2-isogeny is k^2
+    fp2_set(X2, K->X);
+    fp2_set(Z2, K->Z);
+    fp2_sq_safe_scr(X2, s);
+    fp2_sq_safe_scr(Z2, s);
+
+    // [2]K = (XK^2 + ZK^2 : 2XKZK) prepared as ((XK + ZK)^2 : -(XK - ZK)^2)
+    fp2_add(&coeff[0], K->X, K->Z);
+    fp2_sq_safe_scr(&coeff[0], s);
+    fp2_add(&coeff[2], X2, Z2);
+    fp2_add(&coeff[1], &coeff[2], &coeff[2]);
+    fp2_sub(&coeff[1], &coeff[0], &coeff[1]);
+    assert(!fp2_is_zero(&coeff[2]) &&
+           "Kernel point cannot lay above (0, 0)");
+
+    // φ(K) = (XK^2 : ZK^2) prepared as (XK^2 + ZK^2 : ZK^2 - XK^2)
+    fp2_sub(&coeff[3], Z2, X2);
+
+    // Codomain of the second 2-isogeny: (ZK^4 - XK^4 : ZK^4)
+    fp2_mul_unsafe_scr(A24p_, &coeff[2], &coeff[3], s);
+    fp2_sq_safe_scr(Z2, s);
+    fp2_set(C24_, Z2);
+
+    arena_pop(frame);
+}
 
-    point_t K0, T, R;
-    point_init(&K0);
-    point_init(&T);
-    point_init(&R);
+void xISOG4(point_t Q, const fp2_vec_t coeff, const point_t P) {
+    arena_frame_t frame = arena_push();
+    struct ec_scratch *s = arena_scratch();
+    xISOG4_scr(Q, coeff, P, s);
+    arena_pop(frame);
+}
 
-    // K0 = K
-    point_set(K0, K);
+void xISOG4_scr(point_t Q, const fp2_vec_t coeff, const point_t P,
+                struct ec_scratch *s) {
+    // w[0..1] are used by criss_cross
+    fp2_t t0 = &s->t[2], t1 = &s->t[3], X1 = &s->t[4], Z1 = &s->t[5];
+
+    // Image under the first 2-isogeny, see xISOG2_prep
+    fp2_sub(t0, P->X, P->Z);
+    fp2_add(t1, P->X, P->Z);
+    criss_cross_scr(Z1, X1, t0, t1, &coeff[1], &coeff[0], s);
+    fp2_mul_safe_scr(X1, P->X, &s->fs);
+    fp2_mul_safe_scr(Z1, P->Z, &s->fs);
+
+    // Image under the second one, P is not read anymore
+    fp2_sub(t0, X1, Z1);
+    fp2_add(t1, X1, Z1);
+    criss_cross_scr(Q->Z, Q->X, t0, t1, &coeff[3], &coeff[2], s);
+    fp2_mul_safe_scr(Q->X, X1, &s->fs);
+    fp2_mul_safe_scr(Q->Z, Z1, &s->fs);
+}
 
-    // Copy initial curve parameters
-    fp2_set(A24p, A24p_init);
-    fp2_set(C24, C24_init);
+// Costs of the operations used by the chain strategy in the multiplications
+// of Fp: ladder step of xLADDER_int, doubling, 2-isogeny image, odd-degree
+// isogeny image per kernel point and the constant part of the latter. √élu
+// image costs about b log2(b) times the last one. 4-isogeny image costs as
+// much as two 2-isogeny ones. Values are the rounded results of
+// benches/bench_strategy.c for t = 200 with the mont backend, the ratios are
+// similar for the other sizes and the gmp backend.
+#define STRATEGY_COST_LADDER_STEP 32
+#define STRATEGY_COST_DBL 16
+#define STRATEGY_COST_ISOG2 12
+#define STRATEGY_COST_ISOG4 (2 * STRATEGY_COST_ISOG2)
+#define STRATEGY_COST_ISOG_KPT 12
+#define STRATEGY_COST_ISOG_BASE 4
+#define STRATEGY_COST_ISOG_SQRT 90
+
+// Log2 of the power of two factor, 0 for the odd one
+static unsigned int _factor_log2(unsigned int div) {
+    unsigned int e = 0;
+    while (div % 2 == 0) {
+        div /= 2;
+        e++;
+    }
+    return e;
+}
 
-    for (uint32_t i = 0; i < e; i++) {
-        // Calculate "local" kernel - T.order() == 2
-        if (i + 1 < e) {
-            xDBLe(T, K0, A24p, C24, e - i - 1);
-        } else {
-            point_set(T, K0);
+uint64_t isog_strategy_mul_cost(unsigned int div) {
+    unsigned int e = _factor_log2(div);
+    if (e > 0) {
+        return (uint64_t)e * STRATEGY_COST_DBL;
+    }
+    unsigned int bits = 0;
+    while (div >> bits) {
+        bits++;
+    }
+    return (uint64_t)bits * STRATEGY_COST_LADDER_STEP;
+}
+
+uint64_t isog_strategy_eval_cost(unsigned int div) {
+    unsigned int e = _factor_log2(div);
+    if (e > 0) {
+        return (uint64_t)e * STRATEGY_COST_ISOG2;
+    }
+    if (div >= VELUSQRT_MIN_DEGREE) {
+        // b = floor(sqrt(div - 1) / 2) as in KPS_sqrt
+        uint64_t b = 0, bits = 0;
+        while ((2 * b + 2) * (2 * b + 2) <= div - 1) {
+            b++;
+        }
+        while (b >> bits) {
+            bits++;
         }
+        return b * bits * STRATEGY_COST_ISOG_SQRT;
+    }
+    return (uint64_t)KPS_DEG2SIZE(div) * STRATEGY_COST_ISOG_KPT +
+           STRATEGY_COST_ISOG_BASE;
+}
 
-        assert(!fp2_is_zero(T->X) && "Kernel point cannot lay above (0, 0)");
+void isog_chain_strategy(uint16_t *split, const unsigned int *primes,
+                         size_t n) {
+    assert(n > 0 && n <= UINT16_MAX && "Unsupported number of factors");
+    arena_frame_t frame = arena_push();
 
-        // Push every point on the list through the partial isogeny
-        for (point_t *pptr = push_points; *pptr != NULL; pptr++) {
-            xISOG2_unsafe(R, T, *pptr);
-            point_set(*pptr, R);
+    // Prefix sums of the multiplication and the evaluation costs
+    uint64_t *mul = arena_alloc((n + 1) * sizeof(uint64_t));
+    uint64_t *eval = arena_alloc((n + 1) * sizeof(uint64_t));
+    mul[0] = eval[0] = 0;
+    for (size_t i = 0; i < n; i++) {
+        mul[i + 1] = mul[i] + isog_strategy_mul_cost(primes[i]);
+        eval[i + 1] = eval[i] + isog_strategy_eval_cost(primes[i]);
+    }
+
+    // cost[lo, hi) of the isogenies of the factors lo, ..., hi - 1 given the
+    // kernel of their product, without the steps themselves. Splitting at m
+    // multiplies the kernel by the factors [m, hi) and keeps the kernel on
+    // the stack while it is pushed through the isogenies [lo, m).
+    const size_t w = n + 1;
+    uint64_t *cost = arena_alloc(w * w * sizeof(uint64_t));
+    for (size_t lo = 0; lo < n; lo++) {
+        cost[lo * w + lo + 1] = 0;
+        split[lo * w + lo + 1] = lo + 1;
+    }
+    for (size_t len = 2; len <= n; len++) {
+        for (size_t lo = 0, hi = len; hi <= n; lo++, hi++) {
+            uint64_t best = UINT64_MAX;
+            size_t best_m = lo + 1;
+            for (size_t m = lo + 1; m < hi; m++) {
+                uint64_t c = cost[lo * w + m] + cost[m * w + hi] +
+                             (mul[hi] - mul[m]) + (eval[m] - eval[lo]);
+                if (c < best) {
+                    best = c;
+                    best_m = m;
+                }
+            }
+            cost[lo * w + hi] = best;
+            split[lo * w + hi] = best_m;
         }
+    }
 
-        // Calculate codomain
-        aISOG2_24p(A24p, C24, T);
+    arena_pop(frame);
+}
 
-        // Push the kernel of [2^e] degree isogeny, only if not last iteration.
-        // During the last iteration K0 will go to E(0)
-        if (i + 1 < e) {
-            xISOG2_unsafe(R, T, K0);
-            point_set(K0, R);
+void isog2e_strategy(uint16_t *split, size_t n) {
+    assert(n > 0 && n <= UINT16_MAX && "Unsupported number of 4-isogenies");
+    arena_frame_t frame = arena_push();
+
+    // cost[len] of the chain of len 4-isogenies without the steps themselves,
+    // splitting at m quadruples the kernel len - m times and pushes it
+    // through m isogenies
+    uint64_t *cost = arena_alloc((n + 1) * sizeof(uint64_t));
+    cost[1] = 0;
+    split[1] = 1;
+    for (size_t len = 2; len <= n; len++) {
+        uint64_t best = UINT64_MAX;
+        size_t best_m = 1;
+        for (size_t m = 1; m < len; m++) {
+            uint64_t c = cost[m] + cost[len - m] +
+                         (len - m) * 2 * STRATEGY_COST_DBL +
+                         m * STRATEGY_COST_ISOG4;
+            if (c < best) {
+                best = c;
+                best_m = m;
+            }
         }
+        cost[len] = best;
+        split[len] = best_m;
     }
-    point_clear(&K0);
-    point_clear(&T);
-    point_clear(&R);
-}
 
-void ISOG_chain(fp2_t A24p, fp2_t C24, const fp2_t A24p_init,
-                const fp2_t C24_init, const point_t K, pprod_t isog_degree,
-                point_t *push_points) {
-    
-    // We received a trivial point of order one: K = E(0)
-    if (fp2_is_zero(K->Z) || isog_degree->n_primes == 0) {
-        // In both cases 
-        assert(fp2_is_zero(K->Z));
-        assert(isog_degree->n_primes == 0);
+    arena_pop(frame);
+}
 
-        // Copy to destination, push_points remain the same 
-        fp2_set(A24p, A24p_init);
-        fp2_set(C24, C24_init);
+// State of the 2^e-isogeny shared by the traversal
+struct isog2e_chain {
+    fp2_t A24p, C24;
+    const uint16_t *split;
+    // NULL-terminated points of the caller followed by the kernel multiples
+    point_t *push;
+    size_t n_push;
+    fp2_vec_t coeff;
+    struct ec_scratch *s;
+};
+
+// 4-isogenies of the chain of length len given kernel K of their product
+static void _isog2e_traverse(struct isog2e_chain *c, point_t K, size_t len) {
+    if (len == 1) {
+        aISOG4(c->A24p, c->C24, c->coeff, K);
+        for (size_t j = 0; j < c->n_push; j++) {
+            xISOG4_scr(c->push[j], c->coeff, c->push[j], c->s);
+        }
         return;
     }
 
-    fp2_t A24p_next, C24_next;
-    fp2_init(&A24p_next);
-    fp2_init(&C24_next);
+    arena_frame_t frame = arena_push();
+    point_t T = arena_point();
+    size_t m = c->split[len];
+
+    // T = [4^(len - m)]K is the kernel of the first m isogenies
+    point_set(T, K);
+    for (size_t j = 0; j < 2 * (len - m); j++) {
+        xDBL_scr(T, T, c->A24p, c->C24, c->s);
+    }
 
+    c->push[c->n_push++] = K;
+    c->push[c->n_push] = NULL;
+    _isog2e_traverse(c, T, m);
+    c->push[--c->n_push] = NULL;
+    arena_pop(frame);
+
+    _isog2e_traverse(c, K, len - m);
+}
+
+void ISOG2e(fp2_t A24p, fp2_t C24, const fp2_t A24p_init, const fp2_t C24_init,
+            const point_t K, uint32_t e, point_t *push_points,
+            const struct isog_workspace *ws) {
+    arena_frame_t frame = arena_push();
+    point_t K0 = arena_point(), T = arena_point();
+    struct ec_scratch *s = arena_scratch();
+    const size_t n = e / 2;
+
+    point_set(K0, K);
     fp2_set(A24p, A24p_init);
     fp2_set(C24, C24_init);
 
-    point_t K0, Q, T, R;
-    point_init(&K0);
-    point_init(&Q);
-    point_init(&T);
-    point_init(&R);
+    size_t n_user = 0;
+    while (push_points[n_user] != NULL) {
+        n_user++;
+    }
 
-    point_set(K0, K);
+    // Odd e starts with the 2-isogeny of kernel [2^(e - 1)]K
+    if (e % 2 == 1) {
+        point_set(T, K0);
+        for (uint32_t j = 1; j < e; j++) {
+            xDBL_scr(T, T, A24p, C24, s);
+        }
+        assert(!fp2_is_zero(T->X) && "Kernel point cannot lay above (0, 0)");
+
+        point_t R = arena_point();
+        for (size_t j = 0; j < n_user; j++) {
+            xISOG2_unsafe_scr(R, T, push_points[j], s);
+            point_set(push_points[j], R);
+        }
+        if (n > 0) {
+            xISOG2_unsafe_scr(R, T, K0, s);
+            point_set(K0, R);
+        }
+        aISOG2_24p(A24p, C24, T);
+    }
+
+    if (n > 0) {
+        struct isog2e_chain c = {
+            .A24p = A24p,
+            .C24 = C24,
+            .coeff = arena_fp2_vec(4),
+            .s = s,
+        };
+        if (ws != NULL && ws->e2 == e) {
+            c.split = ws->split2;
+        } else {
+            uint16_t *split = arena_alloc((n + 1) * sizeof(uint16_t));
+            isog2e_strategy(split, n);
+            c.split = split;
+        }
 
-    // Push K0 into the push_points list, as first occured "NULL"
-    point_t *pp_last = push_points;
-    while (*pp_last != NULL)
-        pp_last++;
-    // Make sure that push_points end with 2x NULL
-    assert(*pp_last == NULL && *(pp_last + 1) == NULL);
-    // Replace the first NULL with K0
-    *pp_last = K0;
+        // At most one kernel multiple per level waits on the stack
+        c.push = arena_alloc((n_user + n + 1) * sizeof(point_t));
+        memcpy(c.push, push_points, n_user * sizeof(point_t));
+        c.push[n_user] = NULL;
+        c.n_push = n_user;
 
-    // TODO: optimize: calculate MAX out of degree->div and allocate space
-    // maybe store it inside pprod structure?
-    unsigned int max_div = 0;
-    for (unsigned int i = 0; i < isog_degree->n_primes; i++) {
-        max_div =
-            isog_degree->primes[i] > max_div ? isog_degree->primes[i] : max_div;
+        _isog2e_traverse(&c, K0, n);
     }
+    arena_pop(frame);
+}
 
-    size_t max_n = KPS_DEG2SIZE(max_div);
-    point_t *kpts = calloc(max_n, sizeof(point_t));
+// State of the chain shared by the traversal
+struct isog_chain {
+    fp2_t A24p, C24, A24p_next, C24_next;
+    const unsigned int *primes;
+    size_t n;
+    const uint16_t *split;
+    // NULL-terminated points pushed through every step: points of the caller
+    // followed by the kernel multiples waiting on the stack
+    point_t *push;
+    size_t n_push;
+    struct ec_scratch *s;
+    // Workspace of the chain, NULL if the memory is borrowed by each step
+    const struct isog_workspace *ws;
+};
+
+// Isogeny of the i-th factor with kernel T, pushing all points of the chain
+static void _chain_step(struct isog_chain *c, const point_t T, size_t i) {
+    unsigned int div = c->primes[i];
+    assert(!fp2_is_zero(T->Z) &&
+           "Order of the kernel is smaller than the isogeny degree");
+
+    unsigned int log2 = _factor_log2(div);
+    if (log2 > 0) {
+        assert(i == 0 && "Only first number can be a power of 2");
+        ISOG2e(c->A24p_next, c->C24_next, c->A24p, c->C24, T, log2, c->push,
+               c->ws);
+        fp2_set(c->A24p, c->A24p_next);
+        fp2_set(c->C24, c->C24_next);
+        return;
+    }
 
-    // Initialize kernel points
-    for (size_t i = 0; i < max_n; i++) {
-        point_init(&kpts[i]);
+    arena_frame_t frame = arena_push();
+    if (div >= VELUSQRT_MIN_DEGREE) {
+        struct kps_sqrt ks;
+        KPS_sqrt(&ks, T, c->A24p, c->C24, div);
+        aISOG_curve_sqrt(c->A24p_next, c->C24_next, &ks);
+        xISOG_sqrt_batch(c->push, &ks, c->push, c->n_push);
+        fp2_set(c->A24p, c->A24p_next);
+        fp2_set(c->C24, c->C24_next);
+        arena_pop(frame);
+        return;
     }
 
-    // Iterate over all distinct degrees that produce final isogeny
-    for (unsigned int i = 0; i < isog_degree->n_primes; i++) {
+    // Calculate [1]T, [2]T, [3]T ... [div//2]T, the vector of the largest
+    // degree is reused by the following steps. Both the codomain and the
+    // images use the prepared points.
+    struct point_vec kpts;
+    if (c->ws != NULL) {
+        assert(KPS_DEG2SIZE(div) <= c->ws->kpts.n && "Workspace is too small");
+        kpts.n = KPS_DEG2SIZE(div);
+        kpts.X = c->ws->kpts.X;
+        kpts.Z = kpts.X + kpts.n;
+    } else {
+        arena_point_vec(&kpts, KPS_DEG2SIZE(div));
+    }
+    KPS(&kpts, T, c->A24p, c->C24);
+    prepare_kernel_points(&kpts);
 
-        // divisor
-        unsigned int div = isog_degree->primes[i];
+    // Calculate coefficients of the next curve in the isogeny chain
+    aISOG_curve_KPS(c->A24p_next, c->C24_next, c->A24p, c->C24, &kpts);
+    fp2_set(c->A24p, c->A24p_next);
+    fp2_set(c->C24, c->C24_next);
 
-        // Calculate the kernel of ith-degree isogeny
-        // T = [deg/div]K0 is a point of order "div"
-        point_set(T, K0);
-        for (unsigned int j = i + 1; j < isog_degree->n_primes; j++) {
-            // Ki = [m]Ki;  Ki *= m
-            xLADDER_int(Q, T, isog_degree->primes[j], A24p, C24);
-            point_set(T, Q);
-        }
+    xISOG_odd_batch(c->push, &kpts, c->push, c->n_push);
+    arena_pop(frame);
+}
 
-        // TODO: For now we assume that every component can be 'even'
-        // In the future we can store "power_of_two" inside the number
-        // We could "prepare" the kernel points if it is required more than
-        // once?
-        if (div % 2 == 0) {
-            assert(i == 0 && "Only first number can be a power of 2");
-            int log2 = 0;
-            while (div > 1) {
-                log2++;
-                div /= 2;
-            }
+// Isogenies of the factors [lo, hi) given kernel K of their product
+static void _chain_traverse(struct isog_chain *c, point_t K, size_t lo,
+                            size_t hi) {
+    if (hi - lo == 1) {
+        _chain_step(c, K, lo);
+        return;
+    }
 
-            // K0 was already appended into the list of push_points
-            ISOG2e(A24p_next, C24_next, A24p, C24, T, log2, push_points);
-            fp2_set(A24p, A24p_next);
-            fp2_set(C24, C24_next);
-            continue;
-        }
+    arena_frame_t frame = arena_push();
+    point_t T = arena_point(), R = arena_point();
+    size_t m = c->split[lo * (c->n + 1) + hi];
+
+    // T = [l_m ... l_(hi-1)]K is the kernel of the factors [lo, m)
+    point_set(T, K);
+    for (size_t j = m; j < hi; j++) {
+        xLADDER_int_scr(R, T, c->primes[j], c->A24p, c->C24, c->s);
+        point_t tmp = T;
+        T = R;
+        R = tmp;
+    }
 
-        // Calculate [1]T, [2]T, [3]T ... [div//2]T
-        size_t n = KPS_DEG2SIZE(div);
-        KPS(kpts, n, T, A24p, C24);
+    // K is pushed through the first part, afterwards it generates the kernel
+    // of the factors [m, hi)
+    c->push[c->n_push++] = K;
+    c->push[c->n_push] = NULL;
+    _chain_traverse(c, T, lo, m);
+    c->push[--c->n_push] = NULL;
+    arena_pop(frame);
 
-        // Calculate coefficients of the next curve in the isogeny chain
-        aISOG_curve_KPS(A24p_next, C24_next, A24p, C24, kpts, n);
-        A24p_from_A(A24p, C24, A24p_next, C24_next);
+    _chain_traverse(c, K, m, hi);
+}
 
-        // Step required for the multiple calculations of the points
-        prepare_kernel_points(kpts, n);
+void isog_workspace_init(struct isog_workspace *ws) {
+    ws->kpts.X = ws->kpts.Z = NULL;
+    ws->kpts.n = 0;
+    ws->push = NULL;
+    ws->split = NULL;
+    ws->primes = NULL;
+    ws->n_max = ws->n_user_max = ws->n = 0;
+    ws->split2 = NULL;
+    ws->e2 = 0;
+}
 
-        // K0 is included in the push_points
-        for (point_t *pp = push_points; *pp != NULL; pp++) {
-            xISOG_odd(Q, kpts, n, *pp);
-            point_set(*pp, Q);
+void isog_workspace_clear(struct isog_workspace *ws) {
+    point_vec_clear(&ws->kpts);
+    free(ws->push);
+    free(ws->split);
+    free(ws->primes);
+    free(ws->split2);
+    isog_workspace_init(ws);
+}
+
+void isog_workspace_reserve(struct isog_workspace *ws, const pprod_t deg,
+                            size_t n_user) {
+    // Only the factors below VELUSQRT_MIN_DEGREE use KPS, √élu borrows its
+    // O(√degree) points from the arena
+    size_t n_kpts = 1;
+    for (size_t i = 0; i < deg->n_primes; i++) {
+        unsigned int div = deg->primes[i], e = _factor_log2(div);
+        if (e == 0 && div < VELUSQRT_MIN_DEGREE && KPS_DEG2SIZE(div) > n_kpts) {
+            n_kpts = KPS_DEG2SIZE(div);
+        }
+        // Strategy of the power of two depends only on e
+        if (e > 1 && e != ws->e2) {
+            ws->split2 = realloc(ws->split2, (e / 2 + 1) * sizeof(uint16_t));
+            isog2e_strategy(ws->split2, e / 2);
+            ws->e2 = e;
         }
     }
+    if (n_kpts > ws->kpts.n) {
+        point_vec_clear(&ws->kpts);
+        point_vec_init(&ws->kpts, n_kpts);
+    }
 
-    // If using ISOG_chain multiple times we must clear this kernel point to make sure it is NULL
-    *pp_last = NULL;
+    size_t n = deg->n_primes;
+    if (n <= ws->n_max && n_user <= ws->n_user_max) {
+        return;
+    }
+    if (n > ws->n_max) {
+        ws->split = realloc(ws->split, (n + 1) * (n + 1) * sizeof(uint16_t));
+        ws->primes = realloc(ws->primes, n * sizeof(unsigned int));
+        ws->n_max = n;
+        ws->n = 0;
+    }
+    if (n_user > ws->n_user_max) {
+        ws->n_user_max = n_user;
+    }
+    // At most one kernel multiple per factor waits on the stack
+    ws->push = realloc(ws->push,
+                       (ws->n_user_max + ws->n_max + 1) * sizeof(point_t));
+}
 
-    assert(fp2_is_zero(K0->Z) &&
-           "Kernel of the isogeny should end-up as E(0) - E0->Z = 0");
+// Strategy of the factors of deg kept in the workspace
+static const uint16_t *_workspace_strategy(struct isog_workspace *ws,
+                                           const pprod_t deg) {
+    size_t n = deg->n_primes;
+    assert(n <= ws->n_max && "Workspace is too small for the degree");
+    if (ws->n != n ||
+        memcmp(ws->primes, deg->primes, n * sizeof(unsigned int)) != 0) {
+        isog_chain_strategy(ws->split, deg->primes, n);
+        memcpy(ws->primes, deg->primes, n * sizeof(unsigned int));
+        ws->n = n;
+    }
+    return ws->split;
+}
 
-    for (size_t i = 0; i < max_n; i++) {
-        point_clear(&kpts[i]);
+void ISOG_chain(fp2_t A24p, fp2_t C24, const fp2_t A24p_init,
+                const fp2_t C24_init, const point_t K, pprod_t isog_degree,
+                point_t *push_points, struct isog_workspace *ws) {
+    
+    // We received a trivial point of order one: K = E(0)
+    if (fp2_is_zero(K->Z) || isog_degree->n_primes == 0) {
+        // In both cases 
+        assert(fp2_is_zero(K->Z));
+        assert(isog_degree->n_primes == 0);
+
+        // Copy to destination, push_points remain the same 
+        fp2_set(A24p, A24p_init);
+        fp2_set(C24, C24_init);
+        return;
+    }
+
+    arena_frame_t frame = arena_push();
+    const size_t n = isog_degree->n_primes;
+
+    struct isog_chain c = {
+        .A24p = A24p,
+        .C24 = C24,
+        .A24p_next = arena_fp2(),
+        .C24_next = arena_fp2(),
+        .primes = isog_degree->primes,
+        .n = n,
+        .s = arena_scratch(),
+    };
+    fp2_set(A24p, A24p_init);
+    fp2_set(C24, C24_init);
+
+    size_t n_user = 0;
+    while (push_points[n_user] != NULL) {
+        n_user++;
+    }
+
+    if (ws != NULL) {
+        assert(n_user <= ws->n_user_max && "Workspace is too small");
+        c.split = _workspace_strategy(ws, isog_degree);
+        c.push = ws->push;
+        c.ws = ws;
+    } else {
+        uint16_t *split = arena_alloc((n + 1) * (n + 1) * sizeof(uint16_t));
+        isog_chain_strategy(split, isog_degree->primes, n);
+        c.split = split;
+        // At most one kernel multiple per factor waits on the stack
+        c.push = arena_alloc((n_user + n + 1) * sizeof(point_t));
     }
-    free(kpts);
+    memcpy(c.push, push_points, n_user * sizeof(point_t));
+    c.push[n_user] = NULL;
+    c.n_push = n_user;
 
-    fp2_clear(&A24p_next);
-    fp2_clear(&C24_next);
-    point_clear(&K0);
-    point_clear(&Q);
-    point_clear(&T);
-    point_clear(&R);
-}
\ No newline at end of file
+    point_t K0 = arena_point();
+    point_set(K0, K);
+    _chain_traverse(&c, K0, 0, n);
+
+    arena_pop(frame);
+}
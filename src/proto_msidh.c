@@ -190,11 +190,6 @@ void msidh_state_reset(struct msidh_state *msidh) {
            msidh->status == MSIDH_STATUS_INITIALIZED ||
            msidh->status == MSIDH_STATUS_EXCHANGED);
 
-    // state_prepare" initializes global fpchar
-    if (msidh->status != MSIDH_STATUS_INITIALIZED) {
-        fpchar_clear_if_set();
-    }
-
     // We dont deallocate the variables - simply change the status so "prepare"
     // can be called
     msidh->status = MSIDH_STATUS_INITIALIZED;
@@ -203,6 +198,7 @@ void msidh_state_reset(struct msidh_state *msidh) {
 void msidh_key_exchange(struct msidh_state *msidh,
                         const struct msidh_data *pk_other) {
     assert(msidh->status == MSIDH_STATUS_PREPARED);
+    fp_ctx_t prev_ctx = fp_ctx_swap(msidh->ctx);
 
     fp2_t A24p_final, C24_final, A24p_other, C24_other;
     fp2_init(&A24p_final);
@@ -232,18 +228,37 @@ void msidh_key_exchange(struct msidh_state *msidh,
 
     // Run the key exchange
     _msidh_key_exchange_alice(msidh->j_inv, A24p_final, C24_final, A24p_other,
-                              C24_other, &msidh->PQ_self, *deg_self, msidh->secret);
+                              C24_other, &msidh->PQ_self, *deg_self, msidh->secret,
+                              &msidh->ws);
 
     fp2_clear(&A24p_final);
     fp2_clear(&C24_final);
     fp2_clear(&A24p_other);
     fp2_clear(&C24_other);
 
+    fp_ctx_swap(prev_ctx);
     msidh->status = MSIDH_STATUS_EXCHANGED;
 }
 
+size_t msidh_shared_secret_size(const struct msidh_state *msidh) {
+    fp_ctx_t prev_ctx = fp_ctx_swap(msidh->ctx);
+    size_t size = fp2_nbytes();
+    fp_ctx_swap(prev_ctx);
+    return size;
+}
+
+void msidh_get_shared_secret(const struct msidh_state *msidh,
+                             unsigned char *buf) {
+    assert(msidh->status == MSIDH_STATUS_EXCHANGED);
+    fp_ctx_t prev_ctx = fp_ctx_swap(msidh->ctx);
+    fp2_to_bytes(buf, msidh->j_inv);
+    fp_ctx_swap(prev_ctx);
+}
+
 void msidh_get_pubkey(const struct msidh_state *msidh,
                       struct msidh_data *pk_self) {
+    fp_ctx_t prev_ctx = fp_ctx_swap(msidh->ctx);
+
     // Point have to be normalized, otherwise we will get false results
     assert(point_is_normalized(msidh->PQ_pubkey.P));
     assert(point_is_normalized(msidh->PQ_pubkey.Q));
@@ -267,15 +282,25 @@ void msidh_get_pubkey(const struct msidh_state *msidh,
     fp2_div_unsafe(pk_self->a, A, C);
     fp2_clear(&A);
     fp2_clear(&C);
+
+    fp_ctx_swap(prev_ctx);
+}
+
+// Check whether the cached bases were computed for the same parameters and
+// side, the state context must be active
+static int _msidh_cache_valid(const struct msidh_state *msidh,
+                              const struct msidh_data *params, int is_bob) {
+    const struct msidh_data *c = &msidh->cache_params;
+    return c->t != 0 && c->t == params->t && c->f == params->f &&
+           msidh->cache_is_bob == is_bob && fp2_equal(c->a, params->a) &&
+           fp2_equal(c->xP, params->xP) && fp2_equal(c->xQ, params->xQ) &&
+           fp2_equal(c->xR, params->xR);
 }
 
 void msidh_state_prepare(struct msidh_state *msidh,
                          const struct msidh_data *params, int is_bob) {
     assert(msidh->status == MSIDH_STATUS_INITIALIZED);
 
-    // `a = 2` is invalid in montgomery model
-    assert(!fp2_equal_uint(params->a, 2) &&
-           "Curve coefficient cannot be equal to 2");
     assert(params->t >= 2 && "Security parameter t must be larger than 1");
     // assert(params->f > 0 && "MSIDH Params cofactor f must be a positive
     // integer");
@@ -291,11 +316,17 @@ void msidh_state_prepare(struct msidh_state *msidh,
         msidh_calc_pub_params(msidh->p, msidh->A, msidh->B, msidh->t, msidh->f);
     assert(ret == 0 && "MSIDH cannot calculate public params");
 
-    // Initialize global characteristic if its not set
-    fpchar_clear_if_set();
-    ret = fpchar_setup(msidh->p);
+    // Characteristic is kept inside the state context, which is active only
+    // for the duration of the state functions
+    ret = fp_ctx_setup(msidh->ctx, msidh->p);
     assert(ret == 0 &&
-           "MSIDH cannot work properly if global characteristic is invalid");
+           "MSIDH cannot work properly if the characteristic is invalid");
+    fp_ctx_t prev_ctx = fp_ctx_swap(msidh->ctx);
+
+    // `a = 2` is invalid in montgomery model, the check requires the
+    // characteristic to be set
+    assert(!fp2_equal_uint(params->a, 2) &&
+           "Curve coefficient cannot be equal to 2");
 
     mpz_t mask;
     mpz_init(mask);
@@ -306,24 +337,48 @@ void msidh_state_prepare(struct msidh_state *msidh,
     A24p_from_A(msidh->A24p_start, msidh->C24_start, msidh->A24p_start,
                 msidh->C24_start);
 
-    // Convert xP, xQ and xR to torsion basis
-    struct tors_basis PQ;
-    tors_basis_init(&PQ);
-    point_set_fp2_x(PQ.P, params->xP);
-    point_set_fp2_x(PQ.Q, params->xQ);
-    point_set_fp2_x(PQ.PQd, params->xR);
-    mpz_add_ui(PQ.n, msidh->p, 1);
-
     pprod_t *deg_self  = is_bob ? &msidh->B : &msidh->A;
     pprod_t *deg_other = is_bob ? &msidh->A : &msidh->B;
 
-    // Generate my torsion basis
-    tors_basis_get_subgroup(&msidh->PQ_self, (*deg_self)->value, &PQ,
-                            msidh->A24p_start, msidh->C24_start);
-
-    // Generate other torsion basis
-    tors_basis_get_subgroup(&msidh->PQ_pubkey, (*deg_other)->value, &PQ,
-                            msidh->A24p_start, msidh->C24_start);
+    // Torsion bases and the table depend only on the public parameters, they
+    // are recomputed only if the parameters or the side changed
+    if (!_msidh_cache_valid(msidh, params, is_bob)) {
+        // Convert xP, xQ and xR to torsion basis
+        struct tors_basis PQ;
+        tors_basis_init(&PQ);
+        point_set_fp2_x(PQ.P, params->xP);
+        point_set_fp2_x(PQ.Q, params->xQ);
+        point_set_fp2_x(PQ.PQd, params->xR);
+        mpz_add_ui(PQ.n, msidh->p, 1);
+
+        // Generate my torsion basis
+        tors_basis_get_subgroup(&msidh->PQ_self_base, (*deg_self)->value, &PQ,
+                                msidh->A24p_start, msidh->C24_start);
+
+        // Generate other torsion basis
+        tors_basis_get_subgroup(&msidh->PQ_pubkey_base, (*deg_other)->value,
+                                &PQ, msidh->A24p_start, msidh->C24_start);
+
+        // Secret is smaller than the degree of the other side
+        ladder_table_build(&msidh->table_Q, msidh->PQ_self_base.Q,
+                           mpz_sizeinbase((*deg_other)->value, 2),
+                           msidh->A24p_start, msidh->C24_start);
+        tors_basis_clear(&PQ);
+
+        // Both chains of my side push at most the three points of the basis
+        isog_workspace_reserve(&msidh->ws, *deg_self, 3);
+
+        msidh->cache_params.t = params->t;
+        msidh->cache_params.f = params->f;
+        fp2_set(msidh->cache_params.a, params->a);
+        fp2_set(msidh->cache_params.xP, params->xP);
+        fp2_set(msidh->cache_params.xQ, params->xQ);
+        fp2_set(msidh->cache_params.xR, params->xR);
+        msidh->cache_is_bob = is_bob;
+    }
+    // Both bases are modified by the pubkey generation and the key exchange
+    tors_basis_set(&msidh->PQ_self, &msidh->PQ_self_base);
+    tors_basis_set(&msidh->PQ_pubkey, &msidh->PQ_pubkey_base);
 
     // Generate random secret s in range [0, B)
     mpz_urandomm(msidh->secret, msidh->randstate, (*deg_other)->value);
@@ -333,16 +388,16 @@ void msidh_state_prepare(struct msidh_state *msidh,
     _msidh_gen_pubkey_alice(msidh->A24p_pubkey, msidh->C24_pubkey,
                             &msidh->PQ_self, &msidh->PQ_pubkey, *deg_self, 
                             msidh->A24p_start, msidh->C24_start, msidh->secret,
-                            mask);
+                            mask, &msidh->table_Q, &msidh->ws);
 
-    // Normalize for further access
-    point_normalize_coords(msidh->PQ_pubkey.P);
-    point_normalize_coords(msidh->PQ_pubkey.Q);
-    point_normalize_coords(msidh->PQ_pubkey.PQd);
+    // Normalize for further access, sharing a single inversion
+    point_t pubkey_points[] = {msidh->PQ_pubkey.P, msidh->PQ_pubkey.Q,
+                               msidh->PQ_pubkey.PQd};
+    point_normalize_batch(pubkey_points, 3);
 
-    tors_basis_clear(&PQ);
     mpz_clear(mask);
 
+    fp_ctx_swap(prev_ctx);
     msidh->status = MSIDH_STATUS_PREPARED;
 }
 
@@ -353,20 +408,26 @@ void _msidh_gen_pubkey_alice(fp2_t A24p_alice, fp2_t C24_alice,
                              struct tors_basis *PQ_alice,
                              struct tors_basis *PQ_bob, const pprod_t A_deg, const fp2_t A24p_base,
                              const fp2_t C24_base, const mpz_t secret,
-                             const mpz_t mask) {
+                             const mpz_t mask,
+                             const struct ladder_table *table,
+                             struct isog_workspace *ws) {
     // P, Q is a torsion basis for deg
 
     // assert(global_fpchar_setup(p));
 
     // 1. Calculate the kernel of the Alice isogeny
     // PA = PA + [s]QA
-    xLADDER3PT(PQ_alice->P, PQ_alice->Q, PQ_alice->PQd, secret, A24p_base,
-               C24_base);
+    if (table != NULL) {
+        xLADDER3PT_fixed(PQ_alice->P, PQ_alice->PQd, table, secret);
+    } else {
+        xLADDER3PT(PQ_alice->P, PQ_alice->Q, PQ_alice->PQd, secret, A24p_base,
+                   C24_base);
+    }
 
     point_t push_points[] = {PQ_bob->P, PQ_bob->Q, PQ_bob->PQd, NULL, NULL};
 
     ISOG_chain(A24p_alice, C24_alice, A24p_base, C24_base, PQ_alice->P,
-               A_deg, push_points);
+               A_deg, push_points, ws);
 
     // Mask the Bob torsion basis using quadratic root - alpha.
     // mpz_t alpha;
@@ -375,20 +436,16 @@ void _msidh_gen_pubkey_alice(fp2_t A24p_alice, fp2_t C24_alice,
     // assert(!ret);
 
     // 3. Apply masking
-    // We multiply all the points (PB, QB, PQBd) by `alpha`
-    // We use QA as temporary register for holding the point result
-    xLADDER(PQ_alice->Q, PQ_bob->P, mask, A24p_alice, C24_alice);
-    point_set(PQ_bob->P, PQ_alice->Q);
-    xLADDER(PQ_alice->Q, PQ_bob->Q, mask, A24p_alice, C24_alice);
-    point_set(PQ_bob->Q, PQ_alice->Q);
-    xLADDER(PQ_alice->Q, PQ_bob->PQd, mask, A24p_alice, C24_alice);
-    point_set(PQ_bob->PQd, PQ_alice->Q);
+    // We multiply all the points (PB, QB, PQBd) by `alpha` in one ladder
+    point_t bob_points[] = {PQ_bob->P, PQ_bob->Q, PQ_bob->PQd};
+    xLADDER_multi(bob_points, bob_points, 3, mask, A24p_alice, C24_alice);
 }
 
 // TODO: Note that BPQA get destroyed
 void _msidh_key_exchange_alice(fp2_t j_inv, fp2_t A24p_final, fp2_t C24_final,
                                const fp2_t A24p_bob, const fp2_t C24_bob,
-                               struct tors_basis *BPQA, const pprod_t A_deg, const mpz_t A_sec) {
+                               struct tors_basis *BPQA, const pprod_t A_deg, const mpz_t A_sec,
+                               struct isog_workspace *ws) {
 
     // 1. Calculate the kernel of the Alice isogeny
     // PA = PA + [s]QA
@@ -397,17 +454,9 @@ void _msidh_key_exchange_alice(fp2_t j_inv, fp2_t A24p_final, fp2_t C24_final,
     point_t push_points[] = {NULL, NULL};
 
     ISOG_chain(A24p_final, C24_final, A24p_bob, C24_bob, BPQA->P, A_deg,
-               push_points);
-
-    fp2_t A, C;
-    fp2_init(&A);
-    fp2_init(&C);
+               push_points, ws);
 
-    A_from_A24p(A, C, A24p_final, C24_final);
-    j_invariant(j_inv, A, C);
-
-    fp2_clear(&A);
-    fp2_clear(&C);
+    j_invariant_A24p(j_inv, A24p_final, C24_final);
 }
 
 void msidh_data_init(struct msidh_data *md) {
@@ -424,9 +473,59 @@ void msidh_data_clear(struct msidh_data *md) {
     fp2_clear(&md->xR);
 }
 
+size_t msidh_data_packed_size() { return 2 * 4 + 4 * fp2_nbytes(); }
+
+static void _pack_u32(unsigned char *buf, uint32_t val) {
+    for (int i = 0; i < 4; i++) {
+        buf[i] = (unsigned char)(val >> (8 * i));
+    }
+}
+
+static uint32_t _unpack_u32(const unsigned char *buf) {
+    uint32_t val = 0;
+    for (int i = 0; i < 4; i++) {
+        val |= (uint32_t)buf[i] << (8 * i);
+    }
+    return val;
+}
+
+void msidh_data_pack(unsigned char *buf, const struct msidh_data *md) {
+    const size_t n = fp2_nbytes();
+    _pack_u32(buf, md->t);
+    _pack_u32(buf + 4, md->f);
+    buf += 8;
+    fp2_to_bytes(buf, md->a);
+    fp2_to_bytes(buf + n, md->xP);
+    fp2_to_bytes(buf + 2 * n, md->xQ);
+    fp2_to_bytes(buf + 3 * n, md->xR);
+}
+
+int msidh_data_unpack(struct msidh_data *md, const unsigned char *buf) {
+    const size_t n = fp2_nbytes();
+    uint32_t t = _unpack_u32(buf), f = _unpack_u32(buf + 4);
+    if (t < MSIDH_TMIN || t >= MSIDH_TMAX || f == 0 || f > INT32_MAX) {
+        return -1;
+    }
+    md->t = t;
+    md->f = f;
+
+    buf += 8;
+    if (fp2_from_bytes(md->a, buf) != 0 ||
+        fp2_from_bytes(md->xP, buf + n) != 0 ||
+        fp2_from_bytes(md->xQ, buf + 2 * n) != 0 ||
+        fp2_from_bytes(md->xR, buf + 3 * n) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
 void msidh_state_init(struct msidh_state *msidh) {
     gmp_randinit_mt(msidh->randstate);
 
+    // Field elements are initialized under the (not yet set) state context
+    fp_ctx_init(&msidh->ctx);
+    fp_ctx_t prev_ctx = fp_ctx_swap(msidh->ctx);
+
     mpz_init(msidh->p);
     pprod_init(&msidh->A);
     pprod_init(&msidh->B);
@@ -443,6 +542,14 @@ void msidh_state_init(struct msidh_state *msidh) {
     fp2_init(&msidh->j_inv);
     mpz_init(msidh->secret);
 
+    msidh_data_init(&msidh->cache_params);
+    msidh->cache_params.t = 0;
+    tors_basis_init(&msidh->PQ_self_base);
+    tors_basis_init(&msidh->PQ_pubkey_base);
+    ladder_table_init(&msidh->table_Q);
+    isog_workspace_init(&msidh->ws);
+
+    fp_ctx_swap(prev_ctx);
     msidh->status = MSIDH_STATUS_INITIALIZED;
 }
 
@@ -465,5 +572,13 @@ void msidh_state_clear(struct msidh_state *msidh) {
     fp2_clear(&msidh->j_inv);
     mpz_clear(msidh->secret);
 
+    msidh_data_clear(&msidh->cache_params);
+    tors_basis_clear(&msidh->PQ_self_base);
+    tors_basis_clear(&msidh->PQ_pubkey_base);
+    ladder_table_clear(&msidh->table_Q);
+    isog_workspace_clear(&msidh->ws);
+
+    fp_ctx_clear(&msidh->ctx);
+
     msidh->status = MSIDH_STATUS_UNINITIALIZED;
 }
@@ -53,9 +53,12 @@ static unsigned int PRIMES_BOB[TERSIDH_TMAX] = {
 /*
  * @brief Generate random secret for the tersidh and compute the kernel points. 
  * @reads: t, is_bob, secret (if skip_secret = 1), A24_start, C24_start, PQ_self
+ * (if the tables are NULL)
  * @modifies: secret (if skip_secret = 0), KP_deg, KQ_deg, KP, KQ
 */
-void tersidh_generate_kernel_points(struct tersidh_state* tersidh, int skip_secret) {
+void tersidh_generate_kernel_points(struct tersidh_state* tersidh, int skip_secret,
+                                    const struct ladder_table *table_P,
+                                    const struct ladder_table *table_Q) {
     // Interpret secret as ternary number of length `t`.
     mpz_t r, n, cP, cQ;
     mpz_init(r); 
@@ -116,10 +119,16 @@ void tersidh_generate_kernel_points(struct tersidh_state* tersidh, int skip_secr
     pprod_set_array(tersidh->KP_deg, kp_primes, kp_size);
     pprod_set_array(tersidh->KQ_deg, kq_primes, kq_size);
 
-    // KP = [cP]P
-    xLADDER(tersidh->KP, tersidh->PQ_self.P, cP, tersidh->A24p_start, tersidh->C24_start);
-    // KQ = [cQ]Q
-    xLADDER(tersidh->KQ, tersidh->PQ_self.Q, cQ, tersidh->A24p_start, tersidh->C24_start);
+    if (table_P != NULL && table_Q != NULL) {
+        // KP = [cP]P, KQ = [cQ]Q
+        xLADDER_fixed(tersidh->KP, table_P, cP);
+        xLADDER_fixed(tersidh->KQ, table_Q, cQ);
+    } else {
+        // KP = [cP]P
+        xLADDER(tersidh->KP, tersidh->PQ_self.P, cP, tersidh->A24p_start, tersidh->C24_start);
+        // KQ = [cQ]Q
+        xLADDER(tersidh->KQ, tersidh->PQ_self.Q, cQ, tersidh->A24p_start, tersidh->C24_start);
+    }
 
     free(kp_primes);
     free(kq_primes);
@@ -206,40 +215,30 @@ void tersidh_state_reset(struct tersidh_state *tersidh) {
            tersidh->status == TERSIDH_STATUS_INITIALIZED ||
            tersidh->status == TERSIDH_STATUS_EXCHANGED);
 
-    // state_prepare" initializes global fpchar
-    if (tersidh->status != TERSIDH_STATUS_INITIALIZED) {
-        fpchar_clear_if_set();
-    }
-
     // We dont deallocate the variables - simply change the status so "prepare"
     // can be called
     tersidh->status = TERSIDH_STATUS_INITIALIZED;
 }
 
+// Check whether the cached bases were computed for the same parameters and
+// side, the state context must be active
+static int _tersidh_cache_valid(const struct tersidh_state *tersidh,
+                                const struct tersidh_data *params, int is_bob) {
+    const struct tersidh_data *c = &tersidh->cache_params;
+    return c->t != 0 && c->t == params->t && c->f == params->f &&
+           tersidh->cache_is_bob == is_bob && fp2_equal(c->a, params->a) &&
+           fp2_equal(c->xP, params->xP) && fp2_equal(c->xQ, params->xQ) &&
+           fp2_equal(c->xR, params->xR);
+}
+
 void tersidh_state_prepare(struct tersidh_state *tersidh,
                          const struct tersidh_data *params, int is_bob) {
     assert(tersidh->status == TERSIDH_STATUS_INITIALIZED);
 
-    // `a = 2` is invalid in montgomery model
-    assert(!fp2_equal_uint(params->a, 2) &&
-           "Curve coefficient cannot be equal to 2");
     assert(params->t >= TERSIDH_TMIN && params->t <= TERSIDH_TMAX && "Invalid t-parameter size");
     // assert(params->f > 0 && "TERSIDH Params cofactor f must be a positive
     // integer");
 
-    // Middle node - elliptic curve between both isogenies (codomain of KP's isogeny)
-    fp2_t A24p_mid, C24_mid;
-    fp2_init(&A24p_mid);
-    fp2_init(&C24_mid);
-
-    // Image of the KQ point under KP's isogeny
-    point_t phi_KQ;
-    point_init(&phi_KQ);
-
-    // Convert xP, xQ and xR to torsion basis
-    struct tors_basis PQ;
-    tors_basis_init(&PQ);
-
     // Generate public protocol params: p, A, B given t;
     tersidh->is_bob = is_bob;
     tersidh->t = params->t;
@@ -251,17 +250,26 @@ void tersidh_state_prepare(struct tersidh_state *tersidh,
         tersidh_calc_pub_params(tersidh->p, tersidh->A, tersidh->B, tersidh->t, tersidh->f);
     assert(ret == 0 && "TERSIDH cannot calculate public params");
 
-    // Initialize global characteristic if its not set
-    fpchar_clear_if_set();
-    ret = fpchar_setup(tersidh->p);
+    // Characteristic is kept inside the state context, which is active only
+    // for the duration of the state functions
+    ret = fp_ctx_setup(tersidh->ctx, tersidh->p);
     assert(ret == 0 &&
-           "TERSIDH cannot work properly if global characteristic is invalid");
+           "TERSIDH cannot work properly if the characteristic is invalid");
+    fp_ctx_t prev_ctx = fp_ctx_swap(tersidh->ctx);
+
+    // Middle node - elliptic curve between both isogenies (codomain of KP's isogeny)
+    fp2_t A24p_mid, C24_mid;
+    fp2_init(&A24p_mid);
+    fp2_init(&C24_mid);
 
-    // fill torsion basis P,Q = E[n] data based on given params
-    point_set_fp2_x(PQ.P, params->xP);
-    point_set_fp2_x(PQ.Q, params->xQ);
-    point_set_fp2_x(PQ.PQd, params->xR);
-    mpz_add_ui(PQ.n, tersidh->p, 1);
+    // Image of the KQ point under KP's isogeny
+    point_t phi_KQ;
+    point_init(&phi_KQ);
+
+    // `a = 2` is invalid in montgomery model, the check requires the
+    // characteristic to be set
+    assert(!fp2_equal_uint(params->a, 2) &&
+           "Curve coefficient cannot be equal to 2");
 
     // Initalize starting Ellitptic Curve: y^2 = x^3 + ax^2 + x
     fp2_set(tersidh->A24p_start, params->a);
@@ -272,19 +280,55 @@ void tersidh_state_prepare(struct tersidh_state *tersidh,
     pprod_t *deg_self  = is_bob ? &tersidh->B : &tersidh->A;
     pprod_t *deg_other = is_bob ? &tersidh->A : &tersidh->B;
 
-    // Generate my torsion basis PA, QA = E0[A]
-    tors_basis_get_subgroup(&tersidh->PQ_self, (*deg_self)->value, &PQ,
-                            tersidh->A24p_start, tersidh->C24_start);
-
-    // Generate other torsion basis: PB, QB = E0[B]
-    tors_basis_get_subgroup(&tersidh->PQ_pubkey, (*deg_other)->value, &PQ,
-                            tersidh->A24p_start, tersidh->C24_start);
+    // Torsion bases and the tables depend only on the public parameters,
+    // they are recomputed only if the parameters or the side changed
+    if (!_tersidh_cache_valid(tersidh, params, is_bob)) {
+        // Convert xP, xQ and xR to torsion basis P,Q = E[n]
+        struct tors_basis PQ;
+        tors_basis_init(&PQ);
+        point_set_fp2_x(PQ.P, params->xP);
+        point_set_fp2_x(PQ.Q, params->xQ);
+        point_set_fp2_x(PQ.PQd, params->xR);
+        mpz_add_ui(PQ.n, tersidh->p, 1);
+
+        // Generate my torsion basis PA, QA = E0[A]
+        tors_basis_get_subgroup(&tersidh->PQ_self_base, (*deg_self)->value,
+                                &PQ, tersidh->A24p_start, tersidh->C24_start);
+
+        // Generate other torsion basis: PB, QB = E0[B]
+        tors_basis_get_subgroup(&tersidh->PQ_pubkey_base, (*deg_other)->value,
+                                &PQ, tersidh->A24p_start, tersidh->C24_start);
+
+        // Kernel scalars divide the degree of my side
+        size_t n_bits = mpz_sizeinbase((*deg_self)->value, 2);
+        ladder_table_build(&tersidh->table_P, tersidh->PQ_self_base.P, n_bits,
+                           tersidh->A24p_start, tersidh->C24_start);
+        ladder_table_build(&tersidh->table_Q, tersidh->PQ_self_base.Q, n_bits,
+                           tersidh->A24p_start, tersidh->C24_start);
+        tors_basis_clear(&PQ);
+
+        // Degrees of KP and KQ divide my degree, the chains push at most the
+        // basis of the other side and phi_KQ
+        isog_workspace_reserve(&tersidh->ws, *deg_self, 4);
+
+        tersidh->cache_params.t = params->t;
+        tersidh->cache_params.f = params->f;
+        fp2_set(tersidh->cache_params.a, params->a);
+        fp2_set(tersidh->cache_params.xP, params->xP);
+        fp2_set(tersidh->cache_params.xQ, params->xQ);
+        fp2_set(tersidh->cache_params.xR, params->xR);
+        tersidh->cache_is_bob = is_bob;
+    }
+    // Both bases are modified by the pubkey generation and the key exchange
+    tors_basis_set(&tersidh->PQ_self, &tersidh->PQ_self_base);
+    tors_basis_set(&tersidh->PQ_pubkey, &tersidh->PQ_pubkey_base);
 
 
     // Draft random secret; Generate kernel points: KP, KQ
     // Sample new random secret value only if it's equal to 0 => otherwise it was set by the user (unit tests)
     int skip_secret = !!(mpz_sgn(tersidh->secret));
-    tersidh_generate_kernel_points(tersidh, skip_secret);
+    tersidh_generate_kernel_points(tersidh, skip_secret, &tersidh->table_P,
+                                   &tersidh->table_Q);
     point_set(phi_KQ, tersidh->KQ);
 
     // -- Calculate both isogenies from KP and KQ
@@ -292,31 +336,32 @@ void tersidh_state_prepare(struct tersidh_state *tersidh,
     point_t push_points[] = {tersidh->PQ_pubkey.P, tersidh->PQ_pubkey.Q, tersidh->PQ_pubkey.PQd, phi_KQ, NULL, NULL};
 
     // Calculate first isogeny phi_KP
-    ISOG_chain(A24p_mid, C24_mid, tersidh->A24p_start, tersidh->C24_start, tersidh->KP, tersidh->KP_deg, push_points);
+    ISOG_chain(A24p_mid, C24_mid, tersidh->A24p_start, tersidh->C24_start, tersidh->KP, tersidh->KP_deg, push_points, &tersidh->ws);
 
     // Remove the KQ kernel point from the push points list
     push_points[3] = NULL;
 
     // Calculate second isogeny phi_KQ
-    ISOG_chain(tersidh->A24p_pubkey, tersidh->C24_pubkey, A24p_mid, C24_mid,phi_KQ, tersidh->KQ_deg, push_points);
+    ISOG_chain(tersidh->A24p_pubkey, tersidh->C24_pubkey, A24p_mid, C24_mid,phi_KQ, tersidh->KQ_deg, push_points, &tersidh->ws);
 
-    // Normalize for further access
-    point_normalize_coords(tersidh->PQ_pubkey.P);
-    point_normalize_coords(tersidh->PQ_pubkey.Q);
-    point_normalize_coords(tersidh->PQ_pubkey.PQd);
-
-    tors_basis_clear(&PQ);
+    // Normalize for further access, sharing a single inversion
+    point_t pubkey_points[] = {tersidh->PQ_pubkey.P, tersidh->PQ_pubkey.Q,
+                               tersidh->PQ_pubkey.PQd};
+    point_normalize_batch(pubkey_points, 3);
 
     point_clear(&phi_KQ);
 
     fp2_clear(&A24p_mid);
     fp2_clear(&C24_mid);
+
+    fp_ctx_swap(prev_ctx);
     tersidh->status = TERSIDH_STATUS_PREPARED;
 }
 
 void tersidh_key_exchange(struct tersidh_state *tersidh,
                         const struct tersidh_data *pk_other) {
     assert(tersidh->status == TERSIDH_STATUS_PREPARED);
+    fp_ctx_t prev_ctx = fp_ctx_swap(tersidh->ctx);
 
     fp2_t A24p_final, C24_final, A24p_mid, C24_mid;
     fp2_init(&A24p_final);
@@ -346,7 +391,7 @@ void tersidh_key_exchange(struct tersidh_state *tersidh,
     A24p_from_A(tersidh->A24p_start, tersidh->C24_start, tersidh->A24p_start, tersidh->C24_start);
 
     // Use already calculated secret, new basis <PA,QA> = EB[A] and E0 := EB to generate KP and KQ
-    tersidh_generate_kernel_points(tersidh, 1); 
+    tersidh_generate_kernel_points(tersidh, 1, NULL, NULL);
 
     point_t phi_KQ;
     point_init(&phi_KQ);
@@ -356,17 +401,16 @@ void tersidh_key_exchange(struct tersidh_state *tersidh,
     point_t push_points[] = { phi_KQ, NULL, NULL};
 
     // First isogeny; phi_KP
-    ISOG_chain(A24p_mid, C24_mid, tersidh->A24p_start, tersidh->C24_start, tersidh->KP, tersidh->KP_deg, push_points);
+    ISOG_chain(A24p_mid, C24_mid, tersidh->A24p_start, tersidh->C24_start, tersidh->KP, tersidh->KP_deg, push_points, &tersidh->ws);
 
     // Remove the KQ kernel from the list of points
     push_points[0] = NULL;
 
     // Second isogeny; phi_KQ
-    ISOG_chain(A24p_final, C24_final, A24p_mid, C24_mid, phi_KQ, tersidh->KQ_deg, push_points);
+    ISOG_chain(A24p_final, C24_final, A24p_mid, C24_mid, phi_KQ, tersidh->KQ_deg, push_points, &tersidh->ws);
 
     // Calculate j_invariant of the curve
-    A_from_A24p(A24p_final, C24_final, A24p_final, C24_final);
-    j_invariant(tersidh->j_inv, A24p_final, C24_final);
+    j_invariant_A24p(tersidh->j_inv, A24p_final, C24_final);
 
     point_clear(&phi_KQ);
     fp2_clear(&A24p_final);
@@ -374,12 +418,29 @@ void tersidh_key_exchange(struct tersidh_state *tersidh,
     fp2_clear(&A24p_mid);
     fp2_clear(&C24_mid);
 
+    fp_ctx_swap(prev_ctx);
     tersidh->status = TERSIDH_STATUS_EXCHANGED;
 }
 
+size_t tersidh_shared_secret_size(const struct tersidh_state *tersidh) {
+    fp_ctx_t prev_ctx = fp_ctx_swap(tersidh->ctx);
+    size_t size = fp2_nbytes();
+    fp_ctx_swap(prev_ctx);
+    return size;
+}
+
+void tersidh_get_shared_secret(const struct tersidh_state *tersidh,
+                               unsigned char *buf) {
+    assert(tersidh->status == TERSIDH_STATUS_EXCHANGED);
+    fp_ctx_t prev_ctx = fp_ctx_swap(tersidh->ctx);
+    fp2_to_bytes(buf, tersidh->j_inv);
+    fp_ctx_swap(prev_ctx);
+}
+
 void tersidh_get_pubkey(const struct tersidh_state *tersidh,
                       struct tersidh_data *pk_self) {
     assert(tersidh->status == TERSIDH_STATUS_PREPARED);
+    fp_ctx_t prev_ctx = fp_ctx_swap(tersidh->ctx);
 
     // Point have to be normalized, otherwise we will get false results
     assert(point_is_normalized(tersidh->PQ_pubkey.P));
@@ -404,6 +465,8 @@ void tersidh_get_pubkey(const struct tersidh_state *tersidh,
     fp2_div_unsafe(pk_self->a, A, C);
     fp2_clear(&A);
     fp2_clear(&C);
+
+    fp_ctx_swap(prev_ctx);
 }
 
 void tersidh_data_init(struct tersidh_data *md) {
@@ -420,9 +483,59 @@ void tersidh_data_clear(struct tersidh_data *md) {
     fp2_clear(&md->xR);
 }
 
+size_t tersidh_data_packed_size() { return 2 * 4 + 4 * fp2_nbytes(); }
+
+static void _pack_u32(unsigned char *buf, uint32_t val) {
+    for (int i = 0; i < 4; i++) {
+        buf[i] = (unsigned char)(val >> (8 * i));
+    }
+}
+
+static uint32_t _unpack_u32(const unsigned char *buf) {
+    uint32_t val = 0;
+    for (int i = 0; i < 4; i++) {
+        val |= (uint32_t)buf[i] << (8 * i);
+    }
+    return val;
+}
+
+void tersidh_data_pack(unsigned char *buf, const struct tersidh_data *md) {
+    const size_t n = fp2_nbytes();
+    _pack_u32(buf, md->t);
+    _pack_u32(buf + 4, md->f);
+    buf += 8;
+    fp2_to_bytes(buf, md->a);
+    fp2_to_bytes(buf + n, md->xP);
+    fp2_to_bytes(buf + 2 * n, md->xQ);
+    fp2_to_bytes(buf + 3 * n, md->xR);
+}
+
+int tersidh_data_unpack(struct tersidh_data *md, const unsigned char *buf) {
+    const size_t n = fp2_nbytes();
+    uint32_t t = _unpack_u32(buf), f = _unpack_u32(buf + 4);
+    if (t < TERSIDH_TMIN || t > TERSIDH_TMAX || f == 0 || f > INT32_MAX) {
+        return -1;
+    }
+    md->t = t;
+    md->f = f;
+
+    buf += 8;
+    if (fp2_from_bytes(md->a, buf) != 0 ||
+        fp2_from_bytes(md->xP, buf + n) != 0 ||
+        fp2_from_bytes(md->xQ, buf + 2 * n) != 0 ||
+        fp2_from_bytes(md->xR, buf + 3 * n) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
 void tersidh_state_init(struct tersidh_state *tersidh) {
     gmp_randinit_mt(tersidh->randstate);
 
+    // Field elements are initialized under the (not yet set) state context
+    fp_ctx_init(&tersidh->ctx);
+    fp_ctx_t prev_ctx = fp_ctx_swap(tersidh->ctx);
+
     mpz_init(tersidh->p);
     pprod_init(&tersidh->A);
     pprod_init(&tersidh->B);
@@ -446,6 +559,15 @@ void tersidh_state_init(struct tersidh_state *tersidh) {
     mpz_init(tersidh->secret);
     assert(mpz_sgn(tersidh->secret) == 0 && "TerSIDH state secret should be set to 0 after init.");
 
+    tersidh_data_init(&tersidh->cache_params);
+    tersidh->cache_params.t = 0;
+    tors_basis_init(&tersidh->PQ_self_base);
+    tors_basis_init(&tersidh->PQ_pubkey_base);
+    ladder_table_init(&tersidh->table_P);
+    ladder_table_init(&tersidh->table_Q);
+    isog_workspace_init(&tersidh->ws);
+
+    fp_ctx_swap(prev_ctx);
     tersidh->status = TERSIDH_STATUS_INITIALIZED;
 }
 
@@ -474,5 +596,14 @@ void tersidh_state_clear(struct tersidh_state *tersidh) {
     fp2_clear(&tersidh->j_inv);
     mpz_clear(tersidh->secret);
 
+    tersidh_data_clear(&tersidh->cache_params);
+    tors_basis_clear(&tersidh->PQ_self_base);
+    tors_basis_clear(&tersidh->PQ_pubkey_base);
+    ladder_table_clear(&tersidh->table_P);
+    ladder_table_clear(&tersidh->table_Q);
+    isog_workspace_clear(&tersidh->ws);
+
+    fp_ctx_clear(&tersidh->ctx);
+
     tersidh->status = TERSIDH_STATUS_UNINITIALIZED;
 }
@@ -1,6 +1,7 @@
 #include <gmp.h>
 #include <stdio.h>
 
+#include "arena.h"
 #include "ec_mont.h"
 #include "fp2.h"
 #include "testing.h"
@@ -148,6 +149,8 @@ void test_A_A24p_conversion() {
 }
 
 void test_point_set_is_immutable() {
+    fpchar_setup_uint(431);
+
     point_set_str_x(P, "5*i + 2");
     // Q = P
     point_set(Q, P);
@@ -156,7 +159,9 @@ void test_point_set_is_immutable() {
 
     // Check if point P was modified
     // if yes, then point_set is a shallow copy and not a deepcopy
-    CHECK(!mpz_cmp_ui(P->X->a, 2) && !mpz_cmp_ui(P->X->b, 5));
+    CHECK(fp_equal_uint(P->X->a, 2) && fp_equal_uint(P->X->b, 5));
+
+    fpchar_clear();
 }
 
 // ------------------------------
@@ -212,28 +217,28 @@ void test_xDBLe() {
     point_normalize_coords(Q);
 
     point_printx(Q, "x[2]P");
-    CHECK(!mpz_cmp_ui(Q->X->a, 311) && !mpz_cmp_ui(Q->X->b, 400));
+    CHECK(fp_equal_uint(Q->X->a, 311) && fp_equal_uint(Q->X->b, 400));
 
     // x[4]P: 13*i + 67
     xDBLe(Q, P, A24p, C24, 2);
     point_normalize_coords(Q);
 
     point_printx(Q, "x[4]P");
-    CHECK(!mpz_cmp_ui(Q->X->a, 67) && !mpz_cmp_ui(Q->X->b, 13));
+    CHECK(fp_equal_uint(Q->X->a, 67) && fp_equal_uint(Q->X->b, 13));
 
     // x[8]P: 213*i + 105
     xDBLe(Q, P, A24p, C24, 3);
     point_normalize_coords(Q);
 
     point_printx(Q, "x[8]P");
-    CHECK(!mpz_cmp_ui(Q->X->a, 105) && !mpz_cmp_ui(Q->X->b, 213));
+    CHECK(fp_equal_uint(Q->X->a, 105) && fp_equal_uint(Q->X->b, 213));
 
     // x[2^1235]P: 304*i + 223
     xDBLe(Q, P, A24p, C24, 12345);
     point_normalize_coords(Q);
 
     point_printx(Q, "x[2^12345]P");
-    CHECK(!mpz_cmp_ui(Q->X->a, 223) && !mpz_cmp_ui(Q->X->b, 304));
+    CHECK(fp_equal_uint(Q->X->a, 223) && fp_equal_uint(Q->X->b, 304));
 }
 
 void test_xADD_small() {
@@ -260,7 +265,7 @@ void test_xADD_small() {
     point_normalize_coords(PQsum);
     fp2_print(PQsum->X, "xP+Q");
 
-    CHECK(!mpz_cmp_ui(PQsum->X->a, 416) && !mpz_cmp_ui(PQsum->X->b, 106));
+    CHECK(fp_equal_uint(PQsum->X->a, 416) && fp_equal_uint(PQsum->X->b, 106));
 
     point_clear(&PQsum);
 }
@@ -282,7 +287,7 @@ void test_xLADDER3PT() {
     point_normalize_coords(P);
 
     point_printx(P, "x(P+nQ)");
-    CHECK(!mpz_cmp_ui(P->X->a, 360) && !mpz_cmp_ui(P->X->b, 45));
+    CHECK(fp_equal_uint(P->X->a, 360) && fp_equal_uint(P->X->b, 45));
 
     point_set_str_x(P, "271*i + 259");
     point_set_str_x(Q, "335*i + 262");
@@ -294,9 +299,341 @@ void test_xLADDER3PT() {
     xLADDER3PT(P, Q, PQd, m, A24p, C24);
 
     point_normalize_coords(P);
-    CHECK(!mpz_cmp_ui(P->X->a, 360) && !mpz_cmp_ui(P->X->b, 45));
+    CHECK(fp_equal_uint(P->X->a, 360) && fp_equal_uint(P->X->b, 45));
+
+    mpz_clear(m);
+}
+
+void test_xDBLADD() {
+    point_t R, S, T;
+    point_init(&R);
+    point_init(&S);
+    point_init(&T);
+
+    // Projective inputs with Z != 1
+    point_set_str_x(P, "271*i + 259");
+    point_set_str_x(Q, "335*i + 262");
+    point_set_str_x(PQd, "411*i + 143");
+    fp2_mul_int(P->X, P->X, 5);
+    fp2_mul_int(P->Z, P->Z, 5);
+    fp2_mul_int(PQd->X, PQd->X, 3);
+    fp2_mul_int(PQd->Z, PQd->Z, 3);
+
+    // Fused formula gives the same coordinates as xDBL and xADD
+    xDBL(R, P, A24p, C24);
+    xADD(S, P, Q, PQd);
+    point_set(T, Q);
+    xDBLADD(P, T, PQd, A24p, C24);
+    CHECK(fp2_equal(R->X, P->X) && fp2_equal(R->Z, P->Z));
+    CHECK(fp2_equal(S->X, T->X) && fp2_equal(S->Z, T->Z));
+
+    // Conditional swap
+    point_set(R, P);
+    point_set(S, Q);
+    point_cswap(P, Q, 0);
+    CHECK(fp2_equal(R->X, P->X) && fp2_equal(S->Z, Q->Z));
+    point_cswap(P, Q, 1);
+    CHECK(fp2_equal(R->X, Q->X) && fp2_equal(R->Z, Q->Z));
+    CHECK(fp2_equal(S->X, P->X) && fp2_equal(S->Z, P->Z));
+
+    // Branch-free ladders agree with the branching ones for all bit patterns
+    mpz_t m;
+    mpz_init(m);
+    for (long int n = 1; n < 70; n++) {
+        mpz_set_si(m, n);
+        point_set_str_x(P, "271*i + 259");
+        xLADDER_int(R, P, n, A24p, C24);
+        xLADDER(S, P, m, A24p, C24);
+        point_normalize_coords(R);
+        point_normalize_coords(S);
+        CHECK(fp2_equal(R->X, S->X));
+
+        point_set_str_x(R, "271*i + 259");
+        point_set_str_x(Q, "335*i + 262");
+        point_set_str_x(PQd, "411*i + 143");
+        xLADDER3PT_int(R, Q, PQd, n, A24p, C24);
+        point_set_str_x(S, "271*i + 259");
+        point_set_str_x(Q, "335*i + 262");
+        point_set_str_x(PQd, "411*i + 143");
+        xLADDER3PT(S, Q, PQd, m, A24p, C24);
+        point_normalize_coords(R);
+        point_normalize_coords(S);
+        CHECK(fp2_equal(R->X, S->X));
+    }
+
+    mpz_clear(m);
+    point_clear(&R);
+    point_clear(&S);
+    point_clear(&T);
+}
+
+// Return 1 if R and S have the same x-coordinate, Z can be different from 1
+int x_equal(point_t R, point_t S) {
+    fp2_t u, v;
+    fp2_init(&u);
+    fp2_init(&v);
+    fp2_mul_unsafe(u, R->X, S->Z);
+    fp2_mul_unsafe(v, S->X, R->Z);
+    int equal = fp2_equal(u, v) && !fp2_is_zero(R->Z) && !fp2_is_zero(S->Z);
+    fp2_clear(&u);
+    fp2_clear(&v);
+    return equal;
+}
+
+void test_xDBLADD_norm() {
+    point_t R, S, T, U, D;
+    point_init(&R);
+    point_init(&S);
+    point_init(&T);
+    point_init(&U);
+    point_init(&D);
+    struct ec_scratch scr;
+    ec_scratch_init(&scr);
+
+    // A24 = (A + 2) / 4 for C24 = 1
+    fp2_t A24;
+    fp2_init(&A24);
+    fp2_inv_unsafe(A24, C24);
+    fp2_mul_safe(A24, A24p);
+
+    // Projective P and Q, difference affine and projective
+    point_set_str_x(P, "271*i + 259");
+    point_set_str_x(Q, "335*i + 262");
+    point_set_str_x(PQd, "411*i + 143");
+    fp2_mul_int(P->X, P->X, 5);
+    fp2_mul_int(P->Z, P->Z, 5);
+    fp2_mul_int(Q->X, Q->X, 7);
+    fp2_mul_int(Q->Z, Q->Z, 7);
+    for (int affine = 0; affine < 2; affine++) {
+        point_set(D, PQd);
+        if (!affine) {
+            fp2_mul_int(D->X, D->X, 3);
+            fp2_mul_int(D->Z, D->Z, 3);
+        }
+        point_set(R, P);
+        point_set(S, Q);
+        xDBLADD_scr(R, S, D, A24p, C24, &scr);
+        point_set(T, P);
+        point_set(U, Q);
+        xDBLADD_norm_scr(T, U, D, A24, affine, &scr);
+        CHECK(x_equal(R, T) && x_equal(S, U));
+    }
+
+    // Long scalars take the normalized steps, compare with the plain ladders
+    mpz_t m;
+    mpz_init_set_str(m, "0x1d2c3b4a5968778695a4b3c2d1e0f0e1d2c3b4a59687", 0);
+    for (int affine = 0; affine < 2; affine++) {
+        point_set_str_x(P, "271*i + 259");
+        if (!affine) {
+            fp2_mul_int(P->X, P->X, 5);
+            fp2_mul_int(P->Z, P->Z, 5);
+        }
+        xLADDER(R, P, m, A24p, C24);
+
+        point_set(T, P);
+        xDBL(U, P, A24p, C24);
+        for (int bit = mpz_sizeinbase(m, 2) - 2; bit >= 0; bit--) {
+            if (mpz_tstbit(m, bit)) {
+                xADD(T, T, U, P);
+                xDBL(U, U, A24p, C24);
+            } else {
+                xADD(U, T, U, P);
+                xDBL(T, T, A24p, C24);
+            }
+        }
+        CHECK(x_equal(R, T));
+    }
+
+    point_set_str_x(R, "271*i + 259");
+    point_set_str_x(S, "335*i + 262");
+    point_set_str_x(D, "411*i + 143");
+    xLADDER3PT(R, S, D, m, A24p, C24);
+    point_set_str_x(T, "271*i + 259");
+    point_set_str_x(U, "335*i + 262");
+    point_set_str_x(PQd, "411*i + 143");
+    for (size_t bit = 0; bit < mpz_sizeinbase(m, 2); bit++) {
+        if (mpz_tstbit(m, bit))
+            xDBLADD(U, T, PQd, A24p, C24);
+        else
+            xDBLADD(U, PQd, T, A24p, C24);
+    }
+    CHECK(x_equal(R, T));
+
+    mpz_clear(m);
+    fp2_clear(&A24);
+    ec_scratch_clear(&scr);
+    point_clear(&R);
+    point_clear(&S);
+    point_clear(&T);
+    point_clear(&U);
+    point_clear(&D);
+}
+
+void test_xLADDER_multi() {
+    point_t pts[3], res[3], R;
+    for (int i = 0; i < 3; i++) {
+        point_init(&pts[i]);
+        point_init(&res[i]);
+    }
+    point_init(&R);
+
+    // Short scalar on the projective curve, long one on the normalized curve
+    const char *scalars[] = {"87", "0x1d2c3b4a5968778695a4b3c2d1e0f0e1d2c3b4a5"};
+    mpz_t m;
+    mpz_init(m);
+    for (int j = 0; j < 2; j++) {
+        mpz_set_str(m, scalars[j], 0);
+        for (int affine = 0; affine < 2; affine++) {
+            point_set_str_x(pts[0], "271*i + 259");
+            point_set_str_x(pts[1], "335*i + 262");
+            point_set_str_x(pts[2], "411*i + 143");
+            if (!affine) {
+                fp2_mul_int(pts[1]->X, pts[1]->X, 5);
+                fp2_mul_int(pts[1]->Z, pts[1]->Z, 5);
+            }
+            xLADDER_multi(res, (const point_t *)pts, 3, m, A24p, C24);
+            for (int i = 0; i < 3; i++) {
+                xLADDER(R, pts[i], m, A24p, C24);
+                CHECK(x_equal(R, res[i]));
+            }
+
+            // In place
+            xLADDER_multi(pts, (const point_t *)pts, 3, m, A24p, C24);
+            for (int i = 0; i < 3; i++) {
+                CHECK(x_equal(pts[i], res[i]));
+            }
+        }
+    }
+
+    mpz_clear(m);
+    for (int i = 0; i < 3; i++) {
+        point_clear(&pts[i]);
+        point_clear(&res[i]);
+    }
+    point_clear(&R);
+}
+
+void test_ladder_fixed() {
+    point_t R, S, T;
+    point_init(&R);
+    point_init(&S);
+    point_init(&T);
+
+    struct ladder_table table;
+    ladder_table_init(&table);
+
+    // Table of projective Q with Z != 1
+    point_set_str_x(Q, "335*i + 262");
+    fp2_mul_int(Q->X, Q->X, 7);
+    fp2_mul_int(Q->Z, Q->Z, 7);
+    ladder_table_build(&table, Q, 160, A24p, C24);
+    CHECK(table.n == 160);
+
+    const char *scalars[] = {"1", "87", "96",
+                             "0x1d2c3b4a5968778695a4b3c2d1e0f0e1d2c3b4a5"};
+    mpz_t m;
+    mpz_init(m);
+    for (int j = 0; j < 4; j++) {
+        mpz_set_str(m, scalars[j], 0);
+
+        // P + [m]Q
+        point_set_str_x(P, "271*i + 259");
+        point_set(R, Q);
+        point_set_str_x(PQd, "411*i + 143");
+        xLADDER3PT(P, R, PQd, m, A24p, C24);
+        point_set_str_x(S, "271*i + 259");
+        point_set_str_x(T, "411*i + 143");
+        xLADDER3PT_fixed(S, T, &table, m);
+        CHECK(x_equal(P, S));
+
+        // [m]Q
+        xLADDER(R, Q, m, A24p, C24);
+        xLADDER_fixed(S, &table, m);
+        CHECK(x_equal(R, S));
+    }
+
+    // Zero scalar leaves P unchanged
+    mpz_set_ui(m, 0);
+    point_set_str_x(S, "271*i + 259");
+    point_set_str_x(T, "411*i + 143");
+    xLADDER3PT_fixed(S, T, &table, m);
+    CHECK(point_equal_str_x(S, "271*i + 259"));
 
     mpz_clear(m);
+    ladder_table_clear(&table);
+    point_clear(&R);
+    point_clear(&S);
+    point_clear(&T);
+}
+
+void test_scratch_variants() {
+    // Stack storage for points, no heap allocation for the point structures
+    struct point_storage R_st, S_st;
+    point_t R = point_init_storage(&R_st);
+    point_t S = point_init_storage(&S_st);
+
+    struct ec_scratch scr;
+    ec_scratch_init(&scr);
+
+    point_set_str_x(P, "271*i + 259");
+    point_set_str_x(Q, "335*i + 262");
+    point_set_str_x(PQd, "411*i + 143");
+
+    // Same scratch is reused by consecutive calls
+    for (int i = 0; i < 3; i++) {
+        xDBL(R, P, A24p, C24);
+        xDBL_scr(S, P, A24p, C24, &scr);
+        CHECK(fp2_equal(R->X, S->X) && fp2_equal(R->Z, S->Z));
+
+        xADD(R, P, Q, PQd);
+        xADD_scr(S, P, Q, PQd, &scr);
+        CHECK(fp2_equal(R->X, S->X) && fp2_equal(R->Z, S->Z));
+
+        xLADDER_int(R, P, 87 + i, A24p, C24);
+        xLADDER_int_scr(S, P, 87 + i, A24p, C24, &scr);
+        CHECK(fp2_equal(R->X, S->X) && fp2_equal(R->Z, S->Z));
+    }
+
+    ec_scratch_clear(&scr);
+    point_clear_storage(&R_st);
+    point_clear_storage(&S_st);
+}
+
+void test_arena_frames() {
+    point_set_str_x(P, "271*i + 259");
+
+    arena_frame_t outer = arena_push();
+    point_t T = arena_point();
+    xDBL(T, P, A24p, C24);
+
+    // Registers of the popped frame are borrowed again by the next one, more
+    // of them than fit into single block of the pool
+    fp2_t first = NULL;
+    for (int i = 0; i < 3; i++) {
+        arena_frame_t inner = arena_push();
+        fp2_t x = arena_fp2();
+        CHECK(first == NULL || x == first);
+        first = x;
+        for (int j = 0; j < 200; j++) {
+            fp2_set_uint(arena_fp2(), j);
+        }
+        unsigned char *raw = arena_alloc(100000);
+        raw[99999] = 1;
+        // Nested calls borrow from the same arena
+        xLADDER_int(arena_point(), P, 87 + i, A24p, C24);
+        arena_pop(inner);
+    }
+
+    point_t S = arena_point();
+    xDBL(S, P, A24p, C24);
+    CHECK(fp2_equal(T->X, S->X) && fp2_equal(T->Z, S->Z));
+    arena_pop(outer);
+
+    // Next push creates a new arena
+    arena_release();
+    arena_frame_t f = arena_push();
+    xDBL(arena_point(), P, A24p, C24);
+    arena_pop(f);
 }
 
 // ---------------------
@@ -313,28 +650,28 @@ void test_xLADDER_int() {
     point_normalize_coords(Q);
 
     point_printx(Q, "x[1]P");
-    CHECK(!mpz_cmp_ui(Q->X->a, 136) && !mpz_cmp_ui(Q->X->b, 108));
+    CHECK(fp_equal_uint(Q->X->a, 136) && fp_equal_uint(Q->X->b, 108));
 
     // x[2]P = 113*i + 131
     xLADDER_int(Q, P, 2, A24p, C24);
     point_normalize_coords(Q);
 
     point_printx(Q, "x[2]P");
-    CHECK(!mpz_cmp_ui(Q->X->a, 131) && !mpz_cmp_ui(Q->X->b, 113));
+    CHECK(fp_equal_uint(Q->X->a, 131) && fp_equal_uint(Q->X->b, 113));
 
     // x[3]P = 42*i + 83
     xLADDER_int(Q, P, 3, A24p, C24);
     point_normalize_coords(Q);
 
     point_printx(Q, "x[3]P");
-    CHECK(!mpz_cmp_ui(Q->X->a, 83) && !mpz_cmp_ui(Q->X->b, 42));
+    CHECK(fp_equal_uint(Q->X->a, 83) && fp_equal_uint(Q->X->b, 42));
 
     // x[4]P = 47*i + 107
     xLADDER_int(Q, P, 4, A24p, C24);
     point_normalize_coords(Q);
 
     point_printx(Q, "x[4]P");
-    CHECK(!mpz_cmp_ui(Q->X->a, 107) && !mpz_cmp_ui(Q->X->b, 47));
+    CHECK(fp_equal_uint(Q->X->a, 107) && fp_equal_uint(Q->X->b, 47));
 }
 
 void test_xLADDER() {
@@ -349,7 +686,7 @@ void test_xLADDER() {
 
     // x[2^80]P: 98*i + 43
     fp2_print(Q->X, "x[2^80]P");
-    CHECK(!mpz_cmp_ui(Q->X->a, 43) && !mpz_cmp_ui(Q->X->b, 98));
+    CHECK(fp_equal_uint(Q->X->a, 43) && fp_equal_uint(Q->X->b, 98));
 
     // 2. m = 2^80 - 1
     mpz_set_str(m, "ffffffffffffffffffff", 16);
@@ -358,7 +695,7 @@ void test_xLADDER() {
 
     // x[2^80-1]P: 56*i + 96
     fp2_print(Q->X, "x[2^80-1]P");
-    CHECK(!mpz_cmp_ui(Q->X->a, 96) && !mpz_cmp_ui(Q->X->b, 56));
+    CHECK(fp_equal_uint(Q->X->a, 96) && fp_equal_uint(Q->X->b, 56));
 
     // 3. m = random in [2^79, 2^80]
     mpz_set_str(m, "f5697b000f01c17d4c5e", 16);
@@ -367,7 +704,7 @@ void test_xLADDER() {
 
     // x[0xf5697b000f01c17d4c5e]P: 94*i + 31
     fp2_print(Q->X, "x[0xf5697b000f01c17d4c5e]P");
-    CHECK(!mpz_cmp_ui(Q->X->a, 31) && !mpz_cmp_ui(Q->X->b, 94));
+    CHECK(fp_equal_uint(Q->X->a, 31) && fp_equal_uint(Q->X->b, 94));
 
     mpz_clear(m);
 }
@@ -386,7 +723,7 @@ void test_j_invariant() {
 
     // j(E): 9*i + 29
     fp2_print(j_inv, "j(E)");
-    CHECK(!mpz_cmp_ui(j_inv->a, 29) && !mpz_cmp_ui(j_inv->b, 9));
+    CHECK(fp_equal_uint(j_inv->a, 29) && fp_equal_uint(j_inv->b, 9));
 
     fp2_set_str(a, "125*i + 99");
     fp2_print(a, "a(E)");
@@ -395,7 +732,7 @@ void test_j_invariant() {
 
     // j(E): 79*i + 30
     fp2_print(j_inv, "j(E)");
-    CHECK(!mpz_cmp_ui(j_inv->a, 30) && !mpz_cmp_ui(j_inv->b, 79));
+    CHECK(fp_equal_uint(j_inv->a, 30) && fp_equal_uint(j_inv->b, 79));
 
     fp2_set_str(a, "43*i + 61");
     fp2_print(a, "a(E)");
@@ -404,13 +741,43 @@ void test_j_invariant() {
 
     // j(E): 78*i + 97
     fp2_print(j_inv, "j(E)");
-    CHECK(!mpz_cmp_ui(j_inv->a, 97) && !mpz_cmp_ui(j_inv->b, 78));
+    CHECK(fp_equal_uint(j_inv->a, 97) && fp_equal_uint(j_inv->b, 78));
 
     fp2_clear(&a);
     fp2_clear(&c);
     fp2_clear(&j_inv);
 }
 
+void test_j_invariant_proj() {
+    fp2_t a24p, c24, A, C, j, j_A24p, j_num, j_den;
+    fp2_t *elems[] = {&a24p, &c24, &A, &C, &j, &j_A24p, &j_num, &j_den};
+    for (int i = 0; i < 8; i++) {
+        fp2_init(elems[i]);
+    }
+
+    // Projective curves with c24 != 1
+    const char *coeffs[][2] = {{"92*i + 25", "1"},
+                               {"125*i + 99", "17*i + 3"},
+                               {"43*i + 61", "250"}};
+    for (int k = 0; k < 3; k++) {
+        fp2_set_str(a24p, coeffs[k][0]);
+        fp2_set_str(c24, coeffs[k][1]);
+        A_from_A24p(A, C, a24p, c24);
+        j_invariant(j, A, C);
+
+        j_invariant_A24p(j_A24p, a24p, c24);
+        CHECK(fp2_equal(j, j_A24p));
+
+        j_invariant_proj(j_num, j_den, a24p, c24);
+        fp2_mul_safe(j, j_den);
+        CHECK(fp2_equal(j, j_num));
+    }
+
+    for (int i = 0; i < 8; i++) {
+        fp2_clear(elems[i]);
+    }
+}
+
 int main() {
     init_test_variables();
 
@@ -428,6 +795,13 @@ int main() {
     TEST_RUN(test_xDBLe());
     TEST_RUN(test_xADD_small());
     TEST_RUN(test_xLADDER3PT());
+    TEST_RUN_SILENT(test_xDBLADD());
+    TEST_RUN_SILENT(test_xDBLADD_norm());
+    TEST_RUN_SILENT(test_xLADDER_multi());
+    TEST_RUN_SILENT(test_ladder_fixed());
+    TEST_RUN_SILENT(test_j_invariant_proj());
+    TEST_RUN_SILENT(test_scratch_variants());
+    TEST_RUN_SILENT(test_arena_frames());
 
     // p = 139 tests
     set_params_testp139();
@@ -1,6 +1,10 @@
 #include <assert.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "fp2.h"
+#include "gmp_alloc.h"
+#include "proto_msidh.h"
 #include "testing.h"
 
 void test_small_arithmetic() {
@@ -12,23 +16,19 @@ void test_small_arithmetic() {
     CHECK(fp_is_zero(r));
 
     fp_set_uint(r, 16); // r == 16
-    CHECK(!mpz_cmp_ui(r, 16));
     CHECK(fp_equal_uint(r, 16));
 
     fp_sqrt(r, r); // r == 4
-    // TODO: incosistent api, change later
-    CHECK(!mpz_cmp_ui(r, 4));
     CHECK(fp_equal_uint(r, 4));
 
     fp_add_uint(r, r, 10); // r == 14
-    CHECK(!mpz_cmp_ui(r, 14));
     CHECK(fp_equal_uint(r, 14));
 
     fp_sub_uint(r, r, 15); // r == -1 == 430
-    CHECK(!mpz_cmp_ui(r, 430));
+    CHECK(fp_equal_uint(r, 430));
 
     fp_inv(r, r); // r == r ^-1 == 430
-    CHECK(!mpz_cmp_ui(r, 430));
+    CHECK(fp_equal_uint(r, 430));
 
     fp_clear(r);
 
@@ -49,22 +49,22 @@ void test_modulo_arithmetic() {
         fp_init(r);
         // r = a + b (mod 431)
         fp_add(r, a, b);
-        CHECK(!mpz_cmp_ui(r, 10));
+        CHECK(fp_equal_uint(r, 10));
 
         fp_sub(r, a, b);
-        CHECK(!mpz_cmp_ui(r, 152));
+        CHECK(fp_equal_uint(r, 152));
 
         fp_sub(r, b, a);
-        CHECK(!mpz_cmp_ui(r, 279));
+        CHECK(fp_equal_uint(r, 279));
 
         fp_mul(r, a, b);
-        CHECK(!mpz_cmp_ui(r, 283));
+        CHECK(fp_equal_uint(r, 283));
 
         fp_div(r, a, b);
-        CHECK(!mpz_cmp_ui(r, 11));
+        CHECK(fp_equal_uint(r, 11));
 
         fp_div(r, b, a);
-        CHECK(!mpz_cmp_ui(r, 196));
+        CHECK(fp_equal_uint(r, 196));
 
         fp_clear(r);
     }
@@ -75,9 +75,492 @@ void test_modulo_arithmetic() {
     CHECK(!fpchar_clear());
 }
 
+void test_sqrt_is_square() {
+    CHECK(!fpchar_setup_uint(431));
+
+    fp_t x, r, t;
+    fp_init(x);
+    fp_init(r);
+    fp_init(t);
+
+    // Compare with the squares of all elements of F_431
+    int is_square[431] = {0};
+    for (unsigned long int i = 0; i < 431; i++) {
+        is_square[(i * i) % 431] = 1;
+    }
+
+    int n_squares = 0;
+    for (unsigned long int i = 0; i < 431; i++) {
+        fp_set_uint(x, i);
+        CHECK(fp_is_square(x) == is_square[i]);
+        n_squares += fp_is_square(x);
+
+        if (is_square[i]) {
+            fp_sqrt(r, x);
+            fp_mul(r, r, r);
+            CHECK(fp_equal(r, x));
+        }
+
+        // x * pow34(x)^2 = +-1 depending on the Legendre symbol
+        if (i != 0) {
+            fp_pow34(r, x);
+            fp_mul(t, r, r);
+            fp_mul(t, t, x);
+            CHECK(fp_equal_uint(t, is_square[i] ? 1 : 430));
+        }
+    }
+    // 0 and (p - 1)/2 quadratic residues
+    CHECK(n_squares == 216);
+
+    fp_clear(x);
+    fp_clear(r);
+    fp_clear(t);
+
+    CHECK(!fpchar_clear());
+}
+
+// Compare fp_mul with mpz arithmetic for primes of the sizes, where the backend
+// can select fixed-width kernels (plus primes filling the whole top limb)
+void test_mul_kernels() {
+    int bitsizes[] = {738, 768, 922, 960, 1709, 1728};
+    const int n_sizes = sizeof(bitsizes) / sizeof(int);
+    // MSIDH characteristics of example/sock_msidh.h, used by the kernels
+    // generated for a single prime (make FP_SPEC=<t>)
+    int msidh_params[][2] = {{100, 91}, {150, 1}, {200, 18}};
+    const int n_msidh = sizeof(msidh_params) / sizeof(msidh_params[0]);
+    pprod_t A, B;
+    pprod_init(&A);
+    pprod_init(&B);
+
+    gmp_randstate_t rs;
+    gmp_randinit_mt(rs);
+    gmp_randseed_ui(rs, 0xadc0);
+
+    mpz_t p, x, y, z, r;
+    mpz_inits(p, x, y, z, r, NULL);
+
+    for (int k = 0; k < n_sizes + n_msidh; k++) {
+        if (k >= n_sizes) {
+            const int *tf = msidh_params[k - n_sizes];
+            CHECK(!msidh_calc_pub_params(p, A, B, tf[0], tf[1]));
+        } else {
+            // Random prime p = 3 (mod 4) with exactly bitsizes[k] bits
+            do {
+                mpz_urandomb(p, rs, bitsizes[k] - 1);
+                mpz_setbit(p, bitsizes[k] - 1);
+                mpz_nextprime(p, p);
+            } while (mpz_fdiv_ui(p, 4) != 3 ||
+                     mpz_sizeinbase(p, 2) != (size_t)bitsizes[k]);
+        }
+        CHECK(!fpchar_setup(p));
+
+        fp_t a, b, c;
+        fp_init(a);
+        fp_init(b);
+        fp_init(c);
+
+        for (int i = 0; i < 200; i++) {
+            // First iterations use p - 1 to maximize the carries
+            if (i < 2) {
+                mpz_sub_ui(x, p, 1);
+            } else {
+                mpz_urandomm(x, rs, p);
+            }
+            if (i < 1) {
+                mpz_sub_ui(y, p, 1);
+            } else {
+                mpz_urandomm(y, rs, p);
+            }
+            fp_set_mpz(a, x);
+            fp_set_mpz(b, y);
+
+            fp_mul(c, a, b);
+            fp_get_mpz(r, c);
+            mpz_mul(z, x, y);
+            mpz_mod(z, z, p);
+            CHECK(!mpz_cmp(r, z));
+
+            // Squaring, in place
+            fp_mul(a, a, a);
+            fp_get_mpz(r, a);
+            mpz_mul(z, x, x);
+            mpz_mod(z, z, p);
+            CHECK(!mpz_cmp(r, z));
+        }
+
+        // Batch of 4 + 3 products: the first one in place, the last one is
+        // a square
+        fp_t ba[7], bb[7], bc[7];
+        fp_ptr res[7];
+        fp_srcptr x1[7], x2[7];
+        mpz_t expected[7];
+        for (int i = 0; i < 7; i++) {
+            fp_init(ba[i]);
+            fp_init(bb[i]);
+            fp_init(bc[i]);
+            mpz_urandomm(x, rs, p);
+            fp_set_mpz(ba[i], x);
+            mpz_urandomm(y, rs, p);
+            fp_set_mpz(bb[i], y);
+
+            res[i] = i == 0 ? ba[i] : bc[i];
+            x1[i] = ba[i];
+            x2[i] = i == 6 ? ba[i] : bb[i];
+
+            mpz_init(expected[i]);
+            mpz_mul(expected[i], x, i == 6 ? x : y);
+            mpz_mod(expected[i], expected[i], p);
+        }
+        fp_mul_batch(res, x1, x2, 7);
+        for (int i = 0; i < 7; i++) {
+            fp_get_mpz(r, res[i]);
+            CHECK(!mpz_cmp(r, expected[i]));
+            mpz_clear(expected[i]);
+            fp_clear(ba[i]);
+            fp_clear(bb[i]);
+            fp_clear(bc[i]);
+        }
+
+        fp_clear(a);
+        fp_clear(b);
+        fp_clear(c);
+        CHECK(!fpchar_clear());
+    }
+
+    pprod_clear(&A);
+    pprod_clear(&B);
+    mpz_clears(p, x, y, z, r, NULL);
+    gmp_randclear(rs);
+}
+
+void test_inv() {
+    // Random primes around the multiples of 62 and 64 bits
+    int bitsizes[] = {5, 61, 62, 63, 64, 124, 128, 186, 738};
+    const int n_sizes = sizeof(bitsizes) / sizeof(int);
+    // MSIDH characteristics of 1000 to 3900 bits, as in benches/bench_fp.c
+    int msidh_params[][2] = {{120, 52}, {200, 18}, {300, 75}, {400, 229}};
+    const int n_msidh = sizeof(msidh_params) / sizeof(msidh_params[0]);
+    pprod_t A, B;
+    pprod_init(&A);
+    pprod_init(&B);
+
+    gmp_randstate_t rs;
+    gmp_randinit_mt(rs);
+    gmp_randseed_ui(rs, 0x1a7);
+
+    mpz_t p, x, z, r;
+    mpz_inits(p, x, z, r, NULL);
+
+    for (int k = 0; k < n_sizes + n_msidh; k++) {
+        if (k >= n_sizes) {
+            const int *tf = msidh_params[k - n_sizes];
+            CHECK(!msidh_calc_pub_params(p, A, B, tf[0], tf[1]));
+        } else {
+            do {
+                mpz_urandomb(p, rs, bitsizes[k] - 1);
+                mpz_setbit(p, bitsizes[k] - 1);
+                mpz_nextprime(p, p);
+            } while (mpz_fdiv_ui(p, 4) != 3 ||
+                     mpz_sizeinbase(p, 2) != (size_t)bitsizes[k]);
+        }
+        CHECK(!fpchar_setup(p));
+
+        fp_t a, b;
+        fp_init(a);
+        fp_init(b);
+        for (int i = 0; i < 40; i++) {
+            // Edge values 1, 2, p - 1 and p - 2 first
+            if (i < 2) {
+                mpz_set_ui(x, i + 1);
+            } else if (i < 4) {
+                mpz_sub_ui(x, p, i - 1);
+            } else {
+                do {
+                    mpz_urandomm(x, rs, p);
+                } while (!mpz_sgn(x));
+            }
+            fp_set_mpz(a, x);
+            fp_inv(b, a);
+            fp_get_mpz(r, b);
+            CHECK(mpz_invert(z, x, p));
+            CHECK(!mpz_cmp(r, z));
+
+            // In place
+            fp_inv(a, a);
+            CHECK(fp_equal(a, b));
+        }
+        fp_clear(a);
+        fp_clear(b);
+        CHECK(!fpchar_clear());
+    }
+
+    pprod_clear(&A);
+    pprod_clear(&B);
+    mpz_clears(p, x, z, r, NULL);
+    gmp_randclear(rs);
+}
+
+void test_acc() {
+    // Primes of exactly 64n bits leave no spare bit in the upper half
+    int bitsizes[] = {61, 64, 738, 768, 1728};
+    const int n_sizes = sizeof(bitsizes) / sizeof(int);
+
+    gmp_randstate_t rs;
+    gmp_randinit_mt(rs);
+    gmp_randseed_ui(rs, 0xacc);
+
+    mpz_t p, x[4], z, r;
+    mpz_inits(p, z, r, NULL);
+    for (int j = 0; j < 4; j++) {
+        mpz_init(x[j]);
+    }
+
+    for (int k = 0; k < n_sizes; k++) {
+        do {
+            mpz_urandomb(p, rs, bitsizes[k] - 1);
+            mpz_setbit(p, bitsizes[k] - 1);
+            mpz_nextprime(p, p);
+        } while (mpz_fdiv_ui(p, 4) != 3 ||
+                 mpz_sizeinbase(p, 2) != (size_t)bitsizes[k]);
+        CHECK(!fpchar_setup(p));
+
+        fp_t a[4], c;
+        fp_acc_t w0, w1;
+        for (int j = 0; j < 4; j++) {
+            fp_init(a[j]);
+        }
+        fp_init(c);
+        fp_acc_init(w0);
+        fp_acc_init(w1);
+
+        for (int i = 0; i < 100; i++) {
+            // p - 1 everywhere first, then 0 in the subtracted product
+            for (int j = 0; j < 4; j++) {
+                if (i == 0) {
+                    mpz_sub_ui(x[j], p, 1);
+                } else if (i == 1) {
+                    mpz_set_ui(x[j], j < 2);
+                } else {
+                    mpz_urandomm(x[j], rs, p);
+                }
+                fp_set_mpz(a[j], x[j]);
+            }
+
+            // 4 (x0 x1 - x2 x3) + x2 x2 - x0 x1
+            fp_mul_wide(w0, a[0], a[1]);
+            fp_mul_wide(w1, a[2], a[3]);
+            fp_acc_sub(w0, w0, w1);
+            fp_acc_add(w0, w0, w0);
+            fp_acc_add(w0, w0, w0);
+            fp_mul_wide(w1, a[2], a[2]);
+            fp_acc_add(w0, w0, w1);
+            fp_mul_wide(w1, a[0], a[1]);
+            fp_acc_sub(w0, w0, w1);
+            fp_acc_reduce(c, w0);
+
+            mpz_mul(z, x[0], x[1]);
+            mpz_mul_ui(z, z, 3);
+            mpz_mul(r, x[2], x[3]);
+            mpz_submul_ui(z, r, 4);
+            mpz_addmul(z, x[2], x[2]);
+            mpz_mod(z, z, p);
+            fp_get_mpz(r, c);
+            CHECK(!mpz_cmp(r, z));
+        }
+
+        for (int j = 0; j < 4; j++) {
+            fp_clear(a[j]);
+        }
+        fp_clear(c);
+        fp_acc_clear(w0);
+        fp_acc_clear(w1);
+        CHECK(!fpchar_clear());
+    }
+
+    for (int j = 0; j < 4; j++) {
+        mpz_clear(x[j]);
+    }
+    mpz_clears(p, z, r, NULL);
+    gmp_randclear(rs);
+}
+
+void test_gmp_alloc() {
+    struct gmp_alloc_stats st;
+
+    // Block of the cleared number is reused by the next one of the same class
+    mpz_t x, y;
+    mpz_init2(x, 1000);
+    mpz_clear(x);
+    gmp_alloc_reset_stats();
+    mpz_init2(y, 960);
+    gmp_alloc_get_stats(&st);
+    CHECK(st.n_alloc == 1 && st.n_realloc == 0 && st.n_sys == 0);
+
+    // Growing within the size class does not reallocate
+    mpz_realloc2(y, 1020);
+    gmp_alloc_get_stats(&st);
+    CHECK(st.n_realloc == 1 && st.n_sys == 0);
+    mpz_realloc2(y, 100000);
+    mpz_setbit(y, 99999);
+    gmp_alloc_get_stats(&st);
+    CHECK(st.n_sys == 1);
+
+    // Memory returned to the caller is a plain malloc block
+    char *str = mpz_get_str(NULL, 16, y);
+    CHECK(str[0] == '8');
+    free(str);
+    mpz_clear(y);
+
+    // Elements have space for the product once the characteristic is known
+    mpz_init(x);
+    mpz_ui_pow_ui(x, 2, 737);
+    mpz_nextprime(x, x);
+    while (mpz_fdiv_ui(x, 4) != 3) {
+        mpz_add_ui(x, x, 2);
+        mpz_nextprime(x, x);
+    }
+    CHECK(!fpchar_setup(x));
+    fp_t a, b, r;
+    fp_init(a);
+    fp_init(b);
+    fp_init(r);
+    fp_set_uint(a, 3);
+    fp_sub_uint(b, a, 5);
+
+    gmp_alloc_reset_stats();
+    for (int i = 0; i < 100; i++) {
+        fp_mul(r, a, b);
+        fp_mul(a, r, r);
+        fp_add(b, a, r);
+    }
+    gmp_alloc_get_stats(&st);
+    CHECK(st.n_realloc == 0 && st.n_sys == 0);
+
+    // Batch inversion borrows its temporaries from the arena, only the first
+    // call of the thread initializes them
+    fp_t v[4];
+    for (int i = 0; i < 4; i++) {
+        fp_init(v[i]);
+        fp_set_uint(v[i], i + 2);
+    }
+    fp_inv_batch(v, (const fp_t *)v, 4);
+    gmp_alloc_reset_stats();
+    fp_inv_batch(v, (const fp_t *)v, 4);
+    gmp_alloc_get_stats(&st);
+    CHECK(st.n_alloc == 0 && st.n_realloc == 0);
+    CHECK(fp_equal_uint(v[0], 2) && fp_equal_uint(v[3], 5));
+    for (int i = 0; i < 4; i++) {
+        fp_clear(v[i]);
+    }
+
+    fp_clear(a);
+    fp_clear(b);
+    fp_clear(r);
+    mpz_clear(x);
+    CHECK(!fpchar_clear());
+}
+
+void test_bytes() {
+    // Byte lengths 2, 8, 9 and the MSIDH characteristic of t = 100
+    int bitsizes[] = {9, 64, 65};
+    const int n_sizes = sizeof(bitsizes) / sizeof(int);
+    pprod_t A, B;
+    pprod_init(&A);
+    pprod_init(&B);
+
+    gmp_randstate_t rs;
+    gmp_randinit_mt(rs);
+    gmp_randseed_ui(rs, 0xb17e);
+
+    mpz_t p, x, r;
+    mpz_inits(p, x, r, NULL);
+
+    for (int k = 0; k <= n_sizes; k++) {
+        if (k == n_sizes) {
+            CHECK(!msidh_calc_pub_params(p, A, B, 100, 91));
+        } else {
+            do {
+                mpz_urandomb(p, rs, bitsizes[k] - 1);
+                mpz_setbit(p, bitsizes[k] - 1);
+                mpz_nextprime(p, p);
+            } while (mpz_fdiv_ui(p, 4) != 3 ||
+                     mpz_sizeinbase(p, 2) != (size_t)bitsizes[k]);
+        }
+        CHECK(!fpchar_setup(p));
+        const size_t n = fp_nbytes();
+        CHECK(n == (mpz_sizeinbase(p, 2) + 7) / 8);
+
+        unsigned char *buf = malloc(n);
+        fp_t a, b;
+        fp_init(a);
+        fp_init(b);
+        for (int i = 0; i < 20; i++) {
+            // Edge values 0 and p - 1 first
+            if (i == 0) {
+                mpz_set_ui(x, 0);
+            } else if (i == 1) {
+                mpz_sub_ui(x, p, 1);
+            } else {
+                mpz_urandomm(x, rs, p);
+            }
+            fp_set_mpz(a, x);
+            fp_to_bytes(buf, a);
+            CHECK(!fp_from_bytes(b, buf));
+            CHECK(fp_equal(a, b));
+
+            // Encoding is the little-endian integer
+            mpz_import(r, n, -1, 1, 0, 0, buf);
+            CHECK(!mpz_cmp(r, x));
+        }
+
+        // Integers p and 2^(8n) - 1 are rejected, the result is not changed
+        fp_set_uint(b, 7);
+        mpz_export(buf, NULL, -1, 1, 0, 0, p);
+        CHECK(fp_from_bytes(b, buf) == -1);
+        memset(buf, 0xff, n);
+        CHECK(fp_from_bytes(b, buf) == -1);
+        CHECK(fp_equal_uint(b, 7));
+
+        // Setters reduce: p + 5, -2 and the decimal string of 2p + 3
+        mpz_add_ui(x, p, 5);
+        fp_set_mpz(a, x);
+        CHECK(fp_equal_uint(a, 5));
+        mpz_set_si(x, -2);
+        fp_set_mpz(a, x);
+        fp_add_uint(a, a, 2);
+        CHECK(fp_is_zero(a));
+        mpz_mul_ui(x, p, 2);
+        mpz_add_ui(x, x, 3);
+        char *str = malloc(mpz_sizeinbase(x, 10) + 2);
+        mpz_get_str(str, 10, x);
+        CHECK(!fp_set_str(a, str));
+        CHECK(fp_equal_uint(a, 3));
+        free(str);
+        CHECK(fp_set_str(a, "0xz") == -1);
+
+        free(buf);
+        fp_clear(a);
+        fp_clear(b);
+        CHECK(!fpchar_clear());
+    }
+
+    pprod_clear(&A);
+    pprod_clear(&B);
+    mpz_clears(p, x, r, NULL);
+    gmp_randclear(rs);
+}
+
 int main() {
+    // Must precede every mpz allocation, remaining tests run with the pool
+    gmp_alloc_setup(GMP_ALLOC_POOL);
 
+    TEST_RUN(test_gmp_alloc());
     TEST_RUN(test_small_arithmetic());
     TEST_RUN(test_modulo_arithmetic());
+    TEST_RUN(test_sqrt_is_square());
+    TEST_RUN(test_mul_kernels());
+    TEST_RUN(test_inv());
+    TEST_RUN(test_acc());
+    TEST_RUN(test_bytes());
     TEST_RUNS_END;
 }
\ No newline at end of file
@@ -2,7 +2,9 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "arena.h"
 #include "fp2.h"
+#include "fp2_poly.h"
 #include "testing.h"
 
 void test_failed_once() {
@@ -31,13 +33,13 @@ void test_failed_once() {
 
         fp2_sq_unsafe(r, x);
         fp2_print(r, "x^2");
-        CHECK(!mpz_cmp_ui(r->a, 411));
-        CHECK(!mpz_cmp_ui(r->b, 110));
+        CHECK(fp_equal_uint(r->a, 411));
+        CHECK(fp_equal_uint(r->b, 110));
 
         fp2_sq_unsafe(r, y);
         fp2_print(r, "y^2");
-        CHECK(!mpz_cmp_ui(r->a, 286));
-        CHECK(!mpz_cmp_ui(r->b, 170));
+        CHECK(fp_equal_uint(r->a, 286));
+        CHECK(fp_equal_uint(r->b, 170));
 
         fp2_clear(&r);
     }
@@ -58,12 +60,12 @@ void test_basic_arithmetic() {
     // x = 27 + 59i
     fp_set_uint(x->a, 21);
     fp_set_uint(x->b, 59);
-    printf("x: %ld, %ldi\n", mpz_get_ui(x->a), mpz_get_ui(x->b));
+    printf("x: %ld, %ldi\n", fp_get_ui(x->a), fp_get_ui(x->b));
 
     // y = 47 + 25i
     fp_set_uint(y->a, 47);
     fp_set_uint(y->b, 25);
-    printf("y: %ld, %ldi\n", mpz_get_ui(y->a), mpz_get_ui(y->b));
+    printf("y: %ld, %ldi\n", fp_get_ui(y->a), fp_get_ui(y->b));
 
     fp2_t r;
     fp2_init(&r);
@@ -73,36 +75,36 @@ void test_basic_arithmetic() {
     // r = (68 + 84i)
     // r = 68 + 84i (mod 431)
     fp2_add(r, x, y);
-    printf("x + y: %ld, %ldi\n", mpz_get_ui(r->a), mpz_get_ui(r->b));
-    CHECK(!mpz_cmp_ui(r->a, 68));
-    CHECK(!mpz_cmp_ui(r->b, 84));
+    printf("x + y: %ld, %ldi\n", fp_get_ui(r->a), fp_get_ui(r->b));
+    CHECK(fp_equal_uint(r->a, 68));
+    CHECK(fp_equal_uint(r->b, 84));
 
     // r <- x - y
     // r = (27 + 59i) - (47 + 25i)
     // r = (-26 + 34i)
     // r = 405 + 34i (mod 431)
     fp2_sub(r, x, y);
-    printf("x - y: %ld, %ldi\n", mpz_get_ui(r->a), mpz_get_ui(r->b));
-    CHECK(!mpz_cmp_ui(r->a, 405));
-    CHECK(!mpz_cmp_ui(r->b, 34));
+    printf("x - y: %ld, %ldi\n", fp_get_ui(r->a), fp_get_ui(r->b));
+    CHECK(fp_equal_uint(r->a, 405));
+    CHECK(fp_equal_uint(r->b, 34));
 
     // r <- x * y
     // r = (27 + 59i) * (47 + 25i)
     // r = (-488 + 3298i)
     // r = 374 + 281i (mod 431)
     fp2_mul_unsafe(r, x, y);
-    printf("x * y: %ld, %ldi\n", mpz_get_ui(r->a), mpz_get_ui(r->b));
-    CHECK(!mpz_cmp_ui(r->a, 374));
-    CHECK(!mpz_cmp_ui(r->b, 281));
+    printf("x * y: %ld, %ldi\n", fp_get_ui(r->a), fp_get_ui(r->b));
+    CHECK(fp_equal_uint(r->a, 374));
+    CHECK(fp_equal_uint(r->b, 281));
 
     // r <- x^2
     // r = (27 + 59i) * (27 + 59i)
     // r = (-3040 + 2478)
     // r = 408 + 323i (mod 431)
     fp2_sq_unsafe(r, x);
-    printf("x ^ 2: %ld, %ldi\n", mpz_get_ui(r->a), mpz_get_ui(r->b));
-    CHECK(!mpz_cmp_ui(r->a, 408));
-    CHECK(!mpz_cmp_ui(r->b, 323));
+    printf("x ^ 2: %ld, %ldi\n", fp_get_ui(r->a), fp_get_ui(r->b));
+    CHECK(fp_equal_uint(r->a, 408));
+    CHECK(fp_equal_uint(r->b, 323));
 
     fp2_clear(&x);
     fp2_clear(&y);
@@ -130,27 +132,27 @@ void test_safe_unsafe_mul_sq() {
 
     fp2_mul_unsafe(r, x, x);
     fp2_print(r, "(unsafe) r := x * x");
-    CHECK(!mpz_cmp_ui(r->a, 408) && !mpz_cmp_ui(r->b, 323));
+    CHECK(fp_equal_uint(r->a, 408) && fp_equal_uint(r->b, 323));
 
     fp2_set(r, x);
     fp2_mul_safe(r, x);
     fp2_print(r, "(safe) r *= x");
-    CHECK(!mpz_cmp_ui(r->a, 408) && !mpz_cmp_ui(r->b, 323));
+    CHECK(fp_equal_uint(r->a, 408) && fp_equal_uint(r->b, 323));
 
     fp2_set(r, x);
     fp2_mul_safe(r, r);
     fp2_print(r, "(safe) r *= r");
-    CHECK(!mpz_cmp_ui(r->a, 408) && !mpz_cmp_ui(r->b, 323));
+    CHECK(fp_equal_uint(r->a, 408) && fp_equal_uint(r->b, 323));
 
     fp2_set(r, x);
     fp2_sq_unsafe(r, x);
     fp2_print(r, "(unsafe-sq) r := x^2");
-    CHECK(!mpz_cmp_ui(r->a, 408) && !mpz_cmp_ui(r->b, 323));
+    CHECK(fp_equal_uint(r->a, 408) && fp_equal_uint(r->b, 323));
 
     fp2_set(r, x);
     fp2_sq_safe(r);
     fp2_print(r, "(safe-sq) r ^= 2");
-    CHECK(!mpz_cmp_ui(r->a, 408) && !mpz_cmp_ui(r->b, 323));
+    CHECK(fp_equal_uint(r->a, 408) && fp_equal_uint(r->b, 323));
 
     // Make sure that unsafe is wrong when called wrong?
     // Currently mul contains CHECKion that prevents this check
@@ -181,12 +183,12 @@ void test_inv_div() {
         // r = ~x = 221 + 159i
         fp2_inv_unsafe(r, x);
         fp2_print(r, "~x");
-        CHECK(!mpz_cmp_ui(r->a, 221) && !mpz_cmp_ui(r->b, 159));
+        CHECK(fp_equal_uint(r->a, 221) && fp_equal_uint(r->b, 159));
 
         // r * x == 1
         fp2_mul_safe(r, x);
         fp2_print(r, "~x * x");
-        CHECK(!mpz_cmp_ui(r->a, 1) && !mpz_cmp_ui(r->b, 0));
+        CHECK(fp_equal_uint(r->a, 1) && fp_equal_uint(r->b, 0));
     }
 
     {
@@ -198,12 +200,12 @@ void test_inv_div() {
         // r = ~x = 221 + 159i
         fp2_inv_unsafe(r, x);
         fp2_print(r, "~x");
-        CHECK(!mpz_cmp_ui(r->a, 11) && !mpz_cmp_ui(r->b, 86));
+        CHECK(fp_equal_uint(r->a, 11) && fp_equal_uint(r->b, 86));
 
         // r * x == 1
         fp2_mul_safe(r, x);
         fp2_print(r, "~x * x");
-        CHECK(!mpz_cmp_ui(r->a, 1) && !mpz_cmp_ui(r->b, 0));
+        CHECK(fp_equal_uint(r->a, 1) && fp_equal_uint(r->b, 0));
     }
 
     fp2_clear(&x);
@@ -220,25 +222,25 @@ void test_set_str() {
 
     // Valid
     CHECK(0 == fp2_set_str(x, "416*i + 175"));
-    CHECK(!mpz_cmp_ui(x->a, 175) && !mpz_cmp_ui(x->b, 416));
+    CHECK(fp_equal_uint(x->a, 175) && fp_equal_uint(x->b, 416));
 
     CHECK(0 == fp2_set_str(x, "416 + 175 *i"));
-    CHECK(!mpz_cmp_ui(x->a, 416) && !mpz_cmp_ui(x->b, 175));
+    CHECK(fp_equal_uint(x->a, 416) && fp_equal_uint(x->b, 175));
 
     CHECK(0 == fp2_set_str(x, "0xff + 23 *i"));
-    CHECK(!mpz_cmp_ui(x->a, 255) && !mpz_cmp_ui(x->b, 23));
+    CHECK(fp_equal_uint(x->a, 255) && fp_equal_uint(x->b, 23));
 
     CHECK(0 == fp2_set_str(x, "0xff"));
-    CHECK(!mpz_cmp_ui(x->a, 255) && !mpz_cmp_ui(x->b, 0));
+    CHECK(fp_equal_uint(x->a, 255) && fp_equal_uint(x->b, 0));
 
     CHECK(0 == fp2_set_str(x, "0xff*i"));
-    CHECK(!mpz_cmp_ui(x->a, 0) && !mpz_cmp_ui(x->b, 255));
+    CHECK(fp_equal_uint(x->a, 0) && fp_equal_uint(x->b, 255));
 
     CHECK(0 == fp2_set_str(x, "420      *i"));
-    CHECK(!mpz_cmp_ui(x->a, 0) && !mpz_cmp_ui(x->b, 420));
+    CHECK(fp_equal_uint(x->a, 0) && fp_equal_uint(x->b, 420));
 
     CHECK(0 == fp2_set_str(x, "7+5*i"));
-    CHECK(!mpz_cmp_ui(x->a, 7) && !mpz_cmp_ui(x->b, 5));
+    CHECK(fp_equal_uint(x->a, 7) && fp_equal_uint(x->b, 5));
 
     // Invalid
     CHECK(0 != fp2_set_str(x, "i*420"));
@@ -287,17 +289,17 @@ void test_fp2_mul_int() {
     // [224i + 192] * 365 == 301*i + 258 (mod 431)
     fp2_mul_int(r, x, 365);
     fp2_print(r, "365x");
-    CHECK(!mpz_cmp_ui(r->a, 258) && !mpz_cmp_ui(r->b, 301));
+    CHECK(fp_equal_uint(r->a, 258) && fp_equal_uint(r->b, 301));
 
     // [224i + 192] * -5 == 173*i + 333 (mod 431)
     fp2_mul_int(r, x, -5);
     fp2_print(r, "-5x");
-    CHECK(!mpz_cmp_ui(r->a, 333) && !mpz_cmp_ui(r->b, 173));
+    CHECK(fp_equal_uint(r->a, 333) && fp_equal_uint(r->b, 173));
 
     // [145*i + 309] * 1234 == 145*i + 309  (mod 431)
     fp2_mul_int(r, x, 1234);
     fp2_print(r, "1234x");
-    CHECK(!mpz_cmp_ui(r->a, 309) && !mpz_cmp_ui(r->b, 145));
+    CHECK(fp_equal_uint(r->a, 309) && fp_equal_uint(r->b, 145));
 
     fp2_clear(&r);
     fp2_clear(&x);
@@ -387,6 +389,487 @@ void test_large_numbers() {
     fpchar_clear();
 }
 
+void test_mul_sq_random() {
+    mpz_t p, z;
+    mpz_init(p);
+    mpz_init(z);
+    mpz_set_str(
+        p, "14475d5aeccf245fce0e61716bd33537235ad8c4a76a401a4eb1a0fb9cb477dfb",
+        16);
+
+    fpchar_setup(p);
+
+    gmp_randstate_t rs;
+    gmp_randinit_mt(rs);
+    gmp_randseed_ui(rs, 0xdeadbeef);
+
+    fp2_t x, y, r, s;
+    fp2_init(&x);
+    fp2_init(&y);
+    fp2_init(&r);
+    fp2_init(&s);
+
+    fp_t t;
+    fp_init(t);
+
+    for (int i = 0; i < 100; i++) {
+        mpz_urandomm(z, rs, p);
+        fp_set_mpz(x->a, z);
+        mpz_urandomm(z, rs, p);
+        fp_set_mpz(x->b, z);
+        mpz_urandomm(z, rs, p);
+        fp_set_mpz(y->a, z);
+        mpz_urandomm(z, rs, p);
+        fp_set_mpz(y->b, z);
+
+        // Schoolbook reference: s = (ac - bd) + (ad + bc)i
+        fp_mul(s->a, x->a, y->a);
+        fp_mul(t, x->b, y->b);
+        fp_sub(s->a, s->a, t);
+        fp_mul(s->b, x->a, y->b);
+        fp_mul(t, x->b, y->a);
+        fp_add(s->b, s->b, t);
+
+        fp2_mul_unsafe(r, x, y);
+        CHECK(fp2_equal(r, s));
+
+        fp2_set(r, x);
+        fp2_mul_safe(r, y);
+        CHECK(fp2_equal(r, s));
+
+        // s = x^2
+        fp_mul(s->a, x->a, x->a);
+        fp_mul(t, x->b, x->b);
+        fp_sub(s->a, s->a, t);
+        fp_mul(s->b, x->a, x->b);
+        fp_add(s->b, s->b, s->b);
+
+        fp2_sq_unsafe(r, x);
+        CHECK(fp2_equal(r, s));
+
+        fp2_set(r, x);
+        fp2_sq_safe(r);
+        CHECK(fp2_equal(r, s));
+
+        fp2_set(r, x);
+        fp2_mul_safe(r, r);
+        CHECK(fp2_equal(r, s));
+    }
+
+    fp_clear(t);
+    fp2_clear(&x);
+    fp2_clear(&y);
+    fp2_clear(&r);
+    fp2_clear(&s);
+
+    gmp_randclear(rs);
+    mpz_clear(p);
+    mpz_clear(z);
+
+    fpchar_clear();
+}
+
+void test_inv_batch() {
+    mpz_t p, z;
+    mpz_init(p);
+    mpz_init(z);
+    mpz_set_str(
+        p, "14475d5aeccf245fce0e61716bd33537235ad8c4a76a401a4eb1a0fb9cb477dfb",
+        16);
+
+    CHECK(!fpchar_setup(p));
+
+    gmp_randstate_t rs;
+    gmp_randinit_mt(rs);
+    gmp_randseed_ui(rs, 0xbadc0ffe);
+
+    const size_t n = 17;
+    fp2_t x[17], r[17], s;
+    fp2_init(&s);
+    for (size_t i = 0; i < n; i++) {
+        fp2_init(&x[i]);
+        fp2_init(&r[i]);
+        mpz_urandomm(z, rs, p);
+        fp_set_mpz(x[i]->a, z);
+        mpz_urandomm(z, rs, p);
+        fp_set_mpz(x[i]->b, z);
+    }
+
+    // Out of place
+    fp2_inv_batch(r, (const fp2_t *)x, n);
+    for (size_t i = 0; i < n; i++) {
+        fp2_inv_unsafe(s, x[i]);
+        CHECK(fp2_equal(r[i], s));
+    }
+
+    // In place, then a single element
+    fp2_inv_batch(r, (const fp2_t *)r, n);
+    for (size_t i = 0; i < n; i++)
+        CHECK(fp2_equal(r[i], x[i]));
+    fp2_inv_batch(r, (const fp2_t *)r, 1);
+    fp2_inv_unsafe(s, x[0]);
+    CHECK(fp2_equal(r[0], s));
+
+    for (size_t i = 0; i < n; i++) {
+        fp2_clear(&x[i]);
+        fp2_clear(&r[i]);
+    }
+    fp2_clear(&s);
+
+    gmp_randclear(rs);
+    mpz_clear(p);
+    mpz_clear(z);
+
+    fpchar_clear();
+}
+
+void test_mul_batch() {
+    mpz_t p, z;
+    mpz_init(p);
+    mpz_init(z);
+    mpz_set_str(
+        p, "14475d5aeccf245fce0e61716bd33537235ad8c4a76a401a4eb1a0fb9cb477dfb",
+        16);
+
+    CHECK(!fpchar_setup(p));
+
+    gmp_randstate_t rs;
+    gmp_randinit_mt(rs);
+    gmp_randseed_ui(rs, 0xba7c4);
+
+    // Two full chunks and a partial one
+    const size_t n = 11;
+    fp2_t x[11], y[11], r[11], e[11];
+    struct fp2_scratch sb[FP2_MUL_BATCH], s;
+    fp2_scratch_init(&s);
+    for (int i = 0; i < FP2_MUL_BATCH; i++)
+        fp2_scratch_init(&sb[i]);
+    for (size_t i = 0; i < n; i++) {
+        fp2_init(&x[i]);
+        fp2_init(&y[i]);
+        fp2_init(&r[i]);
+        fp2_init(&e[i]);
+        mpz_urandomm(z, rs, p);
+        fp_set_mpz(x[i]->a, z);
+        mpz_urandomm(z, rs, p);
+        fp_set_mpz(x[i]->b, z);
+        mpz_urandomm(z, rs, p);
+        fp_set_mpz(y[i]->a, z);
+        mpz_urandomm(z, rs, p);
+        fp_set_mpz(y[i]->b, z);
+    }
+
+    // Out of place, the last one is a square
+    fp2_t ys[11];
+    for (size_t i = 0; i < n; i++)
+        ys[i] = i == n - 1 ? x[i] : y[i];
+    fp2_mul_batch(r, (const fp2_t *)x, (const fp2_t *)ys, n, sb);
+    for (size_t i = 0; i < n; i++) {
+        fp2_mul_unsafe_scr(e[i], x[i], ys[i], &s);
+        CHECK(fp2_equal(r[i], e[i]));
+    }
+
+    // In place: x[i] *= y[i]
+    fp2_mul_batch(x, (const fp2_t *)x, (const fp2_t *)ys, n, sb);
+    for (size_t i = 0; i < n; i++)
+        CHECK(fp2_equal(x[i], e[i]));
+
+    for (size_t i = 0; i < n; i++) {
+        fp2_clear(&x[i]);
+        fp2_clear(&y[i]);
+        fp2_clear(&r[i]);
+        fp2_clear(&e[i]);
+    }
+    for (int i = 0; i < FP2_MUL_BATCH; i++)
+        fp2_scratch_clear(&sb[i]);
+    fp2_scratch_clear(&s);
+
+    gmp_randclear(rs);
+    mpz_clear(p);
+    mpz_clear(z);
+
+    fpchar_clear();
+}
+
+void test_vec_kernels() {
+    mpz_t p, z;
+    mpz_init(p);
+    mpz_init(z);
+    mpz_set_str(
+        p, "14475d5aeccf245fce0e61716bd33537235ad8c4a76a401a4eb1a0fb9cb477dfb",
+        16);
+
+    CHECK(!fpchar_setup(p));
+
+    gmp_randstate_t rs;
+    gmp_randinit_mt(rs);
+    gmp_randseed_ui(rs, 0x5ec);
+
+    const size_t n = 9;
+    fp2_vec_t x, y, r, l;
+    fp2_vec_init(&x, n);
+    fp2_vec_init(&y, n);
+    fp2_vec_init(&r, n);
+    fp2_vec_init(&l, n);
+    for (size_t i = 0; i < n; i++) {
+        mpz_urandomm(z, rs, p);
+        fp_set_mpz(x[i].a, z);
+        mpz_urandomm(z, rs, p);
+        fp_set_mpz(x[i].b, z);
+        mpz_urandomm(z, rs, p);
+        fp_set_mpz(y[i].a, z);
+        mpz_urandomm(z, rs, p);
+        fp_set_mpz(y[i].b, z);
+    }
+
+    fp2_t e, t;
+    fp2_init(&e);
+    fp2_init(&t);
+    struct fp2_scratch sb[FP2_MUL_BATCH];
+    for (int i = 0; i < FP2_MUL_BATCH; i++)
+        fp2_scratch_init(&sb[i]);
+
+    fp2_vec_add(r, x, y, n);
+    for (size_t i = 0; i < n; i++) {
+        fp2_add(e, &x[i], &y[i]);
+        CHECK(fp2_equal(&r[i], e));
+    }
+    fp2_vec_sub(r, x, y, n);
+    for (size_t i = 0; i < n; i++) {
+        fp2_sub(e, &x[i], &y[i]);
+        CHECK(fp2_equal(&r[i], e));
+    }
+    fp2_vec_mul(r, x, y, n, sb);
+    for (size_t i = 0; i < n; i++) {
+        fp2_mul_unsafe(e, &x[i], &y[i]);
+        CHECK(fp2_equal(&r[i], e));
+    }
+
+    // z = y[0], w = y[1] shared by all elements
+    fp2_vec_criss_cross(l, r, x, x + 1, &y[0], &y[1], n - 1, sb);
+    for (size_t i = 0; i < n - 1; i++) {
+        fp2_mul_unsafe(e, &x[i], &y[1]);
+        fp2_mul_unsafe(t, &x[i + 1], &y[0]);
+        fp2_add(e, e, t);
+        CHECK(fp2_equal(&l[i], e));
+        fp2_sub(e, e, t);
+        fp2_sub(e, e, t);
+        CHECK(fp2_equal(&r[i], e));
+    }
+
+    // In place prefix products, then inverses of the products
+    fp2_vec_prefix_prod(r, x, n, sb);
+    fp2_set(e, &x[0]);
+    for (size_t i = 0; i < n; i++) {
+        if (i > 0)
+            fp2_mul_safe(e, &x[i]);
+        CHECK(fp2_equal(&r[i], e));
+    }
+    fp2_vec_prefix_prod(x, x, n, sb);
+    fp2_vec_inv(l, x, n);
+    for (size_t i = 0; i < n; i++) {
+        CHECK(fp2_equal(&x[i], &r[i]));
+        fp2_mul_unsafe(e, &x[i], &l[i]);
+        CHECK(fp2_equal_uint(e, 1));
+    }
+
+    for (int i = 0; i < FP2_MUL_BATCH; i++)
+        fp2_scratch_clear(&sb[i]);
+    fp2_clear(&e);
+    fp2_clear(&t);
+    fp2_vec_clear(&x, n);
+    fp2_vec_clear(&y, n);
+    fp2_vec_clear(&r, n);
+    fp2_vec_clear(&l, n);
+
+    gmp_randclear(rs);
+    mpz_clear(p);
+    mpz_clear(z);
+
+    fpchar_clear();
+}
+
+// Products, series inverses and the product tree against the schoolbook
+// formulas and Horner evaluation
+void test_poly() {
+    mpz_t p, z;
+    mpz_init(p);
+    mpz_init(z);
+    mpz_set_str(
+        p, "14475d5aeccf245fce0e61716bd33537235ad8c4a76a401a4eb1a0fb9cb477dfb",
+        16);
+
+    CHECK(!fpchar_setup(p));
+
+    gmp_randstate_t rs;
+    gmp_randinit_mt(rs);
+    gmp_randseed_ui(rs, 0x9017);
+
+    const size_t nf = 13, ng = 29, n = nf + ng - 1;
+    fp2_vec_t f, g, r, e;
+    fp2_vec_init(&f, nf);
+    fp2_vec_init(&g, ng);
+    fp2_vec_init(&r, n);
+    fp2_vec_init(&e, n);
+    for (size_t i = 0; i < nf + ng; i++) {
+        fp2_t x = i < nf ? &f[i] : &g[i - nf];
+        mpz_urandomm(z, rs, p);
+        fp_set_mpz(x->a, z);
+        mpz_urandomm(z, rs, p);
+        fp_set_mpz(x->b, z);
+    }
+
+    fp2_t t;
+    fp2_init(&t);
+
+    // Lengths cover the schoolbook, the balanced and unbalanced Karatsuba
+    const size_t lens[][2] = {{3, 5}, {8, 8}, {13, 13}, {13, 29}, {9, 20}};
+    for (size_t c = 0; c < sizeof(lens) / sizeof(lens[0]); c++) {
+        size_t a = lens[c][0], b = lens[c][1];
+        fp2_poly_mul(r, f, a, g, b);
+        for (size_t k = 0; k < a + b - 1; k++) {
+            fp2_set_uint(&e[k], 0);
+        }
+        for (size_t i = 0; i < a; i++) {
+            for (size_t j = 0; j < b; j++) {
+                fp2_mul_unsafe(t, &f[i], &g[j]);
+                fp2_add(&e[i + j], &e[i + j], t);
+            }
+        }
+        for (size_t k = 0; k < a + b - 1; k++) {
+            CHECK(fp2_equal(&r[k], &e[k]));
+        }
+    }
+
+    // f * f^-1 = 1 mod z^nf
+    fp2_set_uint(&f[0], 1);
+    fp2_poly_inv_series(r, f, nf, nf);
+    fp2_poly_mul(e, f, nf, r, nf);
+    CHECK(fp2_equal_uint(&e[0], 1));
+    for (size_t k = 1; k < nf; k++) {
+        CHECK(fp2_is_zero(&e[k]));
+    }
+
+    // Product of g(f[i]) for the roots f[0..nf)
+    struct fp2_poly_tree tree;
+    fp2_t res;
+    fp2_init(&res);
+    arena_frame_t frame = arena_push();
+    fp2_poly_tree_build(&tree, f, nf, ng);
+    fp2_poly_tree_prod_eval(res, &tree, g, ng);
+    arena_pop(frame);
+
+    fp2_t v, acc;
+    fp2_init(&v);
+    fp2_init(&acc);
+    fp2_set_uint(acc, 1);
+    for (size_t i = 0; i < nf; i++) {
+        fp2_set(v, &g[ng - 1]);
+        for (size_t k = ng - 1; k-- > 0;) {
+            fp2_mul_safe(v, &f[i]);
+            fp2_add(v, v, &g[k]);
+        }
+        fp2_mul_safe(acc, v);
+    }
+    CHECK(fp2_equal(res, acc));
+
+    fp2_clear(&v);
+    fp2_clear(&acc);
+    fp2_clear(&res);
+    fp2_clear(&t);
+    fp2_vec_clear(&f, nf);
+    fp2_vec_clear(&g, ng);
+    fp2_vec_clear(&r, n);
+    fp2_vec_clear(&e, n);
+
+    gmp_randclear(rs);
+    mpz_clear(p);
+    mpz_clear(z);
+
+    fpchar_clear();
+}
+
+void test_sqrt() {
+    // Small field, all elements are checked
+    CHECK(!fpchar_setup_uint(431));
+    {
+        fp2_t x, r;
+        fp2_init(&x);
+        fp2_init(&r);
+
+        // Half of nonzero elements and zero are squares
+        int n_squares = 0;
+        for (unsigned long int a = 0; a < 431; a++) {
+            for (unsigned long int b = 0; b < 431; b++) {
+                fp2_fill_uint(x, a, b);
+                int is_square = fp2_is_square(x);
+                n_squares += is_square;
+
+                fp2_fill_uint(r, 1, 1);
+                CHECK((fp2_sqrt(r, x) == 0) == is_square);
+                if (is_square) {
+                    fp2_sq_safe(r);
+                    CHECK(fp2_equal(r, x));
+                } else {
+                    // unchanged on failure
+                    CHECK(fp_equal_uint(r->a, 1) && fp_equal_uint(r->b, 1));
+                }
+            }
+        }
+        CHECK(n_squares == (431 * 431 - 1) / 2 + 1);
+
+        fp2_clear(&x);
+        fp2_clear(&r);
+    }
+    CHECK(!fpchar_clear());
+
+    // Large field, random squares with res = x
+    mpz_t p, z;
+    mpz_init(p);
+    mpz_init(z);
+    mpz_set_str(
+        p, "14475d5aeccf245fce0e61716bd33537235ad8c4a76a401a4eb1a0fb9cb477dfb",
+        16);
+    CHECK(!fpchar_setup(p));
+
+    gmp_randstate_t rs;
+    gmp_randinit_mt(rs);
+    gmp_randseed_ui(rs, 0x5eed);
+
+    fp2_t x, y, r;
+    fp2_init(&x);
+    fp2_init(&y);
+    fp2_init(&r);
+
+    for (int i = 0; i < 100; i++) {
+        mpz_urandomm(z, rs, p);
+        fp_set_mpz(x->a, z);
+        mpz_urandomm(z, rs, p);
+        fp_set_mpz(x->b, z);
+
+        // Random x is a square with probability 1/2
+        CHECK((fp2_sqrt(r, x) == 0) == fp2_is_square(x));
+
+        // y = x^2, r = sqrt(y) = +-x
+        fp2_sq_unsafe(y, x);
+        CHECK(fp2_is_square(y));
+        fp2_set(r, y);
+        CHECK(fp2_sqrt(r, r) == 0);
+        fp2_sq_safe(r);
+        CHECK(fp2_equal(r, y));
+    }
+
+    fp2_clear(&x);
+    fp2_clear(&y);
+    fp2_clear(&r);
+
+    gmp_randclear(rs);
+    mpz_clear(p);
+    mpz_clear(z);
+
+    fpchar_clear();
+}
+
 int main() {
     TEST_RUN(test_set_str());
     TEST_RUN_SILENT(test_write());
@@ -396,5 +879,11 @@ int main() {
     TEST_RUN(test_inv_div());
     TEST_RUN(test_fp2_mul_int());
     TEST_RUN(test_large_numbers());
+    TEST_RUN_SILENT(test_mul_sq_random());
+    TEST_RUN_SILENT(test_inv_batch());
+    TEST_RUN_SILENT(test_mul_batch());
+    TEST_RUN_SILENT(test_vec_kernels());
+    TEST_RUN_SILENT(test_poly());
+    TEST_RUN(test_sqrt());
     TEST_RUNS_END;
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 #include <gmp.h>
 #include <stdio.h>
 
+#include "arena.h"
+#include "ec_mont.h"
 #include "ec_point_xz.h"
 #include "fp.h"
 #include "fp2.h"
@@ -70,6 +72,28 @@ void set_params_testp139() {
     A24p_from_A(A24p, C24, A, C);
 }
 
+void set_params_testp1279() {
+    // p + 1 = 1280 = 2^8 * 5
+    fpchar_clear_if_set();
+    assert(0 == fpchar_setup_uint(1279));
+
+    fp2_set_uint(A, 6);
+    fp2_set_uint(C, 1);
+
+    A24p_from_A(A24p, C24, A, C);
+}
+
+void set_params_testp1168771() {
+    // p + 1 = 1168772 = 2^2 * 11 * 101 * 263
+    fpchar_clear_if_set();
+    assert(0 == fpchar_setup_uint(1168771));
+
+    fp2_set_uint(A, 6);
+    fp2_set_uint(C, 1);
+
+    A24p_from_A(A24p, C24, A, C);
+}
+
 void test_criss_cross_small() {
     fp2_t x, y, z, w, sum, diff;
     fp2_init(&x);
@@ -95,9 +119,9 @@ void test_criss_cross_small() {
     fp2_print(diff, "xw-yz");
 
     // ad+bc: 367*i + 314
-    CHECK(!mpz_cmp_ui(sum->a, 314) && !mpz_cmp_ui(sum->b, 367));
+    CHECK(fp_equal_uint(sum->a, 314) && fp_equal_uint(sum->b, 367));
     // ad-bc: 19*i + 425
-    CHECK(!mpz_cmp_ui(diff->a, 425) && !mpz_cmp_ui(diff->b, 19));
+    CHECK(fp_equal_uint(diff->a, 425) && fp_equal_uint(diff->b, 19));
 
     fp2_clear(&x);
     fp2_clear(&y);
@@ -124,29 +148,29 @@ void test_criss_cross_argsafe() {
     fp2_set_str(w, "183*i + 197");
 
     criss_cross(x, y, x, y, z, w);
-    CHECK(!mpz_cmp_ui(x->a, 314) && !mpz_cmp_ui(x->b, 367));
-    CHECK(!mpz_cmp_ui(y->a, 425) && !mpz_cmp_ui(y->b, 19));
+    CHECK(fp_equal_uint(x->a, 314) && fp_equal_uint(x->b, 367));
+    CHECK(fp_equal_uint(y->a, 425) && fp_equal_uint(y->b, 19));
 
     fp2_set_str(x, "416*i + 175");
     fp2_set_str(y, "112*i + 179");
 
     criss_cross(z, w, x, y, z, w);
-    CHECK(!mpz_cmp_ui(z->a, 314) && !mpz_cmp_ui(z->b, 367));
-    CHECK(!mpz_cmp_ui(w->a, 425) && !mpz_cmp_ui(w->b, 19));
+    CHECK(fp_equal_uint(z->a, 314) && fp_equal_uint(z->b, 367));
+    CHECK(fp_equal_uint(w->a, 425) && fp_equal_uint(w->b, 19));
 
     fp2_set_str(z, "235*i + 107");
     fp2_set_str(w, "183*i + 197");
 
     criss_cross(x, w, x, y, z, w);
-    CHECK(!mpz_cmp_ui(x->a, 314) && !mpz_cmp_ui(x->b, 367));
-    CHECK(!mpz_cmp_ui(w->a, 425) && !mpz_cmp_ui(w->b, 19));
+    CHECK(fp_equal_uint(x->a, 314) && fp_equal_uint(x->b, 367));
+    CHECK(fp_equal_uint(w->a, 425) && fp_equal_uint(w->b, 19));
 
     fp2_set_str(x, "416*i + 175");
     fp2_set_str(w, "183*i + 197");
 
     criss_cross(z, y, x, y, z, w);
-    CHECK(!mpz_cmp_ui(z->a, 314) && !mpz_cmp_ui(z->b, 367));
-    CHECK(!mpz_cmp_ui(y->a, 425) && !mpz_cmp_ui(y->b, 19));
+    CHECK(fp_equal_uint(z->a, 314) && fp_equal_uint(z->b, 367));
+    CHECK(fp_equal_uint(y->a, 425) && fp_equal_uint(y->b, 19));
 
     fp2_clear(&x);
     fp2_clear(&y);
@@ -173,19 +197,19 @@ void test_ISOG2e() {
 
     // Calculate codomain and push point P through the isogeny of degree 2^4
     // = 16.
-    ISOG2e(A24p_, C24_, A24p, C24, K, 4, push_points);
+    ISOG2e(A24p_, C24_, A24p, C24, K, 4, push_points, NULL);
 
     point_normalize_coords(P);
     fp2_print(P->X, "xφ(P)");
 
     // xphi(P) = 69*i + 48
-    CHECK(!mpz_cmp_ui(P->X->a, 48) && !mpz_cmp_ui(P->X->b, 69));
+    CHECK(fp_equal_uint(P->X->a, 48) && fp_equal_uint(P->X->b, 69));
 
     A_from_A24p(A_, C_, A24p_, C24_);
     fp2_div_unsafe(a_, A_, C_);
     fp2_print(a_, "aφ(E)");
     // aphi(E) = 201
-    CHECK(!mpz_cmp_ui(a_->a, 201) && !mpz_cmp_ui(a_->b, 0));
+    CHECK(fp_equal_uint(a_->a, 201) && fp_equal_uint(a_->b, 0));
 
     fp2_clear(&A24p_);
     fp2_clear(&C24_);
@@ -194,6 +218,47 @@ void test_ISOG2e() {
     fp2_clear(&C_);
 }
 
+/*
+ @brief 4-isogeny must be equal to the composition of two 2-isogenies
+*/
+void test_ISOG4() {
+    arena_frame_t frame = arena_push();
+    fp2_t A24p_ = arena_fp2(), C24_ = arena_fp2(), A24p_ref = arena_fp2(),
+          C24_ref = arena_fp2(), a = arena_fp2(), a_ref = arena_fp2();
+    fp2_vec_t coeff = arena_fp2_vec(4);
+    point_t T = arena_point(), R = arena_point(), P_ref = arena_point();
+
+    // K4 = [4]K is of order 4, does not lay above (0, 0)
+    point_set_str_x(K, "33*i + 429");
+    point_set_str_x(P, "158*i + 183");
+    point_t K4 = Q;
+    xDBLe(K4, K, A24p, C24, 2);
+
+    // Reference: kernel [2]K4, then the image of K4
+    point_set(P_ref, P);
+    xDBL(T, K4, A24p, C24);
+    xISOG2_unsafe(R, T, P_ref);
+    point_set(P_ref, R);
+    xISOG2_unsafe(R, T, K4);
+    aISOG2_24p(A24p_ref, C24_ref, T);
+    xISOG2_unsafe(T, R, P_ref);
+    point_set(P_ref, T);
+    aISOG2_24p(A24p_ref, C24_ref, R);
+
+    // Argument-safe for Q = P
+    aISOG4(A24p_, C24_, coeff, K4);
+    xISOG4(P, coeff, P);
+
+    fp2_div_unsafe(a, A24p_, C24_);
+    fp2_div_unsafe(a_ref, A24p_ref, C24_ref);
+    CHECK(fp2_equal(a, a_ref));
+    point_normalize_coords(P);
+    point_normalize_coords(P_ref);
+    CHECK(fp2_equal(P->X, P_ref->X));
+
+    arena_pop(frame);
+}
+
 // ---------------------
 // Testcases for p = 139
 // ---------------------
@@ -206,13 +271,17 @@ void test_KPS() {
     // we do not include last point [deg]K = E(0) which is point at inf.
     const size_t n = KPS_DEG2SIZE(deg);
 
+    struct point_vec kpts;
+    point_vec_init(&kpts, n);
+
+    KPS(&kpts, K, A24p, C24);
+
+    struct point_xz v[n];
     point_t kpt[n];
     for (size_t i = 0; i < n; i++) {
-        point_init(&kpt[i]);
+        kpt[i] = point_vec_at(&v[i], &kpts, i);
     }
 
-    KPS(kpt, n, K, A24p, C24);
-
     // Normalize the coordinates for each point
     for (size_t i = 0; i < n; i++) {
         CHECK(!fp2_is_zero(kpt[i]->Z) && "Ki->Z is zero");
@@ -221,15 +290,25 @@ void test_KPS() {
 
     // [ (j+1)*K for j in range(3) ] == [101*i + 20, 82*i + 16, 106*i + 124]
     fp2_print(kpt[0]->X, "xK1");
-    CHECK(!mpz_cmp_ui(kpt[0]->X->a, 20) && !mpz_cmp_ui(kpt[0]->X->b, 101));
+    CHECK(fp_equal_uint(kpt[0]->X->a, 20) && fp_equal_uint(kpt[0]->X->b, 101));
     fp2_print(kpt[1]->X, "xK2");
-    CHECK(!mpz_cmp_ui(kpt[1]->X->a, 16) && !mpz_cmp_ui(kpt[1]->X->b, 82));
+    CHECK(fp_equal_uint(kpt[1]->X->a, 16) && fp_equal_uint(kpt[1]->X->b, 82));
     fp2_print(kpt[2]->X, "xK3");
-    CHECK(!mpz_cmp_ui(kpt[2]->X->a, 124) && !mpz_cmp_ui(kpt[2]->X->b, 106));
-
-    for (size_t i = 0; i < n; i++) {
-        point_clear(&kpt[i]);
+    CHECK(fp_equal_uint(kpt[2]->X->a, 124) && fp_equal_uint(kpt[2]->X->b, 106));
+
+    point_vec_clear(&kpts);
+
+    // All of the multiples [1]K ... [deg - 1]K, compared with the ladder
+    point_vec_init(&kpts, deg - 1);
+    KPS(&kpts, K, A24p, C24);
+    for (size_t i = 0; i < kpts.n; i++) {
+        point_t Ki = point_vec_at(&v[0], &kpts, i);
+        xLADDER_int(Q, K, i + 1, A24p, C24);
+        point_normalize_coords(Ki);
+        point_normalize_coords(Q);
+        CHECK(fp2_equal(Ki->X, Q->X));
     }
+    point_vec_clear(&kpts);
 }
 
 void test_xISOG_and_aISOG() {
@@ -244,13 +323,13 @@ void test_xISOG_and_aISOG() {
     // isogeny of degree 5 for kernel <K>
     const int degree = 5;
     const size_t n = KPS_DEG2SIZE(degree);
-    point_t kpts[n];
-    for (size_t i = 0; i < n; i++)
-        point_init(&kpts[i]);
+    struct point_vec kpts;
+    point_vec_init(&kpts, n);
     printf("deg: %d\n", degree);
     printf("n: %lu\n", n);
 
-    KPS(kpts, n, K, A24p, C24);
+    KPS(&kpts, K, A24p, C24);
+    prepare_kernel_points(&kpts);
 
     fp2_t phiA, phiC, phi_a;
     fp2_init(&phiA);
@@ -258,29 +337,67 @@ void test_xISOG_and_aISOG() {
     fp2_init(&phi_a);
 
     // Check codomain Curve value
-    aISOG_curve_KPS(phiA, phiC, A24p, C24, kpts, n);
+    aISOG_curve_KPS(phiA, phiC, A24p, C24, &kpts);
+    A_from_A24p(phiA, phiC, phiA, phiC);
     fp2_div_unsafe(phi_a, phiA, phiC);
     fp2_print(phi_a, "aφ(K)");
-    CHECK(!mpz_cmp_ui(phi_a->a, 85) && !mpz_cmp_ui(phi_a->b, 76));
+    CHECK(fp_equal_uint(phi_a->a, 85) && fp_equal_uint(phi_a->b, 76));
 
     // Run the same computation, make sure the result is equal
     aISOG_curve(phiA, phiC, A24p, C24, K, degree);
     fp2_div_unsafe(phi_a, phiA, phiC);
-    CHECK(!mpz_cmp_ui(phi_a->a, 85) && !mpz_cmp_ui(phi_a->b, 76));
+    CHECK(fp_equal_uint(phi_a->a, 85) && fp_equal_uint(phi_a->b, 76));
 
     fp2_clear(&phiA);
     fp2_clear(&phiC);
     fp2_clear(&phi_a);
 
-    prepare_kernel_points(kpts, n);
-    xISOG_odd(Q, kpts, n, P);
+    xISOG_odd(Q, &kpts, P);
     point_normalize_coords(Q);
     fp2_print(Q->X, "xφ(P)");
 
-    CHECK(!mpz_cmp_ui(Q->X->a, 46) && !mpz_cmp_ui(Q->X->b, 88));
+    CHECK(fp_equal_uint(Q->X->a, 46) && fp_equal_uint(Q->X->b, 88));
+
+    point_vec_clear(&kpts);
+}
+
+void test_xISOG_odd_batch() {
+    point_set_str_x(K, "77*i + 38");
+
+    const int degree = 7;
+    const size_t n = KPS_DEG2SIZE(degree);
+    struct point_vec kpts;
+    point_vec_init(&kpts, n);
+    KPS(&kpts, K, A24p, C24);
+    prepare_kernel_points(&kpts);
+
+    // More points than a single batch of products
+    const char *xs[] = {"32*i + 42", "5*i + 17", "100*i + 3", "i + 1", "77",
+                        "12*i + 130"};
+    const size_t m = sizeof(xs) / sizeof(xs[0]);
+    point_t pts[m], imgs[m];
+    for (size_t j = 0; j < m; j++) {
+        point_init(&pts[j]);
+        point_init(&imgs[j]);
+        point_set_str_x(pts[j], xs[j]);
+    }
+
+    xISOG_odd_batch(imgs, &kpts, pts, m);
+    for (size_t j = 0; j < m; j++) {
+        xISOG_odd(Q, &kpts, pts[j]);
+        CHECK(fp2_equal(Q->X, imgs[j]->X) && fp2_equal(Q->Z, imgs[j]->Z));
+    }
 
-    for (size_t i = 0; i < n; i++)
-        point_clear(&kpts[i]);
+    // In place
+    xISOG_odd_batch(pts, &kpts, pts, m);
+    for (size_t j = 0; j < m; j++) {
+        CHECK(fp2_equal(pts[j]->X, imgs[j]->X) &&
+              fp2_equal(pts[j]->Z, imgs[j]->Z));
+        point_clear(&pts[j]);
+        point_clear(&imgs[j]);
+    }
+
+    point_vec_clear(&kpts);
 }
 
 // TODO: reform the test
@@ -301,13 +418,13 @@ void test_ISOG_chain_odd() {
     pprod_set_array(deg, primes, 2);
 
     point_t push_points[] = {NULL, NULL};
-    ISOG_chain(A_, C_, A24p, C24, K, deg, push_points);
+    ISOG_chain(A_, C_, A24p, C24, K, deg, push_points, NULL);
 
     // aφ(K): 102*i + 73
     A_from_A24p(A_, C_, A_, C_);
     fp2_div_unsafe(a_, A_, C_);
     fp2_print(a_, "aφ(K)");
-    CHECK(!mpz_cmp_ui(a_->a, 73) && !mpz_cmp_ui(a_->b, 102));
+    CHECK(fp_equal_uint(a_->a, 73) && fp_equal_uint(a_->b, 102));
 
     fp2_clear(&A_);
     fp2_clear(&C_);
@@ -333,27 +450,27 @@ void test_xISOG2_and_aISOG2() {
     aISOG2(A_, C_, K);
     fp2_div_unsafe(a_, A_, C_);
     fp2_print(a_, "aE2");
-    CHECK(!mpz_cmp_ui(a_->a, 73) && !mpz_cmp_ui(a_->b, 37));
+    CHECK(fp_equal_uint(a_->a, 73) && fp_equal_uint(a_->b, 37));
 
     // Calculate codomain of the 2-isogeny curve (in xDBL form)
     // a' = 44*i + 123
     aISOG2_24p(A_, C_, K);
     fp2_div_unsafe(a_, A_, C_);
     fp2_print(a_, "aE2(24p)");
-    CHECK(!mpz_cmp_ui(a_->a, 123) && !mpz_cmp_ui(a_->b, 44));
+    CHECK(fp_equal_uint(a_->a, 123) && fp_equal_uint(a_->b, 44));
 
     // Calculate the x-coordinate of the image of P under the 2-isogeny
     // xP' = 128*i
     xISOG2_unsafe(Q, K, P);
     point_normalize_coords(Q);
     point_printx(Q, "xφ(P)");
-    CHECK(!mpz_cmp_ui(Q->X->a, 0) && !mpz_cmp_ui(Q->X->b, 128));
+    CHECK(fp_equal_uint(Q->X->a, 0) && fp_equal_uint(Q->X->b, 128));
 
     // Calculate the x-coordinate using prepared Kernel
     prepare_isog2_kernel(K);
     xISOG2_prep(Q, K, P);
     point_normalize_coords(Q);
-    CHECK(!mpz_cmp_ui(Q->X->a, 0) && !mpz_cmp_ui(Q->X->b, 128));
+    CHECK(fp_equal_uint(Q->X->a, 0) && fp_equal_uint(Q->X->b, 128));
 
     fp2_clear(&A_);
     fp2_clear(&C_), fp2_clear(&a_);
@@ -383,7 +500,7 @@ void test_ISOG_chain() {
     point_t push_points[3] = {P, NULL, NULL};
 
     // Return in 24p form
-    ISOG_chain(A24p_, C24_, A24p, C24, K, deg, push_points);
+    ISOG_chain(A24p_, C24_, A24p, C24, K, deg, push_points, NULL);
 
     // Make sure that push_points is cleared in the end
     CHECK(push_points[1] == NULL && push_points[2] == NULL);
@@ -392,11 +509,11 @@ void test_ISOG_chain() {
     fp2_div_unsafe(a_, A_, C_);
 
     fp2_print(a_, "aφ(K)");
-    CHECK(!mpz_cmp_ui(a_->a, 0) && !mpz_cmp_ui(a_->b, 49));
+    CHECK(fp_equal_uint(a_->a, 0) && fp_equal_uint(a_->b, 49));
 
     point_normalize_coords(P);
     point_printx(P, "xφ(P)");
-    CHECK(!mpz_cmp_ui(P->X->a, 68) && !mpz_cmp_ui(P->X->b, 114));
+    CHECK(fp_equal_uint(P->X->a, 68) && fp_equal_uint(P->X->b, 114));
 
     fp2_clear(&A24p_);
     fp2_clear(&C24_);
@@ -428,7 +545,7 @@ void test_ISOG_chain_trivial() {
     point_t push_points[3] = {P, NULL, NULL};
 
     // K is a trivial point, should not modifiy curve coeffs nor push_points
-    ISOG_chain(E_A, E_C, A24p, C24, K, deg, push_points);
+    ISOG_chain(E_A, E_C, A24p, C24, K, deg, push_points, NULL);
 
     // Make sure that push_points is cleared in the end
     CHECK(push_points[1] == NULL && push_points[2] == NULL);
@@ -450,6 +567,427 @@ void test_ISOG_chain_trivial() {
     fp2_clear(&E_a); fp2_clear(&E_A); fp2_clear(&E_C);
 }
 
+/*
+ @brief Splits of the strategy must divide every range of the factors into two
+ nonempty parts
+*/
+void test_isog_chain_strategy() {
+    unsigned int primes[] = {4, 3, 5, 7, 11, 13, 4409, 17, 19, 23};
+    const size_t n = sizeof(primes) / sizeof(unsigned int);
+
+    uint16_t split[(n + 1) * (n + 1)];
+    isog_chain_strategy(split, primes, n);
+
+    for (size_t lo = 0; lo < n; lo++) {
+        CHECK(split[lo * (n + 1) + lo + 1] == lo + 1);
+        for (size_t hi = lo + 2; hi <= n; hi++) {
+            size_t m = split[lo * (n + 1) + hi];
+            CHECK(lo < m && m < hi);
+        }
+    }
+}
+
+/*
+ @brief Cost of the traversal of the factors [lo, hi) following the split
+ table, counted as ISOG_chain runs it: every multiplication of a kernel and
+ every push of the `depth` kernels kept on the stack at an isogeny step
+*/
+uint64_t strategy_tree_cost(const uint16_t *split, const unsigned int *primes,
+                            size_t n, size_t lo, size_t hi, uint64_t depth) {
+    if (hi - lo == 1) {
+        return depth * isog_strategy_eval_cost(primes[lo]);
+    }
+    size_t m = split[lo * (n + 1) + hi];
+    uint64_t c = 0;
+    for (size_t i = m; i < hi; i++) {
+        c += isog_strategy_mul_cost(primes[i]);
+    }
+    c += strategy_tree_cost(split, primes, n, lo, m, depth + 1);
+    return c + strategy_tree_cost(split, primes, n, m, hi, depth);
+}
+
+/*
+ @brief Minimal cost over all split tables of the chain of n <= 6 factors,
+ enumerated as a mixed-radix counter over the entries with hi - lo >= 2
+*/
+uint64_t strategy_brute_force(const unsigned int *primes, size_t n) {
+    uint16_t split[7 * 7] = {0};
+    size_t entries[7 * 7], n_entries = 0;
+    for (size_t lo = 0; lo < n; lo++) {
+        for (size_t hi = lo + 1; hi <= n; hi++) {
+            split[lo * (n + 1) + hi] = lo + 1;
+            if (hi - lo >= 2) {
+                entries[n_entries++] = lo * (n + 1) + hi;
+            }
+        }
+    }
+
+    uint64_t best = UINT64_MAX;
+    size_t j = 0;
+    while (j < n_entries || n_entries == 0) {
+        uint64_t c = strategy_tree_cost(split, primes, n, 0, n, 0);
+        best = c < best ? c : best;
+        if (n_entries == 0) {
+            break;
+        }
+        // Increment the counter, entry k = lo * (n + 1) + hi is in (lo, hi)
+        for (j = 0; j < n_entries; j++) {
+            size_t k = entries[j], lo = k / (n + 1), hi = k % (n + 1);
+            if (++split[k] < hi) {
+                break;
+            }
+            split[k] = lo + 1;
+        }
+    }
+    return best;
+}
+
+void test_isog_strategy_brute_force() {
+    unsigned int chains[][6] = {{4, 3, 5, 7, 11, 13},
+                                {3, 4409, 8, 5, 1201, 7},
+                                {2003, 3, 3, 3, 3, 16},
+                                {4, 4, 4, 4, 4, 4}};
+    uint16_t split[7 * 7];
+    for (size_t c = 0; c < sizeof(chains) / sizeof(chains[0]); c++) {
+        for (size_t n = 1; n <= 6; n++) {
+            isog_chain_strategy(split, chains[c], n);
+            CHECK(strategy_tree_cost(split, chains[c], n, 0, n, 0) ==
+                  strategy_brute_force(chains[c], n));
+        }
+    }
+
+    // Chain of 4-isogenies is the chain of the factors 4, with split[len]
+    // counted from the beginning of each part
+    uint16_t split2[7];
+    for (size_t n = 1; n <= 6; n++) {
+        isog2e_strategy(split2, n);
+        for (size_t lo = 0; lo < n; lo++) {
+            for (size_t hi = lo + 1; hi <= n; hi++) {
+                split[lo * (n + 1) + hi] = lo + split2[hi - lo];
+            }
+        }
+        CHECK(strategy_tree_cost(split, chains[3], n, 0, n, 0) ==
+              strategy_brute_force(chains[3], n));
+    }
+}
+
+/*
+ @brief √élu formulas must give the same codomain and image of P as KPS for
+ the kernel K of the given degree
+*/
+void check_velusqrt_matches_KPS(unsigned int degree) {
+    arena_frame_t frame = arena_push();
+    fp2_t A_ = arena_fp2(), C_ = arena_fp2(), A24p_ = arena_fp2(),
+          C24_ = arena_fp2(), t0 = arena_fp2(), t1 = arena_fp2();
+    point_t P_ref = arena_point(), P_sqrt = arena_point();
+
+    struct point_vec kpts;
+    arena_point_vec(&kpts, KPS_DEG2SIZE(degree));
+    KPS(&kpts, K, A24p, C24);
+    prepare_kernel_points(&kpts);
+    aISOG_curve_KPS(A_, C_, A24p, C24, &kpts);
+    point_set(P_ref, P);
+    xISOG_odd_batch(&P_ref, &kpts, &P_ref, 1);
+
+    struct kps_sqrt ks;
+    KPS_sqrt(&ks, K, A24p, C24, degree);
+    CHECK(2 * ks.b * ks.b_ + ks.n_rest == KPS_DEG2SIZE(degree));
+    aISOG_curve_sqrt(A24p_, C24_, &ks);
+    point_set(P_sqrt, P);
+    xISOG_sqrt_batch(&P_sqrt, &ks, &P_sqrt, 1);
+
+    // (A24p_ : C24_) = (A_ : C_)
+    fp2_mul_unsafe(t0, A24p_, C_);
+    fp2_mul_unsafe(t1, A_, C24_);
+    CHECK(fp2_equal(t0, t1));
+
+    point_normalize_coords(P_ref);
+    point_normalize_coords(P_sqrt);
+    CHECK(fp2_equal(P_ref->X, P_sqrt->X));
+
+    arena_pop(frame);
+}
+
+void test_velusqrt() {
+    // [7]K and [5]K of the point of order 35
+    point_set_str_x(Q, "108*i + 136");
+    point_set_str_x(P, "8*i + 137");
+    xLADDER_int(K, Q, 7, A24p, C24);
+    check_velusqrt_matches_KPS(5);
+    xLADDER_int(K, Q, 5, A24p, C24);
+    check_velusqrt_matches_KPS(7);
+}
+
+/*
+ @brief Find the point R on E: y^2 = x^3 + 6x^2 + x (not on the twist) of the
+ full order p + 1 = 1168772 = 2^2 * 11 * 101 * 263 with x = x0 + i for the
+ smallest x0 = 1, 2, ...
+*/
+static void full_order_point_p1168771(point_t R) {
+    const unsigned int order = 1168772, factors[] = {2, 11, 101, 263};
+    arena_frame_t frame = arena_push();
+    fp2_t t = arena_fp2(), rhs = arena_fp2();
+    point_t T = arena_point();
+
+    for (unsigned long int x = 1;; x++) {
+        fp2_fill_uint(R->X, x, 1);
+        fp2_set_uint(R->Z, 1);
+        // x^3 + 6x^2 + x = x((x + 6)x + 1)
+        fp2_add_uint(t, R->X, 6);
+        fp2_mul_unsafe(rhs, t, R->X);
+        fp2_add_uint(rhs, rhs, 1);
+        fp2_mul_safe(rhs, R->X);
+        if (!fp2_is_square(rhs)) {
+            continue;
+        }
+
+        int full = 1;
+        for (int i = 0; i < 4; i++) {
+            xLADDER_int(T, R, order / factors[i], A24p, C24);
+            full &= !fp2_is_zero(T->Z);
+        }
+        if (full) {
+            break;
+        }
+    }
+
+    arena_pop(frame);
+}
+
+void test_velusqrt_large() {
+    const unsigned int order = 1168772, degrees[] = {11, 101, 263};
+    point_set_str_x(P, "3*i + 5");
+
+    arena_frame_t frame = arena_push();
+    point_t R = arena_point();
+    full_order_point_p1168771(R);
+    for (int i = 0; i < 3; i++) {
+        xLADDER_int(K, R, order / degrees[i], A24p, C24);
+        check_velusqrt_matches_KPS(degrees[i]);
+    }
+    arena_pop(frame);
+}
+
+/*
+ @brief ISOG_chain with the √élu step for 263 must match the steps with KPS
+*/
+void test_ISOG_chain_velusqrt() {
+    unsigned int primes[] = {11, 101, 263};
+    pprod_t deg;
+    pprod_init(&deg);
+    pprod_set_array(deg, primes, 3);
+
+    arena_frame_t frame = arena_push();
+    fp2_t A24p_ = arena_fp2(), C24_ = arena_fp2(), A_ = arena_fp2(),
+          C_ = arena_fp2(), j0 = arena_fp2(), j1 = arena_fp2();
+    point_t R = arena_point(), K_odd = arena_point(), K0 = arena_point(),
+            T = arena_point(), P0 = arena_point(), P_ref = arena_point();
+
+    // Kernel of the odd part of the full order
+    full_order_point_p1168771(R);
+    xLADDER_int(K_odd, R, 4, A24p, C24);
+    point_set_str_x(P0, "3*i + 5");
+    point_set(P_ref, P0);
+    point_t push_points[] = {P0, NULL};
+    ISOG_chain(A24p_, C24_, A24p, C24, K_odd, deg, push_points, NULL);
+
+    // Reference: kernel of each step is the multiple of the pushed K0
+    fp2_set(A_, A24p);
+    fp2_set(C_, C24);
+    point_set(K0, K_odd);
+    point_t pts[] = {P_ref, K0};
+    for (int i = 0; i < 3; i++) {
+        point_set(T, K0);
+        for (int j = i + 1; j < 3; j++) {
+            xLADDER_int(R, T, primes[j], A_, C_);
+            point_set(T, R);
+        }
+        struct point_vec kpts;
+        arena_point_vec(&kpts, KPS_DEG2SIZE(primes[i]));
+        KPS(&kpts, T, A_, C_);
+        prepare_kernel_points(&kpts);
+        aISOG_curve_KPS(j0, j1, A_, C_, &kpts);
+        fp2_set(A_, j0);
+        fp2_set(C_, j1);
+        xISOG_odd_batch(pts, &kpts, pts, 2);
+    }
+    CHECK(fp2_is_zero(K0->Z));
+
+    j_invariant_A24p(j0, A24p_, C24_);
+    j_invariant_A24p(j1, A_, C_);
+    CHECK(fp2_equal(j0, j1));
+    point_normalize_coords(P0);
+    point_normalize_coords(P_ref);
+    CHECK(fp2_equal(P0->X, P_ref->X));
+
+    arena_pop(frame);
+    pprod_clear(&deg);
+}
+
+// 2^e-isogeny computed one 2-isogeny at a time, each kernel is obtained by
+// doubling the pushed K0
+static void isog2e_reference(fp2_t A24p_, fp2_t C24_, const point_t K,
+                             uint32_t e, point_t P_ref) {
+    arena_frame_t frame = arena_push();
+    point_t K0 = arena_point(), T = arena_point(), R = arena_point();
+    point_set(K0, K);
+    fp2_set(A24p_, A24p);
+    fp2_set(C24_, C24);
+    for (uint32_t i = 0; i < e; i++) {
+        xDBLe(T, K0, A24p_, C24_, e - i - 1);
+        xISOG2_unsafe(R, T, P_ref);
+        point_set(P_ref, R);
+        xISOG2_unsafe(R, T, K0);
+        point_set(K0, R);
+        aISOG2_24p(A24p_, C24_, T);
+    }
+    arena_pop(frame);
+}
+
+/*
+ @brief ISOG2e with the strategy of 4-isogenies must match the chain of
+ 2-isogenies for even and odd e, with and without the workspace
+*/
+void test_ISOG2e_strategy() {
+    arena_frame_t frame = arena_push();
+    fp2_t A24p_ = arena_fp2(), C24_ = arena_fp2(), A24p_ref = arena_fp2(),
+          C24_ref = arena_fp2(), a = arena_fp2(), a_ref = arena_fp2(),
+          t = arena_fp2(), rhs = arena_fp2();
+    point_t P_ref = arena_point(), K2 = arena_point();
+
+    // K = [5]Q of order 2^8, [2^7]K != (0, 0)
+    for (unsigned long int x = 1;; x++) {
+        fp2_fill_uint(Q->X, x, 1);
+        fp2_set_uint(Q->Z, 1);
+        fp2_add_uint(t, Q->X, 6);
+        fp2_mul_unsafe(rhs, t, Q->X);
+        fp2_add_uint(rhs, rhs, 1);
+        fp2_mul_safe(rhs, Q->X);
+        if (!fp2_is_square(rhs)) {
+            continue;
+        }
+        xLADDER_int(K, Q, 5, A24p, C24);
+        xDBLe(K2, K, A24p, C24, 7);
+        if (!fp2_is_zero(K2->X) && !fp2_is_zero(K2->Z)) {
+            break;
+        }
+    }
+
+    unsigned int factors[] = {256};
+    pprod_t deg;
+    pprod_init(&deg);
+    pprod_set_array(deg, factors, 1);
+    struct isog_workspace ws;
+    isog_workspace_init(&ws);
+    isog_workspace_reserve(&ws, deg, 1);
+    CHECK(ws.e2 == 8);
+
+    // e = 8 and e = 7 with the kernel [2]K
+    for (uint32_t e = 8; e >= 7; e--) {
+        point_set_str_x(P, "3*i + 5");
+        point_set(P_ref, P);
+        if (e == 7) {
+            xDBL(K, K, A24p, C24);
+        }
+        isog2e_reference(A24p_ref, C24_ref, K, e, P_ref);
+
+        for (int use_ws = 0; use_ws < 2; use_ws++) {
+            point_set_str_x(P, "3*i + 5");
+            point_t push_points[] = {P, NULL};
+            ISOG2e(A24p_, C24_, A24p, C24, K, e, push_points,
+                   use_ws ? &ws : NULL);
+            CHECK(push_points[1] == NULL);
+
+            fp2_div_unsafe(a, A24p_, C24_);
+            fp2_div_unsafe(a_ref, A24p_ref, C24_ref);
+            CHECK(fp2_equal(a, a_ref));
+            point_normalize_coords(P);
+            point_normalize_coords(P_ref);
+            CHECK(fp2_equal(P->X, P_ref->X));
+        }
+    }
+
+    isog_workspace_clear(&ws);
+    pprod_clear(&deg);
+    arena_pop(frame);
+}
+
+// Chain of deg with kernel K computed with the workspace must match the one
+// computed with the arena. K must have the order deg, [deg / l]K != O for
+// every factor l.
+static void check_chain_workspace(struct isog_workspace *ws, pprod_t deg,
+                                  const point_t K) {
+    arena_frame_t frame = arena_push();
+    fp2_t A24p_ = arena_fp2(), C24_ = arena_fp2(), A24p_ws = arena_fp2(),
+          C24_ws = arena_fp2();
+    point_t T = arena_point(), P_ref = arena_point(), P_ws = arena_point();
+
+    unsigned long int order = mpz_get_ui(deg->value);
+    for (unsigned int i = 0; i < deg->n_primes; i++) {
+        xLADDER_int(T, K, order / deg->primes[i], A24p, C24);
+        CHECK(!fp2_is_zero(T->Z));
+    }
+    xLADDER_int(T, K, order, A24p, C24);
+    CHECK(fp2_is_zero(T->Z));
+
+    point_set_str_x(P_ref, "3*i + 5");
+    point_set(P_ws, P_ref);
+    point_t push_ref[] = {P_ref, NULL}, push_ws[] = {P_ws, NULL};
+    ISOG_chain(A24p_, C24_, A24p, C24, K, deg, push_ref, NULL);
+    ISOG_chain(A24p_ws, C24_ws, A24p, C24, K, deg, push_ws, ws);
+    CHECK(push_ws[1] == NULL);
+
+    // Steps are the same, so are the projective coordinates
+    CHECK(fp2_equal(A24p_, A24p_ws) && fp2_equal(C24_, C24_ws));
+    CHECK(fp2_equal(P_ref->X, P_ws->X) && fp2_equal(P_ref->Z, P_ws->Z));
+
+    arena_pop(frame);
+}
+
+/*
+ @brief Workspace reserved once serves the chains of the divisors of its
+ degree, the strategy is recomputed when the factors change
+*/
+void test_ISOG_chain_workspace() {
+    unsigned int primes[] = {11, 101, 263}, sub[] = {11, 263};
+    pprod_t deg, deg_sub;
+    pprod_init(&deg);
+    pprod_init(&deg_sub);
+    pprod_set_array(deg, primes, 3);
+    pprod_set_array(deg_sub, sub, 2);
+
+    struct isog_workspace ws;
+    isog_workspace_init(&ws);
+    isog_workspace_reserve(&ws, deg, 1);
+    // Only 11 and 101 use KPS
+    CHECK(ws.kpts.n == KPS_DEG2SIZE(101));
+
+    // Kernels are the multiples of the point of the full order
+    arena_frame_t frame = arena_push();
+    point_t R = arena_point(), Ker = arena_point();
+    full_order_point_p1168771(R);
+    xLADDER_int(Ker, R, 4, A24p, C24);
+    check_chain_workspace(&ws, deg, Ker);
+    CHECK(ws.n == 3);
+
+    // Reserving the same degree again keeps the memory and the strategy
+    fp2_vec_t kpts_X = ws.kpts.X;
+    isog_workspace_reserve(&ws, deg, 1);
+    CHECK(ws.kpts.X == kpts_X && ws.n == 3);
+
+    xLADDER_int(Ker, R, 4 * 101, A24p, C24);
+    check_chain_workspace(&ws, deg_sub, Ker);
+    CHECK(ws.n == 2);
+
+    xLADDER_int(Ker, R, 4, A24p, C24);
+    check_chain_workspace(&ws, deg, Ker);
+
+    arena_pop(frame);
+    isog_workspace_clear(&ws);
+    pprod_clear(&deg);
+    pprod_clear(&deg_sub);
+}
+
 int main() {
     init_test_variables();
 
@@ -459,16 +997,33 @@ int main() {
     TEST_RUN_SILENT(test_criss_cross_argsafe());
     TEST_RUN(test_criss_cross_small());
     TEST_RUN(test_ISOG2e());
+    TEST_RUN_SILENT(test_ISOG4());
 
     // p = 139 tests
     set_params_testp139();
 
     TEST_RUN(test_KPS());
     TEST_RUN(test_xISOG_and_aISOG());
+    TEST_RUN_SILENT(test_xISOG_odd_batch());
     TEST_RUN(test_ISOG_chain_odd());
     TEST_RUN(test_xISOG2_and_aISOG2());
     TEST_RUN(test_ISOG_chain());
     TEST_RUN(test_ISOG_chain_trivial());
+    TEST_RUN_SILENT(test_isog_chain_strategy());
+    TEST_RUN_SILENT(test_isog_strategy_brute_force());
+    TEST_RUN_SILENT(test_velusqrt());
+
+    // p = 1279 tests
+    set_params_testp1279();
+
+    TEST_RUN_SILENT(test_ISOG2e_strategy());
+
+    // p = 1168771 tests
+    set_params_testp1168771();
+
+    TEST_RUN_SILENT(test_velusqrt_large());
+    TEST_RUN_SILENT(test_ISOG_chain_velusqrt());
+    TEST_RUN_SILENT(test_ISOG_chain_workspace());
 
     clear_test_variables();
 
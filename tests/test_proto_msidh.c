@@ -1,6 +1,8 @@
 #include <gmp.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "ec_mont.h"
 #include "fp.h"
@@ -17,6 +19,18 @@ pprod_t A_deg, B_deg;
 mpz_t p, m;
 int g_t, g_f;
 
+/*
+ * @brief Compare integer (not a field element) with the integer represented as
+ * str type. Return 1 if equal, 0 otherwise.
+ */
+int int_equal_str(const mpz_t a, const char *b_str) {
+    mpz_t b;
+    mpz_init_set_str(b, b_str, 0);
+    int equal = !mpz_cmp(a, b);
+    mpz_clear(b);
+    return equal;
+}
+
 void init_test_variables() {
     fp2_init(&A24p);
     fp2_init(&C24);
@@ -154,52 +168,52 @@ void test_msidh_gen_pub_params() {
     f = msidh_gen_pub_params(p, A_deg, B_deg, t);
     assert(f > 0);
     printf("t: %d\n", t);
-    fp_print(p, "p");
-    fp_print(A_deg->value, "A");
-    fp_print(B_deg->value, "B");
+    gmp_printf("p: %Zd\n", p);
+    gmp_printf("A: %Zd\n", A_deg->value);
+    gmp_printf("B: %Zd\n", B_deg->value);
     printf("f: %d\n", f);
 
     // (1115881660253397921934830779, 20312793853220, 54934917782199, 1)
-    CHECK(fp_equal_str(p, "419"));
-    CHECK(fp_equal_str(A_deg->value, "20"));
-    CHECK(fp_equal_str(B_deg->value, "21"));
+    CHECK(int_equal_str(p, "419"));
+    CHECK(int_equal_str(A_deg->value, "20"));
+    CHECK(int_equal_str(B_deg->value, "21"));
     CHECK(f == 1);
 
     t = 20;
     f = msidh_gen_pub_params(p, A_deg, B_deg, t);
     assert(f > 0);
     printf("t: %d\n", t);
-    fp_print(p, "p");
-    fp_print(A_deg->value, "A");
-    fp_print(B_deg->value, "B");
+    gmp_printf("p: %Zd\n", p);
+    gmp_printf("A: %Zd\n", A_deg->value);
+    gmp_printf("B: %Zd\n", B_deg->value);
     printf("f: %d\n", f);
 
     // (1115881660253397921934830779, 20312793853220, 54934917782199, 1)
-    CHECK(fp_equal_str(p, "1115881660253397921934830779"));
-    CHECK(fp_equal_str(A_deg->value, "20312793853220"));
-    CHECK(fp_equal_str(B_deg->value, "54934917782199"));
+    CHECK(int_equal_str(p, "1115881660253397921934830779"));
+    CHECK(int_equal_str(A_deg->value, "20312793853220"));
+    CHECK(int_equal_str(B_deg->value, "54934917782199"));
     CHECK(f == 1);
 
     t = 100;
     f = msidh_gen_pub_params(p, A_deg, B_deg, t);
     assert(f > 0);
     printf("t: %d\n", t);
-    fp_print(p, "p");
-    fp_print(A_deg->value, "A");
-    fp_print(B_deg->value, "B");
+    gmp_printf("p: %Zd\n", p);
+    gmp_printf("A: %Zd\n", A_deg->value);
+    gmp_printf("B: %Zd\n", B_deg->value);
     printf("f: %d\n", f);
 
-    CHECK(fp_equal_str(
+    CHECK(int_equal_str(
         p, "8575714055829256614755727859263673968077446087605609446743315408101"
            "8759112379622825936264472040913211898391694579544275450839721172773"
            "3337046938979806269649383591155750277998320880157855312245874492523"
            "686094863130587658379"));
     CHECK(
-        fp_equal_str(A_deg->value,
+        int_equal_str(A_deg->value,
                      "374801510478146654390916851616342588666386301694775232095"
                      "65100266538230879013060067601181882604603923651275420"));
     CHECK(
-        fp_equal_str(B_deg->value,
+        int_equal_str(B_deg->value,
                      "251436062458500732842543840100611612168366079689161565071"
                      "573990525611946403712566989284087642734230643996241279"));
     CHECK(f == 91);
@@ -208,24 +222,24 @@ void test_msidh_gen_pub_params() {
     f = msidh_gen_pub_params(p, A_deg, B_deg, t);
     assert(f > 0);
     printf("t: %d\n", t);
-    fp_print(p, "p");
-    fp_print(A_deg->value, "A");
-    fp_print(B_deg->value, "B");
+    gmp_printf("p: %Zd\n", p);
+    gmp_printf("A: %Zd\n", A_deg->value);
+    gmp_printf("B: %Zd\n", B_deg->value);
     printf("f: %d\n", f);
 
-    CHECK(fp_equal_str(
+    CHECK(int_equal_str(
         p, "0x76af20c40b3a9608503c0a977a5aa4b0166b507d7acae27c768f24e70445d8be4"
            "e8b28bc0d3e0cac0099671b40de4af52aeb44c481dfa10cd022053fced2df57c0ac"
            "ae54418987d9249919b738514f78cf1ea9fd8229b05e6084e53d5c603fdd373ab00"
            "bd558005996240cff9c20701a1b8a6da432ea20b2fc988d5889afb10d27bb55a19f"
            "39d71d3a7c45732d6bd265291103266d3b8909b4a1f1a0b1b17cab3c477aa428a5e"
            "e13fbf2d896e7b4e777"));
-    CHECK(fp_equal_str(
+    CHECK(int_equal_str(
         A_deg->value,
         "0x65cff008b4f1c2198f9588e205714bcf98a8d48a43a17950b50ef9348bb24543d426"
         "061ff7ac66d01171762b758a9db7cb8aa493cfe138ad8e8a6b74a2c1f38100b6a3ccaf"
         "116f6cb98817202d181d15521848734125df4"));
-    CHECK(fp_equal_str(
+    CHECK(int_equal_str(
         B_deg->value,
         "0x3a3a98e20a937f99bec60b3d3f9609b13c9c88cc6db1f40270e1e023752b58a25b4b"
         "b6722532c60ca32b3c66f62587003c5462a3dff7d6e0afd455e2e22c69d4167335e99b"
@@ -271,14 +285,14 @@ void test_msidh_secret_zero() {
     // P should not change
     // xP: 295*i + 398
     point_printx_normalized(P, "xK");
-    CHECK(!mpz_cmp_ui(P->X->a, 398) && !mpz_cmp_ui(P->X->b, 295));
+    CHECK(fp_equal_uint(P->X->a, 398) && fp_equal_uint(P->X->b, 295));
 
     xLADDER3PT_int(P, Q, PQd, 0, A24p, C24);
 
     // P should not change
     // xP: 295*i + 398
     point_printx_normalized(P, "xK");
-    CHECK(!mpz_cmp_ui(P->X->a, 398) && !mpz_cmp_ui(P->X->b, 295));
+    CHECK(fp_equal_uint(P->X->a, 398) && fp_equal_uint(P->X->b, 295));
 }
 
 void test_msidh_internals() {
@@ -347,36 +361,36 @@ void test_msidh_internals() {
     gmp_printf("b_mask: %Zd\n", b_mask);
 
     _msidh_gen_pubkey_alice(A24p_alice, C24_alice, &PQA, &PQB, A_deg, A24p, C24, a_sec,
-                            a_mask);
+                            a_mask, NULL, NULL);
 
     // aφ(E)(24p): 271*i + 111
     fp2_div_unsafe(aE_alice, A24p_alice, C24_alice);
     fp2_print(aE_alice, "aφ(E)(24p)");
-    CHECK(!mpz_cmp_ui(aE_alice->a, 111) && !mpz_cmp_ui(aE_alice->b, 271));
+    CHECK(fp_equal_uint(aE_alice->a, 111) && fp_equal_uint(aE_alice->b, 271));
 
     // xφ(PB): 363*i + 349
     point_printx_normalized(PB, "xφ(PB)");
-    CHECK(!mpz_cmp_ui(PQB.P->X->a, 349) && !mpz_cmp_ui(PB->X->b, 363));
+    CHECK(fp_equal_uint(PQB.P->X->a, 349) && fp_equal_uint(PB->X->b, 363));
 
     // xφ(QB): 303*i + 391
     point_printx_normalized(QB, "xφ(QB)");
-    CHECK(!mpz_cmp_ui(PQB.Q->X->a, 391) && !mpz_cmp_ui(QB->X->b, 303));
+    CHECK(fp_equal_uint(PQB.Q->X->a, 391) && fp_equal_uint(QB->X->b, 303));
 
     // xφ(PB-QB): 239*i + 90
     point_printx_normalized(PQBd, "xφ(PQBd)");
-    CHECK(!mpz_cmp_ui(PQBd->X->a, 90) && !mpz_cmp_ui(PQBd->X->b, 239));
+    CHECK(fp_equal_uint(PQBd->X->a, 90) && fp_equal_uint(PQBd->X->b, 239));
 
     _msidh_key_exchange_alice(j_inv, A24p_final, C24_final, A24p_alice,
-                              C24_alice, &PQB, B_deg, b_sec);
+                              C24_alice, &PQB, B_deg, b_sec, NULL);
     fp2_div_unsafe(aE_final, A24p_final, C24_final);
 
     // aτ(φ(E))(24p): 356*i + 219
     fp2_print(aE_final, "aτ(φ(E))(24p)");
-    CHECK(!mpz_cmp_ui(aE_final->a, 219) && !mpz_cmp_ui(aE_final->b, 356));
+    CHECK(fp_equal_uint(aE_final->a, 219) && fp_equal_uint(aE_final->b, 356));
 
     // jτ(φ(E)): 398*i + 166
     fp2_print(j_inv, "jτ(φ(E))");
-    CHECK(!mpz_cmp_ui(j_inv->a, 166) && !mpz_cmp_ui(j_inv->b, 398));
+    CHECK(fp_equal_uint(j_inv->a, 166) && fp_equal_uint(j_inv->b, 398));
 
     // 2. --- testcase sec = 13, mask = 8
     mpz_set_ui(a_sec, 13);
@@ -393,36 +407,36 @@ void test_msidh_internals() {
     tors_basis_get_subgroup(&PQB, B_deg->value, &PQ, A24p, C24);
 
     _msidh_gen_pubkey_alice(A24p_alice, C24_alice, &PQA, &PQB, A_deg, A24p, C24, a_sec,
-                            a_mask);
+                            a_mask, NULL, NULL);
 
     // aφ(E)(24p): 408*i + 332
     fp2_div_unsafe(aE_alice, A24p_alice, C24_alice);
     fp2_print(aE_alice, "aφ(E)(24p)");
-    CHECK(!mpz_cmp_ui(aE_alice->a, 332) && !mpz_cmp_ui(aE_alice->b, 408));
+    CHECK(fp_equal_uint(aE_alice->a, 332) && fp_equal_uint(aE_alice->b, 408));
 
     // xφ(PB): 192*i + 82
     point_printx_normalized(PQB.P, "xφ(PB)");
-    CHECK(!mpz_cmp_ui(PB->X->a, 82) && !mpz_cmp_ui(PB->X->b, 192));
+    CHECK(fp_equal_uint(PB->X->a, 82) && fp_equal_uint(PB->X->b, 192));
 
     // xφ(QB): 299*i + 211
     point_printx_normalized(PQB.Q, "xφ(QB)");
-    CHECK(!mpz_cmp_ui(QB->X->a, 211) && !mpz_cmp_ui(QB->X->b, 299));
+    CHECK(fp_equal_uint(QB->X->a, 211) && fp_equal_uint(QB->X->b, 299));
 
     // xφ(PQBd): 127*i + 181
     point_printx_normalized(PQBd, "xφ(PQBd)");
-    CHECK(!mpz_cmp_ui(PQBd->X->a, 181) && !mpz_cmp_ui(PQBd->X->b, 127));
+    CHECK(fp_equal_uint(PQBd->X->a, 181) && fp_equal_uint(PQBd->X->b, 127));
 
     _msidh_key_exchange_alice(j_inv, A24p_final, C24_final, A24p_alice,
-                              C24_alice, &PQB, B_deg, b_sec);
+                              C24_alice, &PQB, B_deg, b_sec, NULL);
     fp2_div_unsafe(aE_final, A24p_final, C24_final);
 
     // aτ(φ(E))(24p): 204*i + 395
     fp2_print(aE_final, "aτ(φ(E))(24p)");
-    CHECK(!mpz_cmp_ui(aE_final->a, 395) && !mpz_cmp_ui(aE_final->b, 204));
+    CHECK(fp_equal_uint(aE_final->a, 395) && fp_equal_uint(aE_final->b, 204));
 
     // jτ(φ(E)): 407
     fp2_print(j_inv, "jτ(φ(E))");
-    CHECK(!mpz_cmp_ui(j_inv->a, 407) && !mpz_cmp_ui(j_inv->b, 0));
+    CHECK(fp_equal_uint(j_inv->a, 407) && fp_equal_uint(j_inv->b, 0));
 
     // 3. --- Testcase sec = 3, mask = 13
     mpz_set_ui(a_sec, 3);
@@ -439,36 +453,36 @@ void test_msidh_internals() {
     tors_basis_get_subgroup(&PQB, B_deg->value, &PQ, A24p, C24);
 
     _msidh_gen_pubkey_alice(A24p_alice, C24_alice, &PQA, &PQB, A_deg, A24p, C24, a_sec,
-                            a_mask);
+                            a_mask, NULL, NULL);
 
     // aφ(E)(24p): 109*i + 386
     fp2_div_unsafe(aE_alice, A24p_alice, C24_alice);
     fp2_print(aE_alice, "aφ(E)(24p)");
-    CHECK(!mpz_cmp_ui(aE_alice->a, 386) && !mpz_cmp_ui(aE_alice->b, 109));
+    CHECK(fp_equal_uint(aE_alice->a, 386) && fp_equal_uint(aE_alice->b, 109));
 
     // xφ(PB): 298*i + 413
     point_printx_normalized(PQB.P, "xφ(PB)");
-    CHECK(!mpz_cmp_ui(PB->X->a, 413) && !mpz_cmp_ui(PB->X->b, 298));
+    CHECK(fp_equal_uint(PB->X->a, 413) && fp_equal_uint(PB->X->b, 298));
 
     // xφ(QB): 323*i + 222
     point_printx_normalized(PQB.Q, "xφ(QB)");
-    CHECK(!mpz_cmp_ui(QB->X->a, 222) && !mpz_cmp_ui(QB->X->b, 323));
+    CHECK(fp_equal_uint(QB->X->a, 222) && fp_equal_uint(QB->X->b, 323));
 
     // xφ(PQBd): 323*i + 66
     point_printx_normalized(PQBd, "xφ(PQBd)");
-    CHECK(!mpz_cmp_ui(PQBd->X->a, 66) && !mpz_cmp_ui(PQBd->X->b, 323));
+    CHECK(fp_equal_uint(PQBd->X->a, 66) && fp_equal_uint(PQBd->X->b, 323));
 
     _msidh_key_exchange_alice(j_inv, A24p_final, C24_final, A24p_alice,
-                              C24_alice, &PQB, B_deg, b_sec);
+                              C24_alice, &PQB, B_deg, b_sec, NULL);
     fp2_div_unsafe(aE_final, A24p_final, C24_final);
 
     // aτ(φ(E))(24p): 244*i + 279
     fp2_print(aE_final, "aτ(φ(E))(24p)");
-    CHECK(!mpz_cmp_ui(aE_final->a, 279) && !mpz_cmp_ui(aE_final->b, 244));
+    CHECK(fp_equal_uint(aE_final->a, 279) && fp_equal_uint(aE_final->b, 244));
 
     // jτ(φ(E)): 175*i + 351
     fp2_print(j_inv, "jτ(φ(E))");
-    CHECK(!mpz_cmp_ui(j_inv->a, 351) && !mpz_cmp_ui(j_inv->b, 175));
+    CHECK(fp_equal_uint(j_inv->a, 351) && fp_equal_uint(j_inv->b, 175));
 
     // 4. --- Testcase sec = 15, mask = 20
     mpz_set_ui(a_sec, 15);
@@ -485,36 +499,36 @@ void test_msidh_internals() {
     tors_basis_get_subgroup(&PQB, B_deg->value, &PQ, A24p, C24);
 
     _msidh_gen_pubkey_alice(A24p_alice, C24_alice, &PQA, &PQB, A_deg, A24p, C24, a_sec,
-                            a_mask);
+                            a_mask, NULL, NULL);
 
     // aφ(E)(24p): 16*i + 353
     fp2_div_unsafe(aE_alice, A24p_alice, C24_alice);
     fp2_print(aE_alice, "aφ(E)(24p)");
-    CHECK(!mpz_cmp_ui(aE_alice->a, 353) && !mpz_cmp_ui(aE_alice->b, 16));
+    CHECK(fp_equal_uint(aE_alice->a, 353) && fp_equal_uint(aE_alice->b, 16));
 
     // xφ(PB): 340
     point_printx_normalized(PQB.P, "xφ(PB)");
-    CHECK(!mpz_cmp_ui(PB->X->a, 340) && !mpz_cmp_ui(PB->X->b, 0));
+    CHECK(fp_equal_uint(PB->X->a, 340) && fp_equal_uint(PB->X->b, 0));
 
     // xφ(QB): 97*i + 356
     point_printx_normalized(PQB.Q, "xφ(QB)");
-    CHECK(!mpz_cmp_ui(QB->X->a, 356) && !mpz_cmp_ui(QB->X->b, 97));
+    CHECK(fp_equal_uint(QB->X->a, 356) && fp_equal_uint(QB->X->b, 97));
 
     // xφ(PQBd): 330*i + 244
     point_printx_normalized(PQBd, "xφ(PQBd)");
-    CHECK(!mpz_cmp_ui(PQBd->X->a, 244) && !mpz_cmp_ui(PQBd->X->b, 330));
+    CHECK(fp_equal_uint(PQBd->X->a, 244) && fp_equal_uint(PQBd->X->b, 330));
 
     _msidh_key_exchange_alice(j_inv, A24p_final, C24_final, A24p_alice,
-                              C24_alice, &PQB, B_deg, b_sec);
+                              C24_alice, &PQB, B_deg, b_sec, NULL);
     fp2_div_unsafe(aE_final, A24p_final, C24_final);
 
     // aτ(φ(E))(24p): 302
     fp2_print(aE_final, "aτ(φ(E))(24p)");
-    CHECK(!mpz_cmp_ui(aE_final->a, 302) && !mpz_cmp_ui(aE_final->b, 0));
+    CHECK(fp_equal_uint(aE_final->a, 302) && fp_equal_uint(aE_final->b, 0));
 
     // jτ(φ(E)): 98
     fp2_print(j_inv, "jτ(φ(E))");
-    CHECK(!mpz_cmp_ui(j_inv->a, 98) && !mpz_cmp_ui(j_inv->b, 0));
+    CHECK(fp_equal_uint(j_inv->a, 98) && fp_equal_uint(j_inv->b, 0));
 
     fp2_clear(&A24p_alice);
     fp2_clear(&C24_alice);
@@ -717,13 +731,13 @@ void test_msidh_internals_large() {
     mpz_set_str(a_mask, "131339333569636892083385", 10);
     mpz_set_str(b_sec, "72593563569111258510719", 10);
     mpz_set_str(b_mask, "17334875921447289106681", 10);
-    fp_print(a_sec, "A_sec");
-    fp_print(a_mask, "A_mask");
-    fp_print(b_sec, "B_sec");
-    fp_print(b_mask, "B_mask");
+    gmp_printf("A_sec: %Zd\n", a_sec);
+    gmp_printf("A_mask: %Zd\n", a_mask);
+    gmp_printf("B_sec: %Zd\n", b_sec);
+    gmp_printf("B_mask: %Zd\n", b_mask);
 
     _msidh_gen_pubkey_alice(A24p_alice, C24_alice, &PQA, &PQB, A_deg, A24p, C24, a_sec,
-                            a_mask);
+                            a_mask, NULL, NULL);
 
     // aφ(E)(24p)
     fp2_div_unsafe(aE_alice, A24p_alice, C24_alice);
@@ -751,7 +765,7 @@ void test_msidh_internals_large() {
                  "47299240837639061178684012620848485232866182686"));
 
     _msidh_key_exchange_alice(j_inv, A24p_final, C24_final, A24p_alice,
-                              C24_alice, &PQB, B_deg, b_sec);
+                              C24_alice, &PQB, B_deg, b_sec, NULL);
     fp2_div_unsafe(aE_final, A24p_final, C24_final);
 
     // aτ(φ(E))(24p)
@@ -775,13 +789,13 @@ void test_msidh_internals_large() {
     mpz_set_str(a_mask, "234614427428290727103469", 10);
     mpz_set_str(b_sec, "271374038831227351065368", 10);
     mpz_set_str(b_mask, "93531163257802324154959", 10);
-    fp_print(a_sec, "A_sec");
-    fp_print(a_mask, "A_mask");
-    fp_print(b_sec, "B_sec");
-    fp_print(b_mask, "B_mask");
+    gmp_printf("A_sec: %Zd\n", a_sec);
+    gmp_printf("A_mask: %Zd\n", a_mask);
+    gmp_printf("B_sec: %Zd\n", b_sec);
+    gmp_printf("B_mask: %Zd\n", b_mask);
 
     _msidh_gen_pubkey_alice(A24p_alice, C24_alice, &PQA, &PQB, A_deg, A24p, C24, a_sec,
-                            a_mask);
+                            a_mask, NULL, NULL);
 
     // aφ(E)(24p)
     fp2_div_unsafe(aE_alice, A24p_alice, C24_alice);
@@ -809,7 +823,7 @@ void test_msidh_internals_large() {
                  "11702887079976981107716609038554493137279265981"));
 
     _msidh_key_exchange_alice(j_inv, A24p_final, C24_final, A24p_alice,
-                              C24_alice, &PQB, B_deg, b_sec);
+                              C24_alice, &PQB, B_deg, b_sec, NULL);
     fp2_div_unsafe(aE_final, A24p_final, C24_final);
 
     // aτ(φ(E))(24p)
@@ -844,6 +858,181 @@ void test_msidh_internals_large() {
     mpz_clear(PQB.n);
 }
 
+struct handshake_job {
+    int t, n_iter;
+    const char *a_str, *xP_str, *xQ_str, *xR_str;
+    int n_failed;
+};
+
+// Run the full MSIDH handshake several times, using the thread-local
+// characteristic for parsing the params
+void *run_handshakes(void *arg) {
+    struct handshake_job *job = arg;
+
+    mpz_t p;
+    pprod_t A, B;
+    mpz_init(p);
+    pprod_init(&A);
+    pprod_init(&B);
+
+    struct msidh_data md, alice_pk, bob_pk;
+    msidh_data_init(&md);
+    msidh_data_init(&alice_pk);
+    msidh_data_init(&bob_pk);
+
+    md.t = job->t;
+    md.f = msidh_gen_pub_params(p, A, B, job->t);
+    fpchar_setup(p);
+    fp2_set_str(md.a, job->a_str);
+    fp2_set_str(md.xP, job->xP_str);
+    fp2_set_str(md.xQ, job->xQ_str);
+    fp2_set_str(md.xR, job->xR_str);
+
+    struct msidh_state alice, bob;
+    msidh_state_init(&alice);
+    msidh_state_init(&bob);
+
+    for (int iter = 0; iter < job->n_iter; iter++) {
+        // Sides are switched every two iterations, so the cached bases of
+        // the states are both reused and invalidated
+        int side = (iter / 2) & 1;
+        msidh_state_prepare(&alice, &md, side);
+        msidh_state_prepare(&bob, &md, !side);
+
+        msidh_get_pubkey(&alice, &alice_pk);
+        msidh_get_pubkey(&bob, &bob_pk);
+
+        msidh_key_exchange(&alice, &bob_pk);
+        msidh_key_exchange(&bob, &alice_pk);
+
+        // Encoded secrets are the same bytes for both sides
+        size_t n = msidh_shared_secret_size(&alice);
+        unsigned char ss_alice[n], ss_bob[n];
+        msidh_get_shared_secret(&alice, ss_alice);
+        msidh_get_shared_secret(&bob, ss_bob);
+
+        job->n_failed += !fp2_equal(alice.j_inv, bob.j_inv) ||
+                         n != msidh_shared_secret_size(&bob) ||
+                         memcmp(ss_alice, ss_bob, n) != 0;
+
+        msidh_state_reset(&alice);
+        msidh_state_reset(&bob);
+    }
+
+    msidh_state_clear(&alice);
+    msidh_state_clear(&bob);
+
+    msidh_data_clear(&md);
+    msidh_data_clear(&alice_pk);
+    msidh_data_clear(&bob_pk);
+
+    fpchar_clear();
+    mpz_clear(p);
+    pprod_clear(&A);
+    pprod_clear(&B);
+    return NULL;
+}
+
+void test_msidh_concurrent_characteristics() {
+    // Two handshakes with different characteristic running at the same time
+    struct handshake_job jobs[] = {
+        {.t = 4,
+         .n_iter = 50,
+         .a_str = "6",
+         .xP_str = "209*i + 332",
+         .xQ_str = "345*i + 223",
+         .xR_str = "98*i + 199"},
+        {.t = 30,
+         .n_iter = 5,
+         .a_str = "6",
+         .xP_str = "32381872305678490404833289490608450363172933700*i + "
+                   "38566570518230924614310417068523536638018699310",
+         .xQ_str = "29454235622145096109316297773070819902970029047*i + "
+                   "17242937661247998401353436361850378272505949076",
+         .xR_str = "29746668073241433805825980414131965658693152428*i + "
+                   "17760541352524573821929254886145960108078787218"},
+    };
+    const int n_jobs = sizeof(jobs) / sizeof(jobs[0]);
+
+    pthread_t threads[n_jobs];
+    for (int i = 0; i < n_jobs; i++) {
+        CHECK(!pthread_create(&threads[i], NULL, run_handshakes, &jobs[i]));
+    }
+
+    for (int i = 0; i < n_jobs; i++) {
+        pthread_join(threads[i], NULL);
+        CHECK_MSG(jobs[i].n_failed == 0, "Shared keys are not equal");
+    }
+}
+
+void test_msidh_data_pack() {
+    gmp_randstate_t rs;
+    gmp_randinit_mt(rs);
+    gmp_randseed_ui(rs, 0x9ac);
+
+    struct msidh_data md, md2;
+    msidh_data_init(&md);
+    msidh_data_init(&md2);
+    fp2_t *elems[] = {&md.a, &md.xP, &md.xQ, &md.xR};
+
+    mpz_t x, y;
+    mpz_inits(x, y, NULL);
+    for (int i = 0; i < 4; i++) {
+        mpz_urandomm(x, rs, p);
+        mpz_urandomm(y, rs, p);
+        fp_set_mpz((*elems[i])->a, x);
+        fp_set_mpz((*elems[i])->b, y);
+    }
+    md.t = g_t;
+    md.f = g_f;
+
+    const size_t size = msidh_data_packed_size();
+    CHECK(size == 8 + 8 * ((mpz_sizeinbase(p, 2) + 7) / 8));
+    unsigned char *buf = malloc(size);
+    msidh_data_pack(buf, &md);
+    CHECK(!msidh_data_unpack(&md2, buf));
+    CHECK(md2.t == g_t && md2.f == g_f);
+    CHECK(fp2_equal(md.a, md2.a) && fp2_equal(md.xP, md2.xP));
+    CHECK(fp2_equal(md.xQ, md2.xQ) && fp2_equal(md.xR, md2.xR));
+
+    // Points are encoded by the normalized x-coordinate
+    point_t R, S;
+    point_init(&R);
+    point_init(&S);
+    fp2_set(R->X, md.xP);
+    fp2_set(R->Z, md.xQ);
+    CHECK(!point_to_bytes(buf, R));
+    CHECK(!point_from_bytes(S, buf));
+    CHECK(point_is_normalized(S) && fp2_equal(R->X, S->X));
+    fp2_set_uint(R->Z, 0);
+    CHECK(point_to_bytes(buf, R) == -1);
+    point_clear(&R);
+    point_clear(&S);
+
+    // Parameter t out of the range, f zero and unreduced xR are rejected
+    const size_t n = fp2_nbytes();
+    msidh_data_pack(buf, &md);
+    buf[0] = MSIDH_TMIN - 1;
+    CHECK(msidh_data_unpack(&md2, buf) == -1);
+    md.t = MSIDH_TMAX;
+    msidh_data_pack(buf, &md);
+    CHECK(msidh_data_unpack(&md2, buf) == -1);
+    md.t = g_t;
+    md.f = 0;
+    msidh_data_pack(buf, &md);
+    CHECK(msidh_data_unpack(&md2, buf) == -1);
+    md.f = g_f;
+    msidh_data_pack(buf, &md);
+    memset(buf + 8 + 3 * n, 0xff, n / 2);
+    CHECK(msidh_data_unpack(&md2, buf) == -1);
+
+    free(buf);
+    mpz_clears(x, y, NULL);
+    msidh_data_clear(&md);
+    msidh_data_clear(&md2);
+    gmp_randclear(rs);
+}
+
 int main() {
     init_test_variables();
 
@@ -867,6 +1056,10 @@ int main() {
     setup_params_t30();
 
     TEST_RUN(test_msidh_internals_large());
+    TEST_RUN_SILENT(test_msidh_data_pack());
+
+    // Each thread sets its own characteristic
+    TEST_RUN_SILENT(test_msidh_concurrent_characteristics());
 
     clear_test_variables();
 
@@ -1,5 +1,7 @@
 #include <gmp.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "ec_point_xz.h"
 #include "ec_tors_basis.h"
@@ -17,6 +19,18 @@ pprod_t A_deg, B_deg;
 mpz_t p, g_m;
 int g_t, g_f;
 
+/*
+ * @brief Compare integer (not a field element) with the integer represented as
+ * str type. Return 1 if equal, 0 otherwise.
+ */
+int int_equal_str(const mpz_t a, const char *b_str) {
+    mpz_t b;
+    mpz_init_set_str(b, b_str, 0);
+    int equal = !mpz_cmp(a, b);
+    mpz_clear(b);
+    return equal;
+}
+
 void init_test_variables() {
     fp2_init(&A24p);
     fp2_init(&C24);
@@ -65,52 +79,52 @@ void test_tersidh_gen_pub_params() {
     f = tersidh_gen_pub_params(p, A_deg, B_deg, t);
     assert(f > 0);
     printf("t: %d\n", t);
-    fp_print(p, "p");
-    fp_print(A_deg->value, "A");
-    fp_print(B_deg->value, "B");
+    gmp_printf("p: %Zd\n", p);
+    gmp_printf("A: %Zd\n", A_deg->value);
+    gmp_printf("B: %Zd\n", B_deg->value);
     printf("f: %d\n", f);
 
     // (1115881660253397921934830779, 20312793853220, 54934917782199, 1)
-    CHECK(fp_equal_str(p, "419"));
-    CHECK(fp_equal_str(A_deg->value, "20"));
-    CHECK(fp_equal_str(B_deg->value, "21"));
+    CHECK(int_equal_str(p, "419"));
+    CHECK(int_equal_str(A_deg->value, "20"));
+    CHECK(int_equal_str(B_deg->value, "21"));
     CHECK(f == 1);
 
     t = 10;
     f = tersidh_gen_pub_params(p, A_deg, B_deg, t);
     assert(f > 0);
     printf("t: %d\n", t);
-    fp_print(p, "p");
-    fp_print(A_deg->value, "A");
-    fp_print(B_deg->value, "B");
+    gmp_printf("p: %Zd\n", p);
+    gmp_printf("A: %Zd\n", A_deg->value);
+    gmp_printf("B: %Zd\n", B_deg->value);
     printf("f: %d\n", f);
 
     // (1115881660253397921934830779, 20312793853220, 54934917782199, 1)
-    CHECK(fp_equal_str(p, "1115881660253397921934830779"));
-    CHECK(fp_equal_str(A_deg->value, "20312793853220"));
-    CHECK(fp_equal_str(B_deg->value, "54934917782199"));
+    CHECK(int_equal_str(p, "1115881660253397921934830779"));
+    CHECK(int_equal_str(A_deg->value, "20312793853220"));
+    CHECK(int_equal_str(B_deg->value, "54934917782199"));
     CHECK(f == 1);
 
     t = 50;
     f = tersidh_gen_pub_params(p, A_deg, B_deg, t);
     assert(f > 0);
     printf("t: %d\n", t);
-    fp_print(p, "p");
-    fp_print(A_deg->value, "A");
-    fp_print(B_deg->value, "B");
+    gmp_printf("p: %Zd\n", p);
+    gmp_printf("A: %Zd\n", A_deg->value);
+    gmp_printf("B: %Zd\n", B_deg->value);
     printf("f: %d\n", f);
 
-    CHECK(fp_equal_str(
+    CHECK(int_equal_str(
         p, "8575714055829256614755727859263673968077446087605609446743315408101"
            "8759112379622825936264472040913211898391694579544275450839721172773"
            "3337046938979806269649383591155750277998320880157855312245874492523"
            "686094863130587658379"));
     CHECK(
-        fp_equal_str(A_deg->value,
+        int_equal_str(A_deg->value,
                      "374801510478146654390916851616342588666386301694775232095"
                      "65100266538230879013060067601181882604603923651275420"));
     CHECK(
-        fp_equal_str(B_deg->value,
+        int_equal_str(B_deg->value,
                      "251436062458500732842543840100611612168366079689161565071"
                      "573990525611946403712566989284087642734230643996241279"));
     CHECK(f == 91);
@@ -119,24 +133,24 @@ void test_tersidh_gen_pub_params() {
     f = tersidh_gen_pub_params(p, A_deg, B_deg, t);
     assert(f > 0);
     printf("t: %d\n", t);
-    fp_print(p, "p");
-    fp_print(A_deg->value, "A");
-    fp_print(B_deg->value, "B");
+    gmp_printf("p: %Zd\n", p);
+    gmp_printf("A: %Zd\n", A_deg->value);
+    gmp_printf("B: %Zd\n", B_deg->value);
     printf("f: %d\n", f);
 
-    CHECK(fp_equal_str(
+    CHECK(int_equal_str(
         p, "0x76af20c40b3a9608503c0a977a5aa4b0166b507d7acae27c768f24e70445d8be4"
            "e8b28bc0d3e0cac0099671b40de4af52aeb44c481dfa10cd022053fced2df57c0ac"
            "ae54418987d9249919b738514f78cf1ea9fd8229b05e6084e53d5c603fdd373ab00"
            "bd558005996240cff9c20701a1b8a6da432ea20b2fc988d5889afb10d27bb55a19f"
            "39d71d3a7c45732d6bd265291103266d3b8909b4a1f1a0b1b17cab3c477aa428a5e"
            "e13fbf2d896e7b4e777"));
-    CHECK(fp_equal_str(
+    CHECK(int_equal_str(
         A_deg->value,
         "0x65cff008b4f1c2198f9588e205714bcf98a8d48a43a17950b50ef9348bb24543d426"
         "061ff7ac66d01171762b758a9db7cb8aa493cfe138ad8e8a6b74a2c1f38100b6a3ccaf"
         "116f6cb98817202d181d15521848734125df4"));
-    CHECK(fp_equal_str(
+    CHECK(int_equal_str(
         B_deg->value,
         "0x3a3a98e20a937f99bec60b3d3f9609b13c9c88cc6db1f40270e1e023752b58a25b4b"
         "b6722532c60ca32b3c66f62587003c5462a3dff7d6e0afd455e2e22c69d4167335e99b"
@@ -210,10 +224,10 @@ void test_tersidh_generate_kernel_points() {
 
     // 1. s: 0 = '00' -> only KQ gets reduced
     mpz_set_ui(tersidh.secret, 0);
-    fp_print(tersidh.secret, "s");
+    gmp_printf("s: %Zd\n", tersidh.secret);
 
     // KP = PA, KQ = E(0)
-    tersidh_generate_kernel_points(&tersidh, 1);
+    tersidh_generate_kernel_points(&tersidh, 1, NULL, NULL);
     point_printx_normalized(tersidh.KP, "xKP");
     CHECK(point_equal_str_x(tersidh.KP, "153*i + 357"));
     fp2_print(tersidh.KQ->Z, "ZKQ");
@@ -221,10 +235,10 @@ void test_tersidh_generate_kernel_points() {
 
     // 2. s: 4 = '11' -> only KP gets reduced
     mpz_set_ui(tersidh.secret, 4);
-    fp_print(tersidh.secret, "s");
+    gmp_printf("s: %Zd\n", tersidh.secret);
 
     // KP = E(0), KQ = QA
-    tersidh_generate_kernel_points(&tersidh, 1);
+    tersidh_generate_kernel_points(&tersidh, 1, NULL, NULL);
     fp2_print(tersidh.KP->Z, "ZKP");
     CHECK(fp2_equal_uint(tersidh.KP->Z, 0));
     point_printx_normalized(tersidh.KQ, "xKQ");
@@ -232,10 +246,10 @@ void test_tersidh_generate_kernel_points() {
 
     // 3. s: 8 = '22' -> both get reduced to neutral element
     mpz_set_ui(tersidh.secret, 8);
-    fp_print(tersidh.secret, "s");
+    gmp_printf("s: %Zd\n", tersidh.secret);
 
     // Both points get reduced to E(0)
-    tersidh_generate_kernel_points(&tersidh, 1);
+    tersidh_generate_kernel_points(&tersidh, 1, NULL, NULL);
     fp2_print(tersidh.KP->Z, "ZKP");
     CHECK(fp2_equal_uint(tersidh.KP->Z, 0));
     fp2_print(tersidh.KQ->Z, "ZKQ");
@@ -243,9 +257,9 @@ void test_tersidh_generate_kernel_points() {
 
     // 4. s: 3 = '10' -> KP = [4]PA, KQ = [5]QA 
     mpz_set_ui(tersidh.secret, 3);
-    fp_print(tersidh.secret, "s");
+    gmp_printf("s: %Zd\n", tersidh.secret);
 
-    tersidh_generate_kernel_points(&tersidh, 1);
+    tersidh_generate_kernel_points(&tersidh, 1, NULL, NULL);
     point_printx_normalized(tersidh.KP, "xKP");
     CHECK(point_equal_str_x(tersidh.KP, "70*i + 249"));
     point_printx_normalized(tersidh.KQ, "xKQ");
@@ -253,9 +267,9 @@ void test_tersidh_generate_kernel_points() {
     
     // 5. s: 5 = '12' 
     mpz_set_ui(tersidh.secret, 5);
-    fp_print(tersidh.secret, "s");
+    gmp_printf("s: %Zd\n", tersidh.secret);
 
-    tersidh_generate_kernel_points(&tersidh, 1);
+    tersidh_generate_kernel_points(&tersidh, 1, NULL, NULL);
     fp2_print(tersidh.KP->Z, "ZKP");
     CHECK(fp2_equal_uint(tersidh.KP->Z, 0));
     point_printx_normalized(tersidh.KQ, "xKQ");
@@ -404,6 +418,21 @@ void test_tersidh_key_exchange() {
     CHECK(fp2_equal(alice.j_inv, bob.j_inv));
     CHECK(fp2_equal_str(alice.j_inv, "16477822473601326380854754948643703255616912674*i + 12600493404726659034043219507047767318775160385"));
 
+    // Shared secret is encoded by fixed length bytes of j
+    size_t n = tersidh_shared_secret_size(&alice);
+    CHECK(n == fp2_nbytes() && n == tersidh_shared_secret_size(&bob));
+    unsigned char *ss_alice = malloc(n), *ss_bob = malloc(n);
+    tersidh_get_shared_secret(&alice, ss_alice);
+    tersidh_get_shared_secret(&bob, ss_bob);
+    CHECK(!memcmp(ss_alice, ss_bob, n));
+    fp2_t j;
+    fp2_init(&j);
+    CHECK(!fp2_from_bytes(j, ss_alice));
+    CHECK(fp2_equal(j, alice.j_inv));
+    fp2_clear(&j);
+    free(ss_alice);
+    free(ss_bob);
+
     tersidh_state_clear(&alice);
     tersidh_state_clear(&bob);
 
@@ -411,6 +440,68 @@ void test_tersidh_key_exchange() {
     tersidh_data_clear(&b_pk); 
 }
 
+void test_tersidh_data_pack() {
+    gmp_randstate_t rs;
+    gmp_randinit_mt(rs);
+    gmp_randseed_ui(rs, 0x9ac);
+
+    struct tersidh_data td, td2;
+    tersidh_data_init(&td);
+    tersidh_data_init(&td2);
+    fp2_t *elems[] = {&td.a, &td.xP, &td.xQ, &td.xR};
+
+    mpz_t x, y;
+    mpz_inits(x, y, NULL);
+    for (int i = 0; i < 4; i++) {
+        mpz_urandomm(x, rs, p);
+        mpz_urandomm(y, rs, p);
+        fp_set_mpz((*elems[i])->a, x);
+        fp_set_mpz((*elems[i])->b, y);
+    }
+    td.t = g_t;
+    td.f = g_f;
+
+    const size_t size = tersidh_data_packed_size();
+    CHECK(size == 8 + 8 * ((mpz_sizeinbase(p, 2) + 7) / 8));
+    unsigned char *buf = malloc(size);
+    tersidh_data_pack(buf, &td);
+    CHECK(!tersidh_data_unpack(&td2, buf));
+    CHECK(td2.t == g_t && td2.f == g_f);
+    CHECK(fp2_equal(td.a, td2.a) && fp2_equal(td.xP, td2.xP));
+    CHECK(fp2_equal(td.xQ, td2.xQ) && fp2_equal(td.xR, td2.xR));
+
+    // Both ends of the range [TERSIDH_TMIN, TERSIDH_TMAX] are accepted
+    td.t = TERSIDH_TMIN;
+    tersidh_data_pack(buf, &td);
+    CHECK(!tersidh_data_unpack(&td2, buf) && td2.t == TERSIDH_TMIN);
+    td.t = TERSIDH_TMAX;
+    tersidh_data_pack(buf, &td);
+    CHECK(!tersidh_data_unpack(&td2, buf) && td2.t == TERSIDH_TMAX);
+
+    // Parameter t out of the range, f zero and unreduced xR are rejected
+    const size_t n = fp2_nbytes();
+    td.t = TERSIDH_TMIN - 1;
+    tersidh_data_pack(buf, &td);
+    CHECK(tersidh_data_unpack(&td2, buf) == -1);
+    td.t = TERSIDH_TMAX + 1;
+    tersidh_data_pack(buf, &td);
+    CHECK(tersidh_data_unpack(&td2, buf) == -1);
+    td.t = g_t;
+    td.f = 0;
+    tersidh_data_pack(buf, &td);
+    CHECK(tersidh_data_unpack(&td2, buf) == -1);
+    td.f = g_f;
+    tersidh_data_pack(buf, &td);
+    memset(buf + 8 + 3 * n, 0xff, n / 2);
+    CHECK(tersidh_data_unpack(&td2, buf) == -1);
+
+    free(buf);
+    mpz_clears(x, y, NULL);
+    tersidh_data_clear(&td);
+    tersidh_data_clear(&td2);
+    gmp_randclear(rs);
+}
+
 int main() {
     init_test_variables();
 
@@ -425,6 +516,7 @@ int main() {
     setup_params_t15();
     TEST_RUN(test_tersidh_state_prepare());
     TEST_RUN(test_tersidh_key_exchange());
+    TEST_RUN_SILENT(test_tersidh_data_pack());
     
     clear_test_variables();
 